@@ -0,0 +1,655 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        ffvideo_bench.cpp
+// Purpose:     headless decode, convert & export throughput benchmark of ffvideolib
+///////////////////////////////////////////////////////////////////////////////
+
+// Plays each source through its own FFVideo instance, all at once and unpaced, so every stream decodes,
+// filters, converts to RGBA and optionally exports frames as fast as the machine allows. Reports, as JSON,
+// the frames per second of each stream and of all together, the process's CPU time & peak resident memory,
+// and the per stage latencies of FFVideo::GetPipelineStats(), so runs can be compared across library versions.
+//
+// A source is a media file, or "synthetic:" followed by a libavfilter video source such as testsrc2,
+// mandelbrot or smptehdbars, generated at the --size, --fps & --pix-fmt given, see FFVideo::OpenSyntheticSource().
+// Synthetic sources play at their frame rate, as a camera would, unless --unpaced. A source containing "://"
+// is an IP camera, which --record saves as a packet recording; "replay:" followed by a recording replays it
+// as that camera, at its recorded pace with the faults given, see FFVideo::OpenPacketReplay().
+//
+// usage: ffvideo_bench <source> [<source> ...] [options]
+//   --copies <n>            plays each source n times at once, default 1
+//   --frames <n>            stop each stream after n frames delivered, default 0 for the whole source
+//   --seconds <n>           stop every stream after n seconds, default 0 for no limit
+//   --interval <n>          frame interval, deliver every n'th frame, default 1
+//   --filter <graph>        post process filter graph, such as "scale=640:-1"
+//   --decoder-threads <n>   decoder threads per stream, default 0 for automatic
+//   --export-dir <dir>      export frames into dir, which must exist; each stream writes its own subdirectory
+//   --export-interval <n>   export every n'th frame, default 1 when exporting
+//   --export-format <f>     jpg, raw, npy, png or webp, default jpg
+//   --export-gray           raw, npy & png exports in gray rather than RGB
+//   --export-scale <s>      export scale, default 1.0
+//   --export-quality <q>    jpg & webp quality, default 80
+//   --export-archive        append exports into archive shards rather than a file each
+//   --writers <n>           export writer threads per stream, default 2
+//   --label <text>          copied into the report, such as the library version under test
+//   --json <file>           write the report to file rather than stdout
+//   --size <w>x<h>          synthetic sources' frame size, default 1920x1080
+//   --fps <r>               synthetic sources' frame rate, default 30
+//   --pix-fmt <f>           synthetic sources' pixel format, default yuv420p
+//   --counter               draws the frame number into synthetic sources' frames
+//   --font <file>           the frame number's font, default fontconfig's
+//   --unpaced               synthetic sources play as fast as they are consumed
+//   --record <dir>          records each stream's packets into dir, which must exist, as stream<n>.ffvp
+//   --read-timeout <s>      seconds a packet read may block before the stream dies, default the library's
+//   --replay-speed <x>      replays at x times the recorded pace, 0 for as fast as they decode, default 1
+//   --jitter-ms <n>         replayed packets arrive up to n ms late, at random
+//   --stall-every <s>       replays stall on average every s seconds
+//   --stall-ms <n>          for n ms
+//   --dropout-every <s>     replays lose packets on average every s seconds
+//   --dropout-ms <n>        for n ms
+//   --disconnect-after <s>  replays die s seconds in
+//   --replay-loop           replays start again at their end, rather than dying
+//   --seed <n>              the faults' random seed, default 1
+
+#include "ffvideo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX		// std::min & std::max, not the Windows macros
+#endif
+#include <Windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+typedef struct _BENCH_Params
+{
+	std::vector<std::string>			m_sources;
+	int32_t												m_copies = 1;
+	int32_t												m_frames = 0;
+	double												m_seconds = 0.0;
+	int32_t												m_interval = 1;
+	std::string										m_filter;
+	int32_t												m_decoder_threads = 0;
+	std::string										m_export_dir;
+	int32_t												m_export_interval = 1;
+	FFVIDEO_Export_Format					m_export_format;
+	float													m_export_scale = 1.0f;
+	int32_t												m_export_quality = 80;
+	bool													m_export_archive = false;
+	FFVIDEO_Export_Writer_Params	m_writers;
+	std::string										m_label;
+	std::string										m_json;
+	FFVIDEO_Synthetic_Source			m_synthetic;					// all but m_source, which is each source's own
+	std::string										m_record_dir;
+	float													m_read_timeout = -1.0f;
+	FFVIDEO_Replay_Faults					m_faults;
+} BENCH_Params;
+
+//------------------------------------------------------------------------------
+// the process's CPU time & peak resident memory:
+typedef struct _BENCH_Process_Usage
+{
+	double		m_user_s = 0.0;
+	double		m_system_s = 0.0;
+	uint64_t	m_peak_rss_bytes = 0;
+} BENCH_Process_Usage;
+
+
+//------------------------------------------------------------------------------
+// one stream of the benchmark, its FFVideo & what its callbacks counted:
+class BenchStream
+{
+public:
+	BenchStream() : mp_ffvideo(NULL), m_index(0), m_max_frames(0), m_delivered(0), m_exported(0),
+		m_finished(false), m_terminated(false), m_opened(false), m_replay(false), m_seconds(0.0) {};
+
+	static void FrameCallBack(void* p_object, FFVideo_Image& im, int32_t frame_num)
+	{
+		// frames after the stream's limit or the benchmark's end are not counted:
+		BenchStream* p_stream = (BenchStream*)p_object;
+		if (!p_stream || p_stream->m_finished)
+			return;
+
+		uint64_t delivered = ++p_stream->m_delivered;
+		if (p_stream->m_max_frames > 0 && delivered >= (uint64_t)p_stream->m_max_frames)
+			p_stream->Finish();
+	}
+
+	static void ExportCallBack(void* p_object, int32_t frame_num, int32_t export_num, const char* filepath, bool status)
+	{
+		BenchStream* p_stream = (BenchStream*)p_object;
+		if (p_stream && status)
+			p_stream->m_exported++;
+	}
+
+	static void FinishedCallBack(uint32_t frame_num, void* p_object)
+	{
+		BenchStream* p_stream = (BenchStream*)p_object;
+		if (p_stream)
+			p_stream->Finish();
+	}
+
+	static void TerminatedCallBack(void* p_object)
+	{
+		BenchStream* p_stream = (BenchStream*)p_object;
+		if (p_stream)
+		{
+			p_stream->m_terminated = true;
+			p_stream->Finish();
+		}
+	}
+
+	// the first caller stops the clock:
+	void Finish(void)
+	{
+		if (!m_finished.exchange(true))
+			m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+	FFVideo*															mp_ffvideo;
+	std::string														m_source;
+	int32_t																m_index;
+	int32_t																m_max_frames;
+	std::string														m_export_dir;
+
+	std::atomic<uint64_t>									m_delivered;
+	std::atomic<uint64_t>									m_exported;
+	std::atomic<bool>											m_finished;
+	std::atomic<bool>											m_terminated;		// the stream died, as a live stream does
+	bool																	m_opened;
+	bool																	m_replay;
+	std::chrono::steady_clock::time_point	m_start;
+	double																m_seconds;			// from open to finish
+
+	FFVIDEO_Pipeline_Stats								m_pipeline;
+	FFVIDEO_Throughput_Stats							m_throughput;
+	FFVIDEO_Replay_Stats									m_replay_stats;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void GetProcessUsage(BENCH_Process_Usage& usage)
+{
+#ifdef _WIN32
+	FILETIME created, exited, kernel, user;
+	if (GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user))
+	{
+		// 100 nanosecond units:
+		usage.m_user_s = (double)(((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime) / 1.0e7;
+		usage.m_system_s = (double)(((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) / 1.0e7;
+	}
+
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		usage.m_peak_rss_bytes = (uint64_t)counters.PeakWorkingSetSize;
+#else
+	struct rusage ru;
+	if (getrusage(RUSAGE_SELF, &ru) == 0)
+	{
+		usage.m_user_s = (double)ru.ru_utime.tv_sec + (double)ru.ru_utime.tv_usec / 1.0e6;
+		usage.m_system_s = (double)ru.ru_stime.tv_sec + (double)ru.ru_stime.tv_usec / 1.0e6;
+#ifdef __APPLE__
+		usage.m_peak_rss_bytes = (uint64_t)ru.ru_maxrss;					// bytes
+#else
+		usage.m_peak_rss_bytes = (uint64_t)ru.ru_maxrss * 1024;		// kilobytes
+#endif
+	}
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void Usage(void)
+{
+	printf("usage: ffvideo_bench <source> [<source> ...] [--copies <n>] [--frames <n>] [--seconds <n>] [--interval <n>]\n");
+	printf("                     [--filter <graph>] [--decoder-threads <n>] [--export-dir <dir>] [--export-interval <n>]\n");
+	printf("                     [--export-format <jpg|raw|npy|png|webp>] [--export-gray] [--export-scale <s>]\n");
+	printf("                     [--export-quality <q>] [--export-archive] [--writers <n>] [--label <text>] [--json <file>]\n");
+	printf("                     [--size <w>x<h>] [--fps <r>] [--pix-fmt <f>] [--counter] [--font <file>] [--unpaced]\n");
+	printf("                     [--record <dir>] [--read-timeout <s>] [--replay-speed <x>] [--jitter-ms <n>]\n");
+	printf("                     [--stall-every <s>] [--stall-ms <n>] [--dropout-every <s>] [--dropout-ms <n>]\n");
+	printf("                     [--disconnect-after <s>] [--replay-loop] [--seed <n>]\n");
+	printf("       a source is a media file, synthetic:<libavfilter source> such as synthetic:testsrc2,\n");
+	printf("       an IP camera url, or replay:<packet recording>\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static bool ParseArgs(int argc, char* argv[], BENCH_Params& params)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+
+		if (arg.compare(0, 2, "--") != 0)
+			params.m_sources.push_back(arg);
+		else if (arg == "--copies" && has_value)
+			params.m_copies = std::max(1, atoi(argv[++i]));
+		else if (arg == "--frames" && has_value)
+			params.m_frames = std::max(0, atoi(argv[++i]));
+		else if (arg == "--seconds" && has_value)
+			params.m_seconds = std::max(0.0, atof(argv[++i]));
+		else if (arg == "--interval" && has_value)
+			params.m_interval = std::max(1, atoi(argv[++i]));
+		else if (arg == "--filter" && has_value)
+			params.m_filter = argv[++i];
+		else if (arg == "--decoder-threads" && has_value)
+			params.m_decoder_threads = std::max(0, atoi(argv[++i]));
+		else if (arg == "--export-dir" && has_value)
+			params.m_export_dir = argv[++i];
+		else if (arg == "--export-interval" && has_value)
+			params.m_export_interval = std::max(1, atoi(argv[++i]));
+		else if (arg == "--export-format" && has_value)
+		{
+			std::string format = argv[++i];
+			if (format == "jpg")
+				params.m_export_format.m_format = 0;
+			else if (format == "raw")
+				params.m_export_format.m_format = 1;
+			else if (format == "npy")
+				params.m_export_format.m_format = 2;
+			else if (format == "png")
+				params.m_export_format.m_format = 3;
+			else if (format == "webp")
+				params.m_export_format.m_format = 4;
+			else
+			{
+				fprintf(stderr, "unknown export format '%s'\n", format.c_str());
+				return false;
+			}
+		}
+		else if (arg == "--export-gray")
+			params.m_export_format.m_channels = 1;
+		else if (arg == "--export-scale" && has_value)
+			params.m_export_scale = std::min(1.0f, std::max(0.01f, (float)atof(argv[++i])));
+		else if (arg == "--export-quality" && has_value)
+			params.m_export_quality = std::min(100, std::max(1, atoi(argv[++i])));
+		else if (arg == "--export-archive")
+			params.m_export_archive = true;
+		else if (arg == "--writers" && has_value)
+			params.m_writers.m_threads = std::max(0, atoi(argv[++i]));
+		else if (arg == "--label" && has_value)
+			params.m_label = argv[++i];
+		else if (arg == "--json" && has_value)
+			params.m_json = argv[++i];
+		else if (arg == "--size" && has_value)
+		{
+			if (sscanf(argv[++i], "%dx%d", &params.m_synthetic.m_width, &params.m_synthetic.m_height) != 2)
+			{
+				fprintf(stderr, "size '%s' is not <w>x<h>\n", argv[i]);
+				return false;
+			}
+		}
+		else if (arg == "--fps" && has_value)
+			params.m_synthetic.m_fps = atof(argv[++i]);
+		else if (arg == "--pix-fmt" && has_value)
+			params.m_synthetic.m_pixel_format = argv[++i];
+		else if (arg == "--counter")
+			params.m_synthetic.m_frame_counter = true;
+		else if (arg == "--font" && has_value)
+			params.m_synthetic.m_font_file = argv[++i];
+		else if (arg == "--unpaced")
+			params.m_synthetic.m_paced = false;
+		else if (arg == "--record" && has_value)
+			params.m_record_dir = argv[++i];
+		else if (arg == "--read-timeout" && has_value)
+			params.m_read_timeout = std::max(0.0f, (float)atof(argv[++i]));
+		else if (arg == "--replay-speed" && has_value)
+			params.m_faults.m_speed = std::max(0.0f, (float)atof(argv[++i]));
+		else if (arg == "--jitter-ms" && has_value)
+			params.m_faults.m_jitter_ms = std::max(0, atoi(argv[++i]));
+		else if (arg == "--stall-every" && has_value)
+			params.m_faults.m_stall_every_s = std::max(0.0f, (float)atof(argv[++i]));
+		else if (arg == "--stall-ms" && has_value)
+			params.m_faults.m_stall_ms = std::max(0, atoi(argv[++i]));
+		else if (arg == "--dropout-every" && has_value)
+			params.m_faults.m_dropout_every_s = std::max(0.0f, (float)atof(argv[++i]));
+		else if (arg == "--dropout-ms" && has_value)
+			params.m_faults.m_dropout_ms = std::max(0, atoi(argv[++i]));
+		else if (arg == "--disconnect-after" && has_value)
+			params.m_faults.m_disconnect_after_s = std::max(0.0f, (float)atof(argv[++i]));
+		else if (arg == "--replay-loop")
+			params.m_faults.m_loop = true;
+		else if (arg == "--seed" && has_value)
+			params.m_faults.m_seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+		else
+		{
+			fprintf(stderr, "unknown option '%s'\n", arg.c_str());
+			return false;
+		}
+	}
+
+	return params.m_sources.size() > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// sets up the stream's FFVideo & opens its source, playback begins at once:
+static bool OpenStream(BenchStream& stream, BENCH_Params& params)
+{
+	FFVideo* p_ffvideo = new FFVideo();
+	stream.mp_ffvideo = p_ffvideo;
+
+	p_ffvideo->Initialize(true, false);
+	p_ffvideo->SetUnpacedPlayback(true);
+	p_ffvideo->SetDecoderThreads(params.m_decoder_threads);
+	p_ffvideo->SetDisplayFrameCallback(BenchStream::FrameCallBack, &stream);
+	p_ffvideo->SetStreamFinishedCallBack(BenchStream::FinishedCallBack, &stream);
+	p_ffvideo->SetStreamTerminatedCallBack(BenchStream::TerminatedCallBack, &stream);
+
+	if (params.m_filter.length() > 0)
+		p_ffvideo->SetPostProcessFilter(params.m_filter);
+
+	if (params.m_read_timeout >= 0.0f)
+		p_ffvideo->SetReadTimeout(params.m_read_timeout);
+
+	if (params.m_export_dir.length() > 0)
+	{
+		// each stream exports into its own subdirectory, so names never collide:
+		std::filesystem::path dir = std::filesystem::path(params.m_export_dir) / ("stream" + std::to_string(stream.m_index));
+		std::error_code ec;
+		std::filesystem::create_directories(dir, ec);
+		stream.m_export_dir = dir.string();
+
+		std::string base = "bench";
+		if (!p_ffvideo->SetFrameExportFormat(params.m_export_format) ||
+				!p_ffvideo->SetFrameExportArchive(params.m_export_archive) ||
+				!p_ffvideo->SetFrameExportWriters(params.m_writers) ||
+				!p_ffvideo->SetFrameExportingParams(params.m_export_interval, stream.m_export_dir, base, params.m_export_scale,
+																						params.m_export_quality, BenchStream::ExportCallBack, &stream))
+		{
+			fprintf(stderr, "unable to export into '%s'\n", stream.m_export_dir.c_str());
+			return false;
+		}
+	}
+
+	stream.m_max_frames = params.m_frames;
+	stream.m_start = std::chrono::steady_clock::now();
+	const std::string synthetic_prefix = "synthetic:";
+	const std::string replay_prefix = "replay:";
+	if (stream.m_source.compare(0, replay_prefix.size(), replay_prefix) == 0)
+	{
+		stream.m_replay = true;
+		stream.m_opened = p_ffvideo->OpenPacketReplay(stream.m_source.substr(replay_prefix.size()), params.m_interval, &params.m_faults);
+	}
+	else if (stream.m_source.find("://") != std::string::npos)
+		stream.m_opened = p_ffvideo->OpenIPCamera(stream.m_source, params.m_interval);
+	else if (stream.m_source.compare(0, synthetic_prefix.size(), synthetic_prefix) == 0)
+	{
+		// generated streams end by themselves once they have made enough frames for --frames:
+		FFVIDEO_Synthetic_Source source = params.m_synthetic;
+		source.m_source = stream.m_source.substr(synthetic_prefix.size());
+		source.m_frames = (int64_t)params.m_frames * params.m_interval;
+		stream.m_opened = p_ffvideo->OpenSyntheticSource(source, params.m_interval);
+	}
+	else stream.m_opened = p_ffvideo->OpenMediaFile(stream.m_source, params.m_interval, false);
+	if (!stream.m_opened)
+	{
+		fprintf(stderr, "unable to open '%s'\n", stream.m_source.c_str());
+		stream.Finish();
+	}
+	else if (params.m_record_dir.length() > 0)
+	{
+		std::filesystem::path path = std::filesystem::path(params.m_record_dir) / ("stream" + std::to_string(stream.m_index) + ".ffvp");
+		if (!p_ffvideo->StartPacketRecording(path.string()))
+			fprintf(stderr, "unable to record into '%s'\n", path.string().c_str());
+	}
+
+	return stream.m_opened;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// the stats are taken before the stream is killed, so they cover the stream's whole run:
+static void KillStream(BenchStream& stream)
+{
+	FFVideo* p_ffvideo = stream.mp_ffvideo;
+	if (!p_ffvideo)
+		return;
+
+	stream.Finish();
+
+	p_ffvideo->GetPipelineStats(stream.m_pipeline);
+	p_ffvideo->GetThroughputStats(stream.m_throughput);
+	p_ffvideo->GetReplayStats(stream.m_replay_stats);
+
+	p_ffvideo->KillStream();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void DeleteStream(BenchStream& stream)
+{
+	FFVideo* p_ffvideo = stream.mp_ffvideo;
+	if (!p_ffvideo)
+		return;
+
+	p_ffvideo->SetDisplayFrameCallback(NULL, NULL);
+	p_ffvideo->SetStreamFinishedCallBack(NULL, NULL);
+	p_ffvideo->SetStreamTerminatedCallBack(NULL, NULL);
+	delete p_ffvideo;
+	stream.mp_ffvideo = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static std::string JSONString(const std::string& s)
+{
+	std::string out = "\"";
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		char c = s[i];
+		if (c == '"' || c == '\\')
+		{
+			out += '\\';
+			out += c;
+		}
+		else if ((unsigned char)c < 0x20)
+		{
+			char buf[8];
+			snprintf(buf, sizeof(buf), "\\u%04x", (unsigned)(unsigned char)c);
+			out += buf;
+		}
+		else out += c;
+	}
+	return out + "\"";
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void WriteStages(FILE* fp, const FFVIDEO_Stage_Stats* p_stages, const char* indent)
+{
+	fprintf(fp, "{");
+	for (int32_t i = 0; i < (int32_t)FFVIDEO_PIPELINE_STAGE::COUNT; i++)
+	{
+		const FFVIDEO_Stage_Stats& stage = p_stages[i];
+		fprintf(fp, "%s\n%s  \"%s\": {\"count\": %llu, \"mean_us\": %.1f, \"p50_us\": %llu, \"p95_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu}",
+						(i) ? "," : "", indent, FFVideo_PipelineStats::StageName((FFVIDEO_PIPELINE_STAGE)i),
+						(unsigned long long)stage.m_count, stage.m_mean, (unsigned long long)stage.m_p50, (unsigned long long)stage.m_p95,
+						(unsigned long long)stage.m_p99, (unsigned long long)stage.m_max);
+	}
+	fprintf(fp, "\n%s}", indent);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// every stream's stage histograms merged, so percentiles are of all frames rather than averaged:
+static void MergeStages(std::vector<BenchStream*>& streams, FFVIDEO_Stage_Stats* p_stages)
+{
+	for (int32_t i = 0; i < (int32_t)FFVIDEO_PIPELINE_STAGE::COUNT; i++)
+	{
+		FFVIDEO_Stage_Stats& stage = p_stages[i];
+		for (size_t s = 0; s < streams.size(); s++)
+			stage.m_hist.Merge(streams[s]->m_pipeline.m_stages[i].m_hist);
+
+		stage.m_count = stage.m_hist.m_count;
+		stage.m_mean = stage.m_hist.Mean();
+		stage.m_p50 = stage.m_hist.Percentile(0.50);
+		stage.m_p95 = stage.m_hist.Percentile(0.95);
+		stage.m_p99 = stage.m_hist.Percentile(0.99);
+		stage.m_max = stage.m_hist.m_max_us;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void Report(FILE* fp, std::vector<BenchStream*>& streams, BENCH_Params& params, const std::string& version,
+									 double wall_s, BENCH_Process_Usage& usage)
+{
+	uint64_t delivered(0), decoded(0), exported(0), dropped(0);
+	for (size_t s = 0; s < streams.size(); s++)
+	{
+		BenchStream& stream = *streams[s];
+		delivered += stream.m_delivered;
+		exported += stream.m_exported;
+		decoded += stream.m_throughput.m_rates[(int32_t)FFVIDEO_RATE::DECODED].m_total;
+		for (int32_t d = 0; d < (int32_t)FFVIDEO_DROP::COUNT; d++)
+		{
+			if (d != (int32_t)FFVIDEO_DROP::FRAME_INTERVAL)
+				dropped += stream.m_throughput.m_drops[d].m_total;
+		}
+	}
+
+	FFVIDEO_Stage_Stats stages[(int32_t)FFVIDEO_PIPELINE_STAGE::COUNT];
+	MergeStages(streams, stages);
+
+	double cpu_s = usage.m_user_s + usage.m_system_s;
+
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"label\": %s,\n", JSONString(params.m_label).c_str());
+	fprintf(fp, "  \"library\": %s,\n", JSONString(version).c_str());
+	fprintf(fp, "  \"config\": {\"streams\": %d, \"copies\": %d, \"frames\": %d, \"seconds\": %.1f, \"interval\": %d, \"filter\": %s, "
+							"\"decoder_threads\": %d, \"export\": %s, \"export_interval\": %d, \"export_format\": %d, \"export_channels\": %d, "
+							"\"export_scale\": %.3f, \"export_quality\": %d, \"export_archive\": %s, \"writers\": %d, \"hardware_threads\": %u},\n",
+					(int32_t)streams.size(), params.m_copies, params.m_frames, params.m_seconds, params.m_interval, JSONString(params.m_filter).c_str(),
+					params.m_decoder_threads, (params.m_export_dir.length() > 0) ? "true" : "false", params.m_export_interval,
+					params.m_export_format.m_format, params.m_export_format.m_channels, params.m_export_scale, params.m_export_quality,
+					params.m_export_archive ? "true" : "false", params.m_writers.m_threads, std::thread::hardware_concurrency());
+	fprintf(fp, "  \"wall_s\": %.3f,\n", wall_s);
+	fprintf(fp, "  \"cpu_user_s\": %.3f,\n", usage.m_user_s);
+	fprintf(fp, "  \"cpu_system_s\": %.3f,\n", usage.m_system_s);
+	fprintf(fp, "  \"cpu_utilization\": %.3f,\n", (wall_s > 0.0) ? cpu_s / wall_s : 0.0);
+	fprintf(fp, "  \"peak_rss_bytes\": %llu,\n", (unsigned long long)usage.m_peak_rss_bytes);
+	fprintf(fp, "  \"frames_decoded\": %llu,\n", (unsigned long long)decoded);
+	fprintf(fp, "  \"frames_delivered\": %llu,\n", (unsigned long long)delivered);
+	fprintf(fp, "  \"frames_exported\": %llu,\n", (unsigned long long)exported);
+	fprintf(fp, "  \"frames_dropped\": %llu,\n", (unsigned long long)dropped);
+	fprintf(fp, "  \"fps\": %.2f,\n", (wall_s > 0.0) ? (double)delivered / wall_s : 0.0);
+	fprintf(fp, "  \"cpu_ms_per_frame\": %.3f,\n", (delivered) ? cpu_s * 1000.0 / (double)delivered : 0.0);
+	fprintf(fp, "  \"stages\": ");
+	WriteStages(fp, stages, "  ");
+	fprintf(fp, ",\n  \"streams\": [");
+
+	for (size_t s = 0; s < streams.size(); s++)
+	{
+		BenchStream& stream = *streams[s];
+		FFVIDEO_Throughput_Stats& t = stream.m_throughput;
+
+		fprintf(fp, "%s\n    {\"source\": %s, \"opened\": %s, \"seconds\": %.3f, \"fps\": %.2f, \"delivered\": %llu, \"exported\": %llu,\n",
+						(s) ? "," : "", JSONString(stream.m_source).c_str(), stream.m_opened ? "true" : "false", stream.m_seconds,
+						(stream.m_seconds > 0.0) ? (double)stream.m_delivered / stream.m_seconds : 0.0,
+						(unsigned long long)stream.m_delivered, (unsigned long long)stream.m_exported);
+
+		fprintf(fp, "     \"totals\": {");
+		for (int32_t r = 0; r < (int32_t)FFVIDEO_RATE::COUNT; r++)
+			fprintf(fp, "%s\"%s\": %llu", (r) ? ", " : "", t.m_rates[r].m_name, (unsigned long long)t.m_rates[r].m_total);
+		fprintf(fp, "},\n     \"drops\": {");
+		for (int32_t d = 0; d < (int32_t)FFVIDEO_DROP::COUNT; d++)
+			fprintf(fp, "%s\"%s\": %llu", (d) ? ", " : "", t.m_drops[d].m_name, (unsigned long long)t.m_drops[d].m_total);
+		fprintf(fp, "},\n     \"terminated\": %s,", stream.m_terminated ? "true" : "false");
+		if (stream.m_replay)
+		{
+			FFVIDEO_Replay_Stats& r = stream.m_replay_stats;
+			fprintf(fp, "\n     \"replay\": {\"packets\": %llu, \"dropped\": %llu, \"stalls\": %llu, \"loops\": %llu, \"max_late_us\": %lld},",
+							(unsigned long long)r.m_packets, (unsigned long long)r.m_dropped, (unsigned long long)r.m_stalls,
+							(unsigned long long)r.m_loops, (long long)r.m_max_late_us);
+		}
+		fprintf(fp, "\n     \"stages\": ");
+		WriteStages(fp, stream.m_pipeline.m_stages, "     ");
+		fprintf(fp, "}");
+	}
+	fprintf(fp, "\n  ]\n}\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	BENCH_Params params;
+	if (!ParseArgs(argc, argv, params))
+	{
+		Usage();
+		return 1;
+	}
+
+	std::vector<BenchStream*> streams;
+	for (int32_t c = 0; c < params.m_copies; c++)
+	{
+		for (size_t i = 0; i < params.m_sources.size(); i++)
+		{
+			BenchStream* p_stream = new BenchStream();
+			p_stream->m_source = params.m_sources[i];
+			p_stream->m_index = (int32_t)streams.size();
+			streams.push_back(p_stream);
+		}
+	}
+
+	// every stream opens before any is waited on, so they all play at once:
+	auto start = std::chrono::steady_clock::now();
+	int32_t opened = 0;
+	for (size_t s = 0; s < streams.size(); s++)
+	{
+		if (OpenStream(*streams[s], params))
+			opened++;
+	}
+
+	while (opened > 0)
+	{
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(10ms);
+
+		bool all_finished = true;
+		for (size_t s = 0; s < streams.size(); s++)
+			all_finished = all_finished && streams[s]->m_finished;
+		if (all_finished)
+			break;
+
+		if (params.m_seconds > 0.0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= params.m_seconds)
+			break;
+	}
+	for (size_t s = 0; s < streams.size(); s++)
+		streams[s]->Finish();
+	double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// taken before the streams close, so teardown is not counted:
+	BENCH_Process_Usage usage;
+	GetProcessUsage(usage);
+
+	// the library version is read while the first FFVideo is still there:
+	std::string version = streams[0]->mp_ffvideo->GetVersion();
+	for (size_t s = 0; s < streams.size(); s++)
+		KillStream(*streams[s]);
+	{
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(500ms);
+	}
+	for (size_t s = 0; s < streams.size(); s++)
+		DeleteStream(*streams[s]);
+
+	FILE* fp = stdout;
+	if (params.m_json.length() > 0)
+	{
+		fp = fopen(params.m_json.c_str(), "w");
+		if (!fp)
+		{
+			fprintf(stderr, "unable to create '%s'\n", params.m_json.c_str());
+			return 1;
+		}
+	}
+	Report(fp, streams, params, version, wall_s, usage);
+	if (fp != stdout)
+		fclose(fp);
+
+	for (size_t s = 0; s < streams.size(); s++)
+		delete streams[s];
+
+	return (opened == (int32_t)streams.size()) ? 0 : 1;
+}
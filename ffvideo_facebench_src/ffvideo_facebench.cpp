@@ -0,0 +1,535 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        ffvideo_facebench.cpp
+// Purpose:     headless face detection benchmark over a directory of media files
+///////////////////////////////////////////////////////////////////////////////
+
+// Decodes frames from each media file of a directory with ffvideolib, then runs them through
+// FaceDetector stage by stage, and through a FaceDetectionThreadMgr as the player does, at each
+// face detection scale. Reports throughput, per-frame latency percentiles, the share of time in
+// each detection stage, and how well the face counts of each scale agree with the largest scale.
+//
+// usage: ffvideo_facebench <media_dir> [options]
+//   --data <dir>        where the face models are, default the executable's directory
+//   --frames <n>        frames decoded per file, default 100
+//   --max-mb <n>        the decoded frames of all files together, default 2048 MB; later files are skipped
+//   --interval <n>      decode every n'th frame, default 1
+//   --scales <a,b,..>   face detection scales, default 0.25,0.35,0.5
+//   --workers <n>       FaceDetectionThreadMgr workers, default 0 for automatic
+//   --model <68|81>     face landmarks model, default 68
+//   --no-landmarks      detection only
+//   --no-chips          no face images
+
+#include "FaceDetect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <filesystem>
+
+
+//------------------------------------------------------------------------------
+typedef struct _FACEBENCH_Params
+{
+	std::string					m_media_dir;
+	std::string					m_data_dir;
+	int32_t							m_frames = 100;
+	uint64_t						m_max_bytes = 2048ull * 1024 * 1024;	// every frame is held decoded while timed
+	int32_t							m_interval = 1;
+	std::vector<float>	m_scales = { 0.25f, 0.35f, 0.5f };
+	int32_t							m_workers = 0;
+	FACE_MODEL					m_model = FACE_MODEL::sixtyeight;
+	bool								m_landmarks = true;
+	bool								m_chips = true;
+} FACEBENCH_Params;
+
+//------------------------------------------------------------------------------
+// one frame through FaceDetector, milliseconds per stage:
+typedef struct _FACEBENCH_Frame_Times
+{
+	double			m_set_image = 0.0;
+	double			m_face_boxes = 0.0;
+	double			m_landmarks = 0.0;
+	double			m_chips = 0.0;
+	int32_t			m_faces = 0;
+} FACEBENCH_Frame_Times;
+
+//------------------------------------------------------------------------------
+// the results of one detection scale over every frame:
+typedef struct _FACEBENCH_Scale_Results
+{
+	float															m_scale = 0.0f;
+	std::vector<FACEBENCH_Frame_Times>	m_frames;					// in decode order across every file
+	std::vector<double>								m_pipeline_ms;		// FaceDetectionThreadMgr, Add() to delivery
+	double														m_pipeline_fps = 0.0;
+	uint64_t													m_pipeline_dropped = 0;
+} FACEBENCH_Scale_Results;
+
+
+//------------------------------------------------------------------------------
+// collects the first frames played from a media file:
+class FrameCollector
+{
+public:
+	FrameCollector() : m_max_frames(0), m_max_bytes(0), m_bytes(0), m_finished(false), m_full(false), m_over_budget(false) {};
+
+	static void FrameCallBack(void* p_object, FFVideo_Image& im, int32_t frame_num)
+	{
+		FrameCollector* p_collector = (FrameCollector*)p_object;
+		if (!p_collector || p_collector->m_full)
+			return;
+
+		std::lock_guard<std::mutex> lock(p_collector->m_lock);
+		if (p_collector->m_bytes + im.Size() > p_collector->m_max_bytes)
+		{
+			p_collector->m_over_budget = true;
+			p_collector->m_full = true;
+			return;
+		}
+		p_collector->m_bytes += im.Size();
+		p_collector->m_frames.push_back(FFVideo_Image());
+		p_collector->m_frames.back().Clone(im);
+		if ((int32_t)p_collector->m_frames.size() >= p_collector->m_max_frames)
+			p_collector->m_full = true;
+	}
+
+	static void FinishedCallBack(uint32_t frame_num, void* p_object)
+	{
+		FrameCollector* p_collector = (FrameCollector*)p_object;
+		if (p_collector)
+			p_collector->m_finished = true;
+	}
+
+	size_t Size(void)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		return m_frames.size();
+	}
+
+	std::mutex									m_lock;
+	std::vector<FFVideo_Image>	m_frames;
+	int32_t											m_max_frames;
+	uint64_t										m_max_bytes;
+	uint64_t										m_bytes;
+	std::atomic<bool>						m_finished;
+	std::atomic<bool>						m_full;
+	std::atomic<bool>						m_over_budget;		// a frame would have exceeded m_max_bytes
+};
+
+//------------------------------------------------------------------------------
+// counts FaceDetectionThreadMgr deliveries & their latency from Add():
+class PipelineMonitor
+{
+public:
+	PipelineMonitor() : m_delivered(0) {};
+
+	static void FaceDetectionCallBack(void* p_object, FaceDetectionFrame& fdf)
+	{
+		PipelineMonitor* p_monitor = (PipelineMonitor*)p_object;
+		if (!p_monitor)
+			return;
+
+		auto now = std::chrono::steady_clock::now();
+		if (fdf.m_frame_num >= 0 && fdf.m_frame_num < (int32_t)p_monitor->m_added.size())
+		{
+			std::lock_guard<std::mutex> lock(p_monitor->m_lock);
+			p_monitor->m_latency_ms.push_back(std::chrono::duration<double, std::milli>(now - p_monitor->m_added[fdf.m_frame_num]).count());
+		}
+		p_monitor->m_delivered++;
+	}
+
+	std::vector<std::chrono::steady_clock::time_point>	m_added;				// by frame number, set before Add()
+	std::mutex																					m_lock;
+	std::vector<double>																	m_latency_ms;
+	std::atomic<uint64_t>																m_delivered;
+};
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+static double ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// p of 0.0 to 1.0, nearest rank:
+static double Percentile(std::vector<double> values, double p)
+{
+	if (values.size() < 1)
+		return 0.0;
+
+	std::sort(values.begin(), values.end());
+	size_t rank = (size_t)(p * (double)values.size() + 0.5);
+	rank = std::max((size_t)1, std::min(rank, values.size()));
+
+	return values[rank - 1];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void Usage(void)
+{
+	printf("usage: ffvideo_facebench <media_dir> [--data <dir>] [--frames <n>] [--max-mb <n>] [--interval <n>]\n");
+	printf("                         [--scales <a,b,..>] [--workers <n>] [--model <68|81>] [--no-landmarks] [--no-chips]\n");
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static bool ParseArgs(int argc, char* argv[], FACEBENCH_Params& params)
+{
+	if (argc < 2)
+		return false;
+
+	params.m_media_dir = argv[1];
+	params.m_data_dir = std::filesystem::absolute(argv[0]).parent_path().string();
+
+	for (int i = 2; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+
+		if (arg == "--data" && has_value)
+			params.m_data_dir = argv[++i];
+		else if (arg == "--frames" && has_value)
+			params.m_frames = std::max(1, atoi(argv[++i]));
+		else if (arg == "--max-mb" && has_value)
+			params.m_max_bytes = (uint64_t)std::max(1, atoi(argv[++i])) * 1024 * 1024;
+		else if (arg == "--interval" && has_value)
+			params.m_interval = std::max(1, atoi(argv[++i]));
+		else if (arg == "--workers" && has_value)
+			params.m_workers = std::max(0, atoi(argv[++i]));
+		else if (arg == "--model" && has_value)
+			params.m_model = (atoi(argv[++i]) == 81) ? FACE_MODEL::eightyone : FACE_MODEL::sixtyeight;
+		else if (arg == "--scales" && has_value)
+		{
+			params.m_scales.clear();
+			std::string list = argv[++i];
+			size_t start = 0;
+			while (start < list.size())
+			{
+				size_t comma = list.find(',', start);
+				if (comma == std::string::npos)
+					comma = list.size();
+				float scale = (float)atof(list.substr(start, comma - start).c_str());
+				if (scale > 0.0f)
+					params.m_scales.push_back(scale);
+				start = comma + 1;
+			}
+			if (params.m_scales.size() < 1)
+				return false;
+		}
+		else if (arg == "--no-landmarks")
+			params.m_landmarks = false;
+		else if (arg == "--no-chips")
+			params.m_chips = false;
+		else
+		{
+			printf("unknown option '%s'\n", arg.c_str());
+			return false;
+		}
+	}
+
+	// chips are made from the landmarks:
+	if (!params.m_landmarks)
+		params.m_chips = false;
+
+	std::sort(params.m_scales.begin(), params.m_scales.end());
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static bool IsMediaFile(const std::filesystem::path& path)
+{
+	static const char* extensions[] = { ".mp4", ".m4v", ".mov", ".mkv", ".webm", ".avi", ".wmv", ".flv", ".ts", ".mts", ".mpg", ".mpeg", ".264", ".h264" };
+
+	std::string ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)tolower(c); });
+
+	for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+	{
+		if (ext == extensions[i])
+			return true;
+	}
+	return false;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// plays the file until frames are collected or it ends; playback is paced by the file's frame rate,
+// which is why frames are decoded first and detection is timed separately:
+// decodes into at most max_bytes, leaving budget_used true if a frame did not fit:
+static bool DecodeFrames(const std::string& fname, FACEBENCH_Params& params, uint64_t max_bytes, std::vector<FFVideo_Image>& frames, 
+												 uint64_t& bytes, bool& budget_used)
+{
+	FrameCollector collector;
+	collector.m_max_frames = params.m_frames;
+	collector.m_max_bytes = max_bytes;
+
+	FFVideo* p_ffvideo = new FFVideo();
+	p_ffvideo->Initialize(true, false);
+	p_ffvideo->SetDisplayFrameCallback(FrameCollector::FrameCallBack, &collector);
+	p_ffvideo->SetStreamFinishedCallBack(FrameCollector::FinishedCallBack, &collector);
+
+	bool status = p_ffvideo->OpenMediaFile(fname, params.m_interval, false);
+	if (status)
+	{
+		// gives up on a file that stops delivering frames:
+		const double stall_ms = 10000.0;
+
+		size_t collected = 0;
+		auto last_frame = std::chrono::steady_clock::now();
+		while (!collector.m_full && !collector.m_finished)
+		{
+			using namespace std::chrono_literals;
+			std::this_thread::sleep_for(20ms);
+
+			size_t size = collector.Size();
+			if (size != collected)
+			{
+				collected = size;
+				last_frame = std::chrono::steady_clock::now();
+			}
+			else if (ElapsedMs(last_frame) > stall_ms)
+				break;
+		}
+		collector.m_full = true;
+	}
+
+	p_ffvideo->KillStream();
+	{
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(500ms);
+	}
+	p_ffvideo->SetDisplayFrameCallback(NULL, NULL);
+	p_ffvideo->SetStreamFinishedCallBack(NULL, NULL);
+	delete p_ffvideo;
+
+	std::lock_guard<std::mutex> lock(collector.m_lock);
+	for (size_t i = 0; i < collector.m_frames.size(); i++)
+	{
+		frames.push_back(FFVideo_Image());
+		frames.back().Swap(collector.m_frames[i]);
+	}
+	bytes = collector.m_bytes;
+	budget_used = collector.m_over_budget;
+
+	return status && collector.m_frames.size() > 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// each stage of FaceDetector, on this thread, frame by frame:
+static void RunStages(FaceDetector& detector, std::vector<FFVideo_Image>& frames, FACEBENCH_Params& params, FACEBENCH_Scale_Results& results)
+{
+	std::vector<dlib::rectangle>						detections;
+	std::vector<dlib::full_object_detection>	landmarks;
+	std::vector<FFVideo_Image>							face_images;
+
+	for (size_t f = 0; f < frames.size(); f++)
+	{
+		FACEBENCH_Frame_Times times;
+
+		auto start = std::chrono::steady_clock::now();
+		detector.SetImage(frames[f], results.m_scale);
+		times.m_set_image = ElapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		detector.GetFaceBoxes(detections);
+		times.m_face_boxes = ElapsedMs(start);
+		times.m_faces = (int32_t)detections.size();
+
+		if (params.m_landmarks)
+		{
+			start = std::chrono::steady_clock::now();
+			detector.GetFaceLandmarkSets(detections, landmarks);
+			times.m_landmarks = ElapsedMs(start);
+		}
+
+		if (params.m_chips)
+		{
+			start = std::chrono::steady_clock::now();
+			detector.GetFaceImages(detections, landmarks, face_images, true);
+			times.m_chips = ElapsedMs(start);
+		}
+
+		results.m_frames.push_back(times);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// the player's threaded pipeline, fed as fast as the workers take frames:
+static bool RunPipeline(std::vector<FFVideo_Image>& frames, FACEBENCH_Params& params, FACEBENCH_Scale_Results& results)
+{
+	PipelineMonitor monitor;
+	monitor.m_added.resize(frames.size());
+
+	FaceDetectionThreadMgr mgr(params.m_data_dir);
+	mgr.mp_frame_cb     = PipelineMonitor::FaceDetectionCallBack;
+	mgr.mp_frame_object = &monitor;
+	mgr.SetFaceModel(params.m_model);
+	mgr.SetWorkers(params.m_workers, FACE_DROP_POLICY::fifo);
+	mgr.SetFaceDetectionScale(results.m_scale);
+	mgr.m_faceDetectorEnabled    = true;
+	mgr.m_faceFeaturesEnabled    = params.m_landmarks;
+	mgr.m_faceImagesEnabled      = params.m_chips;
+	mgr.m_faceImagesStandardized = true;
+	mgr.StartFaceDetectionThread();
+
+	// the models load in the background, the clock starts once a detector is ready:
+	while (!mgr.m_faceDetectorInitialized && mgr.IsRunning())
+	{
+		using namespace std::chrono_literals;
+		std::this_thread::sleep_for(20ms);
+	}
+	if (!mgr.m_faceDetectorInitialized)
+		return false;
+
+	auto start = std::chrono::steady_clock::now();
+	for (size_t f = 0; f < frames.size(); f++)
+	{
+		// fifo drops a frame added to a full queue, so wait for room rather than drop:
+		while (mgr.Size() >= (size_t)mgr.m_max_queue)
+			FFVideo_Sleep100ns(1);
+
+		monitor.m_added[f] = std::chrono::steady_clock::now();
+		mgr.Add(frames[f], (int32_t)f);
+	}
+	while (monitor.m_delivered + mgr.GetDroppedCount() < frames.size())
+		FFVideo_Sleep100ns(10);
+	double ms = ElapsedMs(start);
+
+	mgr.StopFaceDetectionThread();
+
+	results.m_pipeline_fps = (ms > 0.0) ? (double)monitor.m_delivered * 1000.0 / ms : 0.0;
+	results.m_pipeline_dropped = mgr.GetDroppedCount();
+	results.m_pipeline_ms = monitor.m_latency_ms;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void Report(std::vector<FACEBENCH_Scale_Results>& all_results, FACEBENCH_Params& params)
+{
+	printf("\n%-6s %9s %9s %9s %9s | %7s %7s %7s %7s | %9s %9s %9s %9s %7s\n",
+				 "scale", "fps", "p50 ms", "p95 ms", "p99 ms", "set%", "boxes%", "marks%", "chips%",
+				 "pipe fps", "pipe p50", "pipe p95", "pipe p99", "drops");
+
+	for (size_t s = 0; s < all_results.size(); s++)
+	{
+		FACEBENCH_Scale_Results& r = all_results[s];
+
+		std::vector<double> frame_ms;
+		double set_ms(0.0), boxes_ms(0.0), marks_ms(0.0), chips_ms(0.0);
+		for (size_t f = 0; f < r.m_frames.size(); f++)
+		{
+			FACEBENCH_Frame_Times& t = r.m_frames[f];
+			frame_ms.push_back(t.m_set_image + t.m_face_boxes + t.m_landmarks + t.m_chips);
+			set_ms   += t.m_set_image;
+			boxes_ms += t.m_face_boxes;
+			marks_ms += t.m_landmarks;
+			chips_ms += t.m_chips;
+		}
+		double total_ms = set_ms + boxes_ms + marks_ms + chips_ms;
+		double pct = (total_ms > 0.0) ? 100.0 / total_ms : 0.0;
+
+		printf("%-6.3f %9.1f %9.2f %9.2f %9.2f | %7.1f %7.1f %7.1f %7.1f | %9.1f %9.2f %9.2f %9.2f %7llu\n",
+					 r.m_scale, (total_ms > 0.0) ? (double)frame_ms.size() * 1000.0 / total_ms : 0.0,
+					 Percentile(frame_ms, 0.50), Percentile(frame_ms, 0.95), Percentile(frame_ms, 0.99),
+					 set_ms * pct, boxes_ms * pct, marks_ms * pct, chips_ms * pct,
+					 r.m_pipeline_fps, Percentile(r.m_pipeline_ms, 0.50), Percentile(r.m_pipeline_ms, 0.95), Percentile(r.m_pipeline_ms, 0.99),
+					 (unsigned long long)r.m_pipeline_dropped);
+	}
+
+	// face counts against the largest scale, the closest to ground truth available here:
+	FACEBENCH_Scale_Results& reference = all_results.back();
+
+	printf("\nface counts against scale %.3f:\n", reference.m_scale);
+	printf("%-6s %9s %9s %9s %9s\n", "scale", "faces", "agree%", "missed", "extra");
+
+	for (size_t s = 0; s < all_results.size(); s++)
+	{
+		FACEBENCH_Scale_Results& r = all_results[s];
+
+		uint64_t faces(0), agree(0), missed(0), extra(0);
+		for (size_t f = 0; f < r.m_frames.size() && f < reference.m_frames.size(); f++)
+		{
+			int32_t count = r.m_frames[f].m_faces;
+			int32_t ref_count = reference.m_frames[f].m_faces;
+			faces += count;
+			if (count == ref_count)
+				agree++;
+			else if (count < ref_count)
+				missed += ref_count - count;
+			else extra += count - ref_count;
+		}
+
+		printf("%-6.3f %9llu %9.1f %9llu %9llu\n", r.m_scale, (unsigned long long)faces,
+					 (r.m_frames.size()) ? 100.0 * (double)agree / (double)r.m_frames.size() : 0.0,
+					 (unsigned long long)missed, (unsigned long long)extra);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char* argv[])
+{
+	FACEBENCH_Params params;
+	if (!ParseArgs(argc, argv, params))
+	{
+		Usage();
+		return 1;
+	}
+
+	std::error_code ec;
+	std::vector<std::string> media_files;
+	for (auto& entry : std::filesystem::directory_iterator(params.m_media_dir, ec))
+	{
+		if (entry.is_regular_file() && IsMediaFile(entry.path()))
+			media_files.push_back(entry.path().string());
+	}
+	std::sort(media_files.begin(), media_files.end());
+	if (media_files.size() < 1)
+	{
+		printf("no media files found in '%s'\n", params.m_media_dir.c_str());
+		return 1;
+	}
+
+	// every frame is held decoded through each scale, so the files together decode into --max-mb:
+	std::vector<FFVideo_Image> frames;
+	uint64_t frame_bytes = 0;
+	size_t files_used = 0;
+	bool budget_used = false;
+	for (size_t i = 0; i < media_files.size() && !budget_used; i++)
+	{
+		size_t before = frames.size();
+		uint64_t bytes = 0;
+		if (!DecodeFrames(media_files[i], params, params.m_max_bytes - frame_bytes, frames, bytes, budget_used))
+			printf("unable to decode '%s'\n", media_files[i].c_str());
+		else printf("%s: %d frames\n", media_files[i].c_str(), (int32_t)(frames.size() - before));
+		frame_bytes += bytes;
+		files_used = i + 1;
+	}
+	if (budget_used)
+		printf("decoded frames reached --max-mb %llu after %d of %d files, the rest are not benchmarked\n",
+					 (unsigned long long)(params.m_max_bytes / (1024 * 1024)), (int32_t)files_used, (int32_t)media_files.size());
+	if (frames.size() < 1)
+		return 1;
+
+	FaceDetector detector(params.m_data_dir, params.m_model);
+	if (!detector.IsLoaded())
+	{
+		printf("unable to load the face models from '%s'\n", params.m_data_dir.c_str());
+		return 1;
+	}
+
+	std::vector<FACEBENCH_Scale_Results> all_results(params.m_scales.size());
+	for (size_t s = 0; s < params.m_scales.size(); s++)
+	{
+		all_results[s].m_scale = params.m_scales[s];
+
+		printf("scale %.3f...\n", params.m_scales[s]);
+		RunStages(detector, frames, params, all_results[s]);
+		if (!RunPipeline(frames, params, all_results[s]))
+			printf("  the detection pipeline did not start\n");
+	}
+
+	printf("\n%d frames (%.0f MB) from %d files, %s landmarks, %s face images\n", (int32_t)frames.size(), (double)frame_bytes / (1024.0 * 1024.0), (int32_t)files_used,
+				 params.m_landmarks ? "with" : "no", params.m_chips ? "with" : "no");
+	Report(all_results, params);
+
+	return 0;
+}
@@ -0,0 +1,412 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        FaceChipExport.cpp
+// Author:			Blake Senftner
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "FaceChipExport.h"
+
+#include <boost/filesystem.hpp>
+
+
+using namespace dlib;
+
+////////////////////////////////////////////////////////////////////////
+bool FaceChipExporter::Start( FACE_CHIP_EXPORT_PARAMS& params )
+{
+	Stop();
+
+	m_params = params;
+	if (m_params.m_threads < 1)
+		m_params.m_threads = 1;
+	if (m_params.m_max_queue < 1)
+		m_params.m_max_queue = 1;
+	if (m_params.m_dir.size() > 0 && m_params.m_dir.back() != '\\' && m_params.m_dir.back() != '/')
+		m_params.m_dir += FFVIDEO_PATH_SEPARATOR;
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories( boost::filesystem::path( m_params.m_dir ), ec );
+	if (!boost::filesystem::is_directory( boost::filesystem::path( m_params.m_dir ), ec ))
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceChipExporter: '%s' is not a directory\n", m_params.m_dir.c_str() );
+		return false;
+	}
+
+	if (m_params.m_archive)
+	{
+		uint64_t shard_bytes = (uint64_t)std::max( 1, m_params.m_shard_mb ) * 1024 * 1024;
+		if (!m_archive.Open( m_params.m_dir, m_params.m_base + "_chips", m_params.m_format, shard_bytes ))
+			return false;
+	}
+
+	// appended to, so exporting the same stream again adds rows, numbered on from the rows already there:
+	m_manifest_path = m_params.m_dir + m_params.m_base + "_chips.csv";
+	ResumeNumbering( m_manifest_path );
+	mp_manifest = fopen( m_manifest_path.c_str(), "ab" );
+	if (!mp_manifest)
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceChipExporter: unable to create manifest '%s'\n", m_manifest_path.c_str() );
+		m_archive.Close();
+		return false;
+	}
+	fseek( mp_manifest, 0, SEEK_END );
+	if (ftell( mp_manifest ) == 0)
+	{
+		fprintf( mp_manifest, "# ffvideo face chip manifest 1\n" );
+		fprintf( mp_manifest, "# pts is in microseconds, empty if unknown; box & landmarks are frame pixels, top origin\n" );
+		fprintf( mp_manifest, "# path is relative to this file; for an archive it is the archive index, whose frame numbers are chip numbers\n" );
+		fprintf( mp_manifest, "chip,frame,pts,track,face,left,top,right,bottom,path,landmarks\n" );
+	}
+
+	m_tracks.clear();
+	m_submitted = 0;
+	m_written = 0;
+	m_duplicates = 0;
+	m_dropped = 0;
+	m_failures = 0;
+	m_bytes = 0;
+
+	m_stop = false;
+	for (int32_t i = 0; i < m_params.m_threads; i++)
+	{
+		m_writers_running++;
+		m_writers.push_back( new std::thread( &FaceChipExporter::WriteProcessLoop, this ) );
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceChipExporter::Stop( void )
+{
+	if (m_writers.size() > 0)
+	{
+		// the export threads drain the queue before exiting:
+		m_stop = true;
+		m_queue_cv.notify_all();
+		for (size_t i = 0; i < m_writers.size(); i++)
+		{
+			m_writers[i]->join();
+			delete m_writers[i];
+		}
+		m_writers.clear();
+		m_stop = false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_chipQue.clear();
+		m_free_images.clear();
+	lock.unlock();
+
+	std::lock_guard<std::mutex> wlock(m_write_lock);
+	m_archive.Close();
+	if (mp_manifest)
+	{
+		fclose( mp_manifest );
+		mp_manifest = NULL;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// chip & track numbers continue past the highest in an existing manifest, so a later session's chips never
+// take an earlier session's file names, nor its rows' numbers:
+void FaceChipExporter::ResumeNumbering( const std::string& manifest_path )
+{
+	m_next_chip = 0;
+	m_next_track = 0;
+
+	FILE* fh = fopen( manifest_path.c_str(), "rb" );
+	if (!fh)
+		return;
+
+	// rows are "chip,frame,pts,track,..."; comments, the column names & landmark overflow do not parse:
+	char line[4096];
+	while (fgets( line, sizeof(line), fh ))
+	{
+		char* end = NULL;
+		unsigned long long chip = strtoull( line, &end, 10 );
+		if (end == line || *end != ',')
+			continue;
+
+		const char* field = end;
+		for (int32_t commas = 0; field && commas < 2; commas++)
+			field = strchr( field + 1, ',' );
+		if (!field)
+			continue;
+		long track = strtol( field + 1, &end, 10 );
+		if (end == field + 1 || *end != ',')
+			continue;
+
+		m_next_chip = std::max( m_next_chip, (uint64_t)chip + 1 );
+		m_next_track = std::max( m_next_track, (int32_t)track + 1 );
+	}
+	fclose( fh );
+
+	m_first_track = m_next_track;
+}
+
+////////////////////////////////////////////////////////////////////////
+// a 16x16 grid of luma samples, enough to tell a new pose or expression from the same chip again:
+void FaceChipExporter::Thumbnail( const FFVideo_Image& im, std::vector<uint8_t>& thumb )
+{
+	const int32_t grid = 16;
+
+	thumb.clear();
+	if (!im.mp_pixels || im.m_width < grid || im.m_height < grid)
+		return;
+
+	// gray samples directly, the colour types use green, their largest luma component:
+	uint32_t bpp = (im.m_type == 2) ? 1 : ((im.m_type == 1 || im.m_type == 4) ? 4 : 3);
+	uint32_t channel = (im.m_type == 2) ? 0 : 1;
+
+	thumb.resize( grid * grid );
+	for (int32_t gy = 0; gy < grid; gy++)
+	{
+		uint32_t y = (uint32_t)(((2 * gy + 1) * im.m_height) / (2 * grid));
+		for (int32_t gx = 0; gx < grid; gx++)
+		{
+			uint32_t x = (uint32_t)(((2 * gx + 1) * im.m_width) / (2 * grid));
+			thumb[gy * grid + gx] = im.mp_pixels[((size_t)y * im.m_width + x) * bpp + channel];
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceChipExporter::Submit( const FaceDetectionFrame& fdf )
+{
+	if (!IsRunning() || fdf.m_facesImages.size() < 1 || fdf.m_detect_im_size.x <= 0.0f || fdf.m_detect_im_size.y <= 0.0f)
+		return;
+
+	// the file looped or was sought backwards, or the track has not been seen for too long:
+	for (auto it = m_tracks.begin(); it != m_tracks.end(); )
+	{
+		int32_t gap = fdf.m_frame_num - it->second.m_last_frame;
+		if (gap < 0 || gap > m_params.m_track_gap)
+			it = m_tracks.erase( it );
+		else it++;
+	}
+
+	double sx = (double)fdf.m_im.m_width / fdf.m_detect_im_size.x;
+	double sy = (double)fdf.m_im.m_height / fdf.m_detect_im_size.y;
+	int64_t pts = (m_params.m_frame_rate > 0.0) ? (int64_t)((double)fdf.m_frame_num * 1000000.0 / m_params.m_frame_rate) : AV_NOPTS_VALUE;
+
+	std::vector<int32_t> matched;		// tracks taken by this frame's faces
+
+	size_t faces = std::min( fdf.m_detections.size(), fdf.m_facesImages.size() );
+	for (size_t i = 0; i < faces; i++)
+	{
+		const FFVideo_Image& face_im = fdf.m_facesImages[i];
+		if (!face_im.mp_pixels)
+			continue;
+
+		m_submitted++;
+
+		const rectangle& r = fdf.m_detections[i];
+		drectangle box( r.left() / fdf.m_detect_im_size.x, r.top() / fdf.m_detect_im_size.y,
+										(r.right() + 1) / fdf.m_detect_im_size.x, (r.bottom() + 1) / fdf.m_detect_im_size.y );
+
+		// the best overlapping track not already taken continues, else this face starts one:
+		int32_t track = -1;
+		double best = m_params.m_track_overlap;
+		for (auto it = m_tracks.begin(); it != m_tracks.end(); it++)
+		{
+			if (std::find( matched.begin(), matched.end(), it->first ) != matched.end())
+				continue;
+			double overlap = box_intersection_over_union( box, it->second.m_box );
+			if (overlap >= best)
+			{
+				best = overlap;
+				track = it->first;
+			}
+		}
+		if (track < 0)
+			track = m_next_track++;
+		matched.push_back( track );
+
+		FACE_CHIP_TRACK& t = m_tracks[track];
+		t.m_box = box;
+		t.m_last_frame = fdf.m_frame_num;
+
+		Thumbnail( face_im, m_thumb );
+		if (m_params.m_dedupe > 0.0f && t.m_thumb.size() == m_thumb.size() && m_thumb.size() > 0)
+		{
+			uint32_t total = 0;
+			for (size_t k = 0; k < m_thumb.size(); k++)
+				total += (uint32_t)std::abs( (int32_t)m_thumb[k] - (int32_t)t.m_thumb[k] );
+
+			if ((float)total / (float)m_thumb.size() < m_params.m_dedupe)
+			{
+				m_duplicates++;
+				continue;
+			}
+		}
+
+		// detection never waits on the disk, a full queue drops the chip:
+		std::unique_lock<std::mutex> lock(m_queue_lock);
+		if (m_chipQue.size() >= (size_t)m_params.m_max_queue)
+		{
+			lock.unlock();
+			m_dropped++;
+			continue;
+		}
+		m_chipQue.push_back( FACE_CHIP() );
+		FACE_CHIP& chip = m_chipQue.back();
+		if (m_free_images.size() > 0)
+		{
+			chip.m_im.Swap( m_free_images.back() );
+			m_free_images.pop_back();
+		}
+		chip.m_im.Clone( face_im );
+		chip.m_chip_num = m_next_chip++;
+		chip.m_frame_num = fdf.m_frame_num;
+		chip.m_pts = pts;
+		chip.m_track = track;
+		chip.m_face = (int32_t)i;
+		chip.m_box[0] = (int32_t)(r.left() * sx);
+		chip.m_box[1] = (int32_t)(r.top() * sy);
+		chip.m_box[2] = (int32_t)((r.right() + 1) * sx) - 1;
+		chip.m_box[3] = (int32_t)((r.bottom() + 1) * sy) - 1;
+		if (i < fdf.m_facesLandmarkSets.size())
+		{
+			const full_object_detection& shape = fdf.m_facesLandmarkSets[i];
+			for (unsigned long k = 0; k < shape.num_parts(); k++)
+			{
+				chip.m_points.push_back( (int32_t)(shape.part( k ).x() * sx) );
+				chip.m_points.push_back( (int32_t)(shape.part( k ).y() * sy) );
+			}
+		}
+		lock.unlock();
+		m_queue_cv.notify_one();
+
+		t.m_thumb.swap( m_thumb );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceChipExporter::Write( FACE_CHIP& chip, std::vector<uint8_t>& bytes )
+{
+	// face images are bottom origin, as the frames, & not every encoder flips:
+	chip.m_im.MirrorVertical();
+	if (!chip.m_im.Encode( bytes, m_params.m_format, m_params.m_quality, false ))
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceChipExporter: unable to encode chip %llu\n", (unsigned long long)chip.m_chip_num );
+		return false;
+	}
+
+	if (m_params.m_archive)
+	{
+		std::lock_guard<std::mutex> lock(m_write_lock);
+		if (!m_archive.Append( bytes, (int32_t)chip.m_chip_num, chip.m_pts, chip.m_im.m_width, chip.m_im.m_height ))
+			return false;
+	}
+	else
+	{
+		char name[256];
+		snprintf( name, sizeof(name), "%s_c%08llu_f%06d_t%04d_%02d%s", m_params.m_base.c_str(), (unsigned long long)chip.m_chip_num,
+							chip.m_frame_num, chip.m_track, chip.m_face, FFVideo_Image::SaveExtension( m_params.m_format ) );
+
+		std::string path = m_params.m_dir + name;
+		FILE* fh = fopen( path.c_str(), "wb" );
+		if (!fh)
+		{
+			av_log( NULL, AV_LOG_ERROR, "FaceChipExporter: unable to create '%s'\n", path.c_str() );
+			return false;
+		}
+		bool good = (fwrite( bytes.data(), 1, bytes.size(), fh ) == bytes.size());
+		if (fclose( fh ) != 0 || !good)
+			return false;
+
+		AppendManifest( chip, name );
+		m_bytes += bytes.size();
+		return true;
+	}
+
+	// the archive index sits in the export directory:
+	const std::string& index_path = m_archive.IndexPath();
+	AppendManifest( chip, index_path.substr( std::min( m_params.m_dir.size(), index_path.size() ) ) );
+	m_bytes += bytes.size();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceChipExporter::AppendManifest( FACE_CHIP& chip, const std::string& path )
+{
+	std::string row;
+	char buf[256];
+
+	if (chip.m_pts == AV_NOPTS_VALUE)
+		snprintf( buf, sizeof(buf), "%llu,%d,,%d,%d,%d,%d,%d,%d,", (unsigned long long)chip.m_chip_num, chip.m_frame_num,
+							chip.m_track, chip.m_face, chip.m_box[0], chip.m_box[1], chip.m_box[2], chip.m_box[3] );
+	else
+		snprintf( buf, sizeof(buf), "%llu,%d,%lld,%d,%d,%d,%d,%d,%d,", (unsigned long long)chip.m_chip_num, chip.m_frame_num,
+							(long long)chip.m_pts, chip.m_track, chip.m_face, chip.m_box[0], chip.m_box[1], chip.m_box[2], chip.m_box[3] );
+	row = buf;
+	row += path;
+	row += ",";
+
+	// x y pairs separated by spaces, so the field needs no quoting:
+	for (size_t k = 0; k < chip.m_points.size(); k++)
+	{
+		snprintf( buf, sizeof(buf), (k == 0) ? "%d" : " %d", chip.m_points[k] );
+		row += buf;
+	}
+	row += "\n";
+
+	std::lock_guard<std::mutex> lock(m_write_lock);
+	if (mp_manifest)
+		fwrite( row.data(), 1, row.size(), mp_manifest );
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceChipExporter::WriteProcessLoop( void )
+{
+	std::vector<uint8_t> bytes;		// encode buffer, reused
+
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_queue_cv.wait( lock, [this] { return m_stop || !m_chipQue.empty(); } );
+		if (m_chipQue.empty())
+			break;	// stopping & drained
+		// the pixels are swapped out first, FFVideo_Image copies deep:
+		FACE_CHIP chip;
+		FFVideo_Image im;
+		im.Swap( m_chipQue.front().m_im );
+		chip = m_chipQue.front();
+		chip.m_im.Swap( im );
+		m_chipQue.pop_front();
+		lock.unlock();
+
+		if (Write( chip, bytes ))
+			m_written++;
+		else m_failures++;
+
+		lock.lock();
+		m_free_images.push_back( FFVideo_Image() );
+		m_free_images.back().Swap( chip.m_im );
+		lock.unlock();
+	}
+
+	// the manifest is flushed as each thread finishes, rather than per row:
+	std::lock_guard<std::mutex> wlock(m_write_lock);
+	if (mp_manifest)
+		fflush( mp_manifest );
+
+	m_writers_running--;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceChipExporter::GetStats( FACE_CHIP_EXPORT_STATS& stats )
+{
+	stats.m_submitted = m_submitted;
+	stats.m_written = m_written;
+	stats.m_duplicates = m_duplicates;
+	stats.m_dropped = m_dropped;
+	stats.m_failures = m_failures;
+	stats.m_bytes = m_bytes;
+	stats.m_tracks = (uint64_t)(m_next_track - m_first_track);
+
+	std::lock_guard<std::mutex> lock(m_queue_lock);
+	stats.m_queued = (int32_t)m_chipQue.size();
+}
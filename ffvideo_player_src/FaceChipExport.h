@@ -0,0 +1,143 @@
+#pragma once
+
+#ifndef _FACECHIPEXPORT_H_
+#define _FACECHIPEXPORT_H_
+
+// no wxWidgets here, FaceDetectionThreadMgr feeds this & the benchmark builds without the player:
+#include "FaceDetect.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+
+//------------------------------------------------------------------------------
+// where & how FaceChipExporter writes the face images:
+typedef struct _FACE_CHIP_EXPORT_PARAMS
+{
+	std::string						m_dir;									// with a trailing separator
+	std::string						m_base = "faces";				// file names start with this
+	FFVIDEO_Export_Format	m_format;
+	int32_t								m_quality = 90;					// jpeg & lossy webp
+	bool									m_archive = false;			// append into sharded archive files rather than one file per chip
+	int32_t								m_shard_mb = 1024;
+	double								m_frame_rate = 0.0;			// converts frame numbers to pts, 0 if unknown
+	int32_t								m_threads = 2;					// encode & write threads
+	int32_t								m_max_queue = 64;				// chips waiting to be written; when full new chips are dropped
+	float									m_dedupe = 6.0f;				// mean absolute difference, 0-255, from the track's last chip written
+																								// below which a chip is a duplicate; 0 writes every chip
+	float									m_track_overlap = 0.3f;	// intersection over union with a face of an earlier frame that continues its track
+	int32_t								m_track_gap = 30;				// frames a track may go unseen before a face there starts a new one
+} FACE_CHIP_EXPORT_PARAMS;
+
+//------------------------------------------------------------------------------
+// returned by FaceChipExporter::GetStats():
+typedef struct _FACE_CHIP_EXPORT_STATS
+{
+	uint64_t	m_submitted = 0;								// chips offered by detection
+	uint64_t	m_written = 0;
+	uint64_t	m_duplicates = 0;								// skipped as near-identical to their track's last chip
+	uint64_t	m_dropped = 0;									// the queue was full
+	uint64_t	m_failures = 0;									// encode or write failed
+	uint64_t	m_bytes = 0;
+	uint64_t	m_tracks = 0;										// tracks started
+	int32_t		m_queued = 0;										// at the time of the call
+} FACE_CHIP_EXPORT_STATS;
+
+//------------------------------------------------------------------------------
+// exports the face images of detected frames, standardized chips or clipped heads, each with its frame number,
+// pts, track, box & landmarks in a CSV manifest, "[dir][base]_chips.csv". Chips are written one file per chip,
+// "[dir][base]_c[chip]_f[frame]_t[track]_[face].[ext]", or appended into a frame archive whose entries' frame numbers
+// are chip numbers. Faces are followed between frames by overlap, & a chip too similar to the last one written
+// for its track is not written again. Submit() never waits: the chips are copied into a bounded queue & encoded
+// and written by the export threads, a chip arriving at a full queue is dropped:
+class FaceChipExporter
+{
+public:
+	FaceChipExporter() : m_stop(false), m_writers_running(0), m_next_track(0), m_first_track(0), m_next_chip(0),
+		m_submitted(0), m_written(0), m_duplicates(0), m_dropped(0), m_failures(0), m_bytes(0) {};
+
+	~FaceChipExporter() { Stop(); }
+
+	bool Start( FACE_CHIP_EXPORT_PARAMS& params );
+
+	// writes the chips already queued, then ends the export threads:
+	void Stop( void );
+
+	bool IsRunning( void ) { return m_writers_running > 0; }
+
+	// called in frame order, as FaceDetectionThreadMgr delivers frames; frames without face images are ignored:
+	void Submit( const FaceDetectionFrame& fdf );
+
+	void GetStats( FACE_CHIP_EXPORT_STATS& stats );
+
+	const std::string& GetManifestPath( void ) { return m_manifest_path; }
+
+private:
+	// one chip waiting to be written, its box & landmarks in frame pixels, top origin:
+	typedef struct _FACE_CHIP
+	{
+		FFVideo_Image						m_im;
+		uint64_t								m_chip_num = 0;
+		int32_t									m_frame_num = 0;
+		int64_t									m_pts = 0;
+		int32_t									m_track = 0;
+		int32_t									m_face = 0;
+		int32_t									m_box[4] = { 0, 0, 0, 0 };
+		std::vector<int32_t>		m_points;
+	} FACE_CHIP;
+
+	// a face followed between frames; its box is normalized to the detection image:
+	typedef struct _FACE_CHIP_TRACK
+	{
+		dlib::drectangle				m_box;
+		int32_t									m_last_frame = 0;
+		std::vector<uint8_t>		m_thumb;					// of the last chip written
+	} FACE_CHIP_TRACK;
+
+	// class sub-thread function, one per export thread:
+	void WriteProcessLoop( void );
+
+	void ResumeNumbering( const std::string& manifest_path );
+	bool Write( FACE_CHIP& chip, std::vector<uint8_t>& bytes );
+	void AppendManifest( FACE_CHIP& chip, const std::string& path );
+	static void Thumbnail( const FFVideo_Image& im, std::vector<uint8_t>& thumb );
+
+	FACE_CHIP_EXPORT_PARAMS											m_params;
+	std::vector<std::thread*>										m_writers;
+	std::atomic<bool>														m_stop;
+	std::atomic<int32_t>												m_writers_running;
+
+	// under the sequencer's lock, Submit() is only called in frame order:
+	std::map<int32_t, FACE_CHIP_TRACK>					m_tracks;
+	int32_t																			m_next_track;
+	int32_t																			m_first_track;		// this session's first
+	std::vector<uint8_t>												m_thumb;
+
+	std::mutex																	m_queue_lock;
+	std::condition_variable											m_queue_cv;
+	std::deque<FACE_CHIP>												m_chipQue;
+	std::vector<FFVideo_Image>									m_free_images;		// written chips' pixels for reuse, under m_queue_lock
+	uint64_t																		m_next_chip;
+
+	std::mutex																	m_write_lock;			// the archive & manifest
+	FFVideo_FrameArchiveWriter									m_archive;
+	FILE*																				mp_manifest = NULL;
+	std::string																	m_manifest_path;
+
+	std::atomic<uint64_t>												m_submitted;
+	std::atomic<uint64_t>												m_written;
+	std::atomic<uint64_t>												m_duplicates;
+	std::atomic<uint64_t>												m_dropped;
+	std::atomic<uint64_t>												m_failures;
+	std::atomic<uint64_t>												m_bytes;
+};
+
+
+
+#endif // _FACECHIPEXPORT_H_
@@ -4,7 +4,19 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 
-#include "ffvideo_player_app.h"
+#include "FaceDetect.h"
+#include "FaceIndex.h"
+#include "FaceChipExport.h"
+#include "ffvideo_workerPool.h"
+
+#include <assert.h>
+#include <future>
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 
 // not actually using OpenCV yet...
@@ -16,27 +28,112 @@
 using namespace dlib;
 
 ////////////////////////////////////////////////////////////////////////
-FaceDetector::FaceDetector( TheApp* p_app, FACE_MODEL face_model )
+std::mutex FaceModelCache::m_lock;
+std::map<FACE_MODEL, std::shared_future<std::shared_ptr<const FaceModels>>> FaceModelCache::m_models;
+
+////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const FaceModels> FaceModelCache::Load( std::string model_path )
 {
-	m_detector = get_frontal_face_detector();
-	//
-	m_face_model = face_model;
-	//
+	std::shared_ptr<FaceModels> p_models = std::make_shared<FaceModels>();
+
+	p_models->m_detector = get_frontal_face_detector();
+
+	// the sub-detectors' filters & thresholds, shared by the parallel scan's threads:
+	for (unsigned long i = 0; i < p_models->m_detector.num_detectors(); i++)
+	{
+		const frontal_face_detector::feature_vector_type& w = p_models->m_detector.get_w(i);
+		p_models->m_filterbanks.push_back( p_models->m_detector.get_scanner().build_fhog_filterbank(w) );
+		p_models->m_thresholds.push_back( w(w.size() - 1) );
+	}
+
+	try
+	{
+		deserialize( model_path.c_str() ) >> p_models->m_sp;
+	}
+	catch (std::exception& e)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FaceModelCache: unable to load '%s': %s\n", model_path.c_str(), e.what());
+		return NULL;
+	}
+
+	return p_models;
+}
+
+////////////////////////////////////////////////////////////////////////
+std::shared_future<std::shared_ptr<const FaceModels>> FaceModelCache::Request( const std::string& data_dir, FACE_MODEL face_model )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	// a failed load is forgotten once seen, so a request after the model file is fixed loads it again:
+	auto it = m_models.find( face_model );
+	if (it != m_models.end())
+	{
+		if (it->second.wait_for( std::chrono::seconds(0) ) != std::future_status::ready || it->second.get())
+			return it->second;
+		m_models.erase( it );
+	}
+
 	std::string model_path;
 	if (face_model == FACE_MODEL::sixtyeight)
 	{
-	  model_path = p_app->m_data_dir + "\\shape_predictor_68_face_landmarks.dat";
+	  model_path = data_dir + FFVIDEO_PATH_SEPARATOR "shape_predictor_68_face_landmarks.dat";
 	}
 	else if (face_model == FACE_MODEL::eightyone)
 	{
-		model_path = p_app->m_data_dir + "\\shape_predictor_81_face_landmarks-master\\shape_predictor_81_face_landmarks.dat";
+		model_path = data_dir + FFVIDEO_PATH_SEPARATOR "shape_predictor_81_face_landmarks-master" FFVIDEO_PATH_SEPARATOR "shape_predictor_81_face_landmarks.dat";
 	}
 	else assert(0);
 
-	deserialize( model_path.c_str() ) >> m_sp;
+	std::shared_future<std::shared_ptr<const FaceModels>> loading = std::async( std::launch::async, Load, model_path ).share();
+	m_models[face_model] = loading;
+
+	return loading;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceModelCache::Preload( const std::string& data_dir, FACE_MODEL face_model )
+{
+	Request( data_dir, face_model );
+}
+
+////////////////////////////////////////////////////////////////////////
+std::shared_ptr<const FaceModels> FaceModelCache::Get( const std::string& data_dir, FACE_MODEL face_model )
+{
+	return Request( data_dir, face_model ).get();
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceModelCache::IsLoaded( FACE_MODEL face_model )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	auto it = m_models.find( face_model );
+	if (it == m_models.end())
+		return false;
+
+	return (it->second.wait_for( std::chrono::seconds(0) ) == std::future_status::ready && it->second.get());
+}
+
+
+////////////////////////////////////////////////////////////////////////
+FaceDetector::FaceDetector( const std::string& data_dir, FACE_MODEL face_model )
+{
+	m_face_model = face_model;
+	//
+	// shared by every detector of the process, loaded by the first to ask:
+	mp_models = FaceModelCache::Get( data_dir, face_model );
+	//
+	// the detector keeps scanning state, so each has its own copy:
+	if (mp_models)
+		m_detector = mp_models->m_detector;
 
 	m_detect_scale = 0.25f;
 
+	m_detect_threads = 1;
+
+	mp_src = NULL;
+	m_pixels_scanned = 0;
+
 	m_image_set = false;
 }
 
@@ -45,59 +142,130 @@ FaceDetector::FaceDetector( TheApp* p_app, FACE_MODEL face_model )
 FaceDetector::~FaceDetector() {}
 
 ////////////////////////////////////////////////////////////////////////
-void FaceDetector::SetImage( FFVideo_Image& im, float detection_scale )
+// BT.601 luma weights, 15 bit fixed point, for the RGB & BGR byte orders:
+static void GrayWeights( uint32_t type, int16_t& w0, int16_t& w1, int16_t& w2 )
 {
-  // check if our class instance m_dlib_im is not the same w,h as the passed image:
-	if (m_dlib_im.nc() != im.m_width || m_dlib_im.nr() != im.m_height)
+	if (type == 3 || type == 4)	// BGR & BGRA
+	{
+		w0 = 3735; w1 = 19235; w2 = 9798;
+	}
+	else												// RGB & RGBA
 	{
-	  // reallocate m_dlib_im to same size as passed image:
-		m_dlib_im.set_size( im.m_height, im.m_width );
+		w0 = 9798; w1 = 19235; w2 = 3735;
 	}
+}
 
-	if (m_detect_scale != detection_scale)
+////////////////////////////////////////////////////////////////////////
+// one row of the fused conversion: the pixels at x_offsets (byte offsets into p_src) to gray. 3 channel
+// pixels are converted one at a time, a 4 byte load of the row's last pixel would read past the frame:
+static void GrayRow( const uint8_t* p_src, const uint32_t* x_offsets, uint8_t* p_dst, long width, uint32_t bpp,
+										 int16_t w0, int16_t w1, int16_t w2 )
+{
+	long x = 0;
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+	if (bpp == 4)
 	{
-		m_detect_scale = detection_scale;
+		const __m128i zero    = _mm_setzero_si128();
+		const __m128i weights = _mm_setr_epi16( w0, w1, w2, 0, w0, w1, w2, 0 );
+		const __m128i round   = _mm_set1_epi32( 1 << 14 );
 
-		// set size of reduced scale version used for faster processing:
-		m_dlib_real_im.set_size( ((int32_t)(float)im.m_height * m_detect_scale + 0.5f), ((int32_t)(float)im.m_width * m_detect_scale + 0.5f) );
+		for (; x + 4 <= width; x += 4)
+		{
+			// gather 4 pixels, each channel to 16 bits, then 2 multiply-adds per pixel:
+			__m128i px = _mm_setr_epi32( *(const int32_t*)(p_src + x_offsets[x]),     *(const int32_t*)(p_src + x_offsets[x + 1]),
+																	 *(const int32_t*)(p_src + x_offsets[x + 2]), *(const int32_t*)(p_src + x_offsets[x + 3]) );
+			__m128i lo = _mm_madd_epi16( _mm_unpacklo_epi8( px, zero ), weights );	// c0w0+c1w1, c2w2 for pixels 0,1
+			__m128i hi = _mm_madd_epi16( _mm_unpackhi_epi8( px, zero ), weights );	// pixels 2,3
+
+			__m128 a = _mm_shuffle_ps( _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(2, 0, 2, 0) );
+			__m128 b = _mm_shuffle_ps( _mm_castsi128_ps(lo), _mm_castsi128_ps(hi), _MM_SHUFFLE(3, 1, 3, 1) );
+			__m128i sum = _mm_add_epi32( _mm_add_epi32( _mm_castps_si128(a), _mm_castps_si128(b) ), round );
+			sum = _mm_srli_epi32( sum, 15 );
+
+			sum = _mm_packs_epi32( sum, zero );
+			sum = _mm_packus_epi16( sum, zero );
+			*(int32_t*)(p_dst + x) = _mm_cvtsi128_si32( sum );
+		}
 	}
+#endif
 
-	// remember in this format, incase we're asked for the face rects later:
-	m_im.Clone( im );
-
-	FFVideo_Image im_flip( im );
-	im_flip.MirrorVertical();
+	for (; x < width; x++)
+	{
+		const uint8_t* p = p_src + x_offsets[x];
+		p_dst[x] = (uint8_t)((p[0] * w0 + p[1] * w1 + p[2] * w2 + (1 << 14)) >> 15);
+	}
+}
 
-	int32_t rgba_stride = sizeof(uint8_t) * 4 * im_flip.m_width;
-	int32_t rgb_stride  = sizeof(uint8_t) * 3 * im_flip.m_width;
+////////////////////////////////////////////////////////////////////////
+// the same from a gray source, a resample only:
+static void GrayRowFromGray( const uint8_t* p_src, const uint32_t* x_offsets, uint8_t* p_dst, long width )
+{
+	for (long x = 0; x < width; x++)
+	{
+		p_dst[x] = p_src[x_offsets[x]];
+	}
+}
 
-	int32_t grey_stride  = sizeof(uint8_t) * im_flip.m_width;
+////////////////////////////////////////////////////////////////////////
+// one pass from a rect of the bottom origin frame, given top origin, to the scaled, top origin 
+// greyscale dst, already sized. RGB, RGBA, BGR & BGRA are converted, gray is resampled:
+void FaceDetector::GrayFromFrame( const FFVideo_Image& src, long x0, long y0, long width, long height, 
+																	array2d<uint8_t>& dst )
+{
+	uint32_t bpp = (src.m_type == 2) ? 1 : ((src.m_type == 1 || src.m_type == 4) ? 4 : 3);
+	long nr = dst.nr(), nc = dst.nc();
 
-	// copy the RGBA FFvideo_Image format image to m_dlib_im, a greyscale format image:
-	SimdBgraToGray( im_flip.Pixel(0, 0), im_flip.m_width, im_flip.m_height, rgba_stride, (uint8_t*)&m_dlib_im[0][0], grey_stride );
+	// nearest neighbour sample positions, as byte offsets into a source row:
+	m_gray_x_offsets.resize( nc );
+	for (long x = 0; x < nc; x++)
+	{
+		uint32_t sx = (uint32_t)(x0 + ((uint64_t)(2 * x + 1) * width) / (2 * nc));
+		m_gray_x_offsets[x] = sx * bpp;
+	}
 
-	if (m_detect_scale != 1.0f)
+	int16_t w0, w1, w2;
+	GrayWeights( src.m_type, w0, w1, w2 );
+	//
+	uint32_t src_stride = src.m_width * bpp;
+	for (long y = 0; y < nr; y++)
 	{
-		dlib::array2d<unsigned char> img_flip;
-		dlib::flip_image_up_down(m_dlib_im, img_flip);
+		uint32_t sy = (uint32_t)(y0 + ((uint64_t)(2 * y + 1) * height) / (2 * nr));
+		const uint8_t* p_src_row = src.mp_pixels + (size_t)(src.m_height - 1 - sy) * src_stride;
 
-		// because face detection and face feature recovery take time,
-		// we're going to actually work with an end-user set scaling of 
-		// the image for our detections with dlib:
-		//
-		dlib::interpolate_nearest_neighbor interp_type; // slightly faster? 
-		//
-		dlib::resize_image( m_dlib_im, m_dlib_real_im, interp_type );
-		//
-		// boo! not faster:
-		// SimdResizeBilinear( (uint8_t*)&m_dlib_im[0][0], im_flip.m_width, im_flip.m_height, rgb_stride, 
-		// 										 (uint8_t*)&m_dlib_real_im[0][0], m_dlib_real_im.nc(), m_dlib_real_im.nr(), rgb_stride, 3 );
+		if (bpp == 1)
+			GrayRowFromGray( p_src_row, m_gray_x_offsets.data(), &dst[y][0], nc );
+		else GrayRow( p_src_row, m_gray_x_offsets.data(), &dst[y][0], nc, bpp, w0, w1, w2 );
 	}
-	else
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetector::SetImage( FFVideo_Image& im, float detection_scale, bool keep_frame, FFVideo_Image* p_luma )
+{
+	m_detect_scale = detection_scale;
+
+	// the size used for faster processing, or enhanced precision, is always relative to the frame:
+	long nr = std::max( 1L, (long)((float)im.m_height * m_detect_scale + 0.5f) );
+	long nc = std::max( 1L, (long)((float)im.m_width * m_detect_scale + 0.5f) );
+	if (m_dlib_real_im.nr() != nr || m_dlib_real_im.nc() != nc)
 	{
-		dlib::flip_image_up_down(m_dlib_im, m_dlib_real_im);
+		m_dlib_real_im.set_size( nr, nc );
 	}
 
+	// the pixels come from the luma plane if given, which skips the colour conversion:
+	FFVideo_Image& src = (p_luma && p_luma->mp_pixels) ? *p_luma : im;
+	//
+	GrayFromFrame( src, 0, 0, src.m_width, src.m_height, m_dlib_real_im );
+
+	// region of interest detection samples the source again at native resolution, which a luma plane
+	// already reduced toward the detection scale no longer has, so the frame is sampled instead:
+	mp_src = (src.m_width >= im.m_width && src.m_height >= im.m_height) ? &src : &im;
+
+	// only face images clipped from the video frame need it:
+	if (keep_frame)
+		m_im.Clone( im );
+	else m_im.Empty();
+
 	m_image_set = true;
 }
 
@@ -107,13 +275,355 @@ bool FaceDetector::GetFaceBoxes( std::vector<rectangle>& detections )
 {
 	if (m_image_set)
 	{
+		if (m_detect_threads > 1)
+			return GetFaceBoxesParallel( detections );
+
 		detections = m_detector(m_dlib_real_im);
+		m_pixels_scanned = (uint64_t)m_dlib_real_im.nr() * (uint64_t)m_dlib_real_im.nc();
 		return true;
 	}
 
 	return false;
 }
 
+////////////////////////////////////////////////////////////////////////
+void FaceDetector::ScanTiles( int32_t thread, std::vector<FACE_DETECT_TILE>& tiles, std::atomic<int32_t>& next_tile,
+															std::vector<std::pair<double, rectangle>>& dets )
+{
+	FACE_SCANNER& scanner = m_scanners[thread];
+	pyramid_down<6> pyr;
+
+	std::vector<std::pair<double, rectangle>> tile_dets;
+
+	int32_t t;
+	while ((t = next_tile++) < (int32_t)tiles.size())
+	{
+		FACE_DETECT_TILE& tile = tiles[t];
+		const array2d<uint8_t>& level_im = (tile.m_level == 0) ? m_dlib_real_im : m_pyramid[tile.m_level - 1];
+
+		rectangle band( 0, tile.m_top, level_im.nc() - 1, tile.m_bottom );
+		scanner.load( sub_image( level_im, band ) );
+
+		for (size_t i = 0; i < mp_models->m_filterbanks.size(); i++)
+		{
+			tile_dets.clear();
+			scanner.detect( mp_models->m_filterbanks[i], tile_dets, mp_models->m_thresholds[i] );
+
+			// back to level 0 coordinates:
+			for (size_t d = 0; d < tile_dets.size(); d++)
+			{
+				rectangle r = translate_rect( tile_dets[d].second, 0, tile.m_top );
+				rectangle up = pyr.rect_up( r, tile.m_level );
+				dets.push_back( std::make_pair( tile_dets[d].first, up ) );
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceDetector::GetFaceBoxesParallel( std::vector<rectangle>& detections )
+{
+	// the scanners only scan the one level they are given:
+	if (m_scanners.size() != (size_t)m_detect_threads)
+	{
+		m_scanners.resize( m_detect_threads );
+		for (size_t i = 0; i < m_scanners.size(); i++)
+		{
+			m_scanners[i].copy_configuration( m_detector.get_scanner() );
+			m_scanners[i].set_max_pyramid_levels( 1 );
+		}
+	}
+	const FACE_SCANNER& scanner = m_scanners[0];
+
+	// build the pyramid the serial scan would, pyramid_down<6> until below the scanner's minimum:
+	pyramid_down<6> pyr;
+	int32_t levels = 1;
+	{
+		long nr = m_dlib_real_im.nr(), nc = m_dlib_real_im.nc();
+		while (true)
+		{
+			dlib::rectangle next = pyr.rect_down( dlib::rectangle( nc, nr ) );
+			if (next.width() < scanner.get_min_pyramid_layer_width() || next.height() < scanner.get_min_pyramid_layer_height())
+				break;
+			levels++;
+			nr = next.height();
+			nc = next.width();
+		}
+	}
+	if (m_pyramid.size() < (size_t)(levels - 1))
+		m_pyramid.resize( levels - 1 );
+	for (int32_t k = 1; k < levels; k++)
+	{
+		pyr( (k == 1) ? m_dlib_real_im : m_pyramid[k - 2], m_pyramid[k - 1] );
+	}
+
+	// split the levels into bands of rows, sized so each thread gets about equal area. Bands overlap
+	// by a detection window & its HOG border, so every window lies wholly within some band:
+	long overlap = (long)(scanner.get_detection_window_height() + 2 * scanner.get_cell_size());
+	double total_area = 0.0;
+	for (int32_t k = 0; k < levels; k++)
+	{
+		const array2d<uint8_t>& level_im = (k == 0) ? m_dlib_real_im : m_pyramid[k - 1];
+		total_area += (double)level_im.nr() * (double)level_im.nc();
+	}
+	double target_area = total_area / (double)m_detect_threads;
+
+	std::vector<FACE_DETECT_TILE> tiles;
+	for (int32_t k = 0; k < levels; k++)
+	{
+		const array2d<uint8_t>& level_im = (k == 0) ? m_dlib_real_im : m_pyramid[k - 1];
+		long nr = level_im.nr();
+
+		long bands = (long)((double)nr * (double)level_im.nc() / target_area + 0.5);
+		bands = std::max( 1L, std::min( bands, nr / (2 * overlap) ) );
+
+		for (long b = 0; b < bands; b++)
+		{
+			FACE_DETECT_TILE tile;
+			tile.m_level  = k;
+			tile.m_top    = nr * b / bands;
+			tile.m_bottom = std::min( nr * (b + 1) / bands + overlap, nr ) - 1;
+			tiles.push_back( tile );
+		}
+	}
+
+	// tiles are taken in order, largest levels first, so the small levels fill in around them:
+	int32_t threads = std::min( m_detect_threads, (int32_t)tiles.size() );
+	std::atomic<int32_t> next_tile(0);
+	std::vector<std::vector<std::pair<double, rectangle>>> thread_dets( threads );
+
+	// each scanner's share runs on the shared worker pool or here, none waits for a thread to be created:
+	FFVideo_WorkerPool::Shared().ParallelFor( threads, [&]( int32_t t )
+	{
+		ScanTiles( t, tiles, next_tile, thread_dets[t] );
+	} );
+
+	// non-max suppression over every level & band:
+	std::vector<std::pair<double, rectangle>> dets;
+	for (int32_t t = 0; t < threads; t++)
+		dets.insert( dets.end(), thread_dets[t].begin(), thread_dets[t].end() );
+
+	SuppressOverlaps( dets, detections );
+
+	m_pixels_scanned = (uint64_t)m_dlib_real_im.nr() * (uint64_t)m_dlib_real_im.nc();
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// greedy non-max suppression, strongest first, with the detector's own overlap test:
+void FaceDetector::SuppressOverlaps( std::vector<std::pair<double, rectangle>>& dets, std::vector<rectangle>& detections )
+{
+	std::sort( dets.begin(), dets.end(), [](const std::pair<double, rectangle>& a, const std::pair<double, rectangle>& b) 
+		{ return a.first > b.first; } );
+
+	const test_box_overlap& overlaps = m_detector.get_overlap_tester();
+	detections.clear();
+	for (size_t i = 0; i < dets.size(); i++)
+	{
+		bool suppressed = false;
+		for (size_t j = 0; j < detections.size() && !suppressed; j++)
+			suppressed = overlaps( dets[i].second, detections[j] );
+		if (!suppressed)
+			detections.push_back( dets[i].second );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceDetector::GetFaceBoxesInROIs( std::vector<rectangle>& detections, const std::vector<drectangle>& faces, float margin )
+{
+	if (!m_image_set || !mp_src || !mp_src->mp_pixels)
+		return false;
+
+	const FFVideo_Image& src = *mp_src;
+	double frame_w = (double)src.m_width, frame_h = (double)src.m_height;
+	double window = (double)m_detector.get_scanner().get_detection_window_height();
+
+	// results are in the units of the detection image, as with a full scan:
+	double to_detect_x = (double)m_dlib_real_im.nc() / frame_w;
+	double to_detect_y = (double)m_dlib_real_im.nr() / frame_h;
+
+	std::vector<std::pair<double, rectangle>> dets;
+	std::vector<rect_detection> roi_dets;
+	m_pixels_scanned = 0;
+
+	for (size_t f = 0; f < faces.size(); f++)
+	{
+		// the face, normalized, to source pixels & expanded by the margin on each side:
+		double fw = faces[f].width() * frame_w, fh = faces[f].height() * frame_h;
+		double left   = std::max( 0.0, faces[f].left() * frame_w - fw * margin );
+		double top    = std::max( 0.0, faces[f].top() * frame_h - fh * margin );
+		double right  = std::min( frame_w, faces[f].left() * frame_w + fw * (1.0 + margin) );
+		double bottom = std::min( frame_h, faces[f].top() * frame_h + fh * (1.0 + margin) );
+		if (right - left < 1.0 || bottom - top < 1.0 || fh < 1.0)
+			continue;
+
+		// full resolution, unless the face would be over twice the detection window:
+		double scale = std::min( 1.0, 2.0 * window / fh );
+		long nc = (long)((right - left) * scale + 0.5);
+		long nr = (long)((bottom - top) * scale + 0.5);
+		if (nc < (long)window || nr < (long)window)
+			continue; // too small for the detector to find anything in
+
+		m_roi_im.set_size( nr, nc );
+		GrayFromFrame( src, (long)left, (long)top, (long)(right - left), (long)(bottom - top), m_roi_im );
+		m_pixels_scanned += (uint64_t)nr * (uint64_t)nc;
+
+		roi_dets.clear();
+		m_detector( m_roi_im, roi_dets );
+
+		for (size_t d = 0; d < roi_dets.size(); d++)
+		{
+			const rectangle& r = roi_dets[d].rect;
+			rectangle mapped( (long)((left + r.left() / scale) * to_detect_x + 0.5), (long)((top + r.top() / scale) * to_detect_y + 0.5),
+												(long)((left + r.right() / scale) * to_detect_x + 0.5), (long)((top + r.bottom() / scale) * to_detect_y + 0.5) );
+			dets.push_back( std::make_pair( roi_dets[d].detection_confidence, mapped ) );
+		}
+	}
+
+	// overlapping regions find the same face twice:
+	SuppressOverlaps( dets, detections );
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceDetector::Benchmark( FFVideo_Image& im, std::vector<float>& scales, int32_t iterations, 
+															std::vector<FACE_DETECT_BENCHMARK>& results )
+{
+	if (im.m_width < 1 || im.m_height < 1 || iterations < 1)
+		return false;
+
+	FFVideo_Image im1080;
+	if (im.m_width != 1920 || im.m_height != 1080)
+	{
+		if (!im.RescaleTo( im1080, 1080, 1920 ))
+			return false;
+	}
+	else im1080.Clone( im );
+
+	int32_t detect_threads = m_detect_threads;
+	int32_t parallel_threads = std::max( 2, (int32_t)std::thread::hardware_concurrency() );
+	if (detect_threads > 1)
+		parallel_threads = detect_threads;
+
+	std::vector<rectangle> detections;
+	for (size_t s = 0; s < scales.size(); s++)
+	{
+		SetImage( im1080, scales[s] );
+
+		for (int32_t pass = 0; pass < 2; pass++)
+		{
+			SetDetectThreads( (pass == 0) ? 1 : parallel_threads );
+
+			GetFaceBoxes( detections ); // warm up, allocates the pyramid & scanners
+
+			auto start = std::chrono::steady_clock::now();
+			for (int32_t i = 0; i < iterations; i++)
+				GetFaceBoxes( detections );
+			double ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+			FACE_DETECT_BENCHMARK result;
+			result.m_scale = scales[s];
+			result.m_threads = m_detect_threads;
+			result.m_ms_per_frame = ms / (double)iterations;
+			result.m_faces = (int32_t)detections.size();
+			results.push_back( result );
+		}
+	}
+
+	SetDetectThreads( detect_threads );
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceDetector::BenchmarkFaces( FFVideo_Image& im, std::vector<int32_t>& face_counts, int32_t iterations, 
+																	 std::vector<FACE_LANDMARK_BENCHMARK>& results )
+{
+	if (im.m_width < 1 || im.m_height < 1 || iterations < 1)
+		return false;
+
+	SetImage( im, m_detect_scale, true );
+
+	std::vector<rectangle> found;
+	GetFaceBoxes( found );
+	if (found.size() < 1)
+	{
+		long side = m_dlib_real_im.nr() / 3;
+		long left = (m_dlib_real_im.nc() - side) / 2;
+		long top  = (m_dlib_real_im.nr() - side) / 2;
+		found.push_back( rectangle( left, top, left + side - 1, top + side - 1 ) );
+	}
+
+	int32_t detect_threads = m_detect_threads;
+	int32_t parallel_threads = std::max( 2, (int32_t)std::thread::hardware_concurrency() );
+	if (detect_threads > 1)
+		parallel_threads = detect_threads;
+
+	std::vector<full_object_detection> landmarks;
+	std::vector<FFVideo_Image> face_images;
+	for (size_t c = 0; c < face_counts.size(); c++)
+	{
+		// a crowd of the faces found, repeated; each costs the same as a distinct face:
+		std::vector<rectangle> detections;
+		for (int32_t i = 0; i < face_counts[c]; i++)
+			detections.push_back( found[i % found.size()] );
+
+		for (int32_t pass = 0; pass < 2; pass++)
+		{
+			SetDetectThreads( (pass == 0) ? 1 : parallel_threads );
+
+			FitLandmarks( m_dlib_real_im, detections, landmarks ); // warm up
+			GetFaceImages( detections, landmarks, face_images, true );
+
+			auto start = std::chrono::steady_clock::now();
+			for (int32_t i = 0; i < iterations; i++)
+				FitLandmarks( m_dlib_real_im, detections, landmarks );
+			double landmark_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+			start = std::chrono::steady_clock::now();
+			for (int32_t i = 0; i < iterations; i++)
+				GetFaceImages( detections, landmarks, face_images, true );
+			double chip_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count();
+
+			FACE_LANDMARK_BENCHMARK result;
+			result.m_faces = face_counts[c];
+			result.m_threads = m_detect_threads;
+			result.m_landmark_ms = landmark_ms / (double)iterations;
+			result.m_chip_ms = chip_ms / (double)iterations;
+			results.push_back( result );
+		}
+	}
+
+	SetDetectThreads( detect_threads );
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetector::ForEachFace( size_t count, size_t min_per_thread, const std::function<void(size_t, int32_t)>& fn ) const
+{
+	int32_t threads = std::min( m_detect_threads, (int32_t)(count / std::max( (size_t)1, min_per_thread )) );
+	if (threads < 2)
+	{
+		for (size_t i = 0; i < count; i++)
+			fn( i, 0 );
+		return;
+	}
+
+	// faces are taken in order, so a few slow faces do not hold up one thread's fixed share:
+	std::atomic<size_t> next_face(0);
+	auto loop = [&]( int32_t thread )
+	{
+		for (size_t i = next_face++; i < count; i = next_face++)
+			fn( i, thread );
+	};
+
+	// on the shared worker pool & here; a thread starting after the faces are taken finds none:
+	FFVideo_WorkerPool::Shared().ParallelFor( threads, loop );
+}
+
 ////////////////////////////////////////////////////////////////////////
 void FaceDetector::GetFaceImages( std::vector<rectangle>& detections, 
 																	std::vector<full_object_detection>& faceLandmarkSets,
@@ -122,8 +632,6 @@ void FaceDetector::GetFaceImages( std::vector<rectangle>& detections,
 {
 	if (m_image_set)
 	{
-		face_images.clear();
- 
 		if (full_head_flag)
 		{
 			// gives us the details for the entire vector of faceLandMarks:
@@ -147,46 +655,36 @@ void FaceDetector::GetFaceImages( std::vector<rectangle>& detections,
 				dets = get_face_chip_details(clipped_faceLandmarkSets, 128, 0.8 );
 			}
 
-			// storage for an array of face images in dlib format:
-			dlib::array<array2d<unsigned char>> face_chips;
-
-			// generates all the sub-images in dlib image format:
-			extract_image_chips(m_dlib_real_im, dets, face_chips);
+			face_images.resize( dets.size() );
+			m_chips.resize( std::max( 1, m_detect_threads ) );
 
-			// convert to FFVideo_Image format:
-			for (size_t i = 0; i < face_chips.size(); i++)
+			// each chip is extracted to its thread's scratch, then converted straight into
+			// its FFVideo_Image bottom row first, so it needs no separate flip:
+			ForEachFace( dets.size(), 2, [&]( size_t i, int32_t thread )
 			{
-			  // get reference to face sub-image:
-				array2d<unsigned char>& face_chip = face_chips[i];
+				array2d<unsigned char>& face_chip = m_chips[thread];
+				extract_image_chip( m_dlib_real_im, dets[i], face_chip );
 
-				// we want it flipped in our format:
-				dlib::array2d<unsigned char> chip_flip;
-				dlib::flip_image_up_down(face_chip, chip_flip);
+				FFVideo_Image& im = face_images[i];
+				if (!im.Reallocate( (uint32_t)face_chip.nr(), (uint32_t)face_chip.nc() ))
+					return;
 
-				// create new FFVideo_Image in vector and get reference:
-				face_images.push_back( FFVideo_Image() );
-				FFVideo_Image& im = face_images.back();
-
-				// set dimensions:
-				im.Reallocate( chip_flip.nr(), chip_flip.nc() );
-				
-				// calc bytes per row and copy the face sub-images to FFVideo_Images:
 				int32_t grey_stride  = sizeof(uint8_t) * im.m_width;
 				int32_t rgba_stride  = sizeof(uint8_t) * 4 * im.m_width;
 				//
-				SimdGrayToBgra( &chip_flip[0][0], im.m_width, im.m_height, grey_stride, im.Pixel(0,0), rgba_stride, 255 );
-			}
-
+				for (uint32_t y = 0; y < im.m_height; y++)
+					SimdGrayToBgra( &face_chip[y][0], im.m_width, 1, grey_stride, im.Pixel(0, im.m_height - 1 - y), rgba_stride, 255 );
+			} );
 		}
 		else // this version clips the detected face rects as new images directly from the video frame:
 		{
-			for (size_t i = 0; i < detections.size(); i++)
-			{
-				// make copy of video frame:
-				face_images.push_back(m_im);
+			face_images.resize( detections.size() );
 
-				// get a reference to the copy:
-				FFVideo_Image& im = face_images.back();
+			uint32_t bytes_per_pixel = (m_im.m_type == 2) ? 1 : ((m_im.m_type == 1 || m_im.m_type == 4) ? 4 : 3);
+
+			ForEachFace( detections.size(), 4, [&]( size_t i, int32_t thread )
+			{
+				FFVideo_Image& im = face_images[i];
 
 				// get a face detection rect (note, in a scaled space!):
 				rectangle& oneFaceRect = detections[i];
@@ -197,9 +695,25 @@ void FaceDetector::GetFaceImages( std::vector<rectangle>& detections,
 				float bottom = 1.0f - (float)oneFaceRect.bottom() / (float)m_dlib_real_im.nr(); // normalized and y flipped
 				float top    = 1.0f - (float)oneFaceRect.top() / (float)m_dlib_real_im.nr();
 
-				// clip our in-vector image to the face rect of that detection:
-				im.ClipToRect( (uint32_t)(left*im.m_width), (uint32_t)(bottom*im.m_height), (uint32_t)(right*im.m_width), (uint32_t)(top*im.m_height) );
-			}
+				// the face rect within the frame, copied from it directly:
+				int32_t xmin = std::max( 0, (int32_t)(left * m_im.m_width) );
+				int32_t xmax = std::min( (int32_t)m_im.m_width - 1, (int32_t)(right * m_im.m_width) );
+				int32_t ymin = std::max( 0, (int32_t)(bottom * m_im.m_height) );
+				int32_t ymax = std::min( (int32_t)m_im.m_height - 1, (int32_t)(top * m_im.m_height) );
+				if (xmin >= xmax || ymin >= ymax)
+				{
+					im.Empty();
+					return;
+				}
+
+				if (!im.Reallocate( ymax - ymin + 1, xmax - xmin + 1, m_im.m_type ))
+					return;
+
+				uint32_t src_stride = m_im.m_width * bytes_per_pixel;
+				uint32_t dst_stride = im.m_width * bytes_per_pixel;
+				for (int32_t y = ymin; y <= ymax; y++)
+					memcpy( &im.mp_pixels[(y - ymin) * dst_stride], &m_im.mp_pixels[y * src_stride + xmin * bytes_per_pixel], dst_stride );
+			} );
 		}
 	}
 }
@@ -211,12 +725,7 @@ bool FaceDetector::GetFaceLandmarkSets( std::vector<rectangle>& detections,
 {
 	if (m_image_set)
 	{
-		faceLandmarkSets.clear();
-		for (size_t i = 0; i < detections.size(); i++)
-		{
-			full_object_detection oneFace_landmarkSet = m_sp( m_dlib_real_im, detections[i] );
-			faceLandmarkSets.push_back(oneFace_landmarkSet);
-		}
+		FitLandmarks( m_dlib_real_im, detections, faceLandmarkSets );
 
 		return true;
 	}
@@ -224,6 +733,18 @@ bool FaceDetector::GetFaceLandmarkSets( std::vector<rectangle>& detections,
 	return false;
 }
 
+////////////////////////////////////////////////////////////////////////
+void FaceDetector::FitLandmarks( const array2d<uint8_t>& im, std::vector<rectangle>& detections, 
+																 std::vector<full_object_detection>& faceLandmarkSets ) const
+{
+	faceLandmarkSets.resize( detections.size() );
+
+	ForEachFace( detections.size(), 1, [&]( size_t i, int32_t thread )
+	{
+		faceLandmarkSets[i] = mp_models->m_sp( im, detections[i] );
+	} );
+}
+
 ////////////////////////////////////////////////////////////////////////
 void FaceDetector::GetLandmarks( dlib::full_object_detection& oneFace_landmarkSet,
 																 std::vector<FF_Vector2D>& jawline,
@@ -312,48 +833,555 @@ void FaceDetectionThreadMgr::Add(void* p_object, FFVideo_Image& im, int32_t fram
 }
 
 ////////////////////////////////////////////////////////////////////////
-void FaceDetectionThreadMgr::Add(FFVideo_Image& im, int32_t frame_num)
+void FaceDetectionThreadMgr::Add(FFVideo_Image& im, int32_t frame_num, FFVideo_Image* p_luma)
 {
   // if we are not keeping up, meaning as this is called and images are added to m_frameQue,
-	// if we are not popping them off equally as fast, we allow frame loss to maintain realtime:
-	if (Size() < 3)
+	// if we are not popping them off equally as fast, we allow frame loss to maintain realtime.
+	// The drop policy picks which frame is lost. Scene changes are checked first, so are never missed:
+	if (m_tracking && SceneChanged( (p_luma && p_luma->mp_pixels) ? *p_luma : im ))
+	{
+		m_force_detect = true;
+	}
+
+	if (m_drop_policy == FACE_DROP_POLICY::fifo && Size() >= (size_t)m_max_queue)
+	{
+		m_dropped++;
+		return;
+	}
+
+	FaceDetectionFrame fdf;
+	fdf.m_im.Clone(im);
+	if (p_luma && p_luma->mp_pixels)
+		fdf.m_luma.Clone(*p_luma);
+	fdf.m_frame_num = frame_num;
+	fdf.m_added = std::chrono::steady_clock::now();
+
+	std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+	while (m_frameQue.size() >= (size_t)m_max_queue)
+	{
+		m_frameQue.pop();
+		m_dropped++;
+	}
+	m_frameQue.push(std::move(fdf));
+	lock.unlock();
+}
+
+////////////////////////////////////////////////////////////////////////
+// compares a 16x16 grid of luma samples with the previous frame's, called in frame order by Add():
+bool FaceDetectionThreadMgr::SceneChanged(FFVideo_Image& im)
+{
+	const int32_t grid = 16;
+
+	if (!im.mp_pixels || im.m_width < grid || im.m_height < grid)
+		return false;
+
+	// gray samples directly, the colour types use green, their largest luma component:
+	uint32_t bpp = (im.m_type == 2) ? 1 : ((im.m_type == 1 || im.m_type == 4) ? 4 : 3);
+	uint32_t channel = (im.m_type == 2) ? 0 : 1;
+
+	std::vector<uint8_t> samples( grid * grid );
+	for (int32_t gy = 0; gy < grid; gy++)
+	{
+		uint32_t y = (uint32_t)(((2 * gy + 1) * im.m_height) / (2 * grid));
+		for (int32_t gx = 0; gx < grid; gx++)
+		{
+			uint32_t x = (uint32_t)(((2 * gx + 1) * im.m_width) / (2 * grid));
+			samples[gy * grid + gx] = im.mp_pixels[((size_t)y * im.m_width + x) * bpp + channel];
+		}
+	}
+
+	bool changed = false;
+	if (m_scene_grid.size() == samples.size())
+	{
+		uint32_t total = 0;
+		for (size_t i = 0; i < samples.size(); i++)
+			total += (uint32_t)std::abs( (int32_t)samples[i] - (int32_t)m_scene_grid[i] );
+
+		changed = ((float)total / (float)samples.size() > m_scene_change);
+	}
+	m_scene_grid.swap( samples );
+
+	return changed;
+}
+
+////////////////////////////////////////////////////////////////////////
+// runs in frame order under m_deliver_lock: a detected frame restarts the trackers on its faces,
+// others take their faces from the trackers. A lost face asks for detection on the next frame:
+void FaceDetectionThreadMgr::Track(FaceDetectionFrame& fdf)
+{
+	if (fdf.m_detected)
+	{
+		m_trackers.clear();
+		for (size_t i = 0; i < fdf.m_detections.size(); i++)
+		{
+			m_trackers.push_back( correlation_tracker() );
+			m_trackers.back().start_track( fdf.m_gray, drectangle( fdf.m_detections[i] ) );
+		}
+		m_track_nr = fdf.m_gray.nr();
+		m_track_nc = fdf.m_gray.nc();
+		return;
+	}
+
+	double min_psr = m_track_min_psr;
+	bool lost = false;
+
+	// the detection scale changed since the trackers started, their boxes are another image's units:
+	if (m_trackers.size() > 0 && (fdf.m_gray.nr() != m_track_nr || fdf.m_gray.nc() != m_track_nc))
+	{
+		m_trackers.clear();
+		lost = true;
+	}
+
+	fdf.m_detections.clear();
+	for (size_t i = 0; i < m_trackers.size(); )
+	{
+		double psr = m_trackers[i].update( fdf.m_gray );
+		if (psr < min_psr)
+		{
+			m_trackers.erase( m_trackers.begin() + i );
+			lost = true;
+			continue;
+		}
+		rectangle tracked = m_trackers[i].get_position();
+		fdf.m_detections.push_back( tracked );
+		i++;
+	}
+	if (lost)
+	{
+		m_force_detect = true;
+	}
+
+	if (m_faceFeaturesEnabled && mp_faceDetector)
+	{
+		mp_faceDetector->FitLandmarks( fdf.m_gray, fdf.m_detections, fdf.m_facesLandmarkSets );
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// with m_deliver_lock held, fdf is the next frame in order:
+void FaceDetectionThreadMgr::DeliverInOrder(FaceDetectionFrame& fdf)
+{
+	if (m_faceDetectorEnabled)
+	{
+		if (fdf.m_gray.size() > 0)
+			Track( fdf );
+		else if (fdf.m_detected)
+		{
+			m_held_detections = fdf.m_detections;
+			m_held_landmarks = fdf.m_facesLandmarkSets;
+			m_held_im_size = fdf.m_detect_im_size;
+		}
+		else
+		{
+			// skipped by the detection stride, the latest faces are held:
+			fdf.m_detections = m_held_detections;
+			fdf.m_facesLandmarkSets = m_held_landmarks;
+			fdf.m_detect_im_size = m_held_im_size;
+		}
+
+		// only detection measures the detectors, index hits cost next to nothing:
+		if (fdf.m_detected && !fdf.m_indexed)
+			AutoTune( fdf );
+
+		if (fdf.m_detected)
+			m_detect_frames++;
+		else m_track_frames++;
+
+		// a face not found again in its region may have moved out of it:
+		if (!fdf.m_full_scan && fdf.m_detected && fdf.m_detections.size() < (size_t)fdf.m_roi_count)
+			m_roi_force_full = true;
+
+		// the regions for the next frames to detect in:
+		if (m_roi_detection && fdf.m_detect_im_size.x > 0.0f && fdf.m_detect_im_size.y > 0.0f)
+		{
+			std::lock_guard<std::mutex> roi_lock(m_roi_lock);
+			m_roi_faces.clear();
+			for (size_t i = 0; i < fdf.m_detections.size(); i++)
+			{
+				const rectangle& r = fdf.m_detections[i];
+				m_roi_faces.push_back( drectangle( r.left() / fdf.m_detect_im_size.x, r.top() / fdf.m_detect_im_size.y,
+																					 (r.right() + 1) / fdf.m_detect_im_size.x, (r.bottom() + 1) / fdf.m_detect_im_size.y ) );
+			}
+		}
+	}
+
+	// send results to the client: 
+	if (mp_frame_cb)
+	{
+		(mp_frame_cb)(mp_frame_object, fdf);
+	}
+
+	// in frame order, so the exporter can follow faces between frames; it copies & queues, never writes here:
+	FaceChipExporter* p_exporter = mp_chipExporter;
+	if (p_exporter && fdf.m_facesImages.size() > 0)
+	{
+		p_exporter->Submit( fdf );
+	}
+
+	// the client & exporter have copied what they keep:
+	RecycleImages( fdf.m_facesImages );
+}
+
+////////////////////////////////////////////////////////////////////////
+// scales are kept to 0.05 steps, so the FaceIndex sidecars stay few as the scale moves:
+static float QuantizeDetectionScale(float scale, bool up)
+{
+	return (up ? std::ceil( scale * 20.0f - 0.001f ) : std::floor( scale * 20.0f + 0.001f )) / 20.0f;
+}
+
+////////////////////////////////////////////////////////////////////////
+// called in frame order with each detected frame; decides once per window of them:
+void FaceDetectionThreadMgr::AutoTune(FaceDetectionFrame& fdf)
+{
+	const double busy = 0.75;			// queue occupancy that counts as falling behind
+	const double idle = 0.25;			// & the occupancy, with latency under 70% of target, that allows more work
+
+	std::lock_guard<std::mutex> lock(m_tune_lock);
+
+	if (!m_tune.m_enabled)
+		return;
+
+	m_tune_latencies.push_back( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - fdf.m_added ).count() );
+	m_tune_detect_ms += fdf.m_detect_ms;
+	m_tune_occupancy += (m_max_queue > 0) ? (double)Size() / (double)m_max_queue : 0.0;
+
+	size_t n = m_tune_latencies.size();
+	if (n < (size_t)std::max( m_tune.m_window, 1 ))
+		return;
+
+	FACE_AUTOTUNE_DECISION decision;
+	std::sort( m_tune_latencies.begin(), m_tune_latencies.end() );
+	decision.m_frame_num = fdf.m_frame_num;
+	decision.m_latency_ms = m_tune_latencies[std::min( n - 1, (n * 9) / 10 )];
+	decision.m_detect_ms = m_tune_detect_ms / n;
+	decision.m_occupancy = m_tune_occupancy / n;
+	uint64_t dropped = m_dropped;
+	decision.m_dropped = dropped - m_tune_dropped;
+	m_tune_dropped = dropped;
+	m_tune_latencies.clear();
+	m_tune_detect_ms = 0.0;
+	m_tune_occupancy = 0.0;
+
+	float scale = m_face_detection_scale;
+	float max_scale = m_max_detect_scale;
+	float min_scale = std::min( m_tune.m_min_scale, max_scale );
+	int32_t stride = m_detect_stride;
+	double target = m_tune.m_target_ms;
+
+	decision.m_scale_from = decision.m_scale_to = scale;
+	decision.m_stride_from = decision.m_stride_to = stride;
+
+	if (decision.m_latency_ms > target || decision.m_occupancy > busy || decision.m_dropped > 0)
+	{
+		if (scale > min_scale + 0.001f)
+		{
+			// detection time goes with the pixels scanned, the square of the scale:
+			double ratio = (decision.m_latency_ms > target) ? std::sqrt( target / decision.m_latency_ms ) : 0.9;
+			float lowered = QuantizeDetectionScale( (float)(scale * ratio * 0.95), false );
+			if (lowered >= scale)
+				lowered = scale - 0.05f;
+			decision.m_scale_to = std::max( lowered, min_scale );
+
+			if (decision.m_latency_ms > target)
+				decision.m_reason = "over target, scale lowered";
+			else if (decision.m_dropped > 0)
+				decision.m_reason = "frames dropped, scale lowered";
+			else decision.m_reason = "queue filling, scale lowered";
+		}
+		else if (stride < m_tune.m_max_stride)
+		{
+			decision.m_stride_to = stride + 1;
+			decision.m_reason = "at minimum scale, stride raised";
+		}
+		else decision.m_reason = "at minimum scale & maximum stride";
+	}
+	else if (decision.m_latency_ms < target * 0.7 && decision.m_occupancy < idle)
+	{
+		// scale is precision, so stride is given back first:
+		if (stride > 1)
+		{
+			decision.m_stride_to = stride - 1;
+			decision.m_reason = "under target, stride lowered";
+		}
+		else if (scale < max_scale - 0.001f)
+		{
+			float raised = QuantizeDetectionScale( scale * 1.1f, true );
+			if (raised <= scale)
+				raised = scale + 0.05f;
+			decision.m_scale_to = std::min( raised, max_scale );
+			decision.m_reason = "under target, scale raised";
+		}
+	}
+
+	m_tune_last = decision;
+	m_tune_windows++;
+
+	if (decision.m_scale_to != scale || decision.m_stride_to != stride)
+	{
+		m_face_detection_scale = decision.m_scale_to;
+		m_detect_stride = decision.m_stride_to;
+		if (decision.m_scale_to != scale)
+			DetectionScaleChanged();
+
+		const size_t max_decisions = 32;
+		m_tune_decisions.push_back( decision );
+		while (m_tune_decisions.size() > max_decisions)
+			m_tune_decisions.pop_front();
+		m_tune_changes++;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::SetAutoTune(const FACE_AUTOTUNE_PARAMS& params)
+{
+	std::lock_guard<std::mutex> lock(m_tune_lock);
+
+	m_tune = params;
+	m_tune_latencies.clear();
+	m_tune_detect_ms = 0.0;
+	m_tune_occupancy = 0.0;
+	m_tune_dropped = m_dropped;
+
+	if (!m_tune.m_enabled)
+	{
+		float scale = m_face_detection_scale;
+		m_face_detection_scale = (float)m_max_detect_scale;
+		m_detect_stride = 1;
+		if (m_face_detection_scale != scale)
+			DetectionScaleChanged();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// the faces found so far are in the old scale's units: the next frame taken is detected in full,
+// & Track() drops trackers whose image size no longer matches, as frames taken before this arrive:
+void FaceDetectionThreadMgr::DetectionScaleChanged(void)
+{
+	m_force_detect = true;
+	m_roi_force_full = true;
+
+	std::lock_guard<std::mutex> roi_lock(m_roi_lock);
+	m_roi_faces.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::GetAutoTuneStats(FACE_AUTOTUNE_STATS& stats)
+{
+	std::lock_guard<std::mutex> lock(m_tune_lock);
+
+	stats.m_enabled = m_tune.m_enabled;
+	stats.m_scale = m_face_detection_scale;
+	stats.m_max_scale = m_max_detect_scale;
+	stats.m_stride = m_detect_stride;
+	stats.m_last_window = m_tune_last;
+	stats.m_windows = m_tune_windows;
+	stats.m_changes = m_tune_changes;
+	stats.m_decisions.assign( m_tune_decisions.begin(), m_tune_decisions.end() );
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::TakePooledImages(std::vector<FFVideo_Image>& images, size_t count)
+{
+	std::lock_guard<std::mutex> lock(m_pool_lock);
+
+	while (images.size() < count && m_image_pool.size() > 0)
+	{
+		images.push_back( FFVideo_Image() );
+		images.back().Swap( m_image_pool.back() );
+		m_image_pool.pop_back();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::RecycleImages(std::vector<FFVideo_Image>& images)
+{
+	const size_t max_pooled = 64;
+
+	std::lock_guard<std::mutex> lock(m_pool_lock);
+
+	for (size_t i = 0; i < images.size() && m_image_pool.size() < max_pooled; i++)
+	{
+		if (images[i].mp_pixels)
+		{
+			m_image_pool.push_back( FFVideo_Image() );
+			m_image_pool.back().Swap( images[i] );
+		}
+	}
+	images.clear();
+}
+
+////////////////////////////////////////////////////////////////////////
+// workers finish out of order; a completed frame waits until every frame taken before it has 
+// been delivered. Delivery happens under m_deliver_lock, so the callback is never re-entered:
+void FaceDetectionThreadMgr::Deliver(FaceDetectionFrame& fdf)
+{
+	std::lock_guard<std::mutex> lock(m_deliver_lock);
+
+	if (fdf.m_seq != m_deliver_seq)
+	{
+		m_completed.emplace(fdf.m_seq, std::move(fdf));
+		return;
+	}
+
+	DeliverInOrder( fdf );
+	m_deliver_seq++;
+
+	// and any that were waiting on this one:
+	auto it = m_completed.begin();
+	while (it != m_completed.end() && it->first == m_deliver_seq)
+	{
+		DeliverInOrder( it->second );
+		m_deliver_seq++;
+		it = m_completed.erase(it);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::SetFaceIndexMedia(const std::string& media_path, double frame_rate)
+{
+	std::lock_guard<std::mutex> lock(m_index_lock);
+
+	if (media_path != m_index_media)
+	{
+		mp_faceIndex = NULL;
+		m_index_scale = 0.0f;	// opens on next use
+	}
+	m_index_media = media_path;
+	m_index_frame_rate = frame_rate;
+}
+
+////////////////////////////////////////////////////////////////////////
+std::shared_ptr<FaceIndex> FaceDetectionThreadMgr::GetFaceIndex(void)
+{
+	std::lock_guard<std::mutex> lock(m_index_lock);
+
+	if (m_index_media.empty())
+		return NULL;
+
+	// results are in the units of the detection image, so each model & scale has its own index:
+	if (m_index_model != m_face_model || m_index_scale != m_face_detection_scale)
+	{
+		m_index_model = m_face_model;
+		m_index_scale = m_face_detection_scale;
+		mp_faceIndex = FaceIndex::Open( m_index_media, m_index_model, m_index_scale );
+	}
+
+	return mp_faceIndex;
+}
+
+////////////////////////////////////////////////////////////////////////
+// a frame in the index skips detection; the image is still made when the trackers or face images need it.
+// False, with fdf unchanged, if the frame is not indexed or was indexed from a different detection size:
+bool FaceDetectionThreadMgr::ServeFromIndex(FaceDetector* p_faceDetector, FaceDetectionFrame& fdf, FFVideo_Image* p_luma)
+{
+	std::shared_ptr<FaceIndex> p_index = GetFaceIndex();
+	if (!p_index)
+		return false;
+
+	FF_Vector2D detect_im_size;
+	std::vector<rectangle> detections;
+	std::vector<full_object_detection> faceLandmarkSets;
+	if (!p_index->Lookup( fdf.m_frame_num, m_faceFeaturesEnabled, detect_im_size, detections, faceLandmarkSets ))
+		return false;
+
+	bool face_images = m_faceImagesEnabled && m_faceFeaturesEnabled;
+	if (m_tracking || face_images)
 	{
-		FaceDetectionFrame fdf;
-		fdf.m_im.Clone(im);
-		fdf.m_frame_num = frame_num;
+		p_faceDetector->SetImage( fdf.m_im, p_index->GetDetectionScale(), NeedsColorFrames(), p_luma );
+
+		FF_Vector2D im_size;
+		p_faceDetector->GetDlibImageSize( im_size );
+		if (im_size.x != detect_im_size.x || im_size.y != detect_im_size.y)
+			return false;
 
-		std::unique_lock<std::shared_mutex> lock(m_queue_lock);
-		m_frameQue.push(fdf);
-		lock.unlock();
+		if (m_tracking)
+			dlib::assign_image( fdf.m_gray, p_faceDetector->GetDlibImage() );
 	}
+
+	fdf.m_detect_im_size = detect_im_size;
+	fdf.m_detections.swap( detections );
+	fdf.m_facesLandmarkSets.swap( faceLandmarkSets );
+	fdf.m_detected = true;
+	fdf.m_full_scan = true;
+	fdf.m_indexed = true;
+	fdf.m_detect_scale = p_index->GetDetectionScale();
+
+	if (face_images)
+	{
+		TakePooledImages( fdf.m_facesImages, fdf.m_detections.size() );
+		p_faceDetector->GetFaceImages( fdf.m_detections, fdf.m_facesLandmarkSets, fdf.m_facesImages, m_faceImagesStandardized );
+	}
+
+	m_indexed_frames++;
+
+	return true;
 }
 
 ////////////////////////////////////////////////////////////////////////
-void FaceDetectionThreadMgr::FrameProcessingLoop(void)
+// only full scans are stored, a region of interest scan can miss faces outside its regions. The pts
+// is derived from the frame number, as the frames carry no timestamp of their own:
+void FaceDetectionThreadMgr::StoreInIndex(FaceDetectionFrame& fdf)
+{
+	if (!fdf.m_detected || !fdf.m_full_scan || fdf.m_indexed)
+		return;
+
+	// auto-tuning may have moved the scale since this frame was detected:
+	std::shared_ptr<FaceIndex> p_index = GetFaceIndex();
+	if (!p_index || p_index->GetDetectionScale() != fdf.m_detect_scale)
+		return;
+
+	int64_t pts = (m_index_frame_rate > 0.0) ? (int64_t)((double)fdf.m_frame_num * 1000000.0 / m_index_frame_rate) : AV_NOPTS_VALUE;
+
+	p_index->Store( fdf.m_frame_num, pts, fdf.m_detect_im_size, fdf.m_detections, fdf.m_facesLandmarkSets );
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceDetectionThreadMgr::FrameProcessingLoop(int32_t worker)
 {
 	// we are inside the thread now, possibly not for the first time...
-	// check if the face detector has been allocated (meaning this is our first use)
+	// check if this worker's face detector has been allocated (meaning this is our first use)
 	//
 	bool good(true); // becomes false when bad occurs
 	//
-	if (!m_faceDetectorInitialized)
+	FaceDetector* p_faceDetector = m_faceDetectors[worker];
+	if (!p_faceDetector)
 	{
-		mp_faceDetector = new FaceDetector(mp_app, m_face_model);
-		if (mp_faceDetector)
+		p_faceDetector = new FaceDetector(m_data_dir, m_face_model);
+		if (p_faceDetector && !p_faceDetector->IsLoaded())
 		{
-			m_faceDetectorInitialized = true;
+			delete p_faceDetector;
+			p_faceDetector = NULL;
+		}
+		if (p_faceDetector)
+		{
+			m_faceDetectors[worker] = p_faceDetector;
+
+			// the first detector ready is also the one used for landmark lookups:
+			std::lock_guard<std::mutex> lock(m_deliver_lock);
+			if (!mp_faceDetector)
+			{
+				mp_faceDetector = p_faceDetector;
+				m_faceDetectorInitialized = true;
+			}
 		}
 		else
 		{
 			good = false;
-			m_err = "failed to allocate FaceDetector!";
+			m_err = "failed to load the face models!";
 		}
 	}
 
+	if (good)
+		p_faceDetector->SetDetectThreads( m_worker_detect_threads );
+
 	uint64_t milliseconds = 1000 / 120; // the demoninator is how many times per second we will loop
 
 	uint64_t nanosleep_param = milliseconds * 10; // each ms is 10 nanosleep units
 
+	std::vector<drectangle> roi_faces;	// copied when a frame is taken
+
+	FFVideo_Tracer::NameThread( "face detection " + std::to_string(worker) );
+
 	while (good)
 	{
 		if (m_stop_frame_processing_loop)
@@ -362,28 +1390,98 @@ void FaceDetectionThreadMgr::FrameProcessingLoop(void)
 		}
 		else
 		{
-			std::shared_lock<std::shared_mutex> rlock(m_queue_lock);
-			bool work_to_do = !m_frameQue.empty();
-			rlock.unlock();
-
-			while (work_to_do)
+			while (true)
 			{
+				// the sequence number is taken with the frame, so it matches queue order:
 				std::unique_lock<std::shared_mutex> lock(m_queue_lock);
-				FaceDetectionFrame fdf = m_frameQue.front();
+				if (m_frameQue.empty())
+				{
+					lock.unlock();
+					break;
+				}
+				FaceDetectionFrame fdf = std::move(m_frameQue.front());
 				m_frameQue.pop();
-				work_to_do = !m_frameQue.empty();
+				fdf.m_seq = m_next_seq++;
+				//
+				// in tracking mode most frames skip detection, & auto-tuning may stride over frames:
+				int32_t stride = m_detect_stride;
+				fdf.m_detected = true;
+				if (m_tracking)
+				{
+					fdf.m_detected = m_force_detect.exchange(false) || (++m_frames_since_detect >= m_detect_interval * stride);
+					if (fdf.m_detected)
+						m_frames_since_detect = 0;
+				}
+				else if (stride > 1)
+				{
+					fdf.m_detected = (++m_frames_since_detect >= stride);
+					if (fdf.m_detected)
+						m_frames_since_detect = 0;
+				}
+				//
+				// with regions of interest, most detection frames only scan around the latest faces:
+				fdf.m_full_scan = true;
+				if (m_roi_detection && fdf.m_detected)
+				{
+					std::unique_lock<std::mutex> roi_lock(m_roi_lock);
+					roi_faces = m_roi_faces;
+					roi_lock.unlock();
+
+					fdf.m_full_scan = roi_faces.empty() || m_roi_force_full.exchange(false) || (++m_frames_since_full >= m_full_scan_period);
+					if (fdf.m_full_scan)
+						m_frames_since_full = 0;
+				}
 				lock.unlock();
 
 				// do the work of this thread:
 				if (m_faceDetectorEnabled)
 				{
-					mp_faceDetector->SetImage( fdf.m_im, m_face_detection_scale );
+					FFVideo_Image* p_luma = (fdf.m_luma.mp_pixels) ? &fdf.m_luma : NULL;
+
+					// played or stepped to before, or pre-indexed:
+					if (ServeFromIndex( p_faceDetector, fdf, p_luma ))
+					{
+						Deliver(fdf);
+						continue;
+					}
+
+					// strided over, delivered with the latest faces:
+					if (!fdf.m_detected && !m_tracking)
+					{
+						Deliver(fdf);
+						continue;
+					}
+
+					auto detect_start = std::chrono::steady_clock::now();
+					fdf.m_detect_scale = m_face_detection_scale;
+					p_faceDetector->SetImage( fdf.m_im, fdf.m_detect_scale, NeedsColorFrames(), p_luma );
+					p_faceDetector->GetDlibImageSize( fdf.m_detect_im_size );
+
+					// the trackers need the image, they run in frame order as results are delivered:
+					if (m_tracking)
+					{
+						dlib::assign_image( fdf.m_gray, p_faceDetector->GetDlibImage() );
+						if (!fdf.m_detected)
+						{
+							Deliver(fdf);
+							continue;
+						}
+					}
 
 					// this work is time consuming, so check if we're supposed to quit: 
 					if (m_stop_frame_processing_loop)
 						break;
 
-					mp_faceDetector->GetFaceBoxes( fdf.m_detections );
+					if (fdf.m_full_scan)
+					{
+						p_faceDetector->GetFaceBoxes( fdf.m_detections );
+					}
+					else
+					{
+						p_faceDetector->GetFaceBoxesInROIs( fdf.m_detections, roi_faces, m_roi_margin );
+						fdf.m_roi_count = (int32_t)roi_faces.size();
+					}
+					fdf.m_pixels_scanned = p_faceDetector->GetPixelsScanned();
 
 					// this work is time consuming, so check if we're supposed to quit: 
 					if (m_stop_frame_processing_loop)
@@ -391,30 +1489,38 @@ void FaceDetectionThreadMgr::FrameProcessingLoop(void)
 
 					if (m_faceFeaturesEnabled)
 					{
-						mp_faceDetector->GetFaceLandmarkSets( fdf.m_detections, fdf.m_facesLandmarkSets );
+						p_faceDetector->GetFaceLandmarkSets( fdf.m_detections, fdf.m_facesLandmarkSets );
 					}
 
+					// kept for later plays & steps of this frame:
+					StoreInIndex( fdf );
+
 					// this work is time consuming, so check if we're supposed to quit: 
 					if (m_stop_frame_processing_loop)
 						break;
 
 					if (m_faceImagesEnabled && m_faceFeaturesEnabled)
 					{
-						mp_faceDetector->GetFaceImages( fdf.m_detections, fdf.m_facesLandmarkSets, fdf.m_facesImages, m_faceImagesStandardized );
+						TakePooledImages( fdf.m_facesImages, fdf.m_detections.size() );
+						p_faceDetector->GetFaceImages( fdf.m_detections, fdf.m_facesLandmarkSets, fdf.m_facesImages, m_faceImagesStandardized );
 					}
+					fdf.m_detect_ms = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - detect_start ).count();
+
+					std::unique_lock<std::mutex> tracer_lock(m_tracer_lock);
+					std::shared_ptr<FFVideo_Tracer> p_tracer = mp_tracer;
+					tracer_lock.unlock();
+					if (p_tracer)
+						p_tracer->Complete( "face", "face detect", FFVideo_Tracer::Microseconds(detect_start), FFVideo_Tracer::Now(), 
+																fdf.m_frame_num, "faces", (int64_t)fdf.m_detections.size() );
 				}
-						
-				// send results to the client: 
-				if (mp_frame_cb)
-				{
-					(mp_frame_cb)(mp_frame_object, fdf);
-				}
+
+				Deliver(fdf);
 			}
 
 			good = !m_stop_frame_processing_loop;
 		}
-		nanosleep(nanosleep_param);
+		FFVideo_Sleep100ns(nanosleep_param);
 	}
 
-	m_frame_processing_loop_ended = true;
-}
\ No newline at end of file
+	m_workers_running--;
+}
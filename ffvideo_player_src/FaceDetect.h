@@ -3,11 +3,21 @@
 #ifndef _FACEDETECT_H_
 #define _FACEDETECT_H_
 
-#include "ffvideo_player_app.h"
+// no wxWidgets here, so the face detection benchmark builds without the player:
+#include <math.h>
+#include "ffvideo.h"
+#include "util.h"
 
 #include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_processing/render_face_detections.h>
 #include <dlib/image_processing.h>
+#include <dlib/image_processing/correlation_tracker.h>
+
+#include <map>
+#include <memory>
+#include <future>
+#include <functional>
+#include <deque>
 
 
 enum class FACE_MODEL {
@@ -16,18 +26,119 @@ enum class FACE_MODEL {
 };
 
 
+// the dlib HOG scanner behind frontal_face_detector:
+typedef dlib::frontal_face_detector::image_scanner_type FACE_SCANNER;
+
+//------------------------------------------------------------------------------
+// the models a FaceDetector uses; loaded once, then only read, so shared by every detector:
+class FaceModels
+{
+public:
+	dlib::frontal_face_detector								m_detector;				// copied by each detector, it keeps scanning state
+	dlib::shape_predictor											m_sp;							// const use is thread safe
+	std::vector<FACE_SCANNER::fhog_filterbank> m_filterbanks;		// m_detector's weights, one per sub-detector
+	std::vector<double>												m_thresholds;
+};
+
+//------------------------------------------------------------------------------
+// the process wide cache of FaceModels, one per FACE_MODEL, loaded in the background on first request:
+class FaceModelCache
+{
+public:
+	// starts loading if not already, without waiting:
+	static void Preload( const std::string& data_dir, FACE_MODEL face_model );
+
+	// waits for the models if they are loading; NULL if they failed to load, when the next request tries again:
+	static std::shared_ptr<const FaceModels> Get( const std::string& data_dir, FACE_MODEL face_model );
+
+	static bool IsLoaded( FACE_MODEL face_model );
+
+private:
+	static std::shared_future<std::shared_ptr<const FaceModels>> Request( const std::string& data_dir, FACE_MODEL face_model );
+	static std::shared_ptr<const FaceModels> Load( std::string model_path );
+
+	static std::mutex																														m_lock;
+	static std::map<FACE_MODEL, std::shared_future<std::shared_ptr<const FaceModels>>>	m_models;
+};
+
+//------------------------------------------------------------------------------
+// one row of FaceDetector::Benchmark() results:
+typedef struct _FACE_DETECT_BENCHMARK
+{
+	float				m_scale = 1.0f;					// the face detection scale
+	int32_t			m_threads = 1;
+	double			m_ms_per_frame = 0.0;		// GetFaceBoxes() only, the image is set once
+	int32_t			m_faces = 0;
+} FACE_DETECT_BENCHMARK;
+
+//------------------------------------------------------------------------------
+// one row of FaceDetector::BenchmarkFaces() results:
+typedef struct _FACE_LANDMARK_BENCHMARK
+{
+	int32_t			m_faces = 0;
+	int32_t			m_threads = 1;
+	double			m_landmark_ms = 0.0;		// FitLandmarks() of every face
+	double			m_chip_ms = 0.0;				// GetFaceImages() of every face, standardized chips
+} FACE_LANDMARK_BENCHMARK;
+
+//------------------------------------------------------------------------------
+// one unit of an intra-frame parallel detection: a band of rows of one pyramid level:
+typedef struct _FACE_DETECT_TILE
+{
+	int32_t			m_level = 0;
+	long				m_top = 0;
+	long				m_bottom = 0;						// inclusive
+} FACE_DETECT_TILE;
+
+
 class FaceDetector
 {
 public:
-	FaceDetector(TheApp* app, FACE_MODEL face_model);
+	// the models are read from data_dir, the player's data directory:
+	FaceDetector(const std::string& data_dir, FACE_MODEL face_model);
 	~FaceDetector();
 
-	void SetImage( FFVideo_Image& im, float detection_scale );
+	// false if the face models could not be loaded, the detector is then unusable:
+	bool IsLoaded( void ) { return (mp_models != NULL); }
+
+	// threads used within one GetFaceBoxes(), 1 scans the image pyramid serially:
+	void SetDetectThreads( int32_t threads ) { m_detect_threads = std::max( 1, threads ); }
+	int32_t GetDetectThreads( void ) { return m_detect_threads; }
+
+	// times GetFaceBoxes() on im rescaled to 1080p, serially & with the detect threads, at each scale:
+	bool Benchmark( FFVideo_Image& im, std::vector<float>& scales, int32_t iterations, 
+									std::vector<FACE_DETECT_BENCHMARK>& results );
+
+	// times landmark fitting & face image extraction of the faces found in im, repeated to each of face_counts,
+	// serially & with the detect threads. A centered face is assumed if none are found:
+	bool BenchmarkFaces( FFVideo_Image& im, std::vector<int32_t>& face_counts, int32_t iterations, 
+											 std::vector<FACE_LANDMARK_BENCHMARK>& results );
+
+	// converts the RGB, RGBA, BGR or BGRA frame to scaled greyscale for detection; keep_frame retains
+	// a copy of the frame for the face images GetFaceImages() clips from it. When p_luma,
+	// a gray image of the same frame at any size, is given its pixels are sampled instead.
+	// im may itself be gray, type 2:
+	void SetImage( FFVideo_Image& im, float detection_scale, bool keep_frame = false, FFVideo_Image* p_luma = NULL );
 
 	void GetDlibImageSize( FF_Vector2D& size ) { size.Set( m_dlib_real_im.nc(), m_dlib_real_im.nr() ); }
 
+	// the scaled greyscale image SetImage() made, that detection & landmarks run on:
+	const dlib::array2d<uint8_t>& GetDlibImage( void ) { return m_dlib_real_im; }
+
 	bool GetFaceBoxes( std::vector<dlib::rectangle>& detections );
 
+	// region of interest re-detection: scans only around faces, normalized 0-1 top origin boxes, found in an
+	// earlier frame, each expanded by margin of its size on every side. Regions are sampled from the frame given 
+	// to SetImage(), or its luma plane when that is full size, which must still exist, at full resolution or down 
+	// to where the face is twice the detection window. Detections are in the units of the detection image, as 
+	// with GetFaceBoxes():
+	bool GetFaceBoxesInROIs( std::vector<dlib::rectangle>& detections, const std::vector<dlib::drectangle>& faces, float margin );
+
+	// pixels scanned by the most recent GetFaceBoxes() or GetFaceBoxesInROIs(), full resolution pyramid level only:
+	uint64_t GetPixelsScanned( void ) { return m_pixels_scanned; }
+
+	// one image per face, in parallel with the detect threads. Images already in face_images are reused, 
+	// their pixels kept when the same size. Bottom origin, as the frames:
 	void GetFaceImages( std::vector<dlib::rectangle>& detections, 
 											std::vector<dlib::full_object_detection>& faceLandmarkSets,
 											std::vector<FFVideo_Image>& face_images,
@@ -36,6 +147,11 @@ public:
 	bool GetFaceLandmarkSets( std::vector<dlib::rectangle>& detections, 
 	                          std::vector<dlib::full_object_detection>& faceLandmarkSets );
 
+	// the same on an image other than the one set; the shape predictor is only read, so any thread may call this.
+	// Faces are fit in parallel with the detect threads:
+	void FitLandmarks( const dlib::array2d<uint8_t>& im, std::vector<dlib::rectangle>& detections, 
+										 std::vector<dlib::full_object_detection>& faceLandmarkSets ) const;
+
 	void GetLandmarks( dlib::full_object_detection& oneFace_landmarkSet,
 										 std::vector<FF_Vector2D>& jawline,
 										 std::vector<FF_Vector2D>& rtBrow,
@@ -50,19 +166,38 @@ public:
 
 private:
 
+	// the pyramid levels & bands of rows of them are scanned in parallel, then merged with
+	// the same non-max suppression dlib's object_detector applies to a serial scan:
+	bool GetFaceBoxesParallel( std::vector<dlib::rectangle>& detections );
+	void SuppressOverlaps( std::vector<std::pair<double, dlib::rectangle>>& dets, std::vector<dlib::rectangle>& detections );
+	void GrayFromFrame( const FFVideo_Image& src, long x0, long y0, long width, long height, dlib::array2d<uint8_t>& dst );
+	void ScanTiles( int32_t thread, std::vector<FACE_DETECT_TILE>& tiles, std::atomic<int32_t>& next_tile,
+									std::vector<std::pair<double, dlib::rectangle>>& dets );
+
+	// calls fn( face, thread ) for each of count faces, on up to the detect threads, each taking at least 
+	// min_per_thread faces; thread 0 is the calling thread:
+	void ForEachFace( size_t count, size_t min_per_thread, const std::function<void(size_t, int32_t)>& fn ) const;
 	
 	dlib::frontal_face_detector			m_detector;
 
+	int32_t													m_detect_threads;
+	std::vector<FACE_SCANNER>				m_scanners;				// single level copies of m_detector's scanner, one per thread
+	dlib::array<dlib::array2d<uint8_t>>	m_pyramid;			// levels 1 & up of m_dlib_real_im
+
 	FACE_MODEL											m_face_model;
-	dlib::shape_predictor						m_sp;
+	std::shared_ptr<const FaceModels>	mp_models;			// the shape predictor & filters, shared process wide
 
-	FFVideo_Image										m_im;							// video frame as delivered by ffmpeg
+	FFVideo_Image										m_im;							// video frame as delivered by ffmpeg, when kept
 	bool									          m_image_set;
 
-	float														m_detect_scale;		// normalized size factor between the two below
+	float														m_detect_scale;		// normalized size factor between the frame and below
 
-	dlib::array2d<uint8_t>					m_dlib_im;				// is same w,h as m_im but greyscale
-	dlib::array2d<uint8_t>          m_dlib_real_im;		// potentially scaled to speed up detections or enhance precision
+	dlib::array2d<uint8_t>          m_dlib_real_im;		// greyscale, potentially scaled to speed up detections or enhance precision
+	std::vector<uint32_t>						m_gray_x_offsets;	// GrayFromFrame()'s source byte offset per column
+	const FFVideo_Image*						mp_src;						// the frame or luma last set, for region of interest scans
+	dlib::array2d<uint8_t>					m_roi_im;					// one region of interest
+	std::vector<dlib::array2d<uint8_t>>	m_chips;				// one face chip being extracted, per thread
+	uint64_t												m_pixels_scanned;
 };
 
 
@@ -71,13 +206,27 @@ private:
 class FaceDetectionFrame
 {
 public:
-	FaceDetectionFrame() {};
+	FaceDetectionFrame() : m_frame_num(0), m_seq(0), m_detected(false), m_full_scan(true), m_roi_count(0), m_pixels_scanned(0), m_indexed(false),
+		m_detect_ms(0.0), m_detect_scale(0.0f) {};
 
 	// copy constructor 
 	FaceDetectionFrame(const FaceDetectionFrame& fdf)
 	{
 		m_im.Clone(fdf.m_im);
+		if (fdf.m_luma.mp_pixels)
+			m_luma.Clone(fdf.m_luma);
 		m_frame_num         = fdf.m_frame_num;
+		m_seq               = fdf.m_seq;
+		m_detected          = fdf.m_detected;
+		m_full_scan         = fdf.m_full_scan;
+		m_roi_count         = fdf.m_roi_count;
+		m_pixels_scanned    = fdf.m_pixels_scanned;
+		m_indexed           = fdf.m_indexed;
+		m_added             = fdf.m_added;
+		m_detect_ms         = fdf.m_detect_ms;
+		m_detect_scale      = fdf.m_detect_scale;
+		dlib::assign_image( m_gray, fdf.m_gray );
+		m_detect_im_size    = fdf.m_detect_im_size;
 		m_detections        = fdf.m_detections;
 		m_facesLandmarkSets = fdf.m_facesLandmarkSets;
 		m_facesImages       = fdf.m_facesImages;
@@ -89,7 +238,21 @@ public:
 		if (this != &fdf)
 		{
 			m_im.Clone(fdf.m_im);
+			if (fdf.m_luma.mp_pixels)
+				m_luma.Clone(fdf.m_luma);
+			else m_luma.Empty();
 			m_frame_num         = fdf.m_frame_num;
+			m_seq               = fdf.m_seq;
+			m_detected          = fdf.m_detected;
+			m_full_scan         = fdf.m_full_scan;
+			m_roi_count         = fdf.m_roi_count;
+			m_pixels_scanned    = fdf.m_pixels_scanned;
+			m_indexed           = fdf.m_indexed;
+			m_added             = fdf.m_added;
+			m_detect_ms         = fdf.m_detect_ms;
+			m_detect_scale      = fdf.m_detect_scale;
+			dlib::assign_image( m_gray, fdf.m_gray );
+			m_detect_im_size    = fdf.m_detect_im_size;
 			m_detections        = fdf.m_detections;
 			m_facesLandmarkSets = fdf.m_facesLandmarkSets;
 			m_facesImages       = fdf.m_facesImages;
@@ -98,21 +261,90 @@ public:
 	}
 
 	FFVideo_Image															m_im;
+	FFVideo_Image															m_luma;							// optional, the frame's luma plane detection uses instead
 	int32_t																		m_frame_num;
+	uint64_t																	m_seq;							// order taken from the queue, results are delivered in this order
+	bool																			m_detected;					// false if the faces were tracked from earlier frames
+	dlib::array2d<uint8_t>										m_gray;							// tracking mode only, the image the faces are tracked in
+	bool																			m_full_scan;				// false if only regions around earlier faces were scanned
+	int32_t																		m_roi_count;				// regions scanned when not a full scan
+	uint64_t																	m_pixels_scanned;		// by detection, see FaceDetector::GetPixelsScanned()
+	bool																			m_indexed;					// the faces came from the media file's FaceIndex, not detection
+	std::chrono::steady_clock::time_point			m_added;						// when Add() queued the frame
+	double																		m_detect_ms;				// worker time spent detecting, 0 if not detected
+	float																			m_detect_scale;			// the scale the frame was detected at
+	FF_Vector2D																m_detect_im_size;		// the image detection ran on, whose units the results are in
 	std::vector<dlib::rectangle>							m_detections;
 	std::vector<dlib::full_object_detection>  m_facesLandmarkSets;
 	std::vector<FFVideo_Image>                m_facesImages;
 };
 
 class RenderCanvas;
+class FaceIndex;
+class FaceChipExporter;
+
+// what Add() does when the detectors fall behind & the queue is full:
+enum class FACE_DROP_POLICY {
+	latest = 0,		// the oldest waiting frame is dropped, so overlays track the newest frames
+	fifo					// the new frame is dropped, frames already waiting are all processed
+};
+
+//------------------------------------------------------------------------------
+// latency targeted auto-tuning of the detection scale & stride, see FaceDetectionThreadMgr::SetAutoTune():
+typedef struct _FACE_AUTOTUNE_PARAMS
+{
+	bool				m_enabled = false;
+	double			m_target_ms = 33.0;				// from Add() to delivery, for frames that are detected
+	float				m_min_scale = 0.2f;				// the scale is not lowered below this; the highest is the set detection scale
+	int32_t			m_max_stride = 4;					// at most 1 in this many frames is detected once the scale is at its minimum
+	int32_t			m_window = 15;						// detected frames measured per decision
+} FACE_AUTOTUNE_PARAMS;
+
+//------------------------------------------------------------------------------
+// one change the auto-tuner made, with the measurements that led to it:
+typedef struct _FACE_AUTOTUNE_DECISION
+{
+	int32_t			m_frame_num = 0;					// the frame that completed the window
+	float				m_scale_from = 0.0f;
+	float				m_scale_to = 0.0f;
+	int32_t			m_stride_from = 1;
+	int32_t			m_stride_to = 1;
+	double			m_latency_ms = 0.0;				// 90th percentile of the window
+	double			m_detect_ms = 0.0;				// mean worker detection time of the window
+	double			m_occupancy = 0.0;				// mean queue fill, 0-1, when those frames were delivered
+	uint64_t		m_dropped = 0;						// frames dropped during the window
+	const char* m_reason = "";
+} FACE_AUTOTUNE_DECISION;
 
 //------------------------------------------------------------------------------
+// returned by FaceDetectionThreadMgr::GetAutoTuneStats():
+typedef struct _FACE_AUTOTUNE_STATS
+{
+	bool																m_enabled = false;
+	float																m_scale = 0.0f;					// in use
+	float																m_max_scale = 0.0f;			// the set detection scale
+	int32_t															m_stride = 1;						// 1 in this many frames is detected
+	FACE_AUTOTUNE_DECISION							m_last_window;					// the latest measurements, even when nothing changed
+	uint64_t														m_windows = 0;					// decisions evaluated
+	uint64_t														m_changes = 0;					// decisions that changed the scale or stride
+	std::vector<FACE_AUTOTUNE_DECISION>	m_decisions;						// the most recent changes, oldest first
+} FACE_AUTOTUNE_STATS;
+
+//------------------------------------------------------------------------------
+// N worker threads, each with its own FaceDetector, take frames from a shared queue. Results
+// complete out of order, a sequencer delivers them to the frame callback in the order taken:
 class FaceDetectionThreadMgr
 {
 public:
-	FaceDetectionThreadMgr(TheApp* app) : mp_app(app), 
-	  mp_frameProcessingThread(NULL), m_stop_frame_processing_loop(false), 
-		m_frame_processing_loop_ended(false), mp_frame_cb(NULL), mp_frame_object(NULL),
+	FaceDetectionThreadMgr(const std::string& data_dir) : m_data_dir(data_dir), 
+	  m_stop_frame_processing_loop(false), m_workers_running(0), m_num_workers(0),
+		m_drop_policy(FACE_DROP_POLICY::latest), m_max_queue(0), m_detect_threads(0), m_worker_detect_threads(1), 
+		m_tracking(false), m_detect_interval(10), m_track_min_psr(7.0), m_scene_change(30.0f), m_force_detect(true), 
+		m_frames_since_detect(0), m_track_nr(0), m_track_nc(0), m_detect_frames(0), m_track_frames(0), 
+		m_roi_detection(false), m_roi_margin(0.5f), m_full_scan_period(15), m_frames_since_full(0), m_roi_force_full(false), m_next_seq(0), m_deliver_seq(0), m_dropped(0),
+		m_index_frame_rate(0.0), m_index_model(FACE_MODEL::sixtyeight), m_index_scale(0.0f), m_indexed_frames(0),
+		mp_chipExporter(NULL), m_detect_stride(1), m_max_detect_scale(0.35f), m_tune_detect_ms(0.0), m_tune_occupancy(0.0), m_tune_dropped(0), m_tune_windows(0), m_tune_changes(0),
+		mp_frame_cb(NULL), mp_frame_object(NULL),
 		m_face_model(FACE_MODEL::sixtyeight), mp_faceDetector(NULL), m_face_detection_scale(0.35f), 
 		m_faceDetectorInitialized(false), m_faceDetectorEnabled(false),
 		m_faceFeaturesEnabled(false), m_faceImagesEnabled(false), m_faceImagesStandardized(false) {};
@@ -121,14 +353,14 @@ public:
 	FaceDetectionThreadMgr(const FFVideo_FrameExporter& obj) {}
 
 	//////////////////////////////////////////////////////////////////////////////////////
-	// class sub-thread function that spins waiting for frames to find faces within:
-	void FrameProcessingLoop(void);
+	// class sub-thread function, one per worker, that spins waiting for frames to find faces within:
+	void FrameProcessingLoop(int32_t worker);
 	//
 	// thread variables:
-	std::thread*				mp_frameProcessingThread;
+	std::vector<std::thread*>	m_workers;
 	//
 	std::atomic<bool>		m_stop_frame_processing_loop;
-	std::atomic<bool>		m_frame_processing_loop_ended;
+	std::atomic<int32_t>	m_workers_running;
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	~FaceDetectionThreadMgr()
@@ -136,21 +368,23 @@ public:
 		StopFaceDetectionThread();
 		std::queue<FaceDetectionFrame> empty;
 		std::swap(m_frameQue, empty);
-		if (mp_faceDetector)
+		for (size_t i = 0; i < m_faceDetectors.size(); i++)
 		{
-			delete mp_faceDetector;
-			mp_faceDetector = NULL;
+			if (m_faceDetectors[i])
+				delete m_faceDetectors[i];
 		}
+		m_faceDetectors.clear();
+		mp_faceDetector = NULL;
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	bool IsRunning(void)
 	{
-		if (!mp_frameProcessingThread)
+		if (m_workers.size() < 1)
 			return false;
 
-		// set to true entering Process thread, goes false when exiting Process:
-		bool ret = !m_frame_processing_loop_ended;
+		// each worker counts itself in entering its Process thread, out when exiting Process:
+		bool ret = (m_workers_running > 0);
 
 		return ret;
 	}
@@ -169,44 +403,163 @@ public:
 		return true;
 	}
 
+	//////////////////////////////////////////////////////////////////////////////////////
+	// call before starting: the number of detector threads, 0 for one per core less one (up to 8);
+	// max_queue is how many frames may wait for a worker, 0 for one per worker:
+	bool SetWorkers(int32_t num_workers, FACE_DROP_POLICY drop_policy, int32_t max_queue = 0)
+	{
+		if (IsRunning() || num_workers < 0 || max_queue < 0)
+		{
+			return false;
+		}
+
+		m_num_workers = num_workers;
+		m_drop_policy = drop_policy;
+		m_max_queue   = max_queue;
+
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// threads each worker's detector splits one frame's detection across, 0 to share the cores between workers:
+	bool SetDetectThreads(int32_t detect_threads)
+	{
+		if (IsRunning() || detect_threads < 0)
+		{
+			return false;
+		}
+
+		m_detect_threads = detect_threads;
+
+		return true;
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// detect-then-track: full detection runs every detect_interval frames, after a scene change, or when a 
+	// tracked face is lost; faces in the frames between are followed by dlib correlation trackers. A face is 
+	// lost when its tracker's peak-to-sidelobe ratio falls below min_psr. scene_change is the mean absolute 
+	// difference, 0-255, of a coarse grid of luma between consecutive frames. Face images are only made on 
+	// detection frames. May be changed while running:
+	void SetTracking(bool enable, int32_t detect_interval = 10, double min_psr = 7.0, float scene_change = 30.0f)
+	{
+		m_detect_interval = std::max(1, detect_interval);
+		m_track_min_psr   = min_psr;
+		m_scene_change    = scene_change;
+		m_force_detect    = true;
+		m_tracking        = enable;
+	}
+
+	bool IsTracking(void) { return m_tracking; }
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// region of interest re-detection: when faces were found, detection frames only scan around them, each
+	// expanded by margin of its size per side, at up to full resolution. The whole frame is scanned at the
+	// detection scale every full_scan_period detection frames, or sooner when a face is not found again.
+	// May be changed while running:
+	void SetROIDetection(bool enable, float margin = 0.5f, int32_t full_scan_period = 15)
+	{
+		m_roi_margin       = std::max(0.0f, margin);
+		m_full_scan_period = std::max(1, full_scan_period);
+		m_roi_force_full   = true;
+		m_roi_detection    = enable;
+	}
+
+	bool IsROIDetection(void) { return m_roi_detection; }
+
+	// how many frames had full detection & how many were tracked, since starting:
+	void GetTrackingCounts(uint64_t& detect_frames, uint64_t& track_frames) {
+		detect_frames = m_detect_frames;
+		track_frames = m_track_frames;
+	}
+
 	//////////////////////////////////////////////////////////////////////////////////////
 	void StartFaceDetectionThread(void)
 	{
 		if (!IsRunning())
 		{
-			mp_frameProcessingThread = new std::thread(&FaceDetectionThreadMgr::FrameProcessingLoop, this);
+			int32_t workers = m_num_workers;
+			if (workers < 1)
+				workers = std::max(1, std::min((int32_t)std::thread::hardware_concurrency() - 1, 8));
+			if (m_max_queue < 1)
+				m_max_queue = workers;
+			m_worker_detect_threads = m_detect_threads;
+			if (m_worker_detect_threads < 1)
+				m_worker_detect_threads = std::max(1, (int32_t)std::thread::hardware_concurrency() / workers);
+
+			// detectors are created by their worker, the first waits on the shared models:
+			FaceModelCache::Preload(m_data_dir, m_face_model);
+			m_faceDetectors.resize(workers, NULL);
+
+			m_next_seq = 0;
+			m_deliver_seq = 0;
+			m_completed.clear();
+			m_trackers.clear();
+			m_force_detect = true;
+			m_roi_faces.clear();
+			m_roi_force_full = true;
+			m_frames_since_full = 0;
+			m_frames_since_detect = 0;
+			m_detect_frames = 0;
+			m_track_frames = 0;
+			m_indexed_frames = 0;
+
+			// auto-tuning starts over from the set scale:
+			std::unique_lock<std::mutex> tune_lock(m_tune_lock);
+			m_face_detection_scale = (float)m_max_detect_scale;
+			m_detect_stride = 1;
+			m_tune_latencies.clear();
+			m_tune_detect_ms = 0.0;
+			m_tune_occupancy = 0.0;
+			m_tune_dropped = m_dropped;
+			tune_lock.unlock();
+			m_held_detections.clear();
+			m_held_landmarks.clear();
+
+			for (int32_t i = 0; i < workers; i++)
+			{
+				m_workers_running++;
+				m_workers.push_back(new std::thread(&FaceDetectionThreadMgr::FrameProcessingLoop, this, i));
+			}
 		}
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	void StopFaceDetectionThread(void)
 	{
-		// only if the ExportProcessLoop() is running:
-		if (IsRunning())
+		// only if the FrameProcessingLoop()'s are running:
+		if (m_workers.size() > 0)
 		{
-			// tell FrameProcessingLoop() (running in it's own thread) to exit:
+			// tell FrameProcessingLoop() (running in each worker's thread) to exit:
 			m_stop_frame_processing_loop = true;
 			//
 			uint32_t spins = 0;
-			while (!m_frame_processing_loop_ended)
+			while (m_workers_running > 0)
 			{
 				using namespace std::chrono_literals;
 				std::this_thread::sleep_for(200ms);
 				//
 				spins++;
 			}
-			mp_frameProcessingThread->join();
-			delete mp_frameProcessingThread;
-			mp_frameProcessingThread = NULL;
+			for (size_t i = 0; i < m_workers.size(); i++)
+			{
+				m_workers[i]->join();
+				delete m_workers[i];
+			}
+			m_workers.clear();
 			m_stop_frame_processing_loop = false; // reset for next use
-			m_frame_processing_loop_ended = false;
 		}
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	// adds to queue
 	static void Add(void* object, FFVideo_Image& im, int32_t frame_num);
-	void Add(FFVideo_Image& im, int32_t frame_num);
+	void Add(FFVideo_Image& im, int32_t frame_num, FFVideo_Image* p_luma = NULL);
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// face images clipped from the video frame need the colour frame, everything else can use luma:
+	bool NeedsColorFrames(void) {
+		return m_faceImagesEnabled && m_faceFeaturesEnabled && !m_faceImagesStandardized;
+	}
 	
 
 	//////////////////////////////////////////////////////////////////////////////////////
@@ -218,18 +571,70 @@ public:
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////
+	// with auto-tuning this is the highest scale it may use:
 	void SetFaceDetectionScale(float detection_scale) {	
-		m_face_detection_scale = detection_scale;
+		m_max_detect_scale = detection_scale;
+		if (m_face_detection_scale.exchange(detection_scale) != detection_scale)
+			DetectionScaleChanged();
 	}
 
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	float GetFaceDetectionScale(void) {	
-		return m_face_detection_scale;
+		return m_max_detect_scale;
 	}
 
+	//////////////////////////////////////////////////////////////////////////////////////
+	// frames dropped by the drop policy since starting:
+	uint64_t GetDroppedCount(void) { return m_dropped; }
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// the face occurrence index: while a media file is set, frames in its FaceIndex for the current model 
+	// & detection scale are served from it rather than detected, and full scan detections are added to it.
+	// frame_rate converts frame numbers to the pts stored. An empty media_path stops using an index:
+	void SetFaceIndexMedia(const std::string& media_path, double frame_rate);
+
+	// the index in use, opened on first use & again when the model or detection scale changes; NULL if none:
+	std::shared_ptr<FaceIndex> GetFaceIndex(void);
 
-	TheApp*																		mp_app;
+	// frames served from the index since starting:
+	uint64_t GetIndexedCount(void) { return m_indexed_frames; }
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// latency targeted auto-tuning: each window of detected frames, the 90th percentile latency from Add() to
+	// delivery, the queue occupancy & the frames dropped are compared with the target. Over it, the detection 
+	// scale is lowered by the square root of the excess, detection cost goes with the pixels scanned, and at the
+	// minimum scale the stride grows, detecting 1 in stride frames; frames between are delivered with the latest
+	// faces, or tracked in tracking mode. Well under it, the stride shrinks first, then the scale rises back 
+	// toward the set detection scale. May be changed while running; disabling restores the set scale:
+	void SetAutoTune(const FACE_AUTOTUNE_PARAMS& params);
+
+	void GetAutoTuneStats(FACE_AUTOTUNE_STATS& stats);
+
+	// the scale in use, which auto-tuning may have lowered from GetFaceDetectionScale():
+	float GetDetectionScaleInUse(void) { return m_face_detection_scale; }
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// the face images of each frame delivered are also offered to p_exporter, which only copies them
+	// into its queue; NULL stops. The exporter must outlive this, or be unset first:
+	void SetChipExporter(FaceChipExporter* p_exporter) { mp_chipExporter = p_exporter; }
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// each frame detected is recorded into p_tracer's trace when it is enabled, see FFVideo::GetTracer(); 
+	// an empty pointer stops:
+	void SetTracer(std::shared_ptr<FFVideo_Tracer> p_tracer) {
+		std::lock_guard<std::mutex> lock(m_tracer_lock);
+		mp_tracer = p_tracer;
+	}
+
+
+	std::string																m_data_dir;					// where the face models are
+
+	int32_t																		m_num_workers;			// as requested, 0 for automatic
+	FACE_DROP_POLICY													m_drop_policy;
+	int32_t																		m_max_queue;
+	int32_t																		m_detect_threads;				// as requested, 0 for automatic
+	int32_t																		m_worker_detect_threads;	// in use
 
 	// the "frame callback", called with every frame: 
 	typedef void(*FRAME_FACE_DETECTION_CALLBACK_CB)(void* p_object, FaceDetectionFrame& fdf);
@@ -238,9 +643,10 @@ public:
 	void*																			mp_frame_object;
 
 	FACE_MODEL																m_face_model;
-	FaceDetector*															mp_faceDetector;
-	float																			m_face_detection_scale;
-	bool																			m_faceDetectorInitialized;
+	std::vector<FaceDetector*>								m_faceDetectors;		// one per worker
+	FaceDetector*															mp_faceDetector;		// the first ready, also used for GetLandmarks()
+	std::atomic<float>												m_face_detection_scale;	// in use, auto-tuning lowers it
+	std::atomic<bool>													m_faceDetectorInitialized;
 	bool																			m_faceDetectorEnabled;
 	bool																			m_faceFeaturesEnabled;
 	bool																			m_faceImagesEnabled;
@@ -248,6 +654,87 @@ public:
 
 	mutable std::shared_mutex									m_queue_lock;
 	std::queue<FaceDetectionFrame>						m_frameQue;
+	uint64_t																	m_next_seq;					// the sequence number of the next frame taken, under m_queue_lock
+	std::atomic<uint64_t>											m_dropped;
+
+	// the face occurrence index:
+	bool ServeFromIndex(FaceDetector* p_faceDetector, FaceDetectionFrame& fdf, FFVideo_Image* p_luma);
+	void StoreInIndex(FaceDetectionFrame& fdf);
+	//
+	std::mutex																m_index_lock;
+	std::string																m_index_media;
+	double																		m_index_frame_rate;
+	std::shared_ptr<FaceIndex>								mp_faceIndex;
+	FACE_MODEL																m_index_model;			// of the last open attempt, so a failure is not retried every frame
+	float																			m_index_scale;
+	std::atomic<uint64_t>											m_indexed_frames;
+
+	std::atomic<FaceChipExporter*>						mp_chipExporter;
+
+	std::mutex																m_tracer_lock;
+	std::shared_ptr<FFVideo_Tracer>						mp_tracer;					// under m_tracer_lock, workers take a copy per frame
+
+	// auto-tuning, run by the sequencer in frame order:
+	void AutoTune(FaceDetectionFrame& fdf);
+	void DetectionScaleChanged(void);
+	//
+	FACE_AUTOTUNE_PARAMS											m_tune;							// under m_tune_lock
+	std::atomic<int32_t>											m_detect_stride;		// 1 in this many frames is detected
+	std::atomic<float>												m_max_detect_scale;	// as set, the most auto-tuning uses
+	std::mutex																m_tune_lock;				// what follows
+	std::vector<double>												m_tune_latencies;		// this window's
+	double																		m_tune_detect_ms;
+	double																		m_tune_occupancy;
+	uint64_t																	m_tune_dropped;			// m_dropped when the window began
+	FACE_AUTOTUNE_DECISION										m_tune_last;
+	std::deque<FACE_AUTOTUNE_DECISION>				m_tune_decisions;
+	uint64_t																	m_tune_windows;
+	uint64_t																	m_tune_changes;
+	//
+	// the faces of the latest detected frame, delivered with the frames the stride skips, under m_deliver_lock:
+	std::vector<dlib::rectangle>							m_held_detections;
+	std::vector<dlib::full_object_detection>	m_held_landmarks;
+	FF_Vector2D																m_held_im_size;
+
+	// the sequencer: completed frames wait here until every earlier frame has been delivered:
+	void Deliver(FaceDetectionFrame& fdf);
+	void DeliverInOrder(FaceDetectionFrame& fdf);
+	//
+	std::mutex																m_deliver_lock;
+	std::map<uint64_t, FaceDetectionFrame>		m_completed;
+	uint64_t																	m_deliver_seq;			// the next sequence number to deliver
+
+	// detect-then-track; the trackers advance in frame order, so they are run by the sequencer:
+	void Track(FaceDetectionFrame& fdf);
+	bool SceneChanged(FFVideo_Image& im);
+	//
+	std::atomic<bool>													m_tracking;
+	std::atomic<int32_t>											m_detect_interval;
+	std::atomic<double>												m_track_min_psr;
+	std::atomic<float>												m_scene_change;
+	std::atomic<bool>													m_force_detect;			// the next frame taken gets full detection
+	int32_t																		m_frames_since_detect;	// under m_queue_lock
+	std::vector<dlib::correlation_tracker>		m_trackers;					// under m_deliver_lock
+	long																			m_track_nr, m_track_nc;	// the gray image size they started in, under m_deliver_lock
+	std::vector<uint8_t>											m_scene_grid;				// Add()'s last coarse luma grid
+	std::atomic<uint64_t>											m_detect_frames;
+	std::atomic<uint64_t>											m_track_frames;
+
+	// region of interest re-detection; the faces of the latest frame delivered, normalized:
+	std::atomic<bool>													m_roi_detection;
+	std::atomic<float>												m_roi_margin;
+	std::atomic<int32_t>											m_full_scan_period;
+	int32_t																		m_frames_since_full;	// under m_queue_lock
+	std::atomic<bool>													m_roi_force_full;
+	std::mutex																m_roi_lock;
+	std::vector<dlib::drectangle>							m_roi_faces;
+
+	// face images delivered to the client are recycled here, so steady extraction does not allocate:
+	void TakePooledImages(std::vector<FFVideo_Image>& images, size_t count);
+	void RecycleImages(std::vector<FFVideo_Image>& images);
+	//
+	std::mutex																m_pool_lock;
+	std::vector<FFVideo_Image>								m_image_pool;
 
 	std::string																m_err;
 };
@@ -0,0 +1,653 @@
+///////////////////////////////////////////////////////////////////////////////
+// Name:        FaceIndex.cpp
+// Author:			Blake Senftner
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "FaceIndex.h"
+
+#include <string.h>
+#include <boost/filesystem.hpp>
+
+
+using namespace dlib;
+
+////////////////////////////////////////////////////////////////////////
+// sidecar layout, little endian as written by x86/x64:
+//   header: "FFFACEIX", uint32 version, uint16 face model, uint16 detection scale in hundredths,
+//           uint64 media size, int64 media modification time
+//   record: int32 frame, int64 pts, uint16 width, height, faces, parts, uint32 flags,
+//           int32 left, top, right, bottom per face, int16 x, y per landmark
+static const char		FACE_INDEX_MAGIC[8] = { 'F', 'F', 'F', 'A', 'C', 'E', 'I', 'X' };
+static const uint32_t	FACE_INDEX_VERSION = 1;
+static const size_t		FACE_INDEX_HEADER_SIZE = 32;
+static const size_t		FACE_INDEX_RECORD_SIZE = 24;	// without the faces
+
+std::mutex FaceIndex::m_open_lock;
+std::map<std::string, std::weak_ptr<FaceIndex>> FaceIndex::m_open;
+
+////////////////////////////////////////////////////////////////////////
+template <typename T> static void Put( std::vector<uint8_t>& bytes, T value )
+{
+	size_t at = bytes.size();
+	bytes.resize( at + sizeof(T) );
+	memcpy( &bytes[at], &value, sizeof(T) );
+}
+
+template <typename T> static T Get( const uint8_t* p_bytes, size_t& at )
+{
+	T value;
+	memcpy( &value, p_bytes + at, sizeof(T) );
+	at += sizeof(T);
+	return value;
+}
+
+////////////////////////////////////////////////////////////////////////
+static uint16_t ScaleHundredths( float detection_scale )
+{
+	return (uint16_t)std::max( 1, (int32_t)(detection_scale * 100.0f + 0.5f) );
+}
+
+////////////////////////////////////////////////////////////////////////
+std::string FaceIndex::IndexPath( const std::string& media_path, FACE_MODEL face_model, float detection_scale )
+{
+	char suffix[64];
+	snprintf( suffix, sizeof(suffix), ".faces%d-%d.idx", (face_model == FACE_MODEL::eightyone) ? 81 : 68,
+						(int32_t)ScaleHundredths( detection_scale ) );
+
+	return media_path + suffix;
+}
+
+////////////////////////////////////////////////////////////////////////
+std::shared_ptr<FaceIndex> FaceIndex::Open( const std::string& media_path, FACE_MODEL face_model, float detection_scale )
+{
+	boost::system::error_code ec;
+	boost::filesystem::path media( media_path );
+	uint64_t media_size = (uint64_t)boost::filesystem::file_size( media, ec );
+	if (ec)
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceIndex: '%s' is not a file that can be indexed\n", media_path.c_str() );
+		return NULL;
+	}
+	int64_t media_mtime = (int64_t)boost::filesystem::last_write_time( media, ec );
+
+	std::string path = IndexPath( media_path, face_model, detection_scale );
+
+	std::lock_guard<std::mutex> lock(m_open_lock);
+
+	// already open, by the player or a pre-index job:
+	auto it = m_open.find( path );
+	if (it != m_open.end())
+	{
+		std::shared_ptr<FaceIndex> p_index = it->second.lock();
+		if (p_index && p_index->m_media_size == media_size && p_index->m_media_mtime == media_mtime)
+			return p_index;
+		m_open.erase( it );
+	}
+
+	// the constructor is private, so not make_shared:
+	std::shared_ptr<FaceIndex> p_index( new FaceIndex() );
+	p_index->m_path = path;
+	p_index->m_face_model = face_model;
+	p_index->m_detect_scale = detection_scale;
+	p_index->m_media_size = media_size;
+	p_index->m_media_mtime = media_mtime;
+
+	if (!p_index->Load() && !p_index->Create())
+		return NULL;
+
+	m_open[path] = p_index;
+
+	return p_index;
+}
+
+////////////////////////////////////////////////////////////////////////
+FaceIndex::~FaceIndex()
+{
+	if (mp_file)
+		fclose( mp_file );
+}
+
+////////////////////////////////////////////////////////////////////////
+// reads an existing sidecar of this media & opens it for appending; false if there is none to use:
+bool FaceIndex::Load( void )
+{
+	boost::system::error_code ec;
+	uint64_t file_size = (uint64_t)boost::filesystem::file_size( boost::filesystem::path( m_path ), ec );
+	if (ec || file_size < FACE_INDEX_HEADER_SIZE)
+		return false;
+
+	FILE* fh = fopen( m_path.c_str(), "rb" );
+	if (!fh)
+		return false;
+
+	std::vector<uint8_t> bytes( (size_t)file_size );
+	size_t got = fread( bytes.data(), 1, bytes.size(), fh );
+	fclose( fh );
+	if (got != bytes.size())
+		return false;
+
+	const uint8_t* p = bytes.data();
+	size_t at = 0;
+	if (memcmp( p, FACE_INDEX_MAGIC, sizeof(FACE_INDEX_MAGIC) ) != 0)
+		return false;
+	at += sizeof(FACE_INDEX_MAGIC);
+
+	uint32_t version = Get<uint32_t>( p, at );
+	uint16_t model   = Get<uint16_t>( p, at );
+	uint16_t scale   = Get<uint16_t>( p, at );
+	uint64_t size    = Get<uint64_t>( p, at );
+	int64_t  mtime   = Get<int64_t>( p, at );
+	if (version != FACE_INDEX_VERSION || model != (uint16_t)m_face_model || scale != ScaleHundredths( m_detect_scale ) ||
+			size != m_media_size || mtime != m_media_mtime)
+	{
+		av_log( NULL, AV_LOG_INFO, "FaceIndex: '%s' is of another version of the media, starting over\n", m_path.c_str() );
+		return false;
+	}
+
+	size_t good = at;
+	while (at + FACE_INDEX_RECORD_SIZE <= bytes.size())
+	{
+		FACE_INDEX_ENTRY entry;
+		int32_t frame_num = Get<int32_t>( p, at );
+		entry.m_pts       = Get<int64_t>( p, at );
+		entry.m_width     = Get<uint16_t>( p, at );
+		entry.m_height    = Get<uint16_t>( p, at );
+		uint16_t faces    = Get<uint16_t>( p, at );
+		entry.m_parts     = Get<uint16_t>( p, at );
+		entry.m_flags     = (uint16_t)Get<uint32_t>( p, at );
+
+		size_t rect_bytes  = (size_t)faces * 4 * sizeof(int32_t);
+		size_t point_bytes = (size_t)faces * entry.m_parts * 2 * sizeof(int16_t);
+		if (at + rect_bytes + point_bytes > bytes.size())
+			break;
+
+		entry.m_rects.resize( (size_t)faces * 4 );
+		memcpy( entry.m_rects.data(), p + at, rect_bytes );
+		at += rect_bytes;
+		entry.m_points.resize( (size_t)faces * entry.m_parts * 2 );
+		memcpy( entry.m_points.data(), p + at, point_bytes );
+		at += point_bytes;
+
+		m_entries[frame_num] = std::move( entry );
+		good = at;
+	}
+
+	// a record cut short when last written is dropped, so appending continues from a whole record:
+	if (good < bytes.size())
+	{
+		av_log( NULL, AV_LOG_WARNING, "FaceIndex: '%s' ends in a partial record, dropped\n", m_path.c_str() );
+		boost::filesystem::resize_file( boost::filesystem::path( m_path ), good, ec );
+		if (ec)
+			return false;
+	}
+
+	mp_file = fopen( m_path.c_str(), "ab" );
+	if (!mp_file)
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceIndex: unable to append to '%s'\n", m_path.c_str() );
+		m_entries.clear();
+		return false;
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceIndex::Create( void )
+{
+	m_entries.clear();
+
+	mp_file = fopen( m_path.c_str(), "wb" );
+	if (!mp_file)
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceIndex: unable to create '%s'\n", m_path.c_str() );
+		return false;
+	}
+
+	std::vector<uint8_t> header( FACE_INDEX_MAGIC, FACE_INDEX_MAGIC + sizeof(FACE_INDEX_MAGIC) );
+	Put<uint32_t>( header, FACE_INDEX_VERSION );
+	Put<uint16_t>( header, (uint16_t)m_face_model );
+	Put<uint16_t>( header, ScaleHundredths( m_detect_scale ) );
+	Put<uint64_t>( header, m_media_size );
+	Put<int64_t>( header, m_media_mtime );
+
+	if (fwrite( header.data(), 1, header.size(), mp_file ) != header.size())
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceIndex: unable to write '%s'\n", m_path.c_str() );
+		fclose( mp_file );
+		mp_file = NULL;
+		return false;
+	}
+	fflush( mp_file );
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceIndex::Has( int32_t frame_num, bool need_landmarks )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	auto it = m_entries.find( frame_num );
+	if (it == m_entries.end())
+		return false;
+
+	return !need_landmarks || (it->second.m_flags & FACE_INDEX_LANDMARKS);
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceIndex::Lookup( int32_t frame_num, bool need_landmarks, FF_Vector2D& detect_im_size,
+												std::vector<rectangle>& detections,
+												std::vector<full_object_detection>& faceLandmarkSets )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	auto it = m_entries.find( frame_num );
+	if (it == m_entries.end())
+		return false;
+
+	const FACE_INDEX_ENTRY& entry = it->second;
+	if (need_landmarks && !(entry.m_flags & FACE_INDEX_LANDMARKS))
+		return false;
+
+	detect_im_size.Set( entry.m_width, entry.m_height );
+
+	size_t faces = entry.m_rects.size() / 4;
+	detections.clear();
+	for (size_t i = 0; i < faces; i++)
+	{
+		const int32_t* r = &entry.m_rects[i * 4];
+		detections.push_back( rectangle( r[0], r[1], r[2], r[3] ) );
+	}
+
+	faceLandmarkSets.clear();
+	if (entry.m_flags & FACE_INDEX_LANDMARKS)
+	{
+		std::vector<point> parts( entry.m_parts );
+		for (size_t i = 0; i < faces; i++)
+		{
+			const int16_t* pt = &entry.m_points[i * entry.m_parts * 2];
+			for (uint16_t k = 0; k < entry.m_parts; k++)
+				parts[k] = point( pt[k * 2], pt[k * 2 + 1] );
+			faceLandmarkSets.push_back( full_object_detection( detections[i], parts ) );
+		}
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+bool FaceIndex::Store( int32_t frame_num, int64_t pts, const FF_Vector2D& detect_im_size,
+											 const std::vector<rectangle>& detections,
+											 const std::vector<full_object_detection>& faceLandmarkSets )
+{
+	bool landmarks = (faceLandmarkSets.size() == detections.size()) && (detections.size() == 0 || faceLandmarkSets[0].num_parts() > 0);
+
+	FACE_INDEX_ENTRY entry;
+	entry.m_pts    = pts;
+	entry.m_width  = (uint16_t)detect_im_size.x;
+	entry.m_height = (uint16_t)detect_im_size.y;
+	entry.m_parts  = (landmarks && detections.size() > 0) ? (uint16_t)faceLandmarkSets[0].num_parts() : 0;
+	entry.m_flags  = (landmarks) ? FACE_INDEX_LANDMARKS : 0;
+
+	size_t faces = std::min( detections.size(), (size_t)UINT16_MAX );
+	for (size_t i = 0; i < faces; i++)
+	{
+		const rectangle& r = detections[i];
+		entry.m_rects.push_back( (int32_t)r.left() );
+		entry.m_rects.push_back( (int32_t)r.top() );
+		entry.m_rects.push_back( (int32_t)r.right() );
+		entry.m_rects.push_back( (int32_t)r.bottom() );
+
+		for (uint16_t k = 0; k < entry.m_parts; k++)
+		{
+			const point& pt = faceLandmarkSets[i].part( k );
+			entry.m_points.push_back( (int16_t)std::max( (long)INT16_MIN, std::min( pt.x(), (long)INT16_MAX ) ) );
+			entry.m_points.push_back( (int16_t)std::max( (long)INT16_MIN, std::min( pt.y(), (long)INT16_MAX ) ) );
+		}
+	}
+
+	std::vector<uint8_t> record;
+	record.reserve( FACE_INDEX_RECORD_SIZE + entry.m_rects.size() * sizeof(int32_t) + entry.m_points.size() * sizeof(int16_t) );
+	Put<int32_t>( record, frame_num );
+	Put<int64_t>( record, entry.m_pts );
+	Put<uint16_t>( record, entry.m_width );
+	Put<uint16_t>( record, entry.m_height );
+	Put<uint16_t>( record, (uint16_t)faces );
+	Put<uint16_t>( record, entry.m_parts );
+	Put<uint32_t>( record, entry.m_flags );
+	for (size_t i = 0; i < entry.m_rects.size(); i++)
+		Put<int32_t>( record, entry.m_rects[i] );
+	for (size_t i = 0; i < entry.m_points.size(); i++)
+		Put<int16_t>( record, entry.m_points[i] );
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	// whole records only, a failed write is not kept in memory either:
+	if (!mp_file || fwrite( record.data(), 1, record.size(), mp_file ) != record.size())
+		return false;
+	fflush( mp_file );
+
+	m_entries[frame_num] = std::move( entry );
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+size_t FaceIndex::Size( void )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	return m_entries.size();
+}
+
+
+
+////////////////////////////////////////////////////////////////////////
+bool FaceIndexer::Start( const std::string& media_path, FACE_MODEL face_model, float detection_scale, bool landmarks, int32_t workers )
+{
+	Stop();
+
+	mp_index = FaceIndex::Open( media_path, face_model, detection_scale );
+	if (!mp_index)
+	{
+		std::lock_guard<std::mutex> lock(m_err_lock);
+		m_err = "unable to open the face index!";
+		return false;
+	}
+
+	m_media_path   = media_path;
+	m_face_model   = face_model;
+	m_detect_scale = detection_scale;
+	m_landmarks    = landmarks;
+
+	if (workers < 1)
+		workers = std::max(1, std::min((int32_t)std::thread::hardware_concurrency() - 1, 8));
+	m_max_queue = (size_t)workers * 2;
+
+	m_frames_expected = 0;
+	m_decoded = 0;
+	m_detected = 0;
+	m_skipped = 0;
+	m_faces = 0;
+	m_done = false;
+	m_start_time = std::chrono::steady_clock::now();
+	std::unique_lock<std::mutex> elock(m_err_lock);
+		m_err.clear();
+	elock.unlock();
+
+	// the detectors wait on the models, so start loading them before decoding:
+	FaceModelCache::Preload( m_data_dir, m_face_model );
+
+	m_stop = false;
+	m_decoding = true;
+	mp_decoder = new std::thread( &FaceIndexer::DecodeLoop, this );
+	for (int32_t i = 0; i < workers; i++)
+	{
+		m_workers_running++;
+		m_workers.push_back( new std::thread( &FaceIndexer::DetectLoop, this ) );
+	}
+
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceIndexer::Stop( void )
+{
+	m_stop = true;
+	m_queue_cv.notify_all();
+
+	if (mp_decoder)
+	{
+		mp_decoder->join();
+		delete mp_decoder;
+		mp_decoder = NULL;
+	}
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i]->join();
+		delete m_workers[i];
+	}
+	m_workers.clear();
+
+	std::unique_lock<std::mutex> lock(m_queue_lock);
+		std::queue<FACE_INDEXER_FRAME> empty;
+		std::swap( m_frameQue, empty );
+		m_free_images.clear();
+	lock.unlock();
+
+	mp_index = NULL;
+	m_stop = false;
+}
+
+////////////////////////////////////////////////////////////////////////
+void FaceIndexer::GetProgress( FACE_INDEXER_PROGRESS& progress )
+{
+	progress.m_running = IsRunning();
+	progress.m_done = m_done;
+	progress.m_frames_expected = m_frames_expected;
+	progress.m_decoded = m_decoded;
+	progress.m_detected = m_detected;
+	progress.m_skipped = m_skipped;
+	progress.m_faces = m_faces;
+
+	double secs = std::chrono::duration<double>( std::chrono::steady_clock::now() - m_start_time ).count();
+	progress.m_fps = (secs > 0.0) ? (double)progress.m_decoded / secs : 0.0;
+
+	std::lock_guard<std::mutex> lock(m_err_lock);
+	progress.m_err = m_err;
+}
+
+////////////////////////////////////////////////////////////////////////
+// decodes the whole file, unpaced, into bottom origin gray frames for the workers; frames already
+// indexed are counted & not queued. Frame numbers are as FFVideo::DecodePacket() computes them:
+void FaceIndexer::DecodeLoop( void )
+{
+	AVFormatContext* p_format = NULL;
+	AVCodecContext*  p_codec_context = NULL;
+	AVPacket*        p_packet = av_packet_alloc();
+	AVFrame*         p_frame = av_frame_alloc();
+	SwsContext*      p_sws = NULL;
+	std::string      err;
+
+	int32_t stream_index = -1;
+	double timebase = 0.0, frame_rate = 24.0;
+	bool landmarks = m_landmarks;
+
+	if (!p_packet || !p_frame)
+		err = "out of memory!";
+	else if (avformat_open_input( &p_format, m_media_path.c_str(), NULL, NULL ) != 0)
+		err = "unable to open the media file!";
+	else if (avformat_find_stream_info( p_format, NULL ) < 0)
+		err = "no stream information in the media file!";
+	else if ((stream_index = av_find_best_stream( p_format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0 )) < 0)
+		err = "no video stream in the media file!";
+	else
+	{
+		AVStream* p_stream = p_format->streams[stream_index];
+		const AVCodec* p_codec = avcodec_find_decoder( p_stream->codecpar->codec_id );
+		p_codec_context = (p_codec) ? avcodec_alloc_context3( p_codec ) : NULL;
+		if (!p_codec_context || avcodec_parameters_to_context( p_codec_context, p_stream->codecpar ) != 0)
+			err = "unsupported codec!";
+		else
+		{
+			// frame threads, decode speed is the point here:
+			p_codec_context->thread_count = 0;
+			if (avcodec_open2( p_codec_context, p_codec, NULL ) < 0)
+				err = "failed to open the codec!";
+		}
+
+		timebase = av_q2d( p_stream->time_base );
+		if (p_stream->avg_frame_rate.den != 0)
+			frame_rate = av_q2d( p_stream->avg_frame_rate );
+		if (p_format->duration > 0)
+			m_frames_expected = (int64_t)((double)p_format->duration / (double)AV_TIME_BASE * frame_rate);
+
+		// every other stream's packets are dropped by the demuxer:
+		for (unsigned int i = 0; i < p_format->nb_streams; i++)
+		{
+			if ((int32_t)i != stream_index)
+				p_format->streams[i]->discard = AVDISCARD_ALL;
+		}
+	}
+
+	bool draining = false;
+	while (err.empty() && !m_stop)
+	{
+		if (!draining)
+		{
+			int ret = av_read_frame( p_format, p_packet );
+			if (ret < 0)
+			{
+				draining = true;
+				avcodec_send_packet( p_codec_context, NULL );
+			}
+			else
+			{
+				if (p_packet->stream_index == stream_index)
+					avcodec_send_packet( p_codec_context, p_packet );
+				av_packet_unref( p_packet );
+			}
+		}
+
+		while (!m_stop)
+		{
+			int ret = avcodec_receive_frame( p_codec_context, p_frame );
+			if (ret == AVERROR_EOF || (ret < 0 && draining))
+			{
+				m_done = true;
+				break;
+			}
+			if (ret < 0)
+				break;
+
+			m_decoded++;
+
+			double play_pos = p_frame->best_effort_timestamp * timebase;
+			int32_t frame_num = (int32_t)(play_pos * frame_rate);
+
+			if (mp_index->Has( frame_num, landmarks ))
+			{
+				m_skipped++;
+				av_frame_unref( p_frame );
+				continue;
+			}
+
+			FACE_INDEXER_FRAME iframe;
+			iframe.m_frame_num = frame_num;
+			iframe.m_pts = (int64_t)(play_pos * 1000000.0);
+
+			// wait for room, then take recycled pixels if any:
+			std::unique_lock<std::mutex> lock(m_queue_lock);
+			m_queue_cv.wait( lock, [this] { return m_stop || m_frameQue.size() < m_max_queue; } );
+			if (m_free_images.size() > 0)
+			{
+				iframe.m_im.Swap( m_free_images.back() );
+				m_free_images.pop_back();
+			}
+			lock.unlock();
+
+			if (m_stop)
+				break;
+
+			uint32_t width = (uint32_t)p_frame->width, height = (uint32_t)p_frame->height;
+			if (iframe.m_im.m_width != width || iframe.m_im.m_height != height || iframe.m_im.m_type != 2)
+				iframe.m_im.Reallocate( height, width, 2 );
+
+			p_sws = sws_getCachedContext( p_sws, p_frame->width, p_frame->height, (AVPixelFormat)p_frame->format,
+																		p_frame->width, p_frame->height, AV_PIX_FMT_GRAY8, SWS_POINT, NULL, NULL, NULL );
+			if (!p_sws)
+			{
+				err = "no conversion of the frames to gray!";
+				break;
+			}
+
+			// a negative stride from the last row writes bottom origin, as the player's frames:
+			uint8_t* p_dst[4]      = { &iframe.m_im.mp_pixels[(size_t)(height - 1) * width], NULL, NULL, NULL };
+			int      dst_stride[4] = { -(int)width, 0, 0, 0 };
+			sws_scale( p_sws, p_frame->data, p_frame->linesize, 0, p_frame->height, p_dst, dst_stride );
+			av_frame_unref( p_frame );
+
+			lock.lock();
+			m_frameQue.push( std::move( iframe ) );
+			lock.unlock();
+			m_queue_cv.notify_one();
+		}
+
+		if (m_done)
+			break;
+	}
+
+	if (!err.empty())
+	{
+		av_log( NULL, AV_LOG_ERROR, "FaceIndexer: %s: %s\n", m_media_path.c_str(), err.c_str() );
+		std::lock_guard<std::mutex> lock(m_err_lock);
+		m_err = err;
+	}
+
+	sws_freeContext( p_sws );
+	avcodec_free_context( &p_codec_context );
+	avformat_close_input( &p_format );
+	av_frame_free( &p_frame );
+	av_packet_free( &p_packet );
+
+	m_decoding = false;
+	m_queue_cv.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////
+// detects until the decoder is finished & the queue empty, storing each frame's faces in the index:
+void FaceIndexer::DetectLoop( void )
+{
+	FaceDetector* p_faceDetector = new FaceDetector( m_data_dir, m_face_model );
+	if (!p_faceDetector->IsLoaded())
+	{
+		std::unique_lock<std::mutex> elock(m_err_lock);
+			m_err = "failed to load the face models!";
+		elock.unlock();
+
+		// nothing can be detected, so the decoder stops too:
+		m_stop = true;
+		m_queue_cv.notify_all();
+	}
+
+	std::vector<rectangle>							detections;
+	std::vector<full_object_detection>	faceLandmarkSets;
+	FF_Vector2D													detect_im_size;
+
+	while (!m_stop)
+	{
+		std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_queue_cv.wait( lock, [this] { return m_stop || !m_frameQue.empty() || !m_decoding; } );
+		if (m_frameQue.empty())
+		{
+			if (!m_decoding)
+				break;
+			continue;
+		}
+		FACE_INDEXER_FRAME iframe = std::move( m_frameQue.front() );
+		m_frameQue.pop();
+		lock.unlock();
+		m_queue_cv.notify_all();
+
+		p_faceDetector->SetImage( iframe.m_im, m_detect_scale );
+		p_faceDetector->GetDlibImageSize( detect_im_size );
+		p_faceDetector->GetFaceBoxes( detections );
+		faceLandmarkSets.clear();
+		if (m_landmarks)
+			p_faceDetector->GetFaceLandmarkSets( detections, faceLandmarkSets );
+
+		mp_index->Store( iframe.m_frame_num, iframe.m_pts, detect_im_size, detections, faceLandmarkSets );
+		m_detected++;
+		m_faces += detections.size();
+
+		lock.lock();
+		m_free_images.push_back( FFVideo_Image() );
+		m_free_images.back().Swap( iframe.m_im );
+		lock.unlock();
+	}
+
+	delete p_faceDetector;
+
+	m_workers_running--;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#ifndef _FACEINDEX_H_
+#define _FACEINDEX_H_
+
+// no wxWidgets here either, the face detection benchmark uses the index too:
+#include "FaceDetect.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <queue>
+#include <condition_variable>
+
+
+//------------------------------------------------------------------------------
+// one frame's faces as kept by a FaceIndex, compact so a long file's index stays small in memory:
+typedef struct _FACE_INDEX_ENTRY
+{
+	int64_t								m_pts = 0;							// microseconds
+	uint16_t							m_width = 0;						// the detection image, the units of the results
+	uint16_t							m_height = 0;
+	uint16_t							m_parts = 0;						// landmarks per face, 0 if they were not fit
+	uint16_t							m_flags = 0;						// FACE_INDEX_LANDMARKS when the landmarks were fit
+	std::vector<int32_t>	m_rects;								// left, top, right, bottom per face
+	std::vector<int16_t>	m_points;								// x, y per landmark, m_parts per face
+} FACE_INDEX_ENTRY;
+
+#define FACE_INDEX_LANDMARKS	0x0001
+
+
+//------------------------------------------------------------------------------
+// the faces found in one media file, with one face model at one detection scale, kept in a binary
+// sidecar next to the file, "<media>.faces68-35.idx" for the 68 point model at scale 0.35. The
+// sidecar is a header identifying the media by size & modification time, then one record per
+// detected frame, appended as frames are detected; a frame detected again is appended again, the
+// last record read wins. A sidecar from another version of the media is started over, a record
+// cut short by a crash is dropped. Indexes are shared: Open() of the same sidecar returns the
+// index already open, so the player & a pre-index job fill one index:
+class FaceIndex
+{
+public:
+	~FaceIndex();
+
+	// NULL if the sidecar cannot be read or created:
+	static std::shared_ptr<FaceIndex> Open( const std::string& media_path, FACE_MODEL face_model, float detection_scale );
+
+	static std::string IndexPath( const std::string& media_path, FACE_MODEL face_model, float detection_scale );
+
+	// false if frame_num is not indexed, or need_landmarks and its landmarks were not fit:
+	bool Has( int32_t frame_num, bool need_landmarks );
+
+	bool Lookup( int32_t frame_num, bool need_landmarks, FF_Vector2D& detect_im_size,
+							 std::vector<dlib::rectangle>& detections,
+							 std::vector<dlib::full_object_detection>& faceLandmarkSets );
+
+	// faceLandmarkSets empty when the landmarks were not fit, else one per detection. pts is in microseconds:
+	bool Store( int32_t frame_num, int64_t pts, const FF_Vector2D& detect_im_size,
+							const std::vector<dlib::rectangle>& detections,
+							const std::vector<dlib::full_object_detection>& faceLandmarkSets );
+
+	size_t Size( void );
+
+	const std::string& GetPath( void ) { return m_path; }
+	FACE_MODEL GetFaceModel( void ) { return m_face_model; }
+	float GetDetectionScale( void ) { return m_detect_scale; }
+
+private:
+	FaceIndex() : mp_file(NULL), m_face_model(FACE_MODEL::sixtyeight), m_detect_scale(0.0f), m_media_size(0), m_media_mtime(0) {};
+
+	bool Load( void );
+	bool Create( void );
+
+	std::string																	m_path;
+	FILE*																				mp_file;					// open for appending
+	FACE_MODEL																	m_face_model;
+	float																				m_detect_scale;
+	uint64_t																		m_media_size;			// identify the media the sidecar was made from
+	int64_t																			m_media_mtime;
+
+	std::mutex																	m_lock;
+	std::map<int32_t, FACE_INDEX_ENTRY>					m_entries;				// by frame number
+
+	// the indexes open in this process, by sidecar path:
+	static std::mutex																	m_open_lock;
+	static std::map<std::string, std::weak_ptr<FaceIndex>>	m_open;
+};
+
+
+//------------------------------------------------------------------------------
+// returned by FaceIndexer::GetProgress():
+typedef struct _FACE_INDEXER_PROGRESS
+{
+	bool				m_running = false;
+	bool				m_done = false;							// the whole file was decoded
+	int64_t			m_frames_expected = 0;			// from the duration, 0 if unknown
+	uint64_t		m_decoded = 0;
+	uint64_t		m_detected = 0;
+	uint64_t		m_skipped = 0;							// already in the index
+	uint64_t		m_faces = 0;
+	double			m_fps = 0.0;								// frames decoded per second since starting
+	std::string	m_err;
+} FACE_INDEXER_PROGRESS;
+
+//------------------------------------------------------------------------------
+// the background "pre-index this file" job: decodes a media file as fast as the decoder allows, no
+// playback pacing, & detects faces in every frame not already in its FaceIndex. Frame numbers are
+// computed as FFVideo does for playback, so the player finds these frames when it plays the file.
+// N workers each have their own FaceDetector, the models shared through FaceModelCache:
+class FaceIndexer
+{
+public:
+	FaceIndexer(const std::string& data_dir) : m_data_dir(data_dir), m_stop(false), m_decoding(false), m_workers_running(0),
+		m_face_model(FACE_MODEL::sixtyeight), m_detect_scale(0.35f), m_landmarks(true), m_frames_expected(0),
+		m_decoded(0), m_detected(0), m_skipped(0), m_faces(0), m_done(false) {};
+
+	~FaceIndexer() { Stop(); }
+
+	// workers 0 for one per core less one, up to 8:
+	bool Start( const std::string& media_path, FACE_MODEL face_model, float detection_scale, bool landmarks, int32_t workers = 0 );
+
+	// the frames already detected stay in the index:
+	void Stop( void );
+
+	bool IsRunning( void ) { return m_decoding || m_workers_running > 0; }
+
+	void GetProgress( FACE_INDEXER_PROGRESS& progress );
+
+	const std::string& GetMediaPath( void ) { return m_media_path; }
+
+private:
+	// class sub-thread functions: one decodes into m_frameQue, the workers detect from it:
+	void DecodeLoop( void );
+	void DetectLoop( void );
+
+	std::string																	m_data_dir;					// where the face models are
+	std::string																	m_media_path;
+	std::shared_ptr<FaceIndex>									mp_index;
+
+	std::thread*																mp_decoder = NULL;
+	std::vector<std::thread*>										m_workers;
+	std::atomic<bool>														m_stop;
+	std::atomic<bool>														m_decoding;
+	std::atomic<int32_t>												m_workers_running;
+
+	FACE_MODEL																	m_face_model;
+	float																				m_detect_scale;
+	bool																				m_landmarks;
+
+	// decoded gray frames waiting for a worker, bounded so decode does not run far ahead:
+	typedef struct _FACE_INDEXER_FRAME
+	{
+		FFVideo_Image		m_im;
+		int32_t					m_frame_num = 0;
+		int64_t					m_pts = 0;
+	} FACE_INDEXER_FRAME;
+	//
+	std::mutex																	m_queue_lock;
+	std::condition_variable											m_queue_cv;
+	std::queue<FACE_INDEXER_FRAME>							m_frameQue;
+	size_t																			m_max_queue = 0;
+	std::vector<FFVideo_Image>									m_free_images;			// taken frames' pixels for reuse, under m_queue_lock
+
+	std::atomic<int64_t>												m_frames_expected;
+	std::atomic<uint64_t>												m_decoded;
+	std::atomic<uint64_t>												m_detected;
+	std::atomic<uint64_t>												m_skipped;
+	std::atomic<uint64_t>												m_faces;
+	std::atomic<bool>														m_done;
+	std::chrono::steady_clock::time_point				m_start_time;
+	std::mutex																	m_err_lock;
+	std::string																	m_err;
+};
+
+
+
+#endif // _FACEINDEX_H_
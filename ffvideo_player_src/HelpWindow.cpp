@@ -368,8 +368,9 @@ void HelpWindow::BuildFeatureBullets( void )
 		</LI>
 		<LI value="7"> 
 					<b>Example Export File:</b> is the file path and basename for frame exports as configured by the <b>Frame Export Directory</b> and <b>Export Basename</b> buttons.
-					The timecode is an ISO Extended Timecode with milliseconds, corresponding to the time the video frame is added to the frame export queue, which is also the same
-					time the frame would be displayed, if it is being displayed. 
+					Exported files are named by stream number, frame number and presentation time in microseconds, so exporting the same frame again writes the same file.
+					Every 10,000 files go into a new numbered subdirectory, and a <i>[basename]_s[stream]_manifest.csv</i> file in the export directory lists each frame written
+					and the path it was written to. When archiving, the archive's timecode is an ISO Extended Timecode of when the archive was started. 
 		</LI>
 		<LI value="8"> 
 					<b>Frame Export Scale:</b> is a text entry field for a <i><b>normalized floating point value</b></i>, meaning a value between 0.0 and 1.0. The value is treated like
@@ -377,31 +378,30 @@ void HelpWindow::BuildFeatureBullets( void )
 		</LI>
 		<LI value="9"> 
 					<b>Frame Export Quality:</b> is an integer text entry field with spinner buttons and a range between 0 and 100. The value is the JPEG compression quality used when saving.  
+					</br></br>
+					To the right is the <b>Export Format</b> pull-down. JPEG is the default; for machine learning datasets that should not be lossy, frames may instead be exported 
+					as <b>raw RGB or Gray pixels</b> (the width and height are in the filename), <b>NumPy .npy arrays</b>, <b>PNG</b> using a fast zlib level, or <b>WebP</b>, 
+					lossy using the quality value or lossless. WebP requires the video library to be built with libwebp. 
 		</LI>
 		<LI value="10"> 
 					<b>Encoding Interval:</b> is an integer text entry field with spinner buttons. This is the frequency <b>Exported Frames</b> are compressed back into video streams,
 					potentially with alterations due to the use of <b>AVFilterGraph Video Filters</b> or simply for archive, because the streams originate from security cameras. 
 		</LI>
 		<LI value="11"> 
-					<b>Encoding Interval:</b> is an integer text entry field with spinner buttons. This is the frequency <b>Exported Frames</b> are compressed back into video streams,
-					potentially with alterations due to the use of <b>AVFilterGraph Video Filters</b> or simply for archive, because the streams originate from security cameras. The
+					<b>Encoding Segment Length:</b> is an integer text entry field with spinner buttons. When both this and the <b>Frame Export Interval</b> are non-zero, every 
+					<b>Frame Export Interval</b> frame is compressed into new video streams inside this application, potentially with alterations due to the use of 
+					<b>AVFilterGraph Video Filters</b> or simply for archive, because the streams originate from security cameras. No frames are exported as image files while 
+					encoding. This value is the number of encoded frames per video stream file; when a file reaches that length it is closed and the next file begins. The
           <b>Encoding Directory</b> and <b>Encoding Basename</b> buttons are used to specify the directory the new encoded video stream files are saved, and the filename
 					prefix to use when saving them. 
 		</LI>
 		<LI value="12"> 
 					<b>Example Encode File:</b> is the file path and basename for new encoded stream files as configured by the <b>Encoding Directory</b> and <b>Encoding Basename</b> 
-					buttons. The <b>N</b> in the filename corresponds to the Nth encoding since play began on that stream. 
+					buttons. The <b>N</b> in the filename corresponds to the Nth encoded file since play began on that stream. 
 		</LI>
 		<LI value="13"> 
-					<b>FFmpeg.exe Path:</b> is the path to the <b>FFmpeg</b> executable to use when compressing new streams. At minimum, the <b>FFmpeg</b> executable must be compiled 
-					with the <b>H.264 Codec</b> for steam encoding to work. Note that a pre-compiled version is available from the author's Github project for this application.  
-					</br></br>
-					To the right of the <b>Set path to FFmpeg.exe</b> button is a pull-down selector for choosing what happens to the <b>Exported Video Frames</b> after encoding.
-					<b>They can be deleted,</b> or </b>copied to another location.</b> If the <b>Exported Video Frames</b> are moved to another location, the button to the right 
-					labeled <b>Post Encode Move Path</b> is used to set where image files are coped after encoding. 
-					</br></br>
-					Beneath this line of controls is text showing the active <b>FFmpeg.exe</b> path, and beneath that is more text labeled <b>Post Encode Move</b>, that is the path
-					configured with the <b>Post Encode Move Path</b> button, it is the final destination of <b>Exported Video Frames</b> if they are not deleted. 
+					Encoding is performed by the same <b>FFmpeg</b> libraries used for playback, directly from the frames as they are delivered, so no external <b>FFmpeg</b> 
+					executable is needed. The video library must be linked with an <b>H.264 Codec</b> (libx264 is preferred) for stream encoding to work. 
 		</LI>
 		<LI value="14"> 
 					<b>Encoding FPS:</b> is a text entry field for the <b>playback frames per second rate</b> of the encoded video streams. This may contain integer or floating point
@@ -411,17 +411,15 @@ void HelpWindow::BuildFeatureBullets( void )
 					<b>Encoding Type:</b> is pull-down selection for choosing the video encoding. Current options are:
 					<ul>
 						<li>
-							<b>Encode standard media player H.264 MP4 files:</b> this encodes .MP4 files using an <b>FFmpeg</b> command line of this format:
+							<b>Encode standard media player H.264 MP4 files:</b> this encodes .MP4 files with settings equivalent to this <b>FFmpeg</b> command line:
 							<div class="inset">
-									ffmpeg.exe -f image2 -safe 0 -f concat -i list.txt -vf scale=[userval]:[userval] -r [userval] -c:v libx264 -pix_fmt yuv420p -refs 16 -crf 18 -preset ultrafast output3.mp4
+									ffmpeg.exe -vf scale=[userval]:[userval] -r [userval] -c:v libx264 -pix_fmt yuv420p -crf 18 -preset ultrafast output.mp4
 							</div>
 							Videos encoded with these settings retain decent quality, play in consumer video players, and upload to video services such as YouTube fine. 
 						</li>
 						<li>
-							<b>Encode H.264 MP4 and H.264 Elementry Stream files</b> this encodes twice, first to an H.264 MP4 file, and then the MP4 is converted into its Elementary Stream using:
-							<div class="inset">
-									ffmpeg -i inputfile.mp4 -r [userval] -an -c:v libx264 outputfile.264
-							</div>
+							<b>Encode H.264 MP4 and H.264 Elementry Stream files</b> the same compressed frames are written to both an H.264 MP4 file and an H.264 Elementary Stream (.264) file at once,
+							with no second encoding pass.
 							H.264 Elementary Streams may be placed into a directory running the <b><a href="http://live555.com/mediaServer/">Live555 Media Server</a></b> and immediately re-streamed virtually
 							anywhere. (The author of this application is a huge fan of the Live555 libraries, and a future version of this software will support deeper integration with the Live555 libraries.)  
 							With a little creative hacking, one could create a video feedback loop with evolutionary video filtering experiments, or place cameras around to create a video security system
@@ -24,12 +24,6 @@
 
 #include "ffvideo_player_app.h"
 
-// These custom wxWidgets events need data defined, so here that is:
-//
-wxDEFINE_EVENT(wxEVT_VideoEncodeEvent, wxCommandEvent);
-//
-wxDEFINE_EVENT(wxEVT_VideoEncodeDoneEvent, wxCommandEvent);
-
 const long ID_DELAYEDCALLBACKS_TIMER = wxNewId();
 
 wxBEGIN_EVENT_TABLE(RenderCanvas, wxGLCanvas)
@@ -50,14 +44,14 @@ RenderCanvas::RenderCanvas(wxWindow* parent, VideoStreamConfig* streamConfig)
 								wxDefaultPosition, wxDefaultSize,
 								wxFULL_REPAINT_ON_RESIZE | wxCLIP_CHILDREN | wxCLIP_SIBLINGS),
 	mp_videoWindow((VideoWindow*)parent),
-	m_faceDetectMgr(mp_videoWindow->mp_app),
+	m_faceDetectMgr(mp_videoWindow->mp_app->m_data_dir),
+	m_faceIndexer(mp_videoWindow->mp_app->m_data_dir),
 	m_delayedCallbacks(100, this, ID_DELAYEDCALLBACKS_TIMER), // times per second delayed callbacks are checked for expiration
 	m_status(VIDEO_STATUS::NEVER_PLAYED),
 	mp_playThread(NULL),
 	m_playThreadStarted(false),
 	m_playThreadExited(false),
 	m_playThreadJoined(false),
-	m_next_encoder_id(0),
 	m_frame_loaded(false),
 	m_is_paused(false),
 	m_is_playing(false),
@@ -75,7 +69,8 @@ RenderCanvas::RenderCanvas(wxWindow* parent, VideoStreamConfig* streamConfig)
 	m_rel_mpos(0, 0),
 	m_text_pos(10, 10),
 	m_ip_restarts(0),
-	m_theme(false)
+	m_theme(false),
+	m_luma_frame_num(-1)
 {
 	mp_app = mp_videoWindow->mp_app;
 
@@ -84,8 +79,6 @@ RenderCanvas::RenderCanvas(wxWindow* parent, VideoStreamConfig* streamConfig)
 
 	// events generated outside the GUI thread that are caught by this class and executed here:
 	Bind(wxEVT_VideoNoticeEvent,     &RenderCanvas::OnVideoNotice,     this);
-	Bind(wxEVT_VideoEncodeEvent,     &RenderCanvas::OnVideoEncode,     this);
-	Bind(wxEVT_VideoEncodeDoneEvent, &RenderCanvas::OnVideoEncodeDone, this);
 
 	// load our logo as an initial video frame:
 	LoadLogoFrame();
@@ -137,6 +130,12 @@ RenderCanvas::RenderCanvas(wxWindow* parent, VideoStreamConfig* streamConfig)
 	// select the face landmarks model here:
 	m_faceDetectMgr.SetFaceModel( FACE_MODEL::eightyone );
 	//
+	// one detector per core (less one for playback), newest frames kept when they fall behind:
+	m_faceDetectMgr.SetWorkers( 0, FACE_DROP_POLICY::latest );
+	//
+	// face images are offered to the exporter, which ignores them until it is started:
+	m_faceDetectMgr.SetChipExporter( &m_chipExporter );
+	//
 	m_faceDetectMgr.StartFaceDetectionThread();
 
 
@@ -153,12 +152,17 @@ RenderCanvas::~RenderCanvas()
 		mp_ffvideo->KillStream();
 		wxMilliSleep(500);
 		mp_ffvideo->SetDisplayFrameCallback(NULL, NULL);
+		mp_ffvideo->SetLumaFrameCallback(NULL, NULL);
 		mp_ffvideo->SetStreamTerminatedCallBack(NULL, NULL);
 		mp_ffvideo->SetStreamFinishedCallBack(NULL, NULL);
 		wxMilliSleep(500);
 	}
 
 	m_faceDetectMgr.StopFaceDetectionThread();
+	m_faceDetectMgr.SetChipExporter( NULL );
+	m_faceDetectMgr.SetTracer( NULL );
+	m_chipExporter.Stop();
+	m_faceIndexer.Stop();
 
 	if (mp_glRC)
 	{
@@ -194,11 +198,16 @@ void RenderCanvas::GenerateRenderFont(VideoStreamConfig* vsc)
 ////////////////////////////////////////////////////////////////////////
 bool RenderCanvas::InitFFMPEG(bool deleteFirst)
 {
+	bool tracing(false);	// carried over to the new instance
+
 	if (deleteFirst)
 	{
+		tracing = mp_ffvideo->IsTracing();
+
 		Stop();
 
 		mp_ffvideo->SetDisplayFrameCallback(NULL, NULL);
+		mp_ffvideo->SetLumaFrameCallback(NULL, NULL);
 		mp_ffvideo->SetStreamTerminatedCallBack(NULL, NULL);
 		mp_ffvideo->SetStreamFinishedCallBack(NULL, NULL); 
 		mp_ffvideo->SetStreamLoggingCallback(NULL, NULL);
@@ -219,11 +228,17 @@ bool RenderCanvas::InitFFMPEG(bool deleteFirst)
 	//
 	// ffvideo callbacks for information, video frame delivery, and key events: 
 	mp_ffvideo->SetDisplayFrameCallback(FrameCallBack, this);
+	UpdateLumaOutput();
 	mp_ffvideo->SetStreamTerminatedCallBack(UnexpectedTerminationCallBack, this);
 	mp_ffvideo->SetStreamFinishedCallBack(MediaEndedCallBack, this);
 	mp_ffvideo->SetStreamLoggingCallback(AVLibLoggingCallBack, this);
 	//
 	mp_ffvideo->SetScrubBufferSize(30 * 10);	// how many frames to retain for the scrub buffer
+	//
+	// face detection records into this instance's trace while tracing is on:
+	m_faceDetectMgr.SetTracer(mp_ffvideo->GetTracer());
+	if (tracing)
+		mp_ffvideo->EnableTracing(true, mp_videoWindow->m_id);
 
 	return true;
 }
@@ -453,24 +468,15 @@ void RenderCanvas::Stop(void)
 
 	mp_ffvideo->StopStream();
 
+	// only media files have frames worth indexing, they are set again when played:
+	m_faceDetectMgr.SetFaceIndexMedia( std::string(), 0.0 );
+
 	m_is_paused = false;
 	m_is_playing = false;
 
 	m_status = VIDEO_STATUS::STOPPED;
 
-	// check if we were encoding exported video frames:
-	VideoStreamConfig* vsc = mp_videoWindow->mp_streamConfig;
-	if (vsc->m_export_interval > 0 && vsc->m_encode_interval > 0)
-	{
-		// check if there are un-encoded exported images waiting to be encoded:
-		const int32_t bufferId = m_next_encoder_id % 2;
-		//
-		if (m_exportedFramePaths[bufferId].size() > 0)
-		{
-			m_next_encoder_id++;
-			SendVideoEncodeEvent();
-		}
-	}
+	// note: if encoding, the video library finishes encoding its queued frames & closes the last movie file on its own
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -561,12 +567,7 @@ bool RenderCanvas::Play(void)
 	}
 	if (mp_ffvideo->GetFrameExportingQueueSize() > 0)
 		please_wait = true;
-	//
-	// want the size of the active encoders, but it is used in another thread, so we shared_lock to read it:
-	std::shared_lock lock(m_encodersSharedMutex);	
-	size_t active_encoders = m_encoders.size();
-	lock.unlock();
-	if (active_encoders > 0)
+	if (mp_ffvideo->IsFrameEncodingActive())
 		please_wait = true;
 
 	if (please_wait)
@@ -588,24 +589,13 @@ bool RenderCanvas::Play(void)
 		}
 
 		std::string              export_dir, export_base;
-		EXPORT_FRAME_CALLBACK_CB p_export_cb(NULL);
-		void*                    p_export_data(NULL);
+		int32_t                  export_interval = vsc->m_export_interval;
 		//
 		// check if we're encoding, not just exporting:
 		if ((vsc->m_export_interval > 0) && (vsc->m_encode_interval > 0))
 		{
-			// we're exporting so tell the lib about the frame export directory:
-			export_dir  = vsc->m_export_dir;
-			export_base = vsc->m_export_base;
-
-			// we only care to be notified about frame exports if we're encoding those frames:
-			p_export_cb = FrameExportCallBack;
-			p_export_data = this;
-			//
-			// because we're encoding, the encode id resets and we clear any old m_exportedFramePaths[2]
-			m_next_encoder_id = 0;
-			m_exportedFramePaths[0].clear();
-			m_exportedFramePaths[1].clear();
+			// encoding takes the frames in-process at the export interval, so no frames are exported as jpegs:
+			export_interval = 0;
 		}
 		else if (vsc->m_export_interval > 0)  
 		{
@@ -613,6 +603,8 @@ bool RenderCanvas::Play(void)
 			export_dir  = vsc->m_export_dir;
 			export_base = vsc->m_export_base;
 		}
+		//
+		SetupFrameEncoding( vsc );
 
 		if (vsc->m_frame_interval == 0)
 		{
@@ -639,8 +631,17 @@ bool RenderCanvas::Play(void)
 			}
 		}
 
-		// if vsc->m_export_interval is > 0 encoding is enabled, if vsc->m_export_interval == 0 encoding is disabled: 
-		mp_ffvideo->SetFrameExportingParams(vsc->m_export_interval, export_dir, export_base, vsc->m_export_scale, vsc->m_export_quality, p_export_cb, p_export_data);
+		// if export_interval is > 0 exporting is enabled, if export_interval == 0 exporting is disabled: 
+		mp_ffvideo->SetFrameExportingParams(export_interval, export_dir, export_base, vsc->m_export_scale, vsc->m_export_quality);
+		//
+		FFVIDEO_Export_Format export_format;
+		vsc->ExportFormat( export_format );
+		mp_ffvideo->SetFrameExportFormat( export_format );
+		mp_ffvideo->SetFrameExportArchive( vsc->m_export_archive );
+		//
+		FFVIDEO_Export_Naming export_naming;
+		export_naming.m_stream_id = vsc->m_id;
+		mp_ffvideo->SetFrameExportNaming( export_naming );
 
 		if (vsc->m_type == STREAM_TYPE::FILE)
 		{
@@ -734,6 +735,9 @@ bool RenderCanvas::PlayMediaFile(void)
 		return false;
 	}
 	m_is_playing = true;
+
+	// faces found in this file are kept, so replays & steps do not detect them again:
+	m_faceDetectMgr.SetFaceIndexMedia( vsc->m_info, mp_ffvideo->GetExpectedFrameRate() );
 	return true;
 }
 
@@ -860,30 +864,4 @@ void RenderCanvas::SendOverlayNoticeEvent( std::string& msg, int32_t millisecond
 	AddPendingEvent(cmdEvt);
 }
 
-// the "export frame callback" is called with every frame export
-// typedef void(*EXPORT_FRAME_CALLBACK_CB)(void* p_object, int32_t frame_num, const char* filepath, bool status);
-//
-///////////////////////////////////////////////////////////////////
-void RenderCanvas::SendVideoEncodeEvent(void)
-{
-	if (!mp_app) 
-		return;
-	if (!mp_app->m_we_are_launched || m_terminating)
-		return;
-
-	wxCommandEvent evt(wxEVT_VideoEncodeEvent);
-	AddPendingEvent(evt);
-}
-
-///////////////////////////////////////////////////////////////////
-void RenderCanvas::SendVideoEncodeDoneEvent(void)
-{
-	if (!mp_app) 
-		return;
-	if (!mp_app->m_we_are_launched || m_terminating)
-		return;
-
-	wxCommandEvent evt(wxEVT_VideoEncodeDoneEvent);
-	AddPendingEvent(evt);
-}
 
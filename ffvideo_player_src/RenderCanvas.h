@@ -38,12 +38,6 @@ public:
 	void OnMouseEvent(wxMouseEvent& event);
 	void OnVideoNotice(wxCommandEvent& event);					 // custom event, add notice to video overlay
 	void DelayeCallbacksMonitor(wxTimerEvent& event);    // callback for the DelayedCallbacksMgr 
-																											 //
-	void SendVideoEncodeEvent(void);										 // custom event, do an FFmpeg encoding
-	void OnVideoEncode(wxCommandEvent& event);
-	//
-	void SendVideoEncodeDoneEvent(void);								 // custom event, signal FFmpeg encode done
-	void OnVideoEncodeDone(wxCommandEvent& event);
 
 	bool InitFFMPEG(bool deleteFirst);
 
@@ -54,8 +48,11 @@ public:
 	static void FrameCallBack(void* p_object, FFVideo_Image& im, int frame_num);
 	void FrameCallBack(FFVideo_Image& im, int frame_num);
 	//
-	static void FrameExportCallBack(void* p_object, int32_t frame_num, int32_t export_num, const char* filepath, bool status);
-	void FrameExportCallBack(int32_t frame_num, int32_t export_num, const char* filepath, bool status);
+	static void LumaFrameCallBack(void* p_object, FFVideo_Image& luma, int frame_num);
+	void LumaFrameCallBack(FFVideo_Image& luma, int frame_num);
+	//
+	static void FrameEncodeSegmentCallBack(void* p_object, int32_t segment_num, int32_t frame_count, const char* filepath, bool status);
+	void FrameEncodeSegmentCallBack(int32_t segment_num, int32_t frame_count, const char* filepath, bool status);
 	//
 	static void UnexpectedTerminationCallBack(void* p_object);
 	void UnexpectedTerminationCallBack(void);
@@ -73,6 +70,9 @@ public:
 
 	void CommonFrameHandling( FFVideo_Image& im, int frame_num );
 
+	// face detection takes the decoder's luma plane when enabled, at the detection scale:
+	void UpdateLumaOutput( void );
+
 	// video controls (GLButtons) callbacks:
 	static void PlayButton_cb(void* p_object, GLButton* button);
 	void PlayButton_cb(GLButton* button);
@@ -142,16 +142,8 @@ private:
 	bool PlayUSBCamera(void);
 	bool PlayIPCamera(void);
 
-	// here's a different thread operation; here is a vector of FrameEncoder, one for each frame  
-	// encode spawned by both exporting frames and then encoding them in encode_interval chunks.
-	//
-	mutable std::shared_mutex	 m_encodersSharedMutex;	
-	std::vector<FrameEncoder*> m_encoders;
-	std::atomic<int32_t>			 m_next_encoder_id;
-
-	// a double buffer of strings, used to hold exported frame filenames.
-	// Double buffered so the logic does not need to worry about threading collision: 
-	std::vector<std::string>   m_exportedFramePaths[2];
+	// frame encoding happens inside the video library; this passes the stream config's encode params to it:
+	bool SetupFrameEncoding(VideoStreamConfig* vsc);
 
 public:
 
@@ -234,7 +226,11 @@ public:
 
 	// face & feature detection:
 	FaceDetectionThreadMgr										m_faceDetectMgr;
+	FaceIndexer																m_faceIndexer;			// the "pre-index this file" job
+	FaceChipExporter													m_chipExporter;			// writes the face images m_faceDetectMgr delivers
 	FF_Vector2D																m_detectImSize;
+	FFVideo_Image															m_luma;							// from LumaFrameCallBack(), for the frame that follows
+	int32_t																		m_luma_frame_num;
 	std::vector<dlib::rectangle>							m_detections;
 	std::vector<dlib::full_object_detection>  m_facesLandmarkSets;
 	std::vector<FFVideo_Image>								m_facesImages;
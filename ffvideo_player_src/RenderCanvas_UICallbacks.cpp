@@ -39,10 +39,18 @@ void RenderCanvas::FrameCallBack(FFVideo_Image& im, int frame_num)
 	if (mp_videoWindow && mp_videoWindow->m_terminating)
 		return;
 
-	// if the face detector is both initialized and enbled, send the frame for face detection: 
+	// if the face detector is both initialized and enbled, send the frame for face detection,
+	// with its luma plane if that arrived just before it: 
 	if (m_faceDetectMgr.m_faceDetectorInitialized && m_faceDetectMgr.m_faceDetectorEnabled)
 	{
-		m_faceDetectMgr.Add( im, frame_num );
+		FFVideo_Image* p_luma = (m_luma.mp_pixels && m_luma_frame_num == frame_num) ? &m_luma : NULL;
+		uint64_t dropped = m_faceDetectMgr.GetDroppedCount();
+		m_faceDetectMgr.Add( im, frame_num, p_luma );
+
+		// frames the detectors could not keep up with show in the library's drop counts:
+		dropped = m_faceDetectMgr.GetDroppedCount() - dropped;
+		if (dropped > 0 && mp_ffvideo)
+			mp_ffvideo->CountClientDrops( (uint32_t)dropped );
 	}
 	else // no face detection, forward to rendering prep:
 	{
@@ -50,6 +58,42 @@ void RenderCanvas::FrameCallBack(FFVideo_Image& im, int frame_num)
 	}
 }
 
+////////////////////////////////////////////////////////////////////////////////////
+// installed into ffvideo's luma frame callback while face detection is enabled, this
+// receives the decoder's Y plane just before FrameCallBack() receives the same frame
+void RenderCanvas::LumaFrameCallBack(void* p_object, FFVideo_Image& luma, int frame_num)
+{
+	if (p_object)
+		((RenderCanvas*)p_object)->LumaFrameCallBack(luma, frame_num);
+}
+void RenderCanvas::LumaFrameCallBack(FFVideo_Image& luma, int frame_num)
+{
+	if (mp_videoWindow && mp_videoWindow->m_terminating)
+		return;
+
+	m_luma.Clone( luma );
+	m_luma_frame_num = frame_num;
+}
+
+////////////////////////////////////////////////////////////////////////
+void RenderCanvas::UpdateLumaOutput( void )
+{
+	if (!mp_ffvideo)
+		return;
+
+	if (IsFaceDetectionEnabled())
+	{
+		// the library only reduces, larger detection scales sample up from the native plane:
+		float scale = std::min( 1.0f, m_faceDetectMgr.GetFaceDetectionScale() );
+		mp_ffvideo->SetLumaFrameCallback( LumaFrameCallBack, this, scale );
+	}
+	else
+	{
+		mp_ffvideo->SetLumaFrameCallback( NULL, NULL );
+		m_luma.Empty();
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////
 // when face detection completes, the face detected frame is sent here
 void RenderCanvas::FrameFaceDetectionCallBack(void* p_object, FaceDetectionFrame& fdf)
@@ -64,8 +108,9 @@ void RenderCanvas::FrameFaceDetectionCallBack(FaceDetectionFrame& fdf)
 		// we use the image size of the face detection image to normalize the 
 		// face points, so that size is acquired here. It's acquired here so
 		// the face detection code is free to muck around with detection image
-		// resolution for speed-wise optimization of face detections:
-		m_faceDetectMgr.mp_faceDetector->GetDlibImageSize( m_detectImSize );
+		// resolution for speed-wise optimization of face detections. Each
+		// frame carries the size its own worker's detector used:
+		m_detectImSize = fdf.m_detect_im_size;
 
 		m_detections = fdf.m_detections;
 
@@ -115,56 +160,6 @@ void RenderCanvas::CommonFrameHandling(FFVideo_Image& im, int frame_num)
 }
 
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// the "export frame callback" is called with every frame export (writing of a frame to disk)
-// typedef void(*EXPORT_FRAME_CALLBACK_CB)(void* p_object, int32_t frame_num, const char* filepath, bool status);
-//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-void RenderCanvas::FrameExportCallBack(void* p_object, int32_t frame_num, int32_t export_num, const char* filepath, bool status)
-{
-	if (p_object)
-		((RenderCanvas*)p_object)->FrameExportCallBack(frame_num, export_num, filepath, status);
-}
-
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-// installed as the video library's frame export callback, this is called after each frame's write to disk; the parameters:
-//		frame_num			this is the frame number according to the media
-//		export_num		this tells us how many frame exports have occured since Play began, including this one
-//		filepath			where the file is saved
-//		status				if false, there's been a write error on this file. It may not exist, due to a write error. Exporting is terminated. 
-//
-// Note: this is only installed if we're encoding exported frames into movies.
-// Note: due to slow disks, this could be called long after the same frame is displayed. 
-void RenderCanvas::FrameExportCallBack(int32_t frame_num, int32_t export_num, const char* filepath, bool status)
-{
-	// the filenames are put into a vector, but one of two, double buffered to prevent thread collision:
-	const int32_t bufferId = m_next_encoder_id % 2;
-
-	m_exportedFramePaths[bufferId].push_back( filepath );
-
-	int32_t encode_interval = mp_videoWindow->mp_streamConfig->m_encode_interval.load(std::memory_order::memory_order_relaxed);
-
-	int32_t export_queue_size = mp_ffvideo->GetFrameExportingQueueSize();
-
-	bool end_of_this_streams_export_frames(false);
-	//
-	if ((m_status == VIDEO_STATUS::STOPPED) || (m_status == VIDEO_STATUS::UNEXPECTED_TERMINATION) || (m_status == VIDEO_STATUS::MEDIA_ENDED))
-	{
-		if (export_queue_size == 0)
-		{
-			if (!status)
-				end_of_this_streams_export_frames = true;
-		}
-	}
-
-	if ((m_exportedFramePaths[bufferId].size() >= encode_interval) || end_of_this_streams_export_frames)
-	{
-		m_next_encoder_id++;
-		SendVideoEncodeEvent();
-	}
-}
-
-
-
 ///////////////////////////////////////////////////////////////////
 // installed into ffvideo, this is called upon stream terminations
 void RenderCanvas::UnexpectedTerminationCallBack(void* p_object)
@@ -406,6 +401,7 @@ bool RenderCanvas::EnableFaceDetection( bool enable )
 
 	// "enable" could have a value of true or false here:
 	m_faceDetectMgr.m_faceDetectorEnabled = enable;
+	UpdateLumaOutput();
 
 	if (!IsFaceDetectionEnabled())
 	{
@@ -367,8 +367,8 @@ void RenderCanvas::OnPaint(wxPaintEvent& WXUNUSED(event))
 		if (encode_interval)
 		{
 			if (boinker)
-				scratch = mp_videoWindow->mp_app->FormatStr("Frame ENCODING with interval: %d", encode_interval ); 
-			else scratch = mp_videoWindow->mp_app->FormatStr("Frame Encoding with interval: %d", encode_interval );
+				scratch = mp_videoWindow->mp_app->FormatStr("Frame ENCODING every %d, %d per movie", vsc->m_export_interval, encode_interval ); 
+			else scratch = mp_videoWindow->mp_app->FormatStr("Frame Encoding every %d, %d per movie", vsc->m_export_interval, encode_interval );
 		}
 		else
 		{
@@ -388,14 +388,26 @@ void RenderCanvas::OnPaint(wxPaintEvent& WXUNUSED(event))
 
 		if (vsc->m_type == STREAM_TYPE::FILE && m_expected_frames > 0)
 		{
-			scratch = mp_videoWindow->mp_app->FormatStr("frame %d of %d @ %1.1f fps", m_current_frame_num % m_expected_frames, m_expected_frames, mp_ffvideo->GetReceivedFPS());
+			scratch = mp_videoWindow->mp_app->FormatStr("frame %d of %d @ %1.1f fps", m_current_frame_num % m_expected_frames, m_expected_frames, mp_ffvideo->GetDeliveredFPS());
 			m_text.push_back(scratch);
 		}
 		else
 		{
-			scratch = mp_videoWindow->mp_app->FormatStr("frame %d @ %1.1f fps", m_current_frame_num, mp_ffvideo->GetReceivedFPS());
+			scratch = mp_videoWindow->mp_app->FormatStr("frame %d @ %1.1f fps", m_current_frame_num, mp_ffvideo->GetDeliveredFPS());
 			m_text.push_back(scratch);
 		}
+
+		// decoding falling behind reading shows a decode bottleneck, drops with decoding keeping up a consumer one:
+		FFVIDEO_Throughput_Stats ts;
+		mp_ffvideo->GetThroughputStats(ts);
+		uint64_t drops = 0;
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_DROP::COUNT; i++)
+			if (i != (int32_t)FFVIDEO_DROP::FRAME_INTERVAL)	// asked for
+				drops += ts.m_drops[i].m_total;
+		scratch = mp_videoWindow->mp_app->FormatStr("10s: %1.1f packets, %1.1f decoded, %1.1f delivered per sec, %llu dropped", 
+																								ts.m_rates[(int32_t)FFVIDEO_RATE::PACKETS].m_rate_10s, ts.m_rates[(int32_t)FFVIDEO_RATE::DECODED].m_rate_10s,
+																								ts.m_rates[(int32_t)FFVIDEO_RATE::DELIVERED].m_rate_10s, (unsigned long long)drops);
+		m_text.push_back(scratch);
 	}
 
 	if (m_ip_restarts)
@@ -50,14 +50,13 @@ public:
 	void OnExportBasenameButton(wxCommandEvent& event);
 	void OnExportScaleEdit(wxCommandEvent& event);
 	void OnExportQuality(wxCommandEvent& event);
+	void OnExportFormat(wxCommandEvent& event);
+	void OnExportArchive(wxCommandEvent& event);
 
 	void OnEncodeDirButton(wxCommandEvent& event);
 	void OnEncodeBasenameButton(wxCommandEvent& event);
 
 	void OnEncodeInterval(wxCommandEvent& event);
-	void OnFFmpegPathButton(wxCommandEvent& event);
-	void OnPostEncodeAction(wxCommandEvent& event);
-	void OnMovePathButton(wxCommandEvent& event);
 	void OnEncodeFPS(wxCommandEvent& event);
 	void OnEncodeType(wxCommandEvent& event);
 	void OnEncodeWH(wxCommandEvent& event);
@@ -79,8 +78,6 @@ public:
 
 	void UpdateExampleFrameExportPath( void );
 	void UpdateExampleFrameEncodePath( void );
-	void UpdateFFmpegPath( void );
-	void UpdatePostEncodeMovePath( void );
 
 	TheApp*										mp_app;
 	VideoWindow*							mp_parent;
@@ -104,14 +101,11 @@ public:
 	wxStaticText*							mp_exampleFrameExportPath;
 	wxTextCtrl*								mp_exportScaleCtrl;
 	wxSpinCtrl*								mp_exportQualityCtrl;
+	wxComboBox*								mp_exportFormatCtrl;
+	wxCheckBox*								mp_exportArchiveCtrl;
 
 	wxComboBox*								mp_encodeTypeCtrl;
 	wxSpinCtrl*								mp_encodeIntervalCtrl;
-	wxButton*									mp_ffmpegPath_button;
-	wxStaticText*							mp_ffmpegPath;
-	wxStaticText*							mp_postEncodeMovePath;
-	wxComboBox*								mp_postEncodeCtrl;
-	wxButton*									mp_movePath_button;
 	wxButton*									mp_encodeDir_button;
 	wxButton*									mp_encodeBasename_button;
 	wxStaticText*							mp_exampleFrameEncodePath;
@@ -128,18 +128,15 @@ void VideoStreamConfig::Init(TheApp* app, CKeyValueStore* keyValueStore)
 	data_key = data_prefix + "export_quality";
 	m_export_quality = keyValueStore->ReadInt(data_key, 80);
 
+	data_key = data_prefix + "export_format";
+	m_export_format = keyValueStore->ReadInt(data_key, 0);
 
-	data_key = data_prefix + "encode_interval";
-	m_encode_interval = keyValueStore->ReadInt(data_key, 0);
-
-	data_key = data_prefix + "post_encode";
-	m_post_encode = keyValueStore->ReadInt(data_key, 0);
+	data_key = data_prefix + "export_archive";
+	m_export_archive = keyValueStore->ReadBool(data_key, false);
 
-	data_key = data_prefix + "ffmpeg_path";
-	m_ffmpeg_path = keyValueStore->ReadString(data_key, "unknown");
 
-	data_key = data_prefix + "post_move_path";
-	m_post_move_path = keyValueStore->ReadString(data_key, "unknown");
+	data_key = data_prefix + "encode_interval";
+	m_encode_interval = keyValueStore->ReadInt(data_key, 0);
 
 	data_key = data_prefix + "encode_dir";
 	m_encode_dir = keyValueStore->ReadString(data_key, "unknown");
@@ -194,11 +191,10 @@ VideoStreamConfig::VideoStreamConfig(const VideoStreamConfig& vsc)
 	m_export_base     = vsc.m_export_base;
 	m_export_scale    = vsc.m_export_scale;
 	m_export_quality  = vsc.m_export_quality;
+	m_export_format   = vsc.m_export_format;
+	m_export_archive  = vsc.m_export_archive;
 
 	m_encode_interval = vsc.m_encode_interval.load(std::memory_order::memory_order_relaxed);
-	m_post_encode     = vsc.m_post_encode;
-	m_ffmpeg_path     = vsc.m_ffmpeg_path;
-	m_post_move_path  = vsc.m_post_move_path;
 	m_encode_dir      = vsc.m_encode_dir;
 	m_encode_base     = vsc.m_encode_base;
 	m_encode_fps      = vsc.m_encode_fps;
@@ -240,11 +236,10 @@ VideoStreamConfig& VideoStreamConfig::operator = (const VideoStreamConfig& vsc)
 		m_export_base     = vsc.m_export_base;
 		m_export_scale    = vsc.m_export_scale;
 		m_export_quality  = vsc.m_export_quality;
+		m_export_format   = vsc.m_export_format;
+		m_export_archive  = vsc.m_export_archive;
 
 		m_encode_interval = vsc.m_encode_interval.load(std::memory_order::memory_order_relaxed);
-		m_post_encode     = vsc.m_post_encode;
-		m_ffmpeg_path     = vsc.m_ffmpeg_path;
-		m_post_move_path  = vsc.m_post_move_path;
 		m_encode_dir      = vsc.m_encode_dir;
 		m_encode_base     = vsc.m_encode_base;
 		m_encode_fps      = vsc.m_encode_fps;
@@ -414,18 +409,15 @@ void VideoStreamConfig::Save(TheApp* app)
 	data_key = data_prefix + "export_quality";
 	keyValueStore->WriteInt( data_key, m_export_quality );
 
+	data_key = data_prefix + "export_format";
+	keyValueStore->WriteInt( data_key, m_export_format );
 
-	data_key = data_prefix + "encode_interval";
-	keyValueStore->WriteInt( data_key, m_encode_interval );
+	data_key = data_prefix + "export_archive";
+	keyValueStore->WriteBool( data_key, m_export_archive );
 
-	data_key = data_prefix + "post_encode";
-	keyValueStore->WriteInt( data_key, m_post_encode );
 
-	data_key = data_prefix + "ffmpeg_path";
-	keyValueStore->WriteString( data_key, (char*)m_ffmpeg_path.c_str() );
-
-	data_key = data_prefix + "post_move_path";
-	keyValueStore->WriteString( data_key, (char*)m_post_move_path.c_str() );
+	data_key = data_prefix + "encode_interval";
+	keyValueStore->WriteInt( data_key, m_encode_interval );
 
 	data_key = data_prefix + "encode_dir";
 	keyValueStore->WriteString( data_key, (char*)m_encode_dir.c_str() );
@@ -486,6 +478,24 @@ int32_t VideoStreamConfig::StreamTypeInt( void )
 }
 
 
+void VideoStreamConfig::ExportFormat( FFVIDEO_Export_Format& format )
+{
+	format = FFVIDEO_Export_Format();	// defaults to jpeg
+
+	switch (m_export_format)
+	{
+	default:
+	case 0:	break;
+	case 1: format.m_format = 1; format.m_channels = 3; break;
+	case 2: format.m_format = 1; format.m_channels = 1; break;
+	case 3: format.m_format = 2; format.m_channels = 3; break;
+	case 4: format.m_format = 3; format.m_channels = 3; format.m_png_level = 1; break;
+	case 5: format.m_format = 4; format.m_webp_lossless = false; break;
+	case 6: format.m_format = 4; format.m_webp_lossless = true;  break;
+	}
+}
+
+
 void VideoStreamConfig::SaveStreamType( CKeyValueStore* keyValueStore )
 {
 	std::string data_prefix = "win" + std::to_string(m_id) + "/";
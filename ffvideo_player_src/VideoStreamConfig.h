@@ -48,6 +48,9 @@ public:
 	void SaveStreamType( CKeyValueStore* keyValueStore );
 	int32_t StreamTypeInt( void );
 
+	// converts m_export_format into the video library's export format:
+	void ExportFormat( FFVIDEO_Export_Format& format );
+
 	void SaveStreamInfo( CKeyValueStore* keyValueStore );
 
 
@@ -90,12 +93,11 @@ public:
 	std::string									m_export_dir;						// directory frame is exported, if exported
 	std::string									m_export_base;					// export filename basename before timecode for frame
 	float												m_export_scale;					// some normalized value, 0.0 to 1.0; don't allow larger than delivered
-	int32_t											m_export_quality;				// jpeg quality setting
+	int32_t											m_export_quality;				// jpeg & lossy webp quality setting
+	bool												m_export_archive;				// if true, exports append into archive shards rather than one file per frame
+	int32_t											m_export_format;				// 0 = jpeg, 1 = raw rgb, 2 = raw gray, 3 = .npy rgb, 4 = png, 5 = lossy webp, 6 = lossless webp
 
-	std::atomic<int32_t>				m_encode_interval;			// 0 = off, if > 0 is number of exported frames before encoding them
-	int32_t											m_post_encode;					// an action code; 0 = delete frames, 1 = move to frame store
-	std::string									m_ffmpeg_path;					// required path to ffmpeg.exe for encoding
-	std::string									m_post_move_path;				// if m_post_encode = 1, is path to move image files
+	std::atomic<int32_t>				m_encode_interval;			// 0 = off, if > 0 is number of encoded frames per movie file; frames are taken every m_export_interval
 	std::string									m_encode_dir;						// directory encoded movies are saved, if encoding
 	std::string									m_encode_base;					// encoding basename of movie
 	float												m_encode_fps;						// 0 = last playback fps, else actual encoding fps 
@@ -38,14 +38,13 @@ static const long ID_VIDEOSTREAMDLG_EXPORTDIR = wxNewId();
 static const long ID_VIDEOSTREAMDLG_EXPORTBASE = wxNewId();
 static const long ID_VIDEOSTREAMDLG_EXPORTSCALE = wxNewId();
 static const long ID_VIDEOSTREAMDLG_EXPORTQUALITY = wxNewId();
+static const long ID_VIDEOSTREAMDLG_EXPORTFORMAT = wxNewId();
+static const long ID_VIDEOSTREAMDLG_EXPORTARCHIVE = wxNewId();
 static const long ID_VIDEOSTREAMDLG_EXPORTFAILLIMIT = wxNewId();
 
 static const long ID_VIDEOSTREAMDLG_ENCODEINTERVAL = wxNewId();
 static const long ID_VIDEOSTREAMDLG_ENCODEDIR = wxNewId();
 static const long ID_VIDEOSTREAMDLG_ENCODEBASE = wxNewId();
-static const long ID_VIDEOSTREAMDLG_FFMPEGPATH = wxNewId();
-static const long ID_VIDEOSTREAMDLG_POSTENCODE = wxNewId();
-static const long ID_VIDEOSTREAMDLG_POSTMOVEPATH = wxNewId();
 static const long ID_VIDEOSTREAMDLG_ENCODEFPS = wxNewId();
 static const long ID_VIDEOSTREAMDLG_ENCODETYPE = wxNewId();
 static const long ID_VIDEOSTREAMDLG_ENCODEWH = wxNewId();
@@ -58,11 +57,10 @@ static const long ID_VIDEOSTREAMDLG_FONTBTTN = wxNewId();
 VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWindowID id, const wxString& title, VideoStreamConfig* params)
 	: mp_app(app), mp_parent((VideoWindow*)parent), m_vsc(*params), m_ok(false), mp_loopMediaCtrl(NULL), mp_streamTypeCtrl(NULL), mp_config_button(NULL),
 	  mp_infoCtrl(NULL), mp_frameIntervalCtrl(NULL), mp_autoFrameInterval_button(NULL), mp_exportIntervalCtrl(NULL), mp_exportDir_button(NULL),
-	  mp_exportBasename_button(NULL), mp_exampleFrameExportPath(NULL), mp_exportScaleCtrl(NULL), mp_exportQualityCtrl(NULL), mp_encodeTypeCtrl(NULL),
-	  mp_encodeIntervalCtrl(NULL), mp_ffmpegPath_button(NULL), mp_ffmpegPath(NULL), mp_postEncodeMovePath(NULL), mp_postEncodeCtrl(NULL), 
-		mp_movePath_button(NULL), mp_encodeDir_button(NULL),
+	  mp_exportBasename_button(NULL), mp_exampleFrameExportPath(NULL), mp_exportScaleCtrl(NULL), mp_exportQualityCtrl(NULL), mp_exportFormatCtrl(NULL), mp_exportArchiveCtrl(NULL), mp_encodeTypeCtrl(NULL),
+	  mp_encodeIntervalCtrl(NULL), mp_encodeDir_button(NULL),
 	  mp_encodeBasename_button(NULL), mp_exampleFrameEncodePath(NULL), mp_encodeFPSCtrl(NULL), mp_encodeWHCtrl(NULL), mp_font_button(NULL),
-	  wxDialog(parent, id, title, wxDefaultPosition, wxSize(800, 816) ) 
+	  wxDialog(parent, id, title, wxDefaultPosition, wxSize(800, 720) ) 
 {
 	// m_namesMap is a key/value pairing of stream names and stream ids. This is used
 	// by the stream name pull-down selection control to create a functionality where
@@ -99,7 +97,7 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 	const int ctrlLeft = 150;
 	const int textEditWidth = 600;
 
-	const int pheight = 22 * ctrlH;
+	const int pheight = 19 * ctrlH;
 
 	wxStaticBox* st = new wxStaticBox(panel, -1, wxT("Video Stream Configuration"), wxPoint(5, 5), wxSize(ctrlLeft + textEditWidth + 15, pheight));
 
@@ -117,19 +115,17 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 	wxStaticText* exmoLabel_txt = new wxStaticText(panel, -1, "Frame Export Scale:",     wxPoint(15, 30 + 8 * ctrlH));
 	wxStaticText* exquLabel_txt = new wxStaticText(panel, -1, "Frame Export Quality:",   wxPoint(15, 30 + 9 * ctrlH));
 	//
-	wxStaticText* opt2Addtl_txt = new wxStaticText(panel, -1, "--- Optional Exported Frame Encoding Parameters ------------------------------", 
+	wxStaticText* opt2Addtl_txt = new wxStaticText(panel, -1, "--- Optional Frame Encoding Parameters -----------------------------------------", 
 																								wxPoint(ctrlLeft, 30 + 10 * ctrlH) );
 	//
-	wxStaticText* eninLabel_txt = new wxStaticText(panel, -1, "Encoding Interval:",      wxPoint(15, 30 + 11 * ctrlH));
+	wxStaticText* eninLabel_txt = new wxStaticText(panel, -1, "Encode Segment Length:",  wxPoint(15, 30 + 11 * ctrlH));
 	wxStaticText* exenLabel_txt = new wxStaticText(panel, -1, "Example Encode File:",    wxPoint(15, 30 + 12 * ctrlH));
 
-	wxStaticText* ffmpLabel_txt = new wxStaticText(panel, -1, "FFmpeg.exe Path:",        wxPoint(15, 30 + 13 * ctrlH));
-	wxStaticText* pempLabel_txt = new wxStaticText(panel, -1, "Post Encode Move:",       wxPoint(15, 30 + 15 * ctrlH));
-	wxStaticText* enfsLabel_txt = new wxStaticText(panel, -1, "Encoding FPS:",           wxPoint(15, 30 + 16 * ctrlH));
-	wxStaticText* entyLabel_txt = new wxStaticText(panel, -1, "Encoding Type:",					 wxPoint(15, 30 + 17 * ctrlH));
-	wxStaticText* enwhLabel_txt = new wxStaticText(panel, -1, "Encoding Width, Height:", wxPoint(15, 30 + 18 * ctrlH));
+	wxStaticText* enfsLabel_txt = new wxStaticText(panel, -1, "Encoding FPS:",           wxPoint(15, 30 + 13 * ctrlH));
+	wxStaticText* entyLabel_txt = new wxStaticText(panel, -1, "Encoding Type:",					 wxPoint(15, 30 + 14 * ctrlH));
+	wxStaticText* enwhLabel_txt = new wxStaticText(panel, -1, "Encoding Width, Height:", wxPoint(15, 30 + 15 * ctrlH));
 	//
-	wxStaticText* fontLabel_txt = new wxStaticText(panel, -1, "Video Overlay Font:",     wxPoint(15, 30 + 20 * ctrlH));
+	wxStaticText* fontLabel_txt = new wxStaticText(panel, -1, "Video Overlay Font:",     wxPoint(15, 30 + 17 * ctrlH));
 
 	wxSize textEditSize(textEditWidth, 24);
 
@@ -238,6 +234,10 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 
 	wxStaticText* exscAddtl_txt = new wxStaticText(panel, -1, "A normalized > 0.0 and <= 1.0 value", wxPoint(ctrlLeft + 72, 30 + ctrlsLine * ctrlH) );
 
+	mp_exportArchiveCtrl = new wxCheckBox( panel, ID_VIDEOSTREAMDLG_EXPORTARCHIVE, wxT("Append exports into 1 GB archive shards"), wxPoint(ctrlLeft + 310, 30 + ctrlsLine * ctrlH) );
+	//
+	mp_exportArchiveCtrl->SetValue(m_vsc.m_export_archive);
+
 
 	ctrlsLine++;
 
@@ -246,7 +246,21 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 																				wxPoint(ctrlLeft + 2, 30 + ctrlsLine * ctrlH + vOff), wxSize(60, lh),
 																				wxSP_ARROW_KEYS, 0, 100, m_vsc.m_export_quality);
 
-	wxStaticText* exquAddtl_txt = new wxStaticText(panel, -1, "frame exports are JPEG format, quality varies from 0 to 100", wxPoint(ctrlLeft + 72, 30 + ctrlsLine * ctrlH) );
+	wxStaticText* exquAddtl_txt = new wxStaticText(panel, -1, "JPEG & lossy WebP quality, 0 to 100", wxPoint(ctrlLeft + 72, 30 + ctrlsLine * ctrlH) );
+
+	if (m_vsc.m_export_format < 0 || m_vsc.m_export_format > 6)
+		m_vsc.m_export_format = 0;
+	//
+	// export format combo box:
+	mp_exportFormatCtrl = new wxComboBox(panel, ID_VIDEOSTREAMDLG_EXPORTFORMAT, wxEmptyString, wxPoint(ctrlLeft + 310, 30 + ctrlsLine * ctrlH + vOff), wxSize(290, -1), 0, 0, wxCB_READONLY);
+	mp_exportFormatCtrl->Append("Export JPEG files");
+	mp_exportFormatCtrl->Append("Export raw RGB pixels");
+	mp_exportFormatCtrl->Append("Export raw Gray pixels");
+	mp_exportFormatCtrl->Append("Export NumPy .npy RGB arrays");
+	mp_exportFormatCtrl->Append("Export PNG files (fast zlib level)");
+	mp_exportFormatCtrl->Append("Export lossy WebP files");
+	mp_exportFormatCtrl->Append("Export lossless WebP files");
+	mp_exportFormatCtrl->SetSelection(m_vsc.m_export_format);
 
 
 
@@ -259,7 +273,7 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 																				 wxPoint(ctrlLeft + 2, 30 + ctrlsLine * ctrlH + vOff), wxSize(70, lh),
 																				 wxSP_ARROW_KEYS, 0, 120000, encode_interval);
 
-	wxStaticText* eninAddtl_txt = new wxStaticText(panel, -1, "Encode every N exported frames, 0 = off", wxPoint(ctrlLeft + 82, 30 + ctrlsLine * ctrlH) );
+	wxStaticText* eninAddtl_txt = new wxStaticText(panel, -1, "Frames per encoded file, 0 = off", wxPoint(ctrlLeft + 82, 30 + ctrlsLine * ctrlH) );
 
 	mp_encodeDir_button = new wxButton(panel, ID_VIDEOSTREAMDLG_ENCODEDIR, wxString("Encoding Directory"), 
 																		 wxPoint(ctrlLeft + 320, 30 + ctrlsLine * ctrlH + vOff), wxSize(150, lh));
@@ -276,42 +290,6 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 	}
 
 
-	ctrlsLine++;
-
-	wxString ffmpeg_button_text("Set path to FFmpeg.exe");
-	mp_ffmpegPath_button = new wxButton(panel, ID_VIDEOSTREAMDLG_FFMPEGPATH, ffmpeg_button_text, wxPoint(ctrlLeft, 30 + ctrlsLine * ctrlH + vOff), wxSize(170, lh));
-
-
-	// post encode action combo box:
-	mp_postEncodeCtrl = new wxComboBox(panel, ID_VIDEOSTREAMDLG_POSTENCODE, wxEmptyString, wxPoint(ctrlLeft + 180, 30 + ctrlsLine * ctrlH + vOff + 1), wxSize(230, -1), 0, 0, wxCB_READONLY);
-	mp_postEncodeCtrl->Append("Delete exported frames after encoding");
-	mp_postEncodeCtrl->Append("Move exported frames after encoding");
-	mp_postEncodeCtrl->SetSelection(m_vsc.m_post_encode);
-
-
-	wxString move_button_text("Post encode move path");
-	if (m_vsc.m_ffmpeg_path.compare("unknown")==0)
-	{
-		move_button_text += " is unset";
-	}
-	mp_movePath_button = new wxButton(panel, ID_VIDEOSTREAMDLG_POSTMOVEPATH, move_button_text, wxPoint(ctrlLeft + 420, 30 + ctrlsLine * ctrlH + vOff), wxSize(190, lh));
-
-	ctrlsLine++;
-
-	mp_ffmpegPath = new wxStaticText(panel, -1, "Set with 'Path to FFmpeg.exe' button", wxPoint(ctrlLeft, 30 + ctrlsLine * ctrlH) );
-	if (m_vsc.m_ffmpeg_path.compare("unknown")!=0)
-	{
-		UpdateFFmpegPath();
-	}
-
-	ctrlsLine++;
-
-	mp_postEncodeMovePath = new wxStaticText(panel, -1, "Set with 'Post encode move path' button", wxPoint(ctrlLeft, 30 + ctrlsLine * ctrlH) );
-	if (m_vsc.m_post_move_path.compare("unknown")!=0)
-	{
-		UpdatePostEncodeMovePath();
-	}
-
 	ctrlsLine++;
 
 	if (m_vsc.m_encode_fps < 0.0f)
@@ -366,7 +344,7 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 															m_vsc.m_font_underlined,  wxString( m_vsc.m_font_face_name.c_str() ));
 
 	wxFontPickerCtrl* font_ctrl = new wxFontPickerCtrl( (wxWindow *)this, wxID_ANY, *mp_overlayFont, 
-	wxPoint(ctrlLeft + 160, 30 + 16 * ctrlH + vOff), wxDefaultSize, wxFNTP_DEFAULT_STYLE );
+	wxPoint(ctrlLeft + 160, 30 + 13 * ctrlH + vOff), wxDefaultSize, wxFNTP_DEFAULT_STYLE );
 
 	wxColour fontColor;
 	fontColor.Set( (uint8_t)(m_vsc.m_font_color.x * 255.0f), (uint8_t)(m_vsc.m_font_color.y * 255.0f), (uint8_t)(m_vsc.m_font_color.z * 255.0f));
@@ -410,6 +388,9 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 
 	Connect(ID_VIDEOSTREAMDLG_EXPORTQUALITY, wxEVT_SPINCTRL,	(wxObjectEventFunction)&VideoStreamConfigDlg::OnExportQuality);
 	Connect(ID_VIDEOSTREAMDLG_EXPORTQUALITY, wxEVT_TEXT,      (wxObjectEventFunction)&VideoStreamConfigDlg::OnExportQuality);
+
+	Connect(ID_VIDEOSTREAMDLG_EXPORTFORMAT, wxEVT_COMMAND_COMBOBOX_SELECTED, (wxObjectEventFunction)&VideoStreamConfigDlg::OnExportFormat);
+	Connect(ID_VIDEOSTREAMDLG_EXPORTARCHIVE, wxEVT_CHECKBOX, (wxObjectEventFunction)&VideoStreamConfigDlg::OnExportArchive);
 	
 	Connect(ID_VIDEOSTREAMDLG_ENCODEINTERVAL, wxEVT_SPINCTRL,  (wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeInterval);
 	Connect(ID_VIDEOSTREAMDLG_ENCODEINTERVAL, wxEVT_TEXT,      (wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeInterval);
@@ -417,10 +398,6 @@ VideoStreamConfigDlg::VideoStreamConfigDlg(TheApp* app, wxWindow* parent, wxWind
 	Connect(ID_VIDEOSTREAMDLG_ENCODEDIR,  wxEVT_BUTTON,							(wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeDirButton);
 	Connect(ID_VIDEOSTREAMDLG_ENCODEBASE, wxEVT_BUTTON,							(wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeBasenameButton);
 
-	Connect(ID_VIDEOSTREAMDLG_FFMPEGPATH,   wxEVT_BUTTON,										 (wxObjectEventFunction)&VideoStreamConfigDlg::OnFFmpegPathButton);
-	Connect(ID_VIDEOSTREAMDLG_POSTENCODE,   wxEVT_COMMAND_COMBOBOX_SELECTED, (wxObjectEventFunction)&VideoStreamConfigDlg::OnPostEncodeAction);
-	Connect(ID_VIDEOSTREAMDLG_POSTMOVEPATH, wxEVT_BUTTON,										 (wxObjectEventFunction)&VideoStreamConfigDlg::OnMovePathButton);
-
 	Connect(ID_VIDEOSTREAMDLG_ENCODEFPS, wxEVT_COMMAND_TEXT_UPDATED,(wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeFPS);
 
 	Connect(ID_VIDEOSTREAMDLG_ENCODETYPE, wxEVT_COMMAND_COMBOBOX_SELECTED, (wxObjectEventFunction)&VideoStreamConfigDlg::OnEncodeType);
@@ -484,6 +461,9 @@ void VideoStreamConfigDlg::OnNameEdit(wxCommandEvent& event)
 
 					mp_exportQualityCtrl->SetValue(  wxString::Format("%d", ssc.m_export_quality) );
 
+					mp_exportFormatCtrl->SetSelection( ssc.m_export_format );
+					mp_exportArchiveCtrl->SetValue( ssc.m_export_archive );
+
 					mp_encodeIntervalCtrl->SetValue(  wxString::Format("%d", ssc.m_encode_interval.load(std::memory_order::memory_order_relaxed)) );
 
 					mp_encodeFPSCtrl->SetValue( wxString::Format("%1.4f", ssc.m_encode_fps) );
@@ -499,8 +479,6 @@ void VideoStreamConfigDlg::OnNameEdit(wxCommandEvent& event)
 					UpdateVideoType();
 					UpdateExampleFrameExportPath();
 					UpdateExampleFrameEncodePath();
-					UpdateFFmpegPath();
-					UpdatePostEncodeMovePath();
 
 					wxString bsjnk = wxString::Format( "Win%d hosting: \"%s\", View/Edit Video Stream Configuration Dialog", 
 																						 m_vsc.m_id, m_vsc.m_name.c_str() );
@@ -844,7 +822,20 @@ void VideoStreamConfigDlg::UpdateExampleFrameExportPath( void )
 {
 	if (mp_exampleFrameExportPath)
 	{
-		mp_exampleFrameExportPath->SetLabelText(	wxString::Format( "%s\\%s_[timecode].jpg", m_vsc.m_export_dir.c_str(), m_vsc.m_export_base.c_str() ) );
+		if (m_vsc.m_export_archive)
+		{
+			mp_exampleFrameExportPath->SetLabelText(	wxString::Format( "%s\\%s_[timecode]_NNNN.ffva, indexed by %s_[timecode].ffvi", 
+																													m_vsc.m_export_dir.c_str(), m_vsc.m_export_base.c_str(), m_vsc.m_export_base.c_str() ) );
+			return;
+		}
+
+		FFVIDEO_Export_Format format;
+		m_vsc.ExportFormat( format );
+		//
+		const char* dims = (format.m_format == 1) ? "_[width]x[height]" : "";
+		mp_exampleFrameExportPath->SetLabelText(	wxString::Format( "%s\\%s_s%03d_r[run]_NNNNNN\\%s_s%03d_r[run]_e[export]_f[frame]_p[pts]%s%s", 
+																												m_vsc.m_export_dir.c_str(), m_vsc.m_export_base.c_str(), m_vsc.m_id, 
+																												m_vsc.m_export_base.c_str(), m_vsc.m_id, dims, FFVideo_Image::SaveExtension(format) ) );
 	}
 }
 
@@ -928,6 +919,32 @@ void VideoStreamConfigDlg::OnExportQuality(wxCommandEvent& event)
 	m_vsc.m_export_quality = c->GetValue();
 }
 
+///////////////////////////////////////////////////////////////////
+void VideoStreamConfigDlg::OnExportFormat(wxCommandEvent& event)
+{
+	wxComboBox* cbox = (wxComboBox*)this->FindWindow(ID_VIDEOSTREAMDLG_EXPORTFORMAT);
+	if (cbox)
+	{
+		int32_t sel = cbox->GetSelection();
+		if (sel != wxNOT_FOUND)
+		{
+			m_vsc.m_export_format = sel;
+			UpdateExampleFrameExportPath();
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////
+void VideoStreamConfigDlg::OnExportArchive(wxCommandEvent& event)
+{
+	wxCheckBox* c = (wxCheckBox*)this->FindWindow(ID_VIDEOSTREAMDLG_EXPORTARCHIVE);
+	if (!c)
+		return;
+	
+	m_vsc.m_export_archive = c->GetValue();
+	UpdateExampleFrameExportPath();
+}
+
 ///////////////////////////////////////////////////////////////////
 void VideoStreamConfigDlg::OnEncodeInterval(wxCommandEvent& event)
 {
@@ -946,24 +963,6 @@ void VideoStreamConfigDlg::UpdateExampleFrameEncodePath( void )
 	}
 }
 
-////////////////////////////////////////////////////////////////////////////////
-void VideoStreamConfigDlg::UpdateFFmpegPath( void )
-{
-	if (mp_ffmpegPath)
-	{
-		mp_ffmpegPath->SetLabelText( wxString::Format( "%s", m_vsc.m_ffmpeg_path.c_str() ) );
-	}
-}
-
-////////////////////////////////////////////////////////////////////////////////
-void VideoStreamConfigDlg::UpdatePostEncodeMovePath( void )
-{
-	if (mp_postEncodeMovePath)
-	{
-		mp_postEncodeMovePath->SetLabelText( wxString::Format( "%s", m_vsc.m_post_move_path.c_str() ) );
-	}
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 void VideoStreamConfigDlg::OnEncodeDirButton(wxCommandEvent& event)
 {
@@ -1004,67 +1003,6 @@ void VideoStreamConfigDlg::OnEncodeBasenameButton(wxCommandEvent& event)
 	}
 }
 
-////////////////////////////////////////////////////////////////////////////////
-void VideoStreamConfigDlg::OnFFmpegPathButton(wxCommandEvent& event)
-{
-	wxString defaultDir  = wxEmptyString;
-	wxString defaultFile = wxEmptyString;
-	if (m_vsc.m_ffmpeg_path.compare("unknown")!=0)
-	{
-		std::string pathOnly = mp_app->GetPath( m_vsc.m_ffmpeg_path );
-		std::string filename = mp_app->GetFilename( m_vsc.m_ffmpeg_path );
-		std::string ext      = mp_app->GetExtension( m_vsc.m_ffmpeg_path );
-
-		if (pathOnly.size() > 0)
-			 defaultDir = wxString( pathOnly.c_str() );
-
-		if (filename.size() > 0 && ext.compare("exe")==0)
-		   defaultFile = wxString( filename.c_str() );
-	}
-	wxFileDialog openFileDialog(this,
-															 _("Select the FFmpeg.exe for encoding"),
-															 defaultDir,
-															 defaultFile,
-															 "EXE files (*.exe)|*.exe",
-															 wxFD_OPEN | wxFD_FILE_MUST_EXIST);
-
-	if (openFileDialog.ShowModal() == wxID_CANCEL)
-		return;
-
-
-	m_vsc.m_ffmpeg_path = openFileDialog.GetPath().c_str();
-	UpdateFFmpegPath();
-}
-
-///////////////////////////////////////////////////////////////////
-void VideoStreamConfigDlg::OnPostEncodeAction(wxCommandEvent& event)
-{
-	wxComboBox* cbox = (wxComboBox*)this->FindWindow(ID_VIDEOSTREAMDLG_POSTENCODE);
-	if (cbox)
-	{
-		int32_t sel = cbox->GetSelection();
-		if (sel != wxNOT_FOUND)
-		{
-			m_vsc.m_post_encode = sel;
-		}
-	}
-}
-
-////////////////////////////////////////////////////////////////////////////////
-void VideoStreamConfigDlg::OnMovePathButton(wxCommandEvent& event)
-{
-	wxDirDialog dlg( this, "Select the directory encoded frames are moved after movie encoding", wxString(m_vsc.m_post_move_path.c_str()) ); 
-
-	if (dlg.ShowModal() == wxID_OK)
-	{
-		std::string new_move_dir = dlg.GetPath().c_str();
-
-		m_vsc.m_post_move_path = new_move_dir;
-	  mp_movePath_button->SetLabelText("Post encode move path");
-		UpdatePostEncodeMovePath();
-	}
-}
-
 ///////////////////////////////////////////////////////////////////
 void VideoStreamConfigDlg::OnEncodeFPS(wxCommandEvent& event)
 {
@@ -1181,31 +1119,10 @@ void VideoStreamConfigDlg::OnOkayButton(wxCommandEvent& event)
 			if (m_vsc.m_encode_height < 0)
 				m_vsc.m_encode_height = -1;	// just in case
 
-			wxString msg = wxString::Format("Video Stream '%s' is configured for frame exporting and encoding:\n", m_vsc.m_name.c_str() );
+			wxString msg = wxString::Format("Video Stream '%s' is configured for frame encoding:\n", m_vsc.m_name.c_str() );
 
 			std::string missing;
 			bool any_missing(false);
-			if (!mp_app->IsDirectory(m_vsc.m_export_dir.c_str()))
-			{
-				if (any_missing)
-					missing += std::string(", ");
-				missing += "image export directory";
-				any_missing = true;
-			}
-			if (m_vsc.m_export_base.size() < 1)
-			{
-				if (any_missing)
-					missing += std::string(", ");
-				missing += "export basename";
-				any_missing = true;
-			}
-			if (!mp_app->IsFile( m_vsc.m_ffmpeg_path.c_str() ))
-			{
-				if (any_missing)
-					missing += std::string(", ");
-				missing += std::string("ffmpeg path");
-				any_missing = true;
-			}
 			if (!mp_app->IsDirectory(m_vsc.m_encode_dir.c_str()))
 			{
 				if (any_missing)
@@ -1248,62 +1165,17 @@ void VideoStreamConfigDlg::OnOkayButton(wxCommandEvent& event)
 				missing += "encode height cannot be an odd number";
 				any_missing = true;
 			}
-			if (m_vsc.m_post_encode == 1 && !mp_app->IsDirectory( m_vsc.m_post_move_path.c_str() ))
-			{
-				if (any_missing)
-					missing += std::string(", ");
-				missing += "post encode directory";
-				any_missing = true;
-			}
 			if (any_missing)
 			{
 				msg += "however, these fields are missing data:\n" + missing +
 							 "\nPlease fix these before continuing.";
-				wxMessageBox(msg, "Video Frame Exporting and Encoding Parameter Error:", wxICON_ERROR, this);
+				wxMessageBox(msg, "Video Frame Encoding Parameter Error:", wxICON_ERROR, this);
 				return;
 			}
 
-			// temp:
-			if (m_vsc.m_encode_fps < 0.01f)
-				 m_vsc.m_encode_fps = 25.0f;
-
-			std::string bad_data;
-			bool any_bad_data(false);
-			if (m_vsc.m_export_scale < 0.01f)
-			{
-				if (any_bad_data)
-					bad_data += std::string(", ");
-				bad_data += "image scale questionably small";
-				any_bad_data = true;
-			}
-			if (m_vsc.m_export_quality < 30)
-			{
-				if (any_bad_data)
-					bad_data += std::string(", ");
-				bad_data += "image quality very low";
-				any_bad_data = true;
-			}
-			if (any_bad_data)
-			{
-				msg += "but, these fields might have incorrect values:\n" + bad_data +
-					"\nAre you sure you want these settings?";
-
-				int32_t answer = wxMessageBox(msg, // "Are you sure you want to export video frames?", 
-																			 "Confirm Unusual Parameters for Video Frame Exporting :", wxYES_NO | wxCANCEL, this);
-				if (answer != wxYES)
-					return;
-
-				msg = wxString::Format("Video Stream '%s' is configured for frame exporting:\n", m_vsc.m_name.c_str() );
-			}
-
-
-
-			msg += wxString::Format("Exporting every %d frames, each frame scaled by %1.3f, at a quality of %d,\n", 
-															 m_vsc.m_export_interval, m_vsc.m_export_scale, m_vsc.m_export_quality );
-			msg +=  wxString::Format("writing frames to directory:\n\n    %s\n\n", m_vsc.m_export_dir.c_str() );
-			msg +=  wxString::Format("as JPEGs with basename:\n\n    %s\n\n", m_vsc.m_export_base.c_str() );
-			msg +=  wxString::Format("...and when %d frames have exported they are encoded, writing\n", 
-															 m_vsc.m_encode_interval.load(std::memory_order::memory_order_relaxed) );
+			// note: frames are encoded in-process, straight from the player; no frames are exported as JPEGs when encoding.
+			msg += wxString::Format("Encoding every %d frames, rotating to a new file every %d encoded frames, writing\n", 
+															 m_vsc.m_export_interval, m_vsc.m_encode_interval.load(std::memory_order::memory_order_relaxed) );
 			if (m_vsc.m_encode_type == 0)
 			{
 				msg +=  wxString::Format(".MP4s files to directory:\n\n    %s\n\n", m_vsc.m_encode_dir.c_str() );
@@ -1314,22 +1186,20 @@ void VideoStreamConfigDlg::OnOkayButton(wxCommandEvent& event)
 			}
 			msg +=  wxString::Format("writing these with basename:\n\n    %s\n\n", m_vsc.m_encode_base.c_str() );
 
-			msg += wxString::Format("with an encoding fps of %1.2f, and encoding resolution of %d, %d\n",
-															 m_vsc.m_encode_fps, m_vsc.m_encode_width, m_vsc.m_encode_height );
-
-			if (m_vsc.m_post_encode == 0)
+			if (m_vsc.m_encode_fps < 0.01f)
 			{
-				msg += wxString("and the original exported frames deleted after encoding.\n");
+				msg += wxString::Format("with an encoding fps from the stream, and encoding resolution of %d, %d\n",
+																 m_vsc.m_encode_width, m_vsc.m_encode_height );
 			}
 			else
 			{
-				msg += wxString::Format("and the exported frames moved after encoding to directory:\n\n    %s\n\n",
-																 m_vsc.m_post_move_path.c_str() );
+				msg += wxString::Format("with an encoding fps of %1.2f, and encoding resolution of %d, %d\n",
+																 m_vsc.m_encode_fps, m_vsc.m_encode_width, m_vsc.m_encode_height );
 			}
 
 			msg += "\nAre you sure you want all these settings?";
 
-			int32_t answer = wxMessageBox(msg, "Confirm Video Frame Exporting and Encoding:", wxYES_NO | wxCANCEL, this);
+			int32_t answer = wxMessageBox(msg, "Confirm Video Frame Encoding:", wxYES_NO | wxCANCEL, this);
 			if (answer != wxYES)
 				return;
 		}
@@ -1370,7 +1240,7 @@ void VideoStreamConfigDlg::OnOkayButton(wxCommandEvent& event)
 				bad_data += "image scale questionably small";
 				any_bad_data = true;
 			}
-			if (m_vsc.m_export_quality < 30)
+			if (m_vsc.m_export_quality < 30 && (m_vsc.m_export_format == 0 || m_vsc.m_export_format == 5))
 			{
 				if (any_bad_data)
 					bad_data += std::string(", ");
@@ -1393,7 +1263,11 @@ void VideoStreamConfigDlg::OnOkayButton(wxCommandEvent& event)
 			msg += wxString::Format("Exporting every %d frames, each frame scaled by %1.3f, at a quality of %d,\n", 
 															m_vsc.m_export_interval, m_vsc.m_export_scale, m_vsc.m_export_quality );
 			msg +=  wxString::Format("writing frames to directory:\n\n    %s\n\n", m_vsc.m_export_dir.c_str() );
-			msg +=  wxString::Format("as JPEGs with basename:\n\n    %s\n\n", m_vsc.m_export_base.c_str() );
+			FFVIDEO_Export_Format format;
+			m_vsc.ExportFormat( format );
+			if (m_vsc.m_export_archive)
+				 msg +=  wxString::Format("as %s frames appended into archive shards with basename:\n\n    %s\n\n", FFVideo_Image::SaveExtension(format), m_vsc.m_export_base.c_str() );
+			else msg +=  wxString::Format("as %s files with basename:\n\n    %s\n\n", FFVideo_Image::SaveExtension(format), m_vsc.m_export_base.c_str() );
 			msg += "Exported frames will NOT be encoded.\n";
 			msg += "\nAre you sure you want all these settings?";
 
@@ -60,6 +60,10 @@ const long ID_SET_FACE_DETECTION_PRECISION = wxNewId();
 const long ID_ENABLE_FACE_FEATURE_DISPLAY_MENU = wxNewId();
 const long ID_ENABLE_FACE_IMAGES_DISPLAY_MENU = wxNewId();
 const long ID_ENABLE_FACE_IMAGE_STANDARDIZATION_MENU = wxNewId();
+const long ID_FACE_PRE_INDEX_MENU = wxNewId();
+const long ID_FACE_CHIP_EXPORT_MENU = wxNewId();
+const long ID_FACE_AUTOTUNE_MENU = wxNewId();
+const long ID_TRACE_MENU = wxNewId();
 
 const long ID_TOGGLE_THEME_MENU = wxNewId();
 const long ID_TILE_WINDOWS_MENU = wxNewId();
@@ -146,12 +150,22 @@ VideoWindow::VideoWindow(TheApp* app, int32_t id)
 	//
 	mp_optionsMenu->Append(ID_SET_FACE_DETECTION_PRECISION, "Set face detection precision...");
 	//
+	mp_faceAutoTuneItem = mp_optionsMenu->Append(ID_FACE_AUTOTUNE_MENU, "Auto-tune face detection (33 ms)");
+	//
 	mp_faceFeaturesItem = mp_optionsMenu->Append(ID_ENABLE_FACE_FEATURE_DISPLAY_MENU, "Enable face feature display");
 	//
 	mp_faceImagesItem = mp_optionsMenu->Append(ID_ENABLE_FACE_IMAGES_DISPLAY_MENU, "Enable face images display");
 	//
 	mp_faceImagesStandarizedItem = mp_optionsMenu->Append(ID_ENABLE_FACE_IMAGE_STANDARDIZATION_MENU, "Enable face image standardization");
 	//
+	mp_faceIndexItem = mp_optionsMenu->Append(ID_FACE_PRE_INDEX_MENU, "Pre-index faces in this file");
+	//
+	mp_faceChipExportItem = mp_optionsMenu->Append(ID_FACE_CHIP_EXPORT_MENU, "Export face images");
+	//
+	mp_optionsMenu->AppendSeparator();
+	//
+	mp_traceItem = mp_optionsMenu->Append(ID_TRACE_MENU, "Record pipeline trace");
+	//
 	mp_optionsMenu->AppendSeparator();
 	//
 	mp_themeItem = mp_optionsMenu->Append(ID_TOGGLE_THEME_MENU, "Switch to \"Light Theme\"");
@@ -193,6 +207,11 @@ VideoWindow::VideoWindow(TheApp* app, int32_t id)
 	Connect(ID_ENABLE_FACE_FEATURE_DISPLAY_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFaceFeatures);
 	Connect(ID_ENABLE_FACE_IMAGES_DISPLAY_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFaceImages);
 	Connect(ID_ENABLE_FACE_IMAGE_STANDARDIZATION_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFaceImageStandarization);
+	Connect(ID_FACE_PRE_INDEX_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFacePreIndex);
+	Connect(ID_FACE_CHIP_EXPORT_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFaceChipExport);
+	Connect(ID_FACE_AUTOTUNE_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleFaceAutoTune);
+
+	Connect(ID_TRACE_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleTrace);
 	
 
 	Connect(ID_TOGGLE_THEME_MENU, wxEVT_COMMAND_MENU_SELECTED, (wxObjectEventFunction)&VideoWindow::OnToggleTheme);
@@ -1155,6 +1174,87 @@ void VideoWindow::OnSetFaceDetectionPrecision(wxCommandEvent& WXUNUSED(event))
 	float new_detection_scale = (float)ret / 100.0f;
 
 	mp_renderCanvas->m_faceDetectMgr.SetFaceDetectionScale(new_detection_scale);
+	mp_renderCanvas->UpdateLumaOutput();
+}
+
+////////////////////////////////////////////////////////////////////////
+// lowers the detection precision, then detects fewer frames, to keep detection within 33 ms of each frame;
+// the precision set above is the most it uses. Turning it off reports where it ended & why:
+void VideoWindow::OnToggleFaceAutoTune(wxCommandEvent& WXUNUSED(event))
+{
+	if (m_terminating)
+		return;
+
+	FaceDetectionThreadMgr& mgr = mp_renderCanvas->m_faceDetectMgr;
+
+	FACE_AUTOTUNE_STATS stats;
+	mgr.GetAutoTuneStats( stats );
+
+	FACE_AUTOTUNE_PARAMS params;
+	params.m_enabled = !stats.m_enabled;
+	mgr.SetAutoTune( params );
+
+	if (stats.m_enabled)
+	{
+		mp_renderCanvas->WindowStatus( wxString::Format("Face detection auto-tune stopped at precision %d, 1 in %d frames detected, %llu changes; last window %.1f ms: %s.",
+																			(int)(stats.m_scale * 100.0f + 0.5f), stats.m_stride, (unsigned long long)stats.m_changes,
+																			stats.m_last_window.m_latency_ms, stats.m_last_window.m_reason) );
+	}
+
+	if (mp_faceAutoTuneItem)
+	{
+		wxString msg;
+		if (params.m_enabled)
+		{
+			msg = "Stop auto-tuning face detection";
+		}
+		else
+		{
+			msg = "Auto-tune face detection (33 ms)";
+		}
+		mp_faceAutoTuneItem->SetItemLabel(msg);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// records the latest events of every playback stage, seek, filter rebuild, export & face detection; stopping
+// writes them as a Chrome trace into the export directory, else the data directory, for ui.perfetto.dev:
+void VideoWindow::OnToggleTrace(wxCommandEvent& WXUNUSED(event))
+{
+	if (m_terminating)
+		return;
+
+	FFVideo* p_ffvideo = mp_renderCanvas->mp_ffvideo;
+
+	if (p_ffvideo->IsTracing())
+	{
+		p_ffvideo->EnableTracing(false);
+
+		std::string dir = (mp_streamConfig->m_export_dir.length() > 0) ? mp_streamConfig->m_export_dir : mp_app->m_data_dir;
+		std::string path = dir + mp_app->FormatStr("\\ffvideo_trace_win%d.json", m_id);
+		if (p_ffvideo->WriteTrace(path))
+			mp_renderCanvas->WindowStatus( wxString::Format("Pipeline trace written to '%s'.", path.c_str()) );
+		else wxMessageBox( wxString::Format("Unable to write the pipeline trace to '%s'.", path.c_str()) );
+	}
+	else
+	{
+		p_ffvideo->EnableTracing(true, m_id);
+		mp_renderCanvas->WindowStatus( "Recording pipeline trace." );
+	}
+
+	if (mp_traceItem)
+	{
+		wxString msg;
+		if (p_ffvideo->IsTracing())
+		{
+			msg = "Stop pipeline trace and save";
+		}
+		else
+		{
+			msg = "Record pipeline trace";
+		}
+		mp_traceItem->SetItemLabel(msg);
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////
@@ -1233,6 +1333,128 @@ void VideoWindow::OnToggleFaceImageStandarization(wxCommandEvent& WXUNUSED(event
 	}
 }
 
+////////////////////////////////////////////////////////////////////////
+// detects the faces of this window's media file in the background, as fast as it decodes, with the current
+// model & detection precision, so playing it later with face detection serves faces from its index:
+void VideoWindow::OnToggleFacePreIndex(wxCommandEvent& WXUNUSED(event))
+{
+	if (m_terminating)
+		return;
+
+	FaceIndexer& indexer = mp_renderCanvas->m_faceIndexer;
+
+	if (indexer.IsRunning())
+	{
+		FACE_INDEXER_PROGRESS progress;
+		indexer.GetProgress( progress );
+		indexer.Stop();
+
+		mp_renderCanvas->WindowStatus( wxString::Format("Face pre-indexing stopped: %llu frames detected, %llu already indexed.",
+																			(unsigned long long)progress.m_detected, (unsigned long long)progress.m_skipped) );
+	}
+	else if (mp_streamConfig->m_type != STREAM_TYPE::FILE || mp_streamConfig->m_info.length() == 0)
+	{
+		wxMessageBox( "Only media files can be pre-indexed." );
+	}
+	else
+	{
+		FaceDetectionThreadMgr& mgr = mp_renderCanvas->m_faceDetectMgr;
+
+		if (!indexer.Start( mp_streamConfig->m_info, mgr.m_face_model, mgr.GetFaceDetectionScale(), true ))
+		{
+			FACE_INDEXER_PROGRESS progress;
+			indexer.GetProgress( progress );
+			wxMessageBox( wxString::Format("Unable to pre-index faces: %s", progress.m_err.c_str()) );
+			return;
+		}
+		mp_renderCanvas->WindowStatus( wxString::Format("Pre-indexing faces in '%s'.", mp_streamConfig->m_info.c_str()) );
+	}
+
+	if (mp_faceIndexItem)
+	{
+		wxString msg;
+		if (indexer.IsRunning())
+		{
+			msg = "Stop pre-indexing faces";
+		}
+		else
+		{
+			msg = "Pre-index faces in this file";
+		}
+		mp_faceIndexItem->SetItemLabel(msg);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////
+// writes the standardized face images to the stream's export directory, in its export format & archive setting,
+// one file or archive record per distinct face image, with a manifest of where each face was:
+void VideoWindow::OnToggleFaceChipExport(wxCommandEvent& WXUNUSED(event))
+{
+	if (m_terminating)
+		return;
+
+	FaceChipExporter& exporter = mp_renderCanvas->m_chipExporter;
+
+	if (exporter.IsRunning())
+	{
+		exporter.Stop();
+
+		FACE_CHIP_EXPORT_STATS stats;
+		exporter.GetStats( stats );
+		mp_renderCanvas->WindowStatus( wxString::Format("Face image export stopped: %llu written, %llu duplicates, %llu dropped.",
+																			(unsigned long long)stats.m_written, (unsigned long long)stats.m_duplicates, 
+																			(unsigned long long)stats.m_dropped) );
+	}
+	else if (mp_streamConfig->m_export_dir.length() == 0)
+	{
+		wxMessageBox( "Set this stream's frame export directory first, face images are written there." );
+	}
+	else
+	{
+		// the images exported are the ones displayed, so they are turned on:
+		wxCommandEvent dummy;
+		if (!mp_renderCanvas->IsFaceDetectionEnabled())
+			OnToggleFaceDetection( dummy );
+		// face images are only made for frames with landmarks:
+		if (!mp_renderCanvas->IsFaceLandmarksEnabled())
+			OnToggleFaceFeatures( dummy );
+		if (!mp_renderCanvas->IsFaceImagesEnabled())
+			OnToggleFaceImages( dummy );
+		if (!mp_renderCanvas->IsFaceImagesStandardized())
+			OnToggleFaceImageStandarization( dummy );
+
+		FACE_CHIP_EXPORT_PARAMS params;
+		params.m_dir = mp_streamConfig->m_export_dir;
+		params.m_base = mp_streamConfig->m_export_base + "_faces";
+		mp_streamConfig->ExportFormat( params.m_format );
+		params.m_quality = mp_streamConfig->m_export_quality;
+		params.m_archive = mp_streamConfig->m_export_archive;
+		if (mp_streamConfig->m_type == STREAM_TYPE::FILE)
+			params.m_frame_rate = mp_renderCanvas->mp_ffvideo->GetExpectedFrameRate();
+
+		if (!exporter.Start( params ))
+		{
+			wxMessageBox( wxString::Format("Unable to export face images to '%s'.", params.m_dir.c_str()) );
+			return;
+		}
+		mp_renderCanvas->WindowStatus( wxString::Format("Exporting face images, see '%s'.", exporter.GetManifestPath().c_str()) );
+	}
+
+	if (mp_faceChipExportItem)
+	{
+		wxString msg;
+		if (exporter.IsRunning())
+		{
+			msg = "Stop exporting face images";
+		}
+		else
+		{
+			msg = "Export face images";
+		}
+		mp_faceChipExportItem->SetItemLabel(msg);
+	}
+}
+
 ////////////////////////////////////////////////////////////////////////
 void VideoWindow::OnToggleTheme(wxCommandEvent& WXUNUSED(event))
 {
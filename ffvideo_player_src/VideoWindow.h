@@ -16,6 +16,8 @@
 
 // an experiment:
 #include "FaceDetect.h"
+#include "FaceIndex.h"
+#include "FaceChipExport.h"
 
 
 
@@ -66,6 +68,10 @@ public:
 	wxMenuItem*					mp_faceFeaturesItem;
 	wxMenuItem*					mp_faceImagesItem;
 	wxMenuItem*					mp_faceImagesStandarizedItem;
+	wxMenuItem*					mp_faceIndexItem;
+	wxMenuItem*					mp_faceChipExportItem;
+	wxMenuItem*					mp_faceAutoTuneItem;
+	wxMenuItem*					mp_traceItem;
 
 	wxMenuItem*					mp_themeItem;
 	wxMenuItem*					mp_tileWindowsItem;
@@ -127,6 +133,11 @@ public:
 	void OnToggleFaceFeatures(wxCommandEvent& event);
 	void OnToggleFaceImages(wxCommandEvent& event);
 	void OnToggleFaceImageStandarization(wxCommandEvent& event);
+	void OnToggleFacePreIndex(wxCommandEvent& event);
+	void OnToggleFaceChipExport(wxCommandEvent& event);
+	void OnToggleFaceAutoTune(wxCommandEvent& event);
+
+	void OnToggleTrace(wxCommandEvent& event);
 
 	void OnToggleTheme(wxCommandEvent& event);
 	void OnTileWindows(wxCommandEvent& event);
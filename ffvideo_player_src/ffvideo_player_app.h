@@ -5,6 +5,9 @@
 #ifndef _WX_FFVIDEO_PLAYER_H_
 #define _WX_FFVIDEO_PLAYER_H_
 
+#ifndef NOMINMAX
+#define NOMINMAX		// std::min & std::max, not the Windows macros
+#endif
 #include "windows.h"
 #include <math.h>
 #include <stdint.h>
@@ -55,9 +58,6 @@ extern "C" {
 // defines a wxFrame that hosts an upper level video player:
 #include "VideoWindow.h"
 
-// defines a frame encoding thread for generating .mp4 and .264 streams:
-#include "FrameEncoder.h"
-
 // defines a wxGLCanvas that hosts lower level video player:
 #include "RenderCanvas.h"
 
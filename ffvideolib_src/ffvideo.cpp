@@ -3,6 +3,7 @@
 /////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdarg.h>
+#include <assert.h>
 
 #include "ffvideo.h"
 
@@ -56,6 +57,9 @@ void FFVideo::Initialize(bool vflip, bool debug )
 	m_width						    = 0;
 	m_height					    = 0;
 	mp_opts						    = NULL;			// key/value dictionary of options we request
+	m_decoder_threads			= 0;				// 0 lets the decoder pick
+	m_unpaced							= false;
+	m_synthetic_reads			= 0;
 	mp_format_context     = NULL;
 	mp_video_stream       = NULL;			// the video stream within mp_format_context->streams[]
 	mp_orig_codec_context = NULL;			// codec context we demux/decompress/de-whatever with
@@ -133,6 +137,9 @@ void FFVideo::KillStream()
 			mp_frameMgr->mp_frame_dest->m_frame_exporter.StopExporter();
 		}
 
+		// likewise the encoder, which still closes its current segment file:
+		mp_frameMgr->mp_frame_dest->m_frame_encoder.StopEncoder();
+
 		delete mp_frameMgr;
 		mp_frameMgr = NULL;
 	}
@@ -150,7 +157,7 @@ void FFVideo::logging_callback(void *ptr, int level, const char *fmt, va_list va
 	replaceAll( std_fmt, std::string("%td"), std::string("%d") );
 
 	// Create the actual message
-#ifdef WIN32
+#ifdef _WIN32
 	vsnprintf_s(message, sizeof(message), _TRUNCATE, std_fmt.c_str(), vargs);
 #else
 	vsnprintf(message, sizeof(message), std_fmt.c_str(), vargs);
@@ -237,6 +244,10 @@ void FFVideo::CloseStream(void)
 		mp_orig_codec_context = NULL;
 	}
 
+	// a recording ends with its stream:
+	m_packet_recorder.Close();
+	m_packet_replay.Close();
+
 	// close the stream:
 	if (mp_format_context)
 	{
@@ -270,8 +281,8 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 
 	if (mp_frameMgr->m_first_frame)
 	{
-		// play media files as fast as possible:
-		if (mp_frameMgr->m_stream_type == 0)
+		// play media files & unpaced synthetic sources as fast as possible:
+		if (mp_frameMgr->m_stream_type == 0 || (mp_frameMgr->m_stream_type == 3 && !m_synthetic.m_paced))
 			wait_milliseconds_for_next_packet = 0;
 
 		// no timeout on first frame because we're buffering
@@ -311,8 +322,35 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 
 	int32_t stream_type = mp_frameMgr->m_stream_type;
 
+	// paced synthetic sources are read on a fixed schedule from their first frame, as a camera delivers them,
+	// so one late read is followed by an early one rather than the rate drifting:
+	if (stream_type == 3 && m_synthetic.m_paced)
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (m_synthetic_reads == 0)
+			m_synthetic_start = now;
+		else if (SyntheticWait100ns() > 0)
+			return;
+		else if (now - SyntheticDue(m_synthetic_reads) > std::chrono::seconds(1))
+		{
+			// over a second behind, as when the client stalled: start the schedule again rather than rush to catch up
+			m_synthetic_start = now - (SyntheticDue(m_synthetic_reads) - m_synthetic_start);
+		}
+		m_synthetic_reads++;
+	}
+
 	// let's read a media stream packet/frame:
-	int stream_status = av_read_frame(mp_format_context, curr_packet);
+	FFVIDEO_STAGE_TIMER(stage_timer, mp_frameMgr->mp_tracer.get());
+	int stream_status;
+	if (stream_type == 4)
+	{
+		// a packet replay waits for its packets as a socket does, interruptible the same way:
+		FFVideo_FrameMgr* p_frameMgr = mp_frameMgr;
+		stream_status = m_packet_replay.Read(curr_packet, [this, p_frameMgr]() { 
+			return m_stop_video_processing_loop || FFVideo_FrameMgr::interrupt_callback(p_frameMgr) != 0; });
+	}
+	else stream_status = av_read_frame(mp_format_context, curr_packet);
+	FFVIDEO_STAGE_LAP(stage_timer, mp_frameMgr->m_pipeline_stats, READ, -1);
 	if (stream_status < 0)
 	{
 		char errbuff[256];
@@ -321,8 +359,8 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 
 		ReportLog("av_read_frame: error %s\n", errbuff);
 
-		if (stream_type == 0) 
-			   mp_frameMgr->m_media_has_ended = true;	// end of media file // 0=Media, 1=USB, 2=IP
+		if (stream_type == 0 || stream_type == 3) 
+			   mp_frameMgr->m_media_has_ended = true;	// end of media file or synthetic source // 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 		else mp_frameMgr->m_stream_has_died = true;	// camera/IP/USB stream has terminated unexpectedly 
 
 		mp_frameMgr->m_drain_mode = true;
@@ -337,6 +375,7 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 			mp_frameMgr->m_media_has_ended = false;
 			mp_frameMgr->m_drain_mode = false;
 			mp_frameMgr->mp_frame_dest->m_frame_export_interval = 0;
+			mp_frameMgr->mp_frame_dest->m_frame_encode_interval = 0;
 
 			terminal_flag = false;
 		}
@@ -344,6 +383,13 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 		return;
 	}
 
+	mp_frameMgr->m_throughput.Count(FFVIDEO_RATE::PACKETS);
+	mp_frameMgr->m_throughput.Count(FFVIDEO_RATE::BYTES, (uint64_t)curr_packet->size);
+
+	// recorded as they arrived, corrupt ones too, so a replay reproduces them:
+	if (m_packet_recorder.IsOpen() && curr_packet->stream_index == mp_video_stream->index)
+		m_packet_recorder.Write(curr_packet);
+
 	// check for corruption errors: 
 	if (!(curr_packet->flags & AV_PKT_FLAG_CORRUPT))
 	{
@@ -369,11 +415,12 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 			{
 				ret = avcodec_send_packet(mp_codec_context, curr_packet);
 			}
+			FFVIDEO_STAGE_LAP(stage_timer, mp_frameMgr->m_pipeline_stats, SEND, -1);
 			if (ret < 0)
 			{
 				if (ret == AVERROR_EOF)
 				{
-					if (stream_type == 0)
+					if (stream_type == 0 || stream_type == 3)	// synthetic sources never loop
 					{
 						if (!m_loop_media_file)
 						{
@@ -407,11 +454,15 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 						return;
 					}
 
+					FFVIDEO_STAGE_RESTART(stage_timer);
 					ret = avcodec_receive_frame(mp_codec_context, decompress_frame);
+					FFVIDEO_STAGE_LAP(stage_timer, mp_frameMgr->m_pipeline_stats, RECEIVE, -1);
 					if (!ret) // returning 0 means success
 					{
+						mp_frameMgr->m_throughput.Count(FFVIDEO_RATE::DECODED);
+
 						int32_t stream_type = mp_frameMgr->m_stream_type;
-						if (stream_type == 0) // media file
+						if (stream_type == 0 || stream_type == 3) // media file or synthetic source, both have steady timestamps
 						{
 							double play_pos = decompress_frame->best_effort_timestamp * m_timebase;
 							mp_frameMgr->m_est_play_pos = play_pos; // store in atomic, is seconds
@@ -433,10 +484,16 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 						//
 						// if the discard flag is set in this frame, we decompress but do not display:
 						if (mp_decompressed_frame[use_this_index]->flags & AV_FRAME_FLAG_DISCARD)
+						{
 							skip_this_frame = true;
+							mp_frameMgr->m_throughput.Drop(FFVIDEO_DROP::DISCARD);
+						}
 						//
+						// a frame is counted as dropped for its first reason only:
 						if (mp_frameMgr->m_seek_skip_count > 0)
 						{
+							if (!skip_this_frame)
+								mp_frameMgr->m_throughput.Drop(FFVIDEO_DROP::SEEK_SKIP);
 							skip_this_frame = true;
 							mp_frameMgr->m_seek_skip_count--;
 						}
@@ -448,7 +505,12 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 								mp_frameMgr->m_post_seek_renders = 3;
 								mp_frameMgr->m_post_seek_render_is_really_a_step = false;
 							}
-							else skip_this_frame = true;
+							else
+							{
+								if (!skip_this_frame)
+									mp_frameMgr->m_throughput.Drop(FFVIDEO_DROP::SEEK_SKIP);
+								skip_this_frame = true;
+							}
 						}
 
 						if (!skip_this_frame)
@@ -480,6 +542,7 @@ void FFVideo::ProcessPacket(uint64_t& wait_milliseconds_for_next_packet, bool& t
 	else if (curr_packet->flags & AV_PKT_FLAG_CORRUPT)
 	{	
 		av_log( mp_codec_context, AV_LOG_INFO, "packer_reader: corrupt frame\n" );
+		mp_frameMgr->m_throughput.Drop(FFVIDEO_DROP::CORRUPT_PACKET);
 	}
 
 	// Free the packet that was allocated by av_read_frame 
@@ -506,6 +569,8 @@ void FFVideo::VideoProcessLoop(void)
 
 	uint32_t last_display_index = 9999;
 
+	FFVideo_Tracer::NameThread("packet reader");
+
 	while (true)
 	{
 		if (m_stop_video_processing_loop)
@@ -540,9 +605,26 @@ void FFVideo::VideoProcessLoop(void)
 				}
 				milliseconds = next_milliseconds; 
 				nanosleep_param = milliseconds * 10; // each ms is 10 nanosleep units
+
+				// paced synthetic sources wake when their next frame is due, if that is sooner:
+				int32_t stream_type = mp_frameMgr->m_stream_type;
+				if (stream_type == 3 && m_synthetic.m_paced)
+				{
+					int64_t due = SyntheticWait100ns();
+					if (due > 0 && (uint64_t)due < nanosleep_param)
+						nanosleep_param = (uint64_t)due;
+				}
+
+				// unpaced media files & synthetic sources only give up the rest of their time slice, unless paused:
+				bool unpaced_type = (stream_type == 0) || (stream_type == 3 && !m_synthetic.m_paced);
+				if (m_unpaced && unpaced_type && next_milliseconds == milliseconds_frame_display)
+				{
+					std::this_thread::yield();
+					continue;
+				}
 			}
 		}
-		nanosleep(nanosleep_param);
+		FFVideo_Sleep100ns(nanosleep_param);
 	}
 	
 	m_video_processing_loop_ended = true;
@@ -596,6 +678,87 @@ bool FFVideo::StartIPorMediaFile(std::string& printf_safe_vid_src)
 	return true;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+// m_vid_src holds the filter graph OpenSyntheticSource() made; the lavfi input device plays it as a 
+// stream of wrapped_avframe packets, which decode like any other video:
+bool FFVideo::StartSynthetic(void)
+{
+	// if not NULL, a previous stream was left open:
+	assert (mp_format_context == NULL); 
+
+	const AVInputFormat* input_format = av_find_input_format("lavfi");
+	if (!input_format)
+	{
+		ReportLog("Could not open a synthetic source, this FFmpeg lacks the lavfi input device.");
+		return false;
+	}
+
+	av_log( mp_codec_context, AV_LOG_INFO, "StartSynthetic: %s\n", m_vid_src.c_str() );
+
+	setup_av_options(); 
+
+	m_synthetic_reads = 0;
+
+	if (avformat_open_input( &mp_format_context, m_vid_src.c_str(), (AVInputFormat*)input_format, &mp_opts ) != 0)
+	{
+		ReportLog("Could not open the synthetic source %s.", m_vid_src.c_str() );
+		return false; 
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// m_vid_src is a packet recording. It needs no demuxer, so the format context is only a holder for the 
+// recorded stream, whose packets ProcessPacket() reads from m_packet_replay rather than av_read_frame():
+bool FFVideo::StartReplay(void)
+{
+	// if not NULL, a previous stream was left open:
+	assert (mp_format_context == NULL); 
+
+	av_log( mp_codec_context, AV_LOG_INFO, "StartReplay: %s\n", m_vid_src.c_str() );
+
+	if (!m_packet_replay.Open(m_vid_src, m_replay_faults))
+	{
+		ReportLog("Could not open the packet recording %s.", m_vid_src.c_str() );
+		return false;
+	}
+
+	// the decoder options, & mp_format_context with its I/O callback:
+	setup_av_options(); 
+
+	AVStream* p_stream = avformat_new_stream(mp_format_context, NULL);
+	if (!p_stream || !m_packet_replay.SetupStream(p_stream))
+	{
+		ReportLog("Could not read the stream of the packet recording %s.", m_vid_src.c_str() );
+		m_packet_replay.Close();
+		return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// when frame 'read' of a paced synthetic source is due, counted from its first frame:
+std::chrono::steady_clock::time_point FFVideo::SyntheticDue(int64_t read)
+{
+	std::chrono::duration<double> offset((double)read / m_synthetic.m_fps);
+	return m_synthetic_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(offset);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int64_t FFVideo::SyntheticWait100ns(void)
+{
+	if (m_synthetic_reads == 0)
+		return 0;
+
+	std::chrono::steady_clock::duration wait = SyntheticDue(m_synthetic_reads) - std::chrono::steady_clock::now();
+	if (wait <= std::chrono::steady_clock::duration::zero())
+		return 0;
+
+	return std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(wait).count();
+}
+
 
 #define CHECK_USER_QUICK_TERMINATE if (!mp_frameMgr || (mp_frameMgr && mp_frameMgr->m_drain_mode) || !mp_format_context) {	m_is_opening = false;	return false; }
 
@@ -616,7 +779,7 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 	mp_frameMgr->PrepareForPlayback();
 
 	// special set up for USB:
-	if (mp_frameMgr->m_stream_type == 1) // 0=Media, 1=USB, 2=IP
+	if (mp_frameMgr->m_stream_type == 1) // 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	{
 		if (!StartUSB( camera ))
 		{
@@ -624,6 +787,24 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 			return false;
 		}
 	}
+	// and for generated streams:
+	else if (mp_frameMgr->m_stream_type == 3)
+	{
+		if (!StartSynthetic())
+		{
+			m_is_opening = false;
+			return false;
+		}
+	}
+	// and for packet replays:
+	else if (mp_frameMgr->m_stream_type == 4)
+	{
+		if (!StartReplay())
+		{
+			m_is_opening = false;
+			return false;
+		}
+	}
 	// otherwise m_vid_src contains either the rtsp/http camera string or a media file name
 	else
 	{
@@ -645,23 +826,27 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 
 	CHECK_USER_QUICK_TERMINATE
 
-	// REMEMBER THIS CALL HAS AN INTERNAL EXIT() SITUATION THAT NEEDS TO BE REMOVED!!
-	AVDictionary** opts = setup_find_stream_info_opts(mp_format_context, NULL);
-	int orig_nb_streams = mp_format_context->nb_streams;
+	// a packet replay's recording already describes its stream, there is nothing to probe:
+	if (mp_frameMgr->m_stream_type != 4)
+	{
+		// REMEMBER THIS CALL HAS AN INTERNAL EXIT() SITUATION THAT NEEDS TO BE REMOVED!!
+		AVDictionary** opts = setup_find_stream_info_opts(mp_format_context, NULL);
+		int orig_nb_streams = mp_format_context->nb_streams;
 
-	CHECK_USER_QUICK_TERMINATE
+		CHECK_USER_QUICK_TERMINATE
 
- 	int32_t err = avformat_find_stream_info(mp_format_context, opts);
+ 		int32_t err = avformat_find_stream_info(mp_format_context, opts);
 
-	for (int32_t i = 0; i < orig_nb_streams; i++)
-		  av_dict_free(&opts[i]);
-	av_freep(&opts);
+		for (int32_t i = 0; i < orig_nb_streams; i++)
+			  av_dict_free(&opts[i]);
+		av_freep(&opts);
 
-	if (err < 0)
-	{
-		av_log(mp_codec_context, AV_LOG_WARNING, "%s: could not find codec parameters\n", printf_safe_vid_src.c_str());
-		m_is_opening = false;
-		return false;
+		if (err < 0)
+		{
+			av_log(mp_codec_context, AV_LOG_WARNING, "%s: could not find codec parameters\n", printf_safe_vid_src.c_str());
+			m_is_opening = false;
+			return false;
+		}
 	}
 	
 
@@ -671,7 +856,7 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 		 mp_format_context->pb->eof_reached = 0; // copied over from ffplay.c
 
 	// copied over from ffplay ffmpeg 4.2.2:
-	if (mp_frameMgr->m_seek_by_bytes < 0)
+	if (mp_frameMgr->m_seek_by_bytes < 0 && mp_format_context->iformat)	// packet replays have no input format
 	{
 		mp_frameMgr->m_seek_by_bytes = !!(mp_format_context->iformat->flags & AVFMT_TS_DISCONT) && strcmp("ogg", mp_format_context->iformat->name);
 	}
@@ -782,7 +967,7 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 	m_expected_frame_rate = 0;
 	switch (mp_frameMgr->m_stream_type)
 	{
-	case 0: // 0=Media, 1=USB, 2=IP
+	case 0: // 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	{
 		// only media files have a duration, so print it here: 
 		int64_t ts;
@@ -817,8 +1002,14 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 		}
 		break;
 
+	case 3:
+		m_expected_frame_rate = m_synthetic.m_fps;
+		process_path = "synthetic source";
+		break;
+
 	default:
 	case 2:
+	case 4:	// a packet replay has the rate of the IP camera it recorded
 		if (mp_video_stream->avg_frame_rate.den != 0)
 			m_expected_frame_rate = av_q2d(mp_video_stream->avg_frame_rate);
 		else
@@ -900,6 +1091,19 @@ bool FFVideo::StartStream( FFVIDEO_USB_Camera_Format* camera, double start_time
 		mp_frameMgr->mp_frame_dest->m_frame_exporter.StartExporter();
 	}
 
+	int32_t encode_interval = mp_frameMgr->mp_frame_dest->m_frame_encode_interval;
+	if (encode_interval > 0)
+	{
+		// unless the client gave an encoding fps, encode at the rate frames arrive at the encoder:
+		float encode_fps = mp_frameMgr->mp_frame_dest->m_encode_params.m_fps;
+		if (encode_fps <= 0.0f)
+		{
+			encode_fps = (m_expected_frame_rate > 0.0) ? (float)(m_expected_frame_rate / encode_interval) : 25.0f;
+		}
+
+		mp_frameMgr->mp_frame_dest->m_frame_encoder.StartEncoder(mp_frameMgr->mp_frame_dest->m_encode_params, encode_fps);
+	}
+
 	// needed on 2nd, 3rd and so on plays as the thread ends when the stream ends
 	if (!IsRunning())
 	{
@@ -926,6 +1130,22 @@ void FFVideo::SetDisplayFrameCallback(DISPLAY_FRAME_CALLBACK_CB p_process_frame,
 	}
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::SetLumaFrameCallback(LUMA_FRAME_CALLBACK_CB p_luma_frame, void* p_object, float scale)
+{
+	if (mp_frameMgr)
+	{
+		if (scale <= 0.0f || scale > 1.0f)
+			scale = 1.0f;
+
+		std::unique_lock<std::shared_mutex> lock(mp_frameMgr->m_cb_lock);
+		mp_frameMgr->mp_frame_dest->mp_luma_frame = p_luma_frame;
+		mp_frameMgr->mp_frame_dest->mp_luma_frame_object = p_object;
+		mp_frameMgr->mp_frame_dest->m_luma_scale = scale;
+		lock.unlock();
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 void FFVideo::SetStreamTerminatedCallBack(TERMINATED_STREAM_CALLBACK_CB p_stream_term, void* p_object)
 {
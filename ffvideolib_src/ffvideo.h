@@ -3,8 +3,6 @@
 #define _FFVIDEO_H_
 
 
-#include <Windows.h>
-
 #include "ffvideo_frameMgr.h"
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -61,6 +59,15 @@ public:
 	//
 	void SetDisplayFrameCallback(DISPLAY_FRAME_CALLBACK_CB p_process_frame, void* p_object);
 
+	// luma frame callback, when set, receives the decoded frame's luma (Y) plane as a gray image (type 2) 
+	// just before each display frame callback, with the same frame number. For YUV sources it is copied, or 
+	// resized to scale of the decoded size, straight from the decoder with no colour conversion; values are 
+	// the decoder's, usually limited range. It is taken before any post process filter is applied. For
+	// consumers only needing gray, such as face detection. Scale may be changed during playback:
+	typedef void(*LUMA_FRAME_CALLBACK_CB)(void* p_object, FFVideo_Image& luma, int32_t frame_num);
+	//
+	void SetLumaFrameCallback(LUMA_FRAME_CALLBACK_CB p_luma_frame, void* p_object, float scale = 1.0f);
+
 	// note: there is also a "frame export callback" setup by SetFrameExportingParams(), below
 
 	// unexpected stream termination callback, for USB and IP cameras if set,
@@ -100,7 +107,7 @@ public:
 	// Default is disabled, this is enabled by setting the export_interval > 0. Disable by setting export_interval < 1.
 	// The export directory must be set, exist, the permission to write into the directory must be present. 
 	// Frames are exported as jpg files using the quality passed as the jpg compression. 
-	// The filename is the export dir + export_base + an ISO 8601 timestamp, with milliseconds. 
+	// The filename is the export dir + a name from the export naming template, see SetFrameExportNaming(). 
 	// Failing to write triggers frame exporting to disable. 
 	bool SetFrameExportingParams(int32_t export_interval, std::string& export_dir, std::string& export_base, 
 															 float scale = 1.0f, int32_t quality = 80, 
@@ -115,6 +122,107 @@ public:
 	// returns number of images waiting to be written to disk:
 	int32_t GetFrameExportingQueueSize(void);
 
+	// frame exports default to jpg; for ML pipelines that do not want lossy frames they may instead be
+	// raw RGB or gray pixel dumps (optionally written through a memory map), NumPy .npy arrays, 
+	// PNG with a selectable zlib level, or lossless/lossy WebP. Set before playback begins. 
+	bool SetFrameExportFormat(FFVIDEO_Export_Format& format);
+
+	void GetFrameExportFormat(FFVIDEO_Export_Format& format);
+
+	// rather than one file per exported frame, which at high frame rates across many streams makes filesystem 
+	// metadata the bottleneck, exported frames may be appended into large "shard" files of shard_mb megabytes,
+	// with an index of frame number, pts, shard, offset, length and CRC per frame. The export callback's filepath 
+	// is then the shard written to. Use FFVideo_FrameArchiveReader for random access to archived frames. 
+	// Set before playback begins. 
+	bool SetFrameExportArchive(bool archive, int32_t shard_mb = 1024);
+
+	void GetFrameExportArchive(bool& archive, int32_t& shard_mb);
+
+	// exported frames are encoded on the export thread and written by a pool of writer threads, so encoding 
+	// and disk writes overlap; see FFVIDEO_Export_Writer_Params. At most max_in_flight encoded frames wait on 
+	// the writers before the export thread waits too. With sync set, written files are flushed to the storage
+	// device every sync_batch files per writer. m_threads = 0 writes on the export thread. The export callback 
+	// is then called from the writer threads. Archives & memory mapped formats are written by the export thread. 
+	// Set before playback begins. 
+	bool SetFrameExportWriters(FFVIDEO_Export_Writer_Params& params);
+
+	void GetFrameExportWriters(FFVIDEO_Export_Writer_Params& params);
+
+	// exported files are named by a template of stream id, run, export count, frame number & pts, so names never 
+	// collide, across reconnects & later sessions to the same directory too. Files are spread across subdirectories
+	// of files_per_dir files, and a manifest listing every file written is kept in the export directory. 
+	// See FFVIDEO_Export_Naming in ffvideo_frameExporter.h. Set before playback begins. 
+	bool SetFrameExportNaming(FFVIDEO_Export_Naming& naming);
+
+	void GetFrameExportNaming(FFVIDEO_Export_Naming& naming);
+
+	// per stage latency histograms & totals of the current or most recent frame exporting:
+	void GetFrameExportWriteStats(FFVIDEO_Export_Write_Stats& stats);
+
+	// per stage latency percentiles & histograms of playback, from reading packets through the client's
+	// frame callback & frame export, since playback began, with the depth of each queue between them. 
+	// See ffvideo_pipelineStats.h; callable from any thread at any time:
+	void GetPipelineStats(FFVIDEO_Pipeline_Stats& stats);
+
+	// also resets the export write stats:
+	void ResetPipelineStats(void);
+
+	// rolling 1, 10 & 60 second rates of packets, bytes, decoded, delivered & exported frames since playback 
+	// began, with a counter of every reason a packet or frame did not reach the client, see ffvideo_throughput.h:
+	void GetThroughputStats(FFVIDEO_Throughput_Stats& stats);
+
+	// clients that drop frames after receiving them, such as a detector falling behind, count them here so they
+	// show with the library's own drops as FFVIDEO_DROP::CLIENT. Callable from the frame callback:
+	void CountClientDrops(uint32_t n);
+
+	// records a timeline of this instance's pipeline stages per frame, seeks, filter graph rebuilds, frame exports 
+	// & whatever clients record through GetTracer(), into per thread rings of the latest events_per_thread events.
+	// Switchable while playing; enabling clears the previous recording. stream_id tells streams apart in a trace:
+	void EnableTracing(bool enable, int32_t stream_id = 0, int32_t events_per_thread = 8192);
+
+	bool IsTracing(void) { return (mp_frameMgr) ? mp_frameMgr->mp_tracer->IsEnabled() : false; }
+
+	// writes what is recorded as Chrome trace JSON, for chrome://tracing or ui.perfetto.dev; tracing may be on or off:
+	bool WriteTrace(const std::string& path);
+
+	// for client threads to record into this instance's trace; kept alive by holders after the FFVideo is deleted:
+	std::shared_ptr<FFVideo_Tracer> GetTracer(void) {
+		if (mp_frameMgr) { return mp_frameMgr->mp_tracer; }
+		return std::shared_ptr<FFVideo_Tracer>();
+	}
+
+	// writes im in every export format "iterations" times into bench_dir, timing each; the written files are
+	// deleted afterwards. Use this to pick the fastest format that fits a storage budget:
+	static bool BenchmarkExportFormats(FFVideo_Image& im, std::string& bench_dir, int32_t iterations, 
+																		 std::vector<FFVIDEO_Export_Benchmark>& results);
+
+	// times the export rescaler at each SIMD level, single & multi-threaded, against stb_image_resize and
+	// swscale, at the export scales of 0.25, 0.5 & 0.75. im must be RGBA or BGRA, see FFVideo_Resizer:
+	static bool BenchmarkResize(FFVideo_Image& im, int32_t iterations, std::vector<FFVIDEO_Resize_Benchmark>& results);
+
+	// also similar to the frame_interval, this enables/disables in-process encoding of the decoded frames,
+	// with libavcodec, into .mp4 and/or H.264 elementary stream files; no intermediate image files are written.
+	// Default is disabled, this is enabled by setting the encode_interval > 0. Disable by setting encode_interval < 1.
+	// The encode directory must be set, exist, the permission to write into the directory must be present. 
+	// Encoded files rotate to a new "segment" file every params.m_segment_frames encoded frames, and the 
+	// optional encode segment callback is called as each segment file is closed. 
+	// The filename is the encode dir + encode_base + segment number + an ISO 8601 timestamp, with microseconds. 
+	// Frames arriving while params.m_max_queued wait on the encoder are dropped, counted as FFVIDEO_DROP::ENCODE_BEHIND.
+	// Failing to encode or write triggers frame encoding to disable. 
+	bool SetFrameEncodingParams(int32_t encode_interval, FFVIDEO_Encode_Params& params,
+															ENCODE_SEGMENT_CALLBACK_CB encode_segment_cb = NULL, void* encode_segment_object = NULL);
+
+	void GetFrameEncodingParams(int32_t& encode_interval, FFVIDEO_Encode_Params& params);
+
+	// returns true if frame encoding was enabled and then failed, disabling frame encoding:
+	bool GetFrameEncodingError(void);
+
+	// returns number of frames waiting to be encoded:
+	int32_t GetFrameEncodingQueueSize(void);
+
+	// returns true while the encoder is still writing, which continues after StopStream() until its queue is empty:
+	bool IsFrameEncodingActive(void);
+
 	// step 2 interfaces to use this library: use these to begin and modify video playback:
 
 	// Before opening any video stream, or while reading from an opened video stream, 
@@ -177,12 +285,38 @@ public:
 
 	void SetPostProcessFilter( std::string& filter );
 
-	// use one of these 3 functions to begin a video stream's playback:
+	// media files play as fast as they decode, but the packet reader still sleeps between frames; unpaced, it only
+	// yields, so files decode & deliver at the full speed of the machine. For benchmarks & batch processing,
+	// may be changed while playing:
+	void SetUnpacedPlayback(bool unpaced) { m_unpaced = unpaced; }
+
+	// the decoder's threads, 0 for its automatic choice; call before opening a stream:
+	void SetDecoderThreads(int32_t threads) { m_decoder_threads = (threads > 0) ? threads : 0; }
+
+	// use one of these 5 functions to begin a video stream's playback:
 	// by setting frame_interval to 0, auto-frame_interval is enabled. This is the auto-selection of a frame interval based upon
 	// frame resolution. See SetAutoFrameIntervalProfile(), above, for details of setting a custom auto-frame_interval profile. 
 	bool OpenUSBCamera(int32_t pin = 0, int32_t frame_interval = 1, FFVIDEO_USB_Camera_Format* camera = NULL);
 	bool OpenIPCamera(const std::string& url, int32_t frame_interval = 1);
 	bool OpenMediaFile(const std::string& fname, int32_t frame_interval = 1, bool loop_flag = false, double start_offset = 0.0);
+	//
+	// a generated stream for load tests, at an exact size, frame rate & pixel format, needing no media files or cameras.
+	// It plays as a live stream, without seeks or pausing, and ends as a media file does if source.m_frames is set:
+	bool OpenSyntheticSource(const FFVIDEO_Synthetic_Source& source, int32_t frame_interval = 1);
+	//
+	// a packet recording, see StartPacketRecording() below, replayed as the IP camera it was recorded from: at its 
+	// recorded pace, through the same decode path, with optional jitter, stalls, dropouts & a disconnect injected.
+	// Stalls block the packet read as a stalled socket does, so SetReadTimeout() & the terminated callback behave as live:
+	bool OpenPacketReplay(const std::string& fname, int32_t frame_interval = 1, const FFVIDEO_Replay_Faults* faults = NULL);
+	//
+	// records the playing stream's video packets, with the time each arrived, into fname. Recording ends with 
+	// StopPacketRecording() or when the stream closes:
+	bool StartPacketRecording(const std::string& fname);
+	void StopPacketRecording(void) { m_packet_recorder.Close(); }
+	bool IsPacketRecording(void) { return m_packet_recorder.IsOpen(); }
+	//
+	// what a packet replay has delivered, dropped & stalled so far:
+	void GetReplayStats(FFVIDEO_Replay_Stats& stats) { m_packet_replay.GetStats(stats); }
 
 	// Use one of these three functions to modify active playback. Note that after StopStream() 
 	// one of the three OpenUSBCamera(), OpenIPCamera(), or OpenMediaFile() must be called to 
@@ -236,11 +370,18 @@ public:
 
 	const char* GetVersion( void ) { return "FFVideo V1.0"; }
 
+	// averaged since playback began or was last unpaused, so it hides stalls & bursts:
 	float GetReceivedFPS(void) {
 		if (mp_frameMgr) { return mp_frameMgr->m_fps; } 
 		return -1.0f;
 	}
 
+	// frames delivered to the display frame callback per second, over the last whole window_secs seconds:
+	float GetDeliveredFPS(int32_t window_secs = 1) {
+		if (mp_frameMgr) { return (float)mp_frameMgr->m_throughput.Rate(FFVIDEO_RATE::DELIVERED, window_secs); }
+		return -1.0f;
+	}
+
 	int32_t  GetStreamType(void) {
 		if (mp_frameMgr) { return mp_frameMgr->m_stream_type; }
 		return -1;
@@ -279,11 +420,23 @@ public:
 	bool StartUSBGuessingCamera( void );
 
 	bool StartIPorMediaFile(std::string& printf_safe_vid_src);
+	bool StartSynthetic( void );
+	bool StartReplay( void );
+
+	// 100ns units until the next frame of a paced synthetic source is due to be read, 0 if it is due now:
+	int64_t SyntheticWait100ns( void );
+	std::chrono::steady_clock::time_point SyntheticDue( int64_t read );
 
 	std::string                 m_vid_src;					// used by all, but contents & format of contents changes per stream type
 	std::string                 m_media_fname;			// only used by media files
 	uint32_t                    m_usb_pin;					// only used by USB cams
 	std::string                 m_ip_url;						// only used by IP cameras
+	FFVIDEO_Synthetic_Source		m_synthetic;				// only used by synthetic sources
+	std::chrono::steady_clock::time_point m_synthetic_start;	// when a paced synthetic source read its first frame
+	int64_t											m_synthetic_reads;	// frames read from a paced synthetic source
+	FFVIDEO_Replay_Faults				m_replay_faults;		// only used by packet replays
+	FFVideo_PacketReplay				m_packet_replay;
+	FFVideo_PacketRecorder			m_packet_recorder;	// any stream type may be recorded
 
 	int32_t									    m_width, m_height;  // copies of this info, to reduce access to lock protected structs
 
@@ -299,6 +452,8 @@ public:
 
 	std::atomic<bool>						m_loop_media_file;
 	std::atomic<bool>						m_is_opening;
+	std::atomic<bool>						m_unpaced;					// media files play without sleeping between frames
+	int32_t											m_decoder_threads;	// 0 is automatic
 
 	static void replaceAll(std::string& str, const std::string& from, const std::string& to);
 
@@ -3,9 +3,20 @@
 /////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdarg.h>
+#include <assert.h>
 
 #include "ffvideo.h"
 
+// the USB camera backend of each platform: DirectShow names cameras by their description, opened as
+// "video=[name]"; Video4Linux2 names them by their device, such as /dev/video0, opened as is:
+#ifdef _WIN32
+static const char* gUSBInputFormat = "dshow";
+static std::string USBSource(const std::string& name) { return std::string("video=") + name; }
+#else
+static const char* gUSBInputFormat = "video4linux2";
+static std::string USBSource(const std::string& name) { return name; }
+#endif
+
 //////////////////////////////////////////////////////////////////////////////////////
 bool FFVideo::StartUSB(FFVIDEO_USB_Camera_Format* camera)
 {
@@ -14,10 +25,10 @@ bool FFVideo::StartUSB(FFVIDEO_USB_Camera_Format* camera)
 		return StartUSBGuessingCamera();
 	}
 
-	// USB cams need the "direct show" input format:
-	const AVInputFormat* input_format = av_find_input_format("dshow");
+	// USB cams need the platform's capture input format:
+	const AVInputFormat* input_format = av_find_input_format(gUSBInputFormat);
 
-	m_vid_src = std::string("video=") + camera->m_name;
+	m_vid_src = USBSource(camera->m_name);
 	const char* finalSrcStr = m_vid_src.c_str();
 
 	FFVIDEO_USB_Camera_Format* active_usb_format = camera;
@@ -54,13 +65,12 @@ bool FFVideo::StartUSBGuessingCamera(void)
 	// the USB Pin in the index into these USB device names, make sure index is valid:
 	if (usb_names.size() > 0 && m_usb_pin < usb_names.size())
 	{
-		// USB cams need the "direct show" input format:
-		const AVInputFormat* input_format = av_find_input_format("dshow");
+		// USB cams need the platform's capture input format:
+		const AVInputFormat* input_format = av_find_input_format(gUSBInputFormat);
 
-		// the cam is referenced in a string: video=[device name] where the "device name"
-		// came from GetUSB_CameraNames(), and the USB Pin is the index to each:
+		// the cam is referenced by a name from GetUSB_CameraNames(), and the USB Pin is the index to each:
 		std::string cameraStr = usb_names[m_usb_pin];
-		m_vid_src = std::string("video=") + cameraStr;
+		m_vid_src = USBSource(cameraStr);
 		const char* finalSrcStr = m_vid_src.c_str();
 
 		std::vector<FFVIDEO_USB_Camera_Format> usb_formats;
@@ -208,7 +218,7 @@ void FFVideo::query_callback(void* ptr, int level, const char* fmt, va_list varg
 	replaceAll(std_fmt, std::string("%td"), std::string("%d"));
 
 	// Create the actual message
-#ifdef WIN32
+#ifdef _WIN32
 	vsnprintf_s(message, sizeof(message), _TRUNCATE, std_fmt.c_str(), vargs);
 #else
 	vsnprintf(message, sizeof(message), std_fmt.c_str(), vargs);
@@ -219,9 +229,12 @@ void FFVideo::query_callback(void* ptr, int level, const char* fmt, va_list varg
 }
 
 
-#ifdef WIN32
+#ifdef _WIN32
 //////////////////////////////////////////////////////////////////////////////////////
-// need to link to ole32.lib
+// the DirectShow backend, need to link to ole32.lib
+#ifndef NOMINMAX
+#define NOMINMAX		// std::min & std::max, not the Windows macros
+#endif
 #include <dshow.h>
 #pragma comment(lib, "strmiids.lib")
 HRESULT EnumerateDevices(REFGUID category, IEnumMoniker** ppEnum)
@@ -312,9 +325,9 @@ bool FFVideo::GetUSB_CameraNames(std::vector<std::string>& usb_names)
 bool FFVideo::GetCameraPixelFormats(const char* cameraName, std::vector<FFVIDEO_USB_Camera_Format>& usb_formats)
 {
 	// USB cams need the "direct show" input format:
-	const AVInputFormat* input_format = av_find_input_format("dshow");
+	const AVInputFormat* input_format = av_find_input_format(gUSBInputFormat);
 
-	std::string usb_video_src = std::string("video=") + cameraName;
+	std::string usb_video_src = USBSource(cameraName);
 	const char* finalSrcStr = usb_video_src.c_str();
 
 	// this "opens" a video stream, but actually is a signal to the underlying ffmpeg engine
@@ -513,19 +526,162 @@ bool FFVideo::GetCameraPixelFormats(const char* cameraName, std::vector<FFVIDEO_
 	return good;
 }
 
+#elif defined(__linux__)
+//////////////////////////////////////////////////////////////////////////////////////
+// the Video4Linux2 backend, the devices are asked directly rather than parsing FFmpeg's log
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+
+//////////////////////////////////////////////////////////////////////////////////////
+static int V4L2_ioctl(int fd, unsigned long request, void* arg)
+{
+	int ret;
+	do
+	{
+		ret = ioctl(fd, request, arg);
+	} while (ret == -1 && errno == EINTR);
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// FFmpeg's name of a V4L2 pixel format; compressed formats are named by codec, neither for formats
+// FFmpeg's video4linux2 input does not read:
+static void V4L2_FormatNames(uint32_t fourcc, std::string& pixel_format, std::string& vcodec)
+{
+	switch (fourcc)
+	{
+	case V4L2_PIX_FMT_YUYV:		pixel_format = "yuyv422";		break;
+	case V4L2_PIX_FMT_UYVY:		pixel_format = "uyvy422";		break;
+	case V4L2_PIX_FMT_YUV420:	pixel_format = "yuv420p";		break;
+	case V4L2_PIX_FMT_NV12:		pixel_format = "nv12";			break;
+	case V4L2_PIX_FMT_GREY:		pixel_format = "gray";			break;
+	case V4L2_PIX_FMT_RGB24:	pixel_format = "rgb24";			break;
+	case V4L2_PIX_FMT_BGR24:	pixel_format = "bgr24";			break;
+	case V4L2_PIX_FMT_MJPEG:
+	case V4L2_PIX_FMT_JPEG:		vcodec = "mjpeg";						break;
+	case V4L2_PIX_FMT_H264:		vcodec = "h264";						break;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// frame intervals are seconds per frame, so the shortest is the highest frame rate:
+static void V4L2_FrameRates(int fd, uint32_t fourcc, uint32_t width, uint32_t height, float& min_fps, float& max_fps)
+{
+	min_fps = max_fps = 0.0f;
+
+	struct v4l2_frmivalenum ival;
+	memset(&ival, 0, sizeof(ival));
+	ival.pixel_format = fourcc;
+	ival.width = width;
+	ival.height = height;
+	for (ival.index = 0; V4L2_ioctl(fd, VIDIOC_ENUM_FRAMEINTERVALS, &ival) == 0; ival.index++)
+	{
+		bool discrete = (ival.type == V4L2_FRMIVAL_TYPE_DISCRETE);
+		const struct v4l2_fract& fastest = (discrete) ? ival.discrete : ival.stepwise.min;
+		const struct v4l2_fract& slowest = (discrete) ? ival.discrete : ival.stepwise.max;
+
+		if (fastest.numerator > 0)
+			max_fps = std::max(max_fps, (float)fastest.denominator / (float)fastest.numerator);
+		if (slowest.numerator > 0)
+		{
+			float fps = (float)slowest.denominator / (float)slowest.numerator;
+			min_fps = (min_fps > 0.0f) ? std::min(min_fps, fps) : fps;
+		}
+
+		if (!discrete)
+			break;	// one range covers them all
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// the capture devices in device number order, so the USB pin is the index into them as on Windows.
+// UVC cameras also have a metadata device, which cannot capture & is skipped:
+bool FFVideo::GetUSB_CameraNames(std::vector<std::string>& usb_names)
+{
+	usb_names.clear();
+
+	for (int32_t i = 0; i < 64; i++)
+	{
+		std::string device = std::string("/dev/video") + std::to_string(i);
+		int fd = open(device.c_str(), O_RDWR | O_NONBLOCK);
+		if (fd < 0)
+			continue;
+
+		struct v4l2_capability cap;
+		memset(&cap, 0, sizeof(cap));
+		if (V4L2_ioctl(fd, VIDIOC_QUERYCAP, &cap) == 0)
+		{
+			uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+			if (caps & V4L2_CAP_VIDEO_CAPTURE)
+				usb_names.push_back(device);
+		}
+		close(fd);
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// one format per pixel format & frame size, or per pixel format when the device takes a range of sizes:
+bool FFVideo::GetCameraPixelFormats(const char* cameraName, std::vector<FFVIDEO_USB_Camera_Format>& usb_formats)
+{
+	usb_formats.clear();
+
+	int fd = open(cameraName, O_RDWR | O_NONBLOCK);
+	if (fd < 0)
+		return false;
+
+	struct v4l2_fmtdesc fmt;
+	memset(&fmt, 0, sizeof(fmt));
+	fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+	for (fmt.index = 0; V4L2_ioctl(fd, VIDIOC_ENUM_FMT, &fmt) == 0; fmt.index++)
+	{
+		FFVIDEO_USB_Camera_Format format;
+		format.m_name = std::string(cameraName);
+		V4L2_FormatNames(fmt.pixelformat, format.m_pixelFormat, format.m_vcodec);
+		if (format.m_pixelFormat.empty() && format.m_vcodec.empty())
+			continue;
+
+		struct v4l2_frmsizeenum size;
+		memset(&size, 0, sizeof(size));
+		size.pixel_format = fmt.pixelformat;
+		for (size.index = 0; V4L2_ioctl(fd, VIDIOC_ENUM_FRAMESIZES, &size) == 0; size.index++)
+		{
+			bool discrete = (size.type == V4L2_FRMSIZE_TYPE_DISCRETE);
+
+			format.m_min_width  = (discrete) ? size.discrete.width  : size.stepwise.min_width;
+			format.m_min_height = (discrete) ? size.discrete.height : size.stepwise.min_height;
+			format.m_max_width  = (discrete) ? size.discrete.width  : size.stepwise.max_width;
+			format.m_max_height = (discrete) ? size.discrete.height : size.stepwise.max_height;
+			V4L2_FrameRates(fd, fmt.pixelformat, format.m_max_width, format.m_max_height, format.m_min_fps, format.m_max_fps);
+
+			usb_formats.push_back(format);
+
+			if (!discrete)
+				break;
+		}
+	}
+	close(fd);
+
+	return usb_formats.size() > 0;
+}
+
 #else
 //////////////////////////////////////////////////////////////////////////////////////
+// no USB camera backend on this platform:
 bool FFVideo::GetUSB_CameraNames(std::vector<std::string>& usb_names)
 {
-	// no need for this as the linux USB cameras are labelled
-	// /dev/video0  /dev/video1 etc.
+	usb_names.clear();
 	return false;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
 bool FFVideo::GetCameraPixelFormats(const char* cameraName, std::vector<FFVIDEO_USB_Camera_Format>& usb_formats)
 {
+	usb_formats.clear();
 	return false;
 }
 #endif
-
@@ -0,0 +1,300 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+#include "ffvideo.h"
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+static uint64_t ElapsedMicroseconds(std::chrono::steady_clock::time_point start)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_ExportWriter::Start(FFVIDEO_Export_Writer_Params& params, EXPORT_WRITE_CALLBACK_CB write_cb, void* write_object)
+{
+	Stop();
+
+	m_params = params;
+	if (m_params.m_max_in_flight < 1)
+		m_params.m_max_in_flight = 1;
+	if (m_params.m_sync_batch < 1)
+		m_params.m_sync_batch = 1;
+
+	mp_write_cb = write_cb;
+	mp_write_object = write_object;
+
+	m_stop_writing = false;
+	for (int32_t i = 0; i < m_params.m_threads; i++)
+	{
+		m_writers_running++;
+		m_writers.push_back(new std::thread(&FFVideo_ExportWriter::WriteProcessLoop, this));
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_ExportWriter::Stop(void)
+{
+	if (m_writers.size() > 0)
+	{
+		// the writers drain their queue before exiting:
+		m_stop_writing = true;
+		//
+		while (m_writers_running > 0)
+		{
+			using namespace std::chrono_literals;
+			std::this_thread::sleep_for(20ms);
+		}
+		for (size_t i = 0; i < m_writers.size(); i++)
+		{
+			m_writers[i]->join();
+			delete m_writers[i];
+		}
+		m_writers.clear();
+		m_stop_writing = false; // reset for next use
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+		std::queue<FFVideo_ExportWrite> empty;
+		std::swap(m_writeQue, empty);
+		m_free_buffers.clear();
+	lock.unlock();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_ExportWriter::Submit(const std::string& fname, std::vector<uint8_t>& bytes, int32_t frame_num, int32_t export_num, int64_t pts)
+{
+	FFVideo_ExportWrite w;
+	w.m_fname = fname;
+	w.m_frame_num = frame_num;
+	w.m_export_num = export_num;
+	w.m_pts = pts;
+	w.m_bytes.swap(bytes);
+
+	m_in_flight++;
+	int32_t peak = m_in_flight_peak;
+	while (m_in_flight > peak && !m_in_flight_peak.compare_exchange_weak(peak, m_in_flight))
+		;
+
+	if (m_writers.size() == 0)
+	{
+		std::vector<FILE*> unsynced;
+		std::vector<std::string> unsynced_dirs;
+		bool status = Write(w, unsynced, unsynced_dirs);
+		Sync(unsynced, unsynced_dirs);
+		Complete(w, status);
+		bytes.swap(w.m_bytes);
+		return status;
+	}
+
+	// backpressure: the exporter waits rather than queueing encoded frames without limit:
+	if (m_in_flight > m_params.m_max_in_flight)
+	{
+		auto wait_start = std::chrono::steady_clock::now();
+		while (m_in_flight > m_params.m_max_in_flight && m_writers_running > 0)
+			FFVideo_Sleep100ns(10);
+		m_wait_hist.Add(ElapsedMicroseconds(wait_start));
+	}
+
+	std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+		m_writeQue.push(std::move(w));
+		if (m_free_buffers.size() > 0)
+		{
+			bytes.swap(m_free_buffers.back());
+			m_free_buffers.pop_back();
+		}
+	lock.unlock();
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_ExportWriter::Write(FFVideo_ExportWrite& w, std::vector<FILE*>& unsynced, std::vector<std::string>& unsynced_dirs)
+{
+	auto write_start = std::chrono::steady_clock::now();
+
+	FILE* fh = fopen(w.m_fname.c_str(), "wb");
+	if (!fh)
+	{
+		av_log(NULL, AV_LOG_ERROR, "ExportWriter: unable to create '%s'\n", w.m_fname.c_str());
+		m_failures++;
+		return false;
+	}
+
+	size_t written = fwrite(w.m_bytes.data(), 1, w.m_bytes.size(), fh);
+	if (written != w.m_bytes.size())
+	{
+		av_log(NULL, AV_LOG_ERROR, "ExportWriter: short write to '%s'\n", w.m_fname.c_str());
+		fclose(fh);
+		m_failures++;
+		return false;
+	}
+
+	if (m_params.m_sync)
+	{
+		// the write is reported done before its batch reaches the device, so the bytes at least leave
+		// stdio's buffer here, where a failure is still reported for this file:
+		if (fflush(fh) != 0)
+		{
+			av_log(NULL, AV_LOG_ERROR, "ExportWriter: short write to '%s'\n", w.m_fname.c_str());
+			fclose(fh);
+			m_failures++;
+			return false;
+		}
+
+		// kept open until the batch is flushed, that flush closes it:
+		unsynced.push_back(fh);
+
+		size_t slash = w.m_fname.find_last_of("\\/");
+		std::string dir = (slash == std::string::npos) ? std::string(".") : w.m_fname.substr(0, slash + 1);
+		if (std::find(unsynced_dirs.begin(), unsynced_dirs.end(), dir) == unsynced_dirs.end())
+			unsynced_dirs.push_back(dir);
+	}
+	else if (fclose(fh) != 0)
+	{
+		m_failures++;
+		return false;
+	}
+
+	m_write_hist.Add(ElapsedMicroseconds(write_start));
+	if (mp_tracer)
+		mp_tracer->Complete("export", "export write", FFVideo_Tracer::Microseconds(write_start), FFVideo_Tracer::Now(), 
+												w.m_frame_num, "bytes", (int64_t)written);
+	m_files++;
+	m_bytes += written;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// one flush per batch of files; on Windows the directory entries are committed with the files,
+// elsewhere each directory written into is also flushed so the new names survive a power loss:
+void FFVideo_ExportWriter::Sync(std::vector<FILE*>& unsynced, std::vector<std::string>& unsynced_dirs)
+{
+	if (unsynced.size() < 1)
+		return;
+
+	auto sync_start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < unsynced.size(); i++)
+	{
+		bool synced = FFVideo_SyncFile(unsynced[i]);
+		if (fclose(unsynced[i]) != 0 || !synced)
+		{
+			av_log(NULL, AV_LOG_ERROR, "ExportWriter: unable to flush an exported file to the device\n");
+			m_failures++;
+		}
+	}
+	unsynced.clear();
+
+#ifndef _WIN32
+	for (size_t i = 0; i < unsynced_dirs.size(); i++)
+	{
+		int fd = open(unsynced_dirs[i].c_str(), O_RDONLY);
+		if (fd >= 0)
+		{
+			fsync(fd);
+			close(fd);
+		}
+	}
+#endif
+	unsynced_dirs.clear();
+
+	m_sync_hist.Add(ElapsedMicroseconds(sync_start));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_ExportWriter::Complete(FFVideo_ExportWrite& w, bool status)
+{
+	if (mp_write_cb)
+		(mp_write_cb)(mp_write_object, w, status);
+
+	m_in_flight--;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_ExportWriter::WriteProcessLoop(void)
+{
+	uint64_t nanosleep_param = 10; // 1 ms, each ms is 10 nanosleep units
+
+	std::vector<FILE*>				unsynced;				// written files awaiting this thread's next batch flush
+	std::vector<std::string>	unsynced_dirs;
+
+	FFVideo_Tracer::NameThread("export writer");
+
+	while (true)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+		bool work_to_do = !m_writeQue.empty();
+		FFVideo_ExportWrite w;
+		if (work_to_do)
+		{
+			w = std::move(m_writeQue.front());
+			m_writeQue.pop();
+		}
+		lock.unlock();
+
+		if (!work_to_do)
+		{
+			// an idle writer ends its batch early, rather than leave files unflushed:
+			Sync(unsynced, unsynced_dirs);
+
+			if (m_stop_writing)
+				break;
+
+			FFVideo_Sleep100ns(nanosleep_param);
+			continue;
+		}
+
+		bool status = Write(w, unsynced, unsynced_dirs);
+
+		if ((int32_t)unsynced.size() >= m_params.m_sync_batch)
+			Sync(unsynced, unsynced_dirs);
+
+		Complete(w, status);
+
+		std::unique_lock<std::shared_mutex> flock(m_queue_lock);
+			w.m_bytes.clear();
+			m_free_buffers.push_back(std::move(w.m_bytes));
+		flock.unlock();
+	}
+
+	m_writers_running--;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_ExportWriter::GetStats(FFVIDEO_Export_Write_Stats& stats)
+{
+	m_encode_hist.Snapshot(stats.m_encode);
+	m_wait_hist.Snapshot(stats.m_wait);
+	m_write_hist.Snapshot(stats.m_write);
+	m_sync_hist.Snapshot(stats.m_sync);
+	stats.m_files = m_files;
+	stats.m_bytes = m_bytes;
+	stats.m_failures = m_failures;
+	stats.m_in_flight = m_in_flight;
+	stats.m_in_flight_peak = m_in_flight_peak;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_ExportWriter::ResetStats(void)
+{
+	m_encode_hist.Reset();
+	m_wait_hist.Reset();
+	m_write_hist.Reset();
+	m_sync_hist.Reset();
+	m_files = 0;
+	m_bytes = 0;
+	m_failures = 0;
+	m_in_flight_peak = 0;
+}
@@ -0,0 +1,126 @@
+#pragma once
+#ifndef _FFVIDEO_EXPORTWRITER_H_
+#define _FFVIDEO_EXPORTWRITER_H_
+
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+
+#include "ffvideo_histogram.h"
+#include "ffvideo_trace.h"
+
+
+//------------------------------------------------------------------------------
+// how the frame exporter writes encoded frames to disk, see FFVideo::SetFrameExportWriters():
+typedef struct _FFVIDEO_Export_Writer_Params
+{
+	int32_t m_threads = 2;						// writer threads; 0 writes synchronously on the export thread
+	int32_t m_max_in_flight = 16;			// encoded frames queued or being written before the export thread waits
+	bool		m_sync = false;						// if true, written files are flushed to the storage device in batches
+	int32_t m_sync_batch = 32;				// files per writer thread between flushes when m_sync is set
+} FFVIDEO_Export_Writer_Params;
+
+//------------------------------------------------------------------------------
+// returned by FFVideo::GetFrameExportWriteStats(), latencies are in microseconds:
+typedef struct _FFVIDEO_Export_Write_Stats
+{
+	FFVIDEO_Histogram	m_encode;								// export thread: rescale & encode of one frame
+	FFVIDEO_Histogram	m_wait;									// export thread: waiting on the in-flight limit
+	FFVIDEO_Histogram	m_write;								// writer threads: open, write & close of one file
+	FFVIDEO_Histogram	m_sync;									// writer threads: one batch flush to the device
+	uint64_t					m_files = 0;						// files written
+	uint64_t					m_bytes = 0;						// bytes written
+	uint64_t					m_failures = 0;					// writes that failed
+	int32_t						m_in_flight = 0;				// at the time of the call
+	int32_t						m_in_flight_peak = 0;
+} FFVIDEO_Export_Write_Stats;
+
+//------------------------------------------------------------------------------
+// one encoded frame waiting to be written:
+class FFVideo_ExportWrite
+{
+public:
+	FFVideo_ExportWrite() : m_frame_num(0), m_export_num(0), m_pts(0) {};
+
+	std::string						m_fname;
+	std::vector<uint8_t>	m_bytes;
+	int32_t								m_frame_num;
+	int32_t								m_export_num;
+	int64_t								m_pts;					// microseconds, AV_NOPTS_VALUE if unknown
+};
+
+// the "export write callback" is called once per submitted write, from the thread that wrote it:
+typedef void(*EXPORT_WRITE_CALLBACK_CB)(void* p_object, FFVideo_ExportWrite& w, bool status);
+
+//------------------------------------------------------------------------------
+// separates encoding from I/O: the frame exporter encodes into memory and submits the bytes,
+// a small pool of threads writes them, so encode and disk time overlap rather than add up.
+// Encode buffers are recycled between submits, so a steady export does not allocate:
+class FFVideo_ExportWriter
+{
+public:
+	FFVideo_ExportWriter() : mp_tracer(NULL), m_stop_writing(false), m_writers_running(0), m_in_flight(0), m_in_flight_peak(0),
+		m_files(0), m_bytes(0), m_failures(0), mp_write_cb(NULL), mp_write_object(NULL) {};
+
+	// 2nd required for for thread constructor
+	FFVideo_ExportWriter(const FFVideo_ExportWriter& obj) : mp_tracer(NULL) {}
+
+	~FFVideo_ExportWriter() { Stop(); }
+
+	bool Start(FFVIDEO_Export_Writer_Params& params, EXPORT_WRITE_CALLBACK_CB write_cb, void* write_object);
+
+	// waits for every submitted write to complete & be flushed, then ends the writer threads:
+	void Stop(void);
+
+	// takes the contents of bytes, returning bytes holding a recycled buffer to encode the next frame into.
+	// Waits while the in-flight limit is reached. With no writer threads the write happens before returning:
+	bool Submit(const std::string& fname, std::vector<uint8_t>& bytes, int32_t frame_num, int32_t export_num, int64_t pts);
+
+	int32_t InFlight(void) { return m_in_flight; }
+
+	void GetStats(FFVIDEO_Export_Write_Stats& stats);
+	void ResetStats(void);
+
+	FFVideo_Histogram						m_encode_hist;		// filled by the exporter, kept here with the other stages
+	FFVideo_Tracer*							mp_tracer;				// set by the exporter, each write is a span when tracing
+
+private:
+	// class sub-thread function that spins writing queued frames:
+	void WriteProcessLoop(void);
+
+	bool Write(FFVideo_ExportWrite& w, std::vector<FILE*>& unsynced, std::vector<std::string>& unsynced_dirs);
+	void Sync(std::vector<FILE*>& unsynced, std::vector<std::string>& unsynced_dirs);
+	void Complete(FFVideo_ExportWrite& w, bool status);
+
+	FFVIDEO_Export_Writer_Params				m_params;
+	std::vector<std::thread*>						m_writers;
+	std::atomic<bool>										m_stop_writing;
+	std::atomic<int32_t>								m_writers_running;
+
+	mutable std::shared_mutex						m_queue_lock;
+	std::queue<FFVideo_ExportWrite>			m_writeQue;
+	std::vector<std::vector<uint8_t>>		m_free_buffers;		// written buffers waiting for reuse, also under m_queue_lock
+
+	std::atomic<int32_t>								m_in_flight;
+	std::atomic<int32_t>								m_in_flight_peak;
+	std::atomic<uint64_t>								m_files;
+	std::atomic<uint64_t>								m_bytes;
+	std::atomic<uint64_t>								m_failures;
+	FFVideo_Histogram										m_wait_hist;
+	FFVideo_Histogram										m_write_hist;
+	FFVideo_Histogram										m_sync_hist;
+
+	// typedef void(*EXPORT_WRITE_CALLBACK_CB)(void* p_object, FFVideo_ExportWrite& w, bool status);
+	EXPORT_WRITE_CALLBACK_CB						mp_write_cb;
+	void*																mp_write_object;
+};
+
+
+
+#endif // _FFVIDEO_EXPORTWRITER_H_
@@ -0,0 +1,291 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <algorithm>
+
+#include "ffvideo.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+static uint32_t ArchiveCRC(const uint8_t* p_bytes, size_t size)
+{
+	return av_crc(av_crc_get_table(AV_CRC_32_IEEE_LE), UINT32_MAX, p_bytes, size) ^ UINT32_MAX;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveWriter::Open(const std::string& dir, const std::string& base, FFVIDEO_Export_Format& format, uint64_t shard_bytes)
+{
+	Close();
+
+	using namespace boost::posix_time;
+	ptime t = microsec_clock::universal_time();
+	//
+	std::string iso_part = to_iso_extended_string(t);
+	std::replace(iso_part.begin(), iso_part.end(), ':', '-');
+	std::replace(iso_part.begin(), iso_part.end(), '.', '-');
+
+	m_archive_path = dir + base + std::string("_") + iso_part;
+	m_index_path   = m_archive_path + std::string(".ffvi");
+	m_shard_bytes  = shard_bytes;
+	m_shard_num    = 0;
+	m_unflushed    = 0;
+
+	mp_index = fopen(m_index_path.c_str(), "wb");
+	if (!mp_index)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameArchive: unable to create index '%s'\n", m_index_path.c_str());
+		return false;
+	}
+
+	FFVIDEO_Archive_Header header;
+	memcpy(header.m_magic, "FFVI", 4);
+	header.m_version  = 1;
+	header.m_format   = format.m_format;
+	header.m_channels = format.m_channels;
+	if (fwrite(&header, sizeof(header), 1, mp_index) != 1 || !OpenShard())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveWriter::OpenShard(void)
+{
+	if (mp_shard)
+	{
+		fclose(mp_shard);
+		mp_shard = NULL;
+	}
+
+	char shard_part[16];
+	snprintf(shard_part, sizeof(shard_part), "_%04d.ffva", m_shard_num);
+	m_shard_path = m_archive_path + std::string(shard_part);
+
+	mp_shard = fopen(m_shard_path.c_str(), "wb");
+	if (!mp_shard)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameArchive: unable to create shard '%s'\n", m_shard_path.c_str());
+		return false;
+	}
+
+	// records are written whole, so a large buffer turns them into few large writes:
+	setvbuf(mp_shard, NULL, _IOFBF, 1024 * 1024);
+	m_shard_offset = 0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveWriter::Append(std::vector<uint8_t>& bytes, int32_t frame_num, int64_t pts, uint32_t width, uint32_t height)
+{
+	if (!mp_index || !mp_shard || bytes.size() < 1)
+		return false;
+
+	// start the next shard if this record would grow the current one past the shard size:
+	uint64_t record_size = sizeof(FFVIDEO_Archive_Record) + bytes.size();
+	if (m_shard_offset > 0 && m_shard_offset + record_size > m_shard_bytes)
+	{
+		m_shard_num++;
+		if (!OpenShard())
+			return false;
+	}
+
+	FFVIDEO_Archive_Record record;
+	memcpy(record.m_magic, "FFVR", 4);
+	record.m_length    = (uint32_t)bytes.size();
+	record.m_frame_num = frame_num;
+	record.m_crc       = ArchiveCRC(bytes.data(), bytes.size());
+	record.m_pts       = pts;
+
+	if (fwrite(&record, sizeof(record), 1, mp_shard) != 1 ||
+			fwrite(bytes.data(), 1, bytes.size(), mp_shard) != bytes.size())
+		return false;
+
+	FFVIDEO_Archive_Entry entry;
+	entry.m_frame_num = frame_num;
+	entry.m_shard     = m_shard_num;
+	entry.m_pts       = pts;
+	entry.m_offset    = m_shard_offset + sizeof(record);
+	entry.m_length    = record.m_length;
+	entry.m_crc       = record.m_crc;
+	entry.m_width     = width;
+	entry.m_height    = height;
+
+	m_shard_offset += record_size;
+
+	if (fwrite(&entry, sizeof(entry), 1, mp_index) != 1)
+		return false;
+
+	// the index is flushed periodically so readers of a live archive see recent frames,
+	// the shard first so no index entry points past the data on disk:
+	if (++m_unflushed >= 64)
+	{
+		fflush(mp_shard);
+		fflush(mp_index);
+		m_unflushed = 0;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameArchiveWriter::Close(void)
+{
+	if (mp_shard)
+	{
+		fclose(mp_shard);
+		mp_shard = NULL;
+	}
+	if (mp_index)
+	{
+		fclose(mp_index);
+		mp_index = NULL;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveReader::Open(const char* index_path)
+{
+	Close();
+
+	std::string path(index_path);
+	if (path.size() < 6 || path.compare(path.size() - 5, 5, ".ffvi") != 0)
+		return false;
+	m_archive_path = path.substr(0, path.size() - 5);
+
+	FILE* fh = fopen(index_path, "rb");
+	if (!fh)
+		return false;
+
+	FFVIDEO_Archive_Header header;
+	if (fread(&header, sizeof(header), 1, fh) != 1 || memcmp(header.m_magic, "FFVI", 4) != 0 || header.m_version != 1)
+	{
+		fclose(fh);
+		return false;
+	}
+	m_format.m_format   = header.m_format;
+	m_format.m_channels = header.m_channels;
+
+	// a partially written trailing entry of a live archive is ignored:
+	FFVIDEO_Archive_Entry entry;
+	while (fread(&entry, sizeof(entry), 1, fh) == 1)
+	{
+		if (m_entries.size() > 0 && entry.m_frame_num < m_entries.back().m_frame_num)
+			m_sorted = false;
+		m_entries.push_back(entry);
+	}
+	fclose(fh);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameArchiveReader::Close(void)
+{
+	for (size_t i = 0; i < m_shards.size(); i++)
+	{
+		if (m_shards[i])
+			fclose(m_shards[i]);
+	}
+	m_shards.clear();
+	m_entries.clear();
+	m_sorted = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveReader::GetEntry(size_t index, FFVIDEO_Archive_Entry& entry)
+{
+	if (index >= m_entries.size())
+		return false;
+
+	entry = m_entries[index];
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int64_t FFVideo_FrameArchiveReader::FindFrame(int32_t frame_num)
+{
+	// a frame exported more than once, as after a seek or loop, is found as its latest export on either path.
+	// Ascending entries hold repeats adjacent & in write order, so that is the last of the equal run:
+	if (m_sorted)
+	{
+		auto it = std::upper_bound(m_entries.begin(), m_entries.end(), frame_num,
+															 [](int32_t f, const FFVIDEO_Archive_Entry& e) { return f < e.m_frame_num; });
+		if (it != m_entries.begin() && (it - 1)->m_frame_num == frame_num)
+			return (int64_t)(it - 1 - m_entries.begin());
+		return -1;
+	}
+
+	// frame numbers go backwards after seeks, so the latest export of a frame wins:
+	for (size_t i = m_entries.size(); i > 0; i--)
+	{
+		if (m_entries[i - 1].m_frame_num == frame_num)
+			return (int64_t)(i - 1);
+	}
+	return -1;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FILE* FFVideo_FrameArchiveReader::GetShard(int32_t shard)
+{
+	if (shard < 0)
+		return NULL;
+
+	if ((size_t)shard >= m_shards.size())
+		m_shards.resize(shard + 1, NULL);
+
+	if (!m_shards[shard])
+	{
+		char shard_part[16];
+		snprintf(shard_part, sizeof(shard_part), "_%04d.ffva", shard);
+		std::string shard_path = m_archive_path + std::string(shard_part);
+
+		m_shards[shard] = fopen(shard_path.c_str(), "rb");
+	}
+
+	return m_shards[shard];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveReader::ReadFrame(size_t index, std::vector<uint8_t>& bytes)
+{
+	if (index >= m_entries.size())
+		return false;
+
+	FFVIDEO_Archive_Entry& entry = m_entries[index];
+
+	FILE* fh = GetShard(entry.m_shard);
+	if (!fh)
+		return false;
+
+	bytes.resize(entry.m_length);
+	if (FFVideo_Seek64(fh, (int64_t)entry.m_offset, SEEK_SET) != 0 ||
+			fread(bytes.data(), 1, entry.m_length, fh) != entry.m_length)
+		return false;
+
+	if (ArchiveCRC(bytes.data(), bytes.size()) != entry.m_crc)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameArchive: CRC mismatch for frame %d in shard %d\n", entry.m_frame_num, entry.m_shard);
+		return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameArchiveReader::ReadImage(size_t index, FFVideo_Image& im)
+{
+	std::vector<uint8_t> bytes;
+	if (!ReadFrame(index, bytes))
+		return false;
+
+	FFVIDEO_Archive_Entry& entry = m_entries[index];
+
+	return im.Decode(bytes.data(), bytes.size(), m_format, entry.m_width, entry.m_height);
+}
@@ -0,0 +1,136 @@
+#pragma once
+#ifndef _FFVIDEO_FRAMEARCHIVE_H_
+#define _FFVIDEO_FRAMEARCHIVE_H_
+
+
+#include <string>
+#include <vector>
+
+
+extern "C" {
+#include "libavutil/crc.h"
+}
+
+#include "ffvideo_image.h"
+
+
+// ---------------------------------------------------------------------------------
+// A frame archive is an alternative to writing one file per exported frame. Encoded frames
+// are appended as records into large "shard" files, and a compact index file records where
+// each frame landed. Per archive there is one index and one or more shards:
+//
+//		[dir][base]_[timecode].ffvi					the index: an FFVIDEO_Archive_Header then FFVIDEO_Archive_Entry's
+//		[dir][base]_[timecode]_0000.ffva		shard 0: FFVIDEO_Archive_Record's, each followed by its payload
+//		[dir][base]_[timecode]_0001.ffva		shard 1, started when shard 0 reaches the shard size, and so on
+//
+// Records repeat their index entry's frame number, pts, length & CRC, so the shards are
+// self-describing if an index is lost. All values are little endian.
+// ---------------------------------------------------------------------------------
+
+#pragma pack(push, 1)
+
+typedef struct _FFVIDEO_Archive_Header
+{
+	char			m_magic[4];				// "FFVI"
+	uint32_t	m_version;				// 1
+	int32_t		m_format;					// FFVIDEO_Export_Format m_format the payloads are encoded with
+	int32_t		m_channels;				// FFVIDEO_Export_Format m_channels the payloads are encoded with
+} FFVIDEO_Archive_Header;
+
+typedef struct _FFVIDEO_Archive_Entry
+{
+	int32_t		m_frame_num;
+	int32_t		m_shard;					// shard file number
+	int64_t		m_pts;						// presentation time in microseconds, AV_NOPTS_VALUE if unknown
+	uint64_t	m_offset;					// of the payload within the shard
+	uint32_t	m_length;					// payload bytes
+	uint32_t	m_crc;						// CRC-32 (IEEE, as zlib) of the payload
+	uint32_t	m_width;
+	uint32_t	m_height;
+} FFVIDEO_Archive_Entry;
+
+typedef struct _FFVIDEO_Archive_Record
+{
+	char			m_magic[4];				// "FFVR"
+	uint32_t	m_length;
+	int32_t		m_frame_num;
+	uint32_t	m_crc;
+	int64_t		m_pts;
+} FFVIDEO_Archive_Record;
+
+#pragma pack(pop)
+
+
+// ---------------------------------------------------------------------------------
+// used by the frame exporter's thread, appends encoded frames into shards & the index:
+class FFVideo_FrameArchiveWriter
+{
+public:
+	FFVideo_FrameArchiveWriter() : mp_index(NULL), mp_shard(NULL), m_shard_bytes(0), m_shard_num(0),
+		m_shard_offset(0), m_unflushed(0) {};
+	~FFVideo_FrameArchiveWriter() { Close(); }
+
+	// shard_bytes is the size a shard grows to before the next shard is started:
+	bool Open(const std::string& dir, const std::string& base, FFVIDEO_Export_Format& format, uint64_t shard_bytes);
+	bool Append(std::vector<uint8_t>& bytes, int32_t frame_num, int64_t pts, uint32_t width, uint32_t height);
+	void Close(void);
+
+	bool								IsOpen(void) { return (mp_index != NULL); }
+	const std::string&	ShardPath(void) { return m_shard_path; }
+	const std::string&	IndexPath(void) { return m_index_path; }
+
+private:
+	bool OpenShard(void);
+
+	FILE*						mp_index;
+	FILE*						mp_shard;
+	std::string			m_archive_path;		// dir + base + timecode, the shared part of the file names
+	std::string			m_index_path;
+	std::string			m_shard_path;
+	uint64_t				m_shard_bytes;
+	int32_t					m_shard_num;
+	uint64_t				m_shard_offset;
+	int32_t					m_unflushed;			// index entries written since the last fflush
+};
+
+
+// ---------------------------------------------------------------------------------
+// random access to the frames of an archive by index lookup. Archives still being written
+// may be opened; entries appended after Open() are not seen until the next Open():
+class FFVideo_FrameArchiveReader
+{
+public:
+	FFVideo_FrameArchiveReader() : m_sorted(true) {};
+	~FFVideo_FrameArchiveReader() { Close(); }
+
+	// index_path is the .ffvi file, the shards are expected alongside it:
+	bool		Open(const char* index_path);
+	void		Close(void);
+
+	size_t	Count(void) { return m_entries.size(); }
+	bool		GetEntry(size_t index, FFVIDEO_Archive_Entry& entry);
+
+	// returns the index of the entry for frame_num, its latest export if archived more than once, or -1 if not archived:
+	int64_t FindFrame(int32_t frame_num);
+
+	// the encoded payload, false if unreadable or its CRC does not match:
+	bool		ReadFrame(size_t index, std::vector<uint8_t>& bytes);
+
+	// the payload decoded, see FFVideo_Image::Decode() for the image types returned:
+	bool		ReadImage(size_t index, FFVideo_Image& im);
+
+	FFVIDEO_Export_Format& Format(void) { return m_format; }
+
+private:
+	FILE* GetShard(int32_t shard);
+
+	std::string												m_archive_path;
+	FFVIDEO_Export_Format							m_format;
+	std::vector<FFVIDEO_Archive_Entry>	m_entries;
+	bool															m_sorted;		// true if frame numbers ascend, allowing a binary search
+	std::vector<FILE*>								m_shards;
+};
+
+
+
+#endif // _FFVIDEO_FRAMEARCHIVE_H_
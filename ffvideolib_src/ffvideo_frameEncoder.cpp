@@ -0,0 +1,472 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <stdarg.h>
+
+#include "ffvideo.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::Add(FFVideo_Image& im, int32_t frame_num, bool vflip)
+{
+	// an encoder slower than the frame rate drops frames rather than queue them without limit,
+	// playback is not held back for it:
+	int32_t max_queued = m_max_queued;
+	if (max_queued > 0 && (int32_t)Size() >= max_queued)
+		return false;
+
+	FFVideo_EncodeFrame ef;
+	ef.m_im.Clone(im);
+	ef.m_frame_num = frame_num;
+	ef.m_vflip = vflip;
+
+	std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+		m_encodeQue.push(ef);
+	lock.unlock();
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameEncoder::EncodeProcessLoop(void)
+{
+	uint64_t milliseconds = 1000 / 120; // the demoninator is how many times per second we will loop
+
+	uint64_t nanosleep_param = milliseconds * 10; // each ms is 10 nanosleep units
+
+	bool encode_success = true;
+
+	FFVideo_Tracer::NameThread("frame encoder");
+
+	mp_packet = av_packet_alloc();
+	if (!mp_packet)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: out of memory\n");
+		encode_success = false;
+		m_stop_encode_processing_loop = true;
+	}
+
+	while (true)
+	{
+		if (m_stop_encode_processing_loop)
+		{
+			break;
+		}
+		else
+		{
+			// read before the queue, so a finish request cannot slip past frames added ahead of it:
+			bool finishing = m_finish_requested;
+
+			std::shared_lock<std::shared_mutex> rlock(m_queue_lock);
+			bool work_to_do = !m_encodeQue.empty();
+			rlock.unlock();
+
+			if (!work_to_do && finishing)
+				break;
+
+			while (work_to_do && !m_stop_encode_processing_loop)
+			{
+				std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+				FFVideo_EncodeFrame ef = m_encodeQue.front();
+				m_encodeQue.pop();
+				work_to_do = !m_encodeQue.empty();
+				lock.unlock();
+
+				FFVideo_TraceScope trace(mp_tracer, "export", "video encode", ef.m_frame_num);
+				encode_success = EncodeFrame(ef);
+				if (!encode_success)
+				{
+					mp_parent->m_frame_encode_interval = -1;	// disable, -1 signals disabled in error
+					m_stop_encode_processing_loop = true;
+					break;
+				}
+			}
+		}
+		FFVideo_Sleep100ns(nanosleep_param);
+	}
+
+	// whether finishing, stopping or failing, close out the current segment:
+	CloseSegment(encode_success);
+
+	if (mp_sws_context)
+	{
+		sws_freeContext(mp_sws_context);
+		mp_sws_context = NULL;
+	}
+
+	if (mp_packet)
+		av_packet_free(&mp_packet);
+
+	m_encode_processing_loop_ended = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::EncodeFrame(FFVideo_EncodeFrame& ef)
+{
+	FFVideo_Image& im = ef.m_im;
+
+	enum AVPixelFormat src_format;
+	int32_t bytes_per_pixel;
+	switch (im.m_type) // 0=RGB, 1=RGBA, 2=Gray, 3=BGR, 4=BGRA
+	{
+	case 0:  src_format = AV_PIX_FMT_RGB24; bytes_per_pixel = 3; break;
+	case 2:  src_format = AV_PIX_FMT_GRAY8; bytes_per_pixel = 1; break;
+	case 3:  src_format = AV_PIX_FMT_BGR24; bytes_per_pixel = 3; break;
+	case 4:  src_format = AV_PIX_FMT_BGRA;  bytes_per_pixel = 4; break;
+	default: src_format = AV_PIX_FMT_RGBA;  bytes_per_pixel = 4; break;
+	}
+
+	if (!mp_codec_context)
+	{
+		// first frame of a segment; the output resolution is fixed from this frame:
+		if (!OpenSegment( im.m_width, im.m_height ))
+		{
+			CloseSegment(false);
+			return false;
+		}
+	}
+
+	// the source resolution can change mid-segment (post process filter changes), so the cached context follows it:
+	mp_sws_context = sws_getCachedContext( mp_sws_context,
+																				 im.m_width, im.m_height, src_format,
+																				 m_out_width, m_out_height, mp_codec_context->pix_fmt,
+																				 SWS_BICUBIC, NULL, NULL, NULL );
+	if (!mp_sws_context)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot create pixel format conversion context\n");
+		return false;
+	}
+
+	if (av_frame_make_writable(mp_yuv_frame) < 0)
+		return false;
+
+	// bottom origin images are flipped back during the conversion by walking the rows backwards:
+	int32_t         row_bytes = im.m_width * bytes_per_pixel;
+	const uint8_t*	src_data[4] = { im.mp_pixels, NULL, NULL, NULL };
+	int							src_stride[4] = { row_bytes, 0, 0, 0 };
+	if (ef.m_vflip)
+	{
+		src_data[0] = im.mp_pixels + (size_t)(im.m_height - 1) * (size_t)row_bytes;
+		src_stride[0] = -row_bytes;
+	}
+
+	sws_scale( mp_sws_context, src_data, src_stride, 0, im.m_height, mp_yuv_frame->data, mp_yuv_frame->linesize );
+
+	// time base is 1/fps, so the pts is simply the segment's frame count:
+	mp_yuv_frame->pts = m_segment_frame_count;
+
+	if (!SendFrame( mp_yuv_frame ))
+		return false;
+
+	m_segment_frame_count++;
+
+	int32_t segment_frames = m_params.m_segment_frames;
+	if (segment_frames > 0 && m_segment_frame_count >= segment_frames)
+	{
+		// rotate; the next frame opens the next segment:
+		CloseSegment(true);
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::SendFrame(AVFrame* p_frame)
+{
+	int ret = avcodec_send_frame(mp_codec_context, p_frame);
+	if (ret < 0)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: avcodec_send_frame error %d\n", ret);
+		return false;
+	}
+
+	while (ret >= 0)
+	{
+		ret = avcodec_receive_packet(mp_codec_context, mp_packet);
+		if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+			break;
+		if (ret < 0)
+		{
+			av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: avcodec_receive_packet error %d\n", ret);
+			return false;
+		}
+
+		bool write_success = WritePacket(mp_packet);
+		av_packet_unref(mp_packet);
+		if (!write_success)
+			return false;
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::WritePacket(AVPacket* p_packet)
+{
+	int ret = 0;
+
+	// the muxers take ownership of what they are given, so the elementary stream gets its own reference:
+	if (mp_es_context)
+	{
+		AVPacket* p_es_packet = av_packet_clone(p_packet);
+		if (!p_es_packet)
+			return false;
+
+		av_packet_rescale_ts(p_es_packet, mp_codec_context->time_base, mp_es_stream->time_base);
+		p_es_packet->stream_index = mp_es_stream->index;
+
+		ret = av_interleaved_write_frame(mp_es_context, p_es_packet);
+		av_packet_free(&p_es_packet);
+		if (ret < 0)
+		{
+			av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: error writing %s\n", m_es_fname.c_str());
+			return false;
+		}
+	}
+
+	if (mp_mp4_context)
+	{
+		av_packet_rescale_ts(p_packet, mp_codec_context->time_base, mp_mp4_stream->time_base);
+		p_packet->stream_index = mp_mp4_stream->index;
+
+		ret = av_interleaved_write_frame(mp_mp4_context, p_packet);
+		if (ret < 0)
+		{
+			av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: error writing %s\n", m_mp4_fname.c_str());
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::OpenMuxer(AVFormatContext** pp_context, AVStream** pp_stream, const char* format_name, std::string& fname)
+{
+	AVFormatContext* p_context = NULL;
+
+	int ret = avformat_alloc_output_context2(&p_context, NULL, format_name, fname.c_str());
+	if (ret < 0 || !p_context)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot create '%s' muxer\n", format_name);
+		return false;
+	}
+
+	AVStream* p_stream = avformat_new_stream(p_context, NULL);
+	if (!p_stream || avcodec_parameters_from_context(p_stream->codecpar, mp_codec_context) < 0)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot create '%s' stream\n", format_name);
+		avformat_free_context(p_context);
+		return false;
+	}
+	p_stream->time_base = mp_codec_context->time_base;
+	p_stream->avg_frame_rate = mp_codec_context->framerate;
+
+	if (!(p_context->oformat->flags & AVFMT_NOFILE))
+	{
+		ret = avio_open(&p_context->pb, fname.c_str(), AVIO_FLAG_WRITE);
+		if (ret < 0)
+		{
+			av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot open %s for writing\n", fname.c_str());
+			avformat_free_context(p_context);
+			return false;
+		}
+	}
+
+	// note the muxer may change the stream's time_base here, which is why packets are rescaled on write:
+	ret = avformat_write_header(p_context, NULL);
+	if (ret < 0)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot write header of %s\n", fname.c_str());
+		if (!(p_context->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&p_context->pb);
+		avformat_free_context(p_context);
+		return false;
+	}
+
+	// only muxers with a written header are handed back, so CloseSegment() can always write their trailer:
+	*pp_context = p_context;
+	*pp_stream  = p_stream;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameEncoder::OpenSegment(int32_t src_width, int32_t src_height)
+{
+	FFVIDEO_Encode_Params& params = m_params;
+
+	// output resolution, same rules as ffmpeg's scale filter with -1:
+	m_out_width  = params.m_width;
+	m_out_height = params.m_height;
+	if (m_out_width <= 0 && m_out_height <= 0)
+	{
+		m_out_width  = src_width;
+		m_out_height = src_height;
+	}
+	else if (m_out_width <= 0)
+	{
+		m_out_width = (int32_t)((int64_t)src_width * m_out_height / src_height);
+	}
+	else if (m_out_height <= 0)
+	{
+		m_out_height = (int32_t)((int64_t)src_height * m_out_width / src_width);
+	}
+	// 4:2:0 chroma requires even dimensions:
+	m_out_width  &= ~1;
+	m_out_height &= ~1;
+	if (m_out_width < 2 || m_out_height < 2)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: bad encode resolution %dx%d\n", m_out_width, m_out_height);
+		return false;
+	}
+
+	AVCodec* p_codec = NULL;
+	if (params.m_codec.size() > 0)
+		p_codec = avcodec_find_encoder_by_name(params.m_codec.c_str());
+	if (!p_codec)
+		p_codec = avcodec_find_encoder(AV_CODEC_ID_H264);
+	if (!p_codec)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: no '%s' or H.264 encoder available\n", params.m_codec.c_str());
+		return false;
+	}
+
+	mp_codec_context = avcodec_alloc_context3(p_codec);
+	if (!mp_codec_context)
+		return false;
+
+	mp_codec_context->width     = m_out_width;
+	mp_codec_context->height    = m_out_height;
+	mp_codec_context->framerate = av_d2q(m_fps, 100000);
+	mp_codec_context->time_base = av_inv_q(mp_codec_context->framerate);
+	mp_codec_context->sample_aspect_ratio = av_make_q(1, 1);
+
+	// prefer 4:2:0 for media player compatibility, otherwise the encoder's first choice:
+	mp_codec_context->pix_fmt = AV_PIX_FMT_YUV420P;
+	if (p_codec->pix_fmts)
+	{
+		bool has_yuv420p(false);
+		for (const enum AVPixelFormat* p = p_codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++)
+		{
+			if (*p == AV_PIX_FMT_YUV420P)
+				has_yuv420p = true;
+		}
+		if (!has_yuv420p)
+			mp_codec_context->pix_fmt = p_codec->pix_fmts[0];
+	}
+
+	// When an elementary stream is also written the encoder must repeat its headers in-band,
+	// so the global header is only requested for mp4-only encoding. The mp4 muxer picks the
+	// in-band headers up from the first packet when there is no global header.
+	bool write_es = params.m_elementary && (p_codec->id == AV_CODEC_ID_H264 || p_codec->id == AV_CODEC_ID_HEVC);
+	if (params.m_elementary && !write_es)
+	{
+		av_log(NULL, AV_LOG_WARNING, "FFVideo_FrameEncoder: %s has no elementary stream format, writing mp4 only\n", p_codec->name);
+	}
+	if (!write_es)
+		mp_codec_context->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+
+	// these are private options of libx264 (and some others); ignored by encoders without them:
+	AVDictionary* p_opts = NULL;
+	if (params.m_preset.size() > 0)
+		av_dict_set(&p_opts, "preset", params.m_preset.c_str(), 0);
+	if (params.m_crf >= 0)
+		av_dict_set_int(&p_opts, "crf", params.m_crf, 0);
+
+	int ret = avcodec_open2(mp_codec_context, p_codec, &p_opts);
+	av_dict_free(&p_opts);
+	if (ret < 0)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_FrameEncoder: cannot open encoder %s\n", p_codec->name);
+		return false;
+	}
+
+	mp_yuv_frame = av_frame_alloc();
+	if (!mp_yuv_frame)
+		return false;
+	mp_yuv_frame->format = mp_codec_context->pix_fmt;
+	mp_yuv_frame->width  = m_out_width;
+	mp_yuv_frame->height = m_out_height;
+	if (av_frame_get_buffer(mp_yuv_frame, 32) < 0)
+		return false;
+
+	// filename is the encode dir + encode_base + segment number + an ISO 8601 timestamp, with microseconds:
+	using namespace boost::posix_time;
+	ptime t = microsec_clock::universal_time();
+	//
+	std::string iso_part = to_iso_extended_string(t);
+
+	replaceAll(iso_part, std::string(":"), std::string("-"));
+	replaceAll(iso_part, std::string("."), std::string("-"));
+
+	char segment_part[32];
+	snprintf(segment_part, sizeof(segment_part), "_%04d_", m_segment_num);
+
+	std::string fname = params.m_encode_dir + params.m_encode_base + std::string(segment_part) + iso_part;
+
+	if (params.m_mp4 || !write_es)
+	{
+		m_mp4_fname = fname + std::string(".mp4");
+		if (!OpenMuxer(&mp_mp4_context, &mp_mp4_stream, "mp4", m_mp4_fname))
+			return false;
+	}
+
+	if (write_es)
+	{
+		bool is_hevc = (p_codec->id == AV_CODEC_ID_HEVC);
+		m_es_fname = fname + std::string( is_hevc ? ".265" : ".264" );
+		if (!OpenMuxer(&mp_es_context, &mp_es_stream, is_hevc ? "hevc" : "h264", m_es_fname))
+			return false;
+	}
+
+	m_segment_frame_count = 0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameEncoder::CloseSegment(bool status)
+{
+	if (!mp_codec_context)
+		return; // no segment open
+
+	// drain any frames the encoder is holding (b-frame reordering, lookahead):
+	if (status && avcodec_is_open(mp_codec_context) && mp_packet)
+		status = SendFrame(NULL);
+
+	std::string fname = (mp_mp4_context) ? m_mp4_fname : m_es_fname;
+
+	AVFormatContext* contexts[2] = { mp_mp4_context, mp_es_context };
+	for (int32_t i = 0; i < 2; i++)
+	{
+		AVFormatContext* p_context = contexts[i];
+		if (!p_context)
+			continue;
+
+		if (av_write_trailer(p_context) < 0)
+			status = false;
+		if (!(p_context->oformat->flags & AVFMT_NOFILE))
+			avio_closep(&p_context->pb);
+
+		avformat_free_context(p_context);
+	}
+	mp_mp4_context = NULL;
+	mp_es_context  = NULL;
+	mp_mp4_stream  = NULL;
+	mp_es_stream   = NULL;
+
+	avcodec_free_context(&mp_codec_context);
+	av_frame_free(&mp_yuv_frame);
+
+	if (mp_encode_segment_cb)
+	{
+		(mp_encode_segment_cb)(mp_encode_segment_object, m_segment_num, m_segment_frame_count, fname.c_str(), status);
+	}
+
+	m_segment_num++;
+	m_segment_frame_count = 0;
+}
@@ -0,0 +1,264 @@
+#pragma once
+#ifndef _FFVIDEO_FRAMEENCODER_H_
+#define _FFVIDEO_FRAMEENCODER_H_
+
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <chrono>
+#include <functional>
+
+
+extern "C" {
+#include "libavcodec/avcodec.h"
+#include "libavformat/avformat.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/opt.h"
+#include "libswscale/swscale.h"
+#include "libavutil/error.h"
+#include "libavutil/log.h"
+}
+#ifdef _MSC_VER
+#pragma comment(lib, "libavformat.a")
+#endif
+
+#include "BCTime.h"
+#include "ffvideo_image.h"
+#include "ffvideo_trace.h"
+
+
+//------------------------------------------------------------------------------
+// parameters of the in-process encoder sink. Frames are encoded straight from
+// the frame delivery path into .mp4 and/or elementary stream files, rotating to
+// a new file "segment" every m_segment_frames encoded frames:
+typedef struct _FFVIDEO_Encode_Params
+{
+	std::string m_encode_dir;							// must exist
+	std::string m_encode_base;						// basename before segment number & timestamp
+	int32_t			m_segment_frames = 0;			// encoded frames per file segment, < 1 is one segment until stream stops
+	float				m_fps = 0.0f;							// encoding fps, <= 0 derives from stream's frame rate and encode interval
+	int32_t			m_width = -1;							// encode width, height; set either to -1 for auto-fitting,
+	int32_t			m_height = -1;						// or both to -1 for original resolution
+	bool				m_mp4 = true;							// write .mp4 segments
+	bool				m_elementary = false;			// write elementary stream segments (.264 for H.264, .265 for HEVC)
+	std::string m_codec = "libx264";			// encoder name, falls back to any H.264 encoder if not found
+	std::string m_preset = "ultrafast";		// passed to the encoder as its "preset" option, if it has one
+	int32_t			m_crf = 18;								// passed to the encoder as its "crf" option, if it has one
+	int32_t			m_max_queued = 60;				// frames waiting on the encoder before further frames are dropped, < 1 no limit
+} FFVIDEO_Encode_Params;
+
+//------------------------------------------------------------------------------
+class FFVideo_EncodeFrame
+{
+public:
+	FFVideo_EncodeFrame() : m_frame_num(0), m_vflip(true) {};
+
+	// copy constructor
+	FFVideo_EncodeFrame(const FFVideo_EncodeFrame& ef)
+	{
+		m_im.Clone(ef.m_im);
+		m_frame_num = ef.m_frame_num;
+		m_vflip = ef.m_vflip;
+	}
+
+	// copy assignement operator
+	FFVideo_EncodeFrame& operator = (const FFVideo_EncodeFrame& ef)
+	{
+		if (this != &ef)
+		{
+			m_im.Clone(ef.m_im);
+			m_frame_num = ef.m_frame_num;
+			m_vflip = ef.m_vflip;
+		}
+		return (*this);
+	}
+
+	FFVideo_Image	m_im;
+	int32_t				m_frame_num;
+	bool					m_vflip;		// true when m_im is bottom origin and needs flipping back before encoding
+};
+
+class FFVideo_FrameDestination;
+
+// the "encode segment callback" is called each time an encoded file segment is closed;
+// filepath is the .mp4 if one was written, otherwise the elementary stream file:
+typedef void(*ENCODE_SEGMENT_CALLBACK_CB)(void* p_object, int32_t segment_num, int32_t frame_count, const char* filepath, bool status);
+
+//------------------------------------------------------------------------------
+// in-process libavcodec encoder sink; frames queued by Add() are converted to the
+// encoder's pixel format, encoded and muxed by a sub-thread, no intermediate files:
+class FFVideo_FrameEncoder
+{
+public:
+	FFVideo_FrameEncoder() : mp_encodeProcessingThread(NULL), m_stop_encode_processing_loop(false),
+		m_encode_processing_loop_ended(false), m_finish_requested(false), m_max_queued(0), m_fps(25.0f),
+		mp_parent(NULL), mp_tracer(NULL), mp_encode_segment_cb(NULL), mp_encode_segment_object(NULL),
+		mp_codec_context(NULL), mp_mp4_context(NULL), mp_es_context(NULL), mp_mp4_stream(NULL), mp_es_stream(NULL),
+		mp_sws_context(NULL), mp_yuv_frame(NULL), mp_packet(NULL),
+		m_segment_num(0), m_segment_frame_count(0), m_out_width(0), m_out_height(0) {};
+
+	// 2nd required for for thread constructor
+	FFVideo_FrameEncoder(const FFVideo_FrameEncoder& obj) {}
+
+	// class sub-thread function that spins encoding video frames:
+	void EncodeProcessLoop(void);
+	//
+	// thread variables:
+	std::thread* mp_encodeProcessingThread;
+	//
+	std::atomic<bool>		m_stop_encode_processing_loop;
+	std::atomic<bool>		m_encode_processing_loop_ended;
+	std::atomic<bool>		m_finish_requested;		// encode what is queued, close the segment, then exit
+
+	~FFVideo_FrameEncoder()
+	{
+		StopEncoder();
+		std::queue<FFVideo_EncodeFrame> empty;
+		std::swap(m_encodeQue, empty);
+	}
+
+	bool IsRunning(void)
+	{
+		if (!mp_encodeProcessingThread)
+			return false;
+
+		// set to true entering Process thread, goes false when exiting Process:
+		bool ret = !m_encode_processing_loop_ended;
+
+		return ret;
+	}
+
+	// fps is the encoding rate, already resolved from the params or the stream:
+	void StartEncoder(FFVIDEO_Encode_Params& params, float fps)
+	{
+		// a previous stream's encoder may still be finishing; let it close its segment first:
+		while (IsRunning() && m_finish_requested)
+		{
+			using namespace std::chrono_literals;
+			std::this_thread::sleep_for(20ms);
+		}
+
+		if (!IsRunning())
+		{
+			// collect the thread of an encoder that finished on its own:
+			ReleaseThread();
+
+			m_params = params;	// our own copy, the client may change theirs while we finish
+			m_max_queued = params.m_max_queued;
+			m_fps = fps;
+			m_segment_num = 0;
+			m_finish_requested = false;
+			mp_encodeProcessingThread = new std::thread(&FFVideo_FrameEncoder::EncodeProcessLoop, this);
+		}
+	}
+
+	// non-blocking; the encode thread drains the queue, closes the segment & exits:
+	void FinishEncoder(void)
+	{
+		if (IsRunning())
+			m_finish_requested = true;
+	}
+
+	// blocking; abandons any queued frames, but still closes the segment so it is playable:
+	void StopEncoder(void)
+	{
+		// only if the EncodeProcessLoop() is running:
+		if (IsRunning())
+		{
+			// tell EncodeProcessLoop() (running in it's own thread) to exit:
+			m_stop_encode_processing_loop = true;
+			//
+			uint32_t spins = 0;
+			while (!m_encode_processing_loop_ended)
+			{
+				using namespace std::chrono_literals;
+				std::this_thread::sleep_for(200ms);
+				//
+				spins++;
+			}
+		}
+		ReleaseThread();
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	void replaceAll(std::string& str, const std::string& from, const std::string& to)
+	{
+		if (from.empty())
+			return;
+		size_t start_pos = 0;
+		while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
+			str.replace(start_pos, from.length(), to);
+			start_pos += to.length(); // In case 'to' contains 'from', like replacing 'x' with 'yx'
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// false if the frame was dropped, the encoder being m_max_queued frames behind:
+	bool Add(FFVideo_Image& im, int32_t frame_num, bool vflip);
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	size_t Size(void) {
+		std::shared_lock<std::shared_mutex> rlock(m_queue_lock);
+		size_t work_to_do = m_encodeQue.size();
+		rlock.unlock();
+		return work_to_do;
+	}
+
+	FFVideo_FrameDestination*				mp_parent;
+	FFVideo_Tracer*									mp_tracer;				// each frame encoded is a span when tracing
+
+	ENCODE_SEGMENT_CALLBACK_CB			mp_encode_segment_cb;
+	void*														mp_encode_segment_object;
+
+	mutable std::shared_mutex				m_queue_lock;
+	std::queue<FFVideo_EncodeFrame>	m_encodeQue;
+
+private:
+	void ReleaseThread(void)
+	{
+		if (mp_encodeProcessingThread)
+		{
+			mp_encodeProcessingThread->join();
+			delete mp_encodeProcessingThread;
+			mp_encodeProcessingThread = NULL;
+			m_stop_encode_processing_loop = false; // reset for next use
+			m_encode_processing_loop_ended = false;
+		}
+	}
+
+	// segment handling, only called from the encode thread:
+	bool OpenSegment(int32_t src_width, int32_t src_height);
+	bool OpenMuxer(AVFormatContext** pp_context, AVStream** pp_stream, const char* format_name, std::string& fname);
+	void CloseSegment(bool status);
+	bool EncodeFrame(FFVideo_EncodeFrame& ef);
+	bool SendFrame(AVFrame* p_frame);			// NULL flushes the encoder
+	bool WritePacket(AVPacket* p_packet);
+
+	FFVIDEO_Encode_Params						m_params;
+	std::atomic<int32_t>						m_max_queued;			// m_params' copy, read by Add() on the delivery thread
+	float														m_fps;
+
+	AVCodecContext*									mp_codec_context;
+	AVFormatContext*								mp_mp4_context;
+	AVFormatContext*								mp_es_context;
+	AVStream*												mp_mp4_stream;
+	AVStream*												mp_es_stream;
+	struct SwsContext*							mp_sws_context;
+	AVFrame*												mp_yuv_frame;
+	AVPacket*												mp_packet;
+
+	std::string											m_mp4_fname;
+	std::string											m_es_fname;
+	int32_t													m_segment_num;
+	int32_t													m_segment_frame_count;
+	int32_t													m_out_width, m_out_height;
+};
+
+
+
+#endif // _FFVIDEO_FRAMEENCODER_H_
@@ -27,17 +27,21 @@ extern "C" {
 #include "libavfilter/buffersrc.h"
 #include "libavutil/avstring.h"
 }
+#ifdef _MSC_VER
 #pragma comment(lib, "libavformat.a")
+#endif
 
 #include "BCTime.h"
 #include "ffvideo_image.h"
+#include "ffvideo_frameArchive.h"
+#include "ffvideo_exportWriter.h"
 
 
 //------------------------------------------------------------------------------
 class FFVideo_ExportFrame
 {
 public:
-	FFVideo_ExportFrame() {};
+	FFVideo_ExportFrame() : m_frame_num(0), m_export_num(0), m_pts(AV_NOPTS_VALUE) {};
 
 	// copy constructor 
 	FFVideo_ExportFrame(const FFVideo_ExportFrame& ef)
@@ -46,6 +50,7 @@ public:
 		m_fname = ef.m_fname;
 		m_frame_num = ef.m_frame_num;
 		m_export_num = ef.m_export_num;
+		m_pts = ef.m_pts;
 	}
 
 	// copy assignement operator
@@ -57,6 +62,7 @@ public:
 			m_fname = ef.m_fname;
 			m_frame_num = ef.m_frame_num;
 			m_export_num = ef.m_export_num;
+			m_pts = ef.m_pts;
 		}
 		return (*this);
 	}
@@ -65,8 +71,47 @@ public:
 	std::string		m_fname;
 	int32_t				m_frame_num;
 	int32_t				m_export_num;
+	int64_t				m_pts;					// microseconds, AV_NOPTS_VALUE if unknown
 };
 
+//------------------------------------------------------------------------------
+// one row of FFVideo::BenchmarkExportFormats() results:
+typedef struct _FFVIDEO_Export_Benchmark
+{
+	std::string						m_name;
+	FFVIDEO_Export_Format m_format;
+	bool									m_ok = false;				// false if the format failed, such as WebP without libwebp
+	double								m_ms_per_frame = 0.0;
+	double								m_fps = 0.0;
+	double								m_mb_per_sec = 0.0;	// of decoded pixels in, not bytes written
+	uint64_t							m_file_bytes = 0;		// average size on disk per frame
+} FFVIDEO_Export_Benchmark;
+
+//------------------------------------------------------------------------------
+// how exported frame files are named & placed, see FFVideo::SetFrameExportNaming(). The template
+// tokens expand to fixed widths so names sort in frame order:
+//
+//		{base}		the export basename
+//		{stream}	m_stream_id, 3 digits
+//		{run}			when the exporter started, an ISO 8601 UTC timestamp with microseconds
+//		{frame}		the estimated frame number, 9 digits
+//		{export}	the export count, 9 digits
+//		{pts}			presentation time in microseconds, 13 digits, or "none" if unknown
+//
+// Frame & export numbers restart, and pts may be missing or repeat, each time the stream is opened, so
+// a template needs {run} so a reconnect or a later session never overwrites an earlier one's files.
+// Raw pixel exports add "_[width]x[height]", then the format's extension is added. With m_files_per_dir
+// > 0 files go into subdirectories "[base]_s[stream]_r[run]_NNNNNN" of that many files each, NNNNNN
+// counting from 000000 each run. A manifest "[base]_s[stream]_manifest.csv" in the export directory
+// records the scheme and a row per written file, so downstream tools need not list directories to find frames:
+typedef struct _FFVIDEO_Export_Naming
+{
+	std::string m_template = "{base}_s{stream}_r{run}_e{export}_f{frame}_p{pts}";
+	int32_t			m_stream_id = 0;				// identifies the stream when several share an export directory
+	int32_t			m_files_per_dir = 10000;	// subdirectory shard size, 0 for a flat export directory
+	bool				m_manifest = true;
+} FFVIDEO_Export_Naming;
+
 class FFVideo_FrameDestination;
 
 // the "export frame callback" is called with every frame export
@@ -77,7 +122,8 @@ class FFVideo_FrameExporter
 {
 public:
 	FFVideo_FrameExporter() : mp_exportProcessingThread(NULL), m_stop_export_processing_loop(false), 
-		m_export_processing_loop_ended(false), mp_parent(NULL), mp_export_frame_cb(NULL), mp_export_frame_object(NULL) {};
+		m_export_processing_loop_ended(false), mp_parent(NULL), mp_export_frame_cb(NULL), mp_export_frame_object(NULL),
+		m_name_shard(-1), mp_manifest(NULL), m_manifest_unflushed(0) { m_run[0] = 0; };
 
 	// 2nd required for for thread constructor
 	FFVideo_FrameExporter(const FFVideo_FrameExporter& obj) {}
@@ -113,6 +159,8 @@ public:
 	{
 		if (!IsRunning())
 		{
+			m_name_shard = -1;	// so the first file's subdirectory is created
+			NewRun();
 			mp_exportProcessingThread = new std::thread(&FFVideo_FrameExporter::ExportProcessLoop, this);
 		}
 	}
@@ -142,23 +190,27 @@ public:
 	}
 
 	//////////////////////////////////////////////////////////////////////////////////////
-	void replaceAll(std::string& str, const std::string& from, const std::string& to)
-	{
-		if (from.empty())
-			return;
-		size_t start_pos = 0;
-		while ((start_pos = str.find(from, start_pos)) != std::string::npos) {
-			str.replace(start_pos, from.length(), to);
-			start_pos += to.length(); // In case 'to' contains 'from', like replacing 'x' with 'yx'
-		}
-	}
+	int32_t IsDirectory(const char* path);
 
 	//////////////////////////////////////////////////////////////////////////////////////
-	int32_t IsDirectory(const char* path);
+	// gens filename from the naming template & adds to queue; when archiving there is 
+	// no per frame filename, frames go into the archive's shards:
+	void Add(FFVideo_Image& im, int32_t frame_num, int32_t export_num, int64_t pts);
 
 	//////////////////////////////////////////////////////////////////////////////////////
-	// gens filename w/ ISO timecode including milliseconds for time called & adds to queue
-	void Add(FFVideo_Image& im, int32_t frame_num, int32_t export_num);
+	// expands a naming template into p_buf without allocating, false if the result does not fit:
+	static bool FormatName(char* p_buf, size_t buf_size, const char* p_template, const char* p_base, 
+												 int32_t stream_id, const char* p_run, int32_t frame_num, int32_t export_num, int64_t pts);
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// stamps m_run with the current time, as the exporter starts:
+	void NewRun(void);
+
+	//////////////////////////////////////////////////////////////////////////////////////
+	// the manifest is opened by the export thread, rows are appended as files complete:
+	bool OpenManifest(void);
+	void AppendManifest(int32_t frame_num, int32_t export_num, int64_t pts, const char* filepath);
+	void CloseManifest(void);
 
 	//////////////////////////////////////////////////////////////////////////////////////
 	size_t Size(void) {	
@@ -178,6 +230,20 @@ public:
 
 	mutable std::shared_mutex				m_queue_lock;
 	std::queue<FFVideo_ExportFrame>	m_exportQue;
+
+	FFVideo_FrameArchiveWriter			m_archive;			// only used by the export thread, when archiving
+	FFVideo_ExportWriter						m_writer;				// writes what the export thread encodes, when not archiving
+	FFVideo_Image										m_scaled;				// export thread's rescale target when the export scale < 1
+
+	char														m_name_buf[1024];	// Add()'s filename workspace
+	char														m_run[48];				// this run's {run}, set before the first Add()
+	int32_t													m_name_shard;			// subdirectory Add() last created
+	FILE*														mp_manifest;
+	int32_t													m_manifest_unflushed;
+	std::mutex											m_manifest_lock;	// rows arrive from the writer threads
+
+	// called by m_writer as each file completes, delivers the "export frame callback":
+	static void ExportWriteCallBack(void* p_object, FFVideo_ExportWrite& w, bool status);
 };
 
 
@@ -3,6 +3,7 @@
 /////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdarg.h>
+#include <algorithm>
 
 #include "ffvideo.h"
 
@@ -22,14 +23,26 @@ FFVideo_FrameDestination::FFVideo_FrameDestination(FFVideo_FrameMgr* parent)
 	m_frame_exporter.mp_parent = this;		// needed by frame export callback
 	m_frame_export_interval = 0;
 	m_frame_export_count = 0;
+	m_export_archive = false;
+	m_export_shard_bytes = (uint64_t)1024 * 1024 * 1024;
+	//
+	m_frame_encoder.mp_parent = this;			// needed by encode segment callback
+	m_frame_encode_interval = 0;
+	m_frame_encode_count = 0;
 
 	m_vflip = true;
 
 	// client callbacks:
 	mp_process_frame = NULL;
 	mp_process_frame_object = NULL;
+	mp_luma_frame = NULL;
+	mp_luma_frame_object = NULL;
+	m_luma_scale = 1.0f;
+	mp_luma_sws = NULL;
 
 	mp_frame_filter = new FFVIDEO_FrameFilter();
+	mp_frame_filter->mp_tracer = mp_parent->mp_tracer.get();
+	m_frame_encoder.mp_tracer = mp_parent->mp_tracer.get();
 
 	m_scrub_pos = -1;										// client position viewing the scrub buffer
 	m_scrub_index = -1;
@@ -48,7 +61,11 @@ FFVideo_FrameDestination::~FFVideo_FrameDestination()
 {
 	delete mp_frame_filter;
 
+	if (mp_luma_sws)
+		sws_freeContext(mp_luma_sws);
+
 	m_frame_exporter.StopExporter();
+	m_frame_encoder.StopEncoder();
 }
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -63,18 +80,34 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 	if (IsEmptyAVrame(src_frame))
 	{
 		// should not happen, but poorly encoded video happens
+		mp_parent->m_throughput.Drop(FFVIDEO_DROP::BAD_FRAME);
 		m_frame_count++;
 		return;
 	}
 
 	FFVideo* p_root = mp_parent->mp_parent;
 
+	// presentation time in microseconds, taken before filtering may replace the frame's timestamps:
+	int64_t pts = src_frame->best_effort_timestamp;
+	if (pts != AV_NOPTS_VALUE && p_root->mp_video_stream)
+		pts = av_rescale_q(pts, p_root->mp_video_stream->time_base, AV_TIME_BASE_Q);
+
+	// the luma plane is taken before filtering replaces the decoded frame with RGBA. It is
+	// delivered with the display frame, so shares its frame interval:
+	bool do_luma_callback = ((first_frame) || ((display_index % (uint32_t)m_frame_interval) == 0));
+	     do_luma_callback = (do_luma_callback && mp_luma_frame && ExtractLuma(src_frame));
+
 	// always apply frame filtering because this also compensates for partial frames and corrupt frames:
 	std::shared_lock<std::shared_mutex> rlock(p_root->m_post_process_lock);
+	FFVIDEO_STAGE_TIMER(stage_timer, mp_parent->mp_tracer.get());
 	int ret = mp_frame_filter->FilterFrame(p_root->mp_format_context, p_root->mp_video_stream, src_frame, p_root->m_post_process );
+	FFVIDEO_STAGE_LAP(stage_timer, mp_parent->m_pipeline_stats, FILTER, (int32_t)estimated_frame_number);
 	rlock.unlock();
 	if (ret < 0)
+	{
+		mp_parent->m_throughput.Drop(FFVIDEO_DROP::BAD_FRAME);
 		return;
+	}
 
 	// frame filtering can change our output resolution:
 	if (src_frame->width != im.m_width || src_frame->height != im.m_height)
@@ -92,10 +125,15 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 
 	bool do_frame_callback = ((first_frame) || ((display_index % (uint32_t)m_frame_interval) == 0));
 	     do_frame_callback = (do_frame_callback && mp_process_frame);
+	if (!do_frame_callback && mp_process_frame)
+		mp_parent->m_throughput.Drop(FFVIDEO_DROP::FRAME_INTERVAL);
   //
 	bool do_frame_export = ((m_frame_export_interval > 0) && ((first_frame) || ((display_index % (uint32_t)m_frame_export_interval) == 0)));
+  //
+	int32_t frame_encode_interval = m_frame_encode_interval; // because atomic
+	bool do_frame_encode = ((frame_encode_interval > 0) && ((first_frame) || ((display_index % (uint32_t)frame_encode_interval) == 0)));
 
-	if (do_frame_callback || do_frame_export || (mp_parent->m_stream_type == 0))
+	if (do_frame_callback || do_frame_export || do_frame_encode || (mp_parent->m_stream_type == 0))
 	{
 		// we're delivering this frame somewhere, so do the frame's prep:
 		// (if a media file, we want the scrub buffer to hold every frame, 
@@ -103,6 +141,8 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 
 		int32_t true_bytes_per_row = src_frame->width * 4; // each RGBA is 4 bytes
 
+		FFVIDEO_STAGE_RESTART(stage_timer);
+
 		// check if frame format conversion gave us pixels rows the wrong length:
 		if (src_frame->linesize[0] != true_bytes_per_row)
 		{
@@ -118,6 +158,7 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 			}
 			else
 			{
+				mp_parent->m_throughput.Drop(FFVIDEO_DROP::BAD_FRAME);
 				return; // rows given are too short, so we're going to abandon them. This case does not appear to occur.
 			}
 		}
@@ -127,10 +168,12 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 			std::size_t pixels_size = (std::size_t)src_frame->height * (std::size_t)src_frame->width * 4;
 			std::memcpy(im.mp_pixels, src_frame->data[0], pixels_size);
 		}
+		FFVIDEO_STAGE_LAP(stage_timer, mp_parent->m_pipeline_stats, RGBA_COPY, (int32_t)estimated_frame_number);
 
 		if (m_vflip) // library client can turn this bool false
 		{
 			im.MirrorVertical();
+			FFVIDEO_STAGE_LAP(stage_timer, mp_parent->m_pipeline_stats, MIRROR, (int32_t)estimated_frame_number);
 		}
 
 		// only media files have scrub buffer when paused support:
@@ -144,8 +187,10 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 				// we've overflowed
 				index = index % m_scrub_max_size;
 			}
+			FFVIDEO_STAGE_RESTART(stage_timer);
 			m_scrub_frames[index].m_im.Clone(im);
 			m_scrub_frames[index].m_frame_num = estimated_frame_number;
+			FFVIDEO_STAGE_LAP(stage_timer, mp_parent->m_pipeline_stats, SCRUB_CLONE, (int32_t)estimated_frame_number);
 
 			// we've been asked to deliver a frame to the client. However, we might be backwards in time due to frame scrubbing.
 			// if we're back in time, deliver the back in time frames before delivering the frame we were asked to deliver:
@@ -169,14 +214,23 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 
 
 	// if the frame goes anywhere, lock:
-	if (do_frame_callback || do_frame_export)
+	if (do_frame_callback || do_frame_export || do_frame_encode || do_luma_callback)
 	{
 		std::shared_lock<std::shared_mutex> frlock(mp_parent->m_cb_lock);
 
+		// the luma plane precedes its frame, so the client can pair them by frame number:
+		if (do_luma_callback && mp_luma_frame)
+		{
+			(mp_luma_frame)(mp_luma_frame_object, m_luma, estimated_frame_number);
+		}
+
 		// if the frame is being delivered to the client's frame callback:
 		if (do_frame_callback)
 		{
+			FFVIDEO_STAGE_RESTART(stage_timer);
 			(mp_process_frame)(mp_process_frame_object, im, estimated_frame_number);
+			FFVIDEO_STAGE_LAP(stage_timer, mp_parent->m_pipeline_stats, CLIENT_CALLBACK, (int32_t)estimated_frame_number);
+			mp_parent->m_throughput.Count(FFVIDEO_RATE::DELIVERED);
 		}
 
 		// if the frame is being exported:
@@ -184,7 +238,16 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 		{
 			m_frame_export_count++;
 
-			m_frame_exporter.Add(im, estimated_frame_number, m_frame_export_count);
+			m_frame_exporter.Add(im, estimated_frame_number, m_frame_export_count, pts);
+		}
+
+		// if the frame is being encoded:
+		if (do_frame_encode)
+		{
+			m_frame_encode_count++;
+
+			if (!m_frame_encoder.Add(im, estimated_frame_number, m_vflip))
+				mp_parent->m_throughput.Drop(FFVIDEO_DROP::ENCODE_BEHIND);
 		}
 
 		frlock.unlock();
@@ -193,12 +256,91 @@ void FFVideo_FrameDestination::DeliverFrameToClient(
 	m_frame_count++;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+// Decoded YUV frames hold the luma plane as 8 bit rows, copied or resized here without any colour 
+// conversion. Other decoded formats, packed YUV or RGB, are converted to gray by swscale. 
+// Oriented as the display frames are, so bottom origin unless vflip is off:
+bool FFVideo_FrameDestination::ExtractLuma(AVFrame* frame)
+{
+	if (frame->width < 1 || frame->height < 1 || !frame->data[0])
+		return false;
+
+	float scale = m_luma_scale;
+	uint32_t width  = (uint32_t)std::max(1.0f, (float)frame->width * scale + 0.5f);
+	uint32_t height = (uint32_t)std::max(1.0f, (float)frame->height * scale + 0.5f);
+
+	if (m_luma.m_width != width || m_luma.m_height != height || m_luma.m_type != 2 || !m_luma.mp_pixels)
+	{
+		if (!m_luma.Reallocate(height, width, 2))
+			return false;
+	}
+
+	const AVPixFmtDescriptor* p_desc = av_pix_fmt_desc_get((AVPixelFormat)frame->format);
+	if (!p_desc)
+		return false;
+
+	bool luma_plane = ((p_desc->flags & (AV_PIX_FMT_FLAG_RGB | AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL)) == 0) &&
+										(p_desc->comp[0].plane == 0) && (p_desc->comp[0].step == 1) && 
+										(p_desc->comp[0].offset == 0) && (p_desc->comp[0].depth == 8) && (frame->linesize[0] > 0);
+
+	if (luma_plane)
+	{
+		if (width == (uint32_t)frame->width && height == (uint32_t)frame->height)
+		{
+			for (uint32_t y = 0; y < height; y++)
+			{
+				uint32_t dst_y = (m_vflip) ? height - 1 - y : y;
+				std::memcpy(&m_luma.mp_pixels[dst_y * width], &frame->data[0][y * frame->linesize[0]], width);
+			}
+			return true;
+		}
+
+		if (!FFVideo_Resizer::Resize(frame->data[0], frame->width, frame->height, frame->linesize[0], 
+																 m_luma.mp_pixels, width, height, width, 1))
+			return false;
+
+		if (m_vflip)
+			m_luma.MirrorVertical();
+
+		return true;
+	}
+
+	mp_luma_sws = sws_getCachedContext(mp_luma_sws, frame->width, frame->height, (AVPixelFormat)frame->format,
+																		 width, height, AV_PIX_FMT_GRAY8, SWS_BILINEAR, NULL, NULL, NULL);
+	if (!mp_luma_sws)
+	{
+		av_log(NULL, AV_LOG_ERROR, "ExtractLuma: no conversion from %s to gray\n", p_desc->name);
+		return false;
+	}
+
+	// a negative stride from the last row writes bottom origin:
+	uint8_t* p_dst[4]     = { (m_vflip) ? &m_luma.mp_pixels[(height - 1) * width] : m_luma.mp_pixels, NULL, NULL, NULL };
+	int      dst_stride[4] = { (m_vflip) ? -(int)width : (int)width, 0, 0, 0 };
+	//
+	sws_scale(mp_luma_sws, frame->data, frame->linesize, 0, frame->height, p_dst, dst_stride);
+
+	return true;
+}
+
 void FFVideo_FrameExporter::ExportProcessLoop(void)
 {
 	uint64_t milliseconds = 1000 / 120; // the demoninator is how many times per second we will loop
 
 	uint64_t nanosleep_param = milliseconds * 10; // each ms is 10 nanosleep units
 
+	std::vector<uint8_t> encode_bytes;	// encode buffer, when archiving reused, otherwise swapped with the writer's recycled buffers
+
+	FFVideo_Tracer::NameThread("frame export");
+
+	FFVideo_Tracer* p_tracer = mp_parent->mp_parent->mp_tracer.get();
+
+	m_writer.ResetStats();
+	m_writer.mp_tracer = p_tracer;
+	m_writer.Start(mp_parent->m_export_writer_params, ExportWriteCallBack, this);
+
+	if (!mp_parent->m_export_archive && mp_parent->m_export_naming.m_manifest)
+		OpenManifest();
+
 	while (true)
 	{
 		if (m_stop_export_processing_loop)
@@ -211,7 +353,7 @@ void FFVideo_FrameExporter::ExportProcessLoop(void)
 			bool work_to_do = !m_exportQue.empty();
 			rlock.unlock();
 
-			while (work_to_do)
+			while (work_to_do && !m_stop_export_processing_loop)
 			{
 				std::unique_lock<std::shared_mutex> lock(m_queue_lock);
 				FFVideo_ExportFrame ef = m_exportQue.front();
@@ -221,22 +363,70 @@ void FFVideo_FrameExporter::ExportProcessLoop(void)
 
 				float	  scale_factor = mp_parent->m_export_scale;
 				int32_t quality = mp_parent->m_export_quality;
+				FFVIDEO_Export_Format& format = mp_parent->m_export_format;
 				bool	  save_success = true;
 
-				// we do not scale up in this app, so anything above this is treated as 1.0f
-				if (scale_factor >= 0.9999f)
-				{
-					save_success = ef.m_im.SaveJpgTurbo(ef.m_fname.c_str(), quality);
-				}
-				else
+				auto encode_start = std::chrono::steady_clock::now();
+
+				// we do not scale up in this app, so anything above this is treated as 1.0f;
+				// frames are scaled into m_scaled, whose pixels are reused frame to frame:
+				FFVideo_Image* p_im = &ef.m_im;
+				if (scale_factor < 0.9999f)
 				{
 					int32_t       rescaled_width  = (int32_t)((float)ef.m_im.m_width * scale_factor + 0.5f);
 					int32_t				rescaled_height = (int32_t)((float)ef.m_im.m_height * scale_factor + 0.5f);
 
-					ef.m_im.Rescale( rescaled_height, rescaled_width );
-					ef.m_im.SaveJpgTurbo(ef.m_fname.c_str(), quality);
+					if (ef.m_im.RescaleTo( m_scaled, rescaled_height, rescaled_width ))
+						p_im = &m_scaled;
 				}
 
+				if (mp_parent->m_export_archive)
+				{
+					// encode into memory & append to the archive, opening it with the first frame:
+					save_success = p_im->Encode(encode_bytes, format, quality, mp_parent->m_vflip);
+					m_writer.m_encode_hist.Add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+																			std::chrono::steady_clock::now() - encode_start).count());
+					p_tracer->Complete("export", "export encode", FFVideo_Tracer::Microseconds(encode_start), FFVideo_Tracer::Now(), ef.m_frame_num);
+					if (save_success && !m_archive.IsOpen())
+						save_success = m_archive.Open(mp_parent->m_export_dir, mp_parent->m_export_base, 
+																					format, mp_parent->m_export_shard_bytes);
+					if (save_success)
+					{
+						FFVIDEO_STAGE_TIMER(write_timer, p_tracer);
+						save_success = m_archive.Append(encode_bytes, ef.m_frame_num, ef.m_pts, p_im->m_width, p_im->m_height);
+						FFVIDEO_STAGE_LAP(write_timer, mp_parent->mp_parent->m_pipeline_stats, EXPORT_WRITE, ef.m_frame_num);
+					}
+
+					ef.m_fname = m_archive.ShardPath();
+				}
+				else if (format.m_mmap && (format.m_format == 1 || format.m_format == 2))
+				{
+					// memory mapped formats write as they convert, there is no encoded buffer to hand off,
+					// so their time is all counted as writing:
+					FFVIDEO_STAGE_TIMER(write_timer, p_tracer);
+					save_success = p_im->Save(ef.m_fname.c_str(), format, quality, mp_parent->m_vflip);
+					FFVIDEO_STAGE_LAP(write_timer, mp_parent->mp_parent->m_pipeline_stats, EXPORT_WRITE, ef.m_frame_num);
+					if (save_success)
+						AppendManifest(ef.m_frame_num, ef.m_export_num, ef.m_pts, ef.m_fname.c_str());
+				}
+				else
+				{
+					// encode here, the writer threads do the I/O & deliver the export callback:
+					save_success = p_im->Encode(encode_bytes, format, quality, mp_parent->m_vflip);
+					m_writer.m_encode_hist.Add((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+																			std::chrono::steady_clock::now() - encode_start).count());
+					p_tracer->Complete("export", "export encode", FFVideo_Tracer::Microseconds(encode_start), FFVideo_Tracer::Now(), ef.m_frame_num);
+					if (save_success)
+					{
+						m_writer.Submit(ef.m_fname, encode_bytes, ef.m_frame_num, ef.m_export_num, ef.m_pts);
+						continue;
+					}
+				}
+
+				if (save_success)
+					mp_parent->mp_parent->m_throughput.Count(FFVIDEO_RATE::EXPORTED);
+				else mp_parent->mp_parent->m_throughput.Drop(FFVIDEO_DROP::EXPORT_FAILED);
+
 				if (mp_export_frame_cb)
 				{
 				  // at this point "save_success" tell if more saving will continue...
@@ -260,12 +450,51 @@ void FFVideo_FrameExporter::ExportProcessLoop(void)
 				}
 			}
 		}
-		nanosleep(nanosleep_param);
+		FFVideo_Sleep100ns(nanosleep_param);
 	}
 
+	// completes the writes already submitted:
+	m_writer.Stop();
+
+	CloseManifest();
+
+	m_archive.Close();
+
   m_export_processing_loop_ended = true;
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameExporter::ExportWriteCallBack(void* p_object, FFVideo_ExportWrite& w, bool status)
+{
+	FFVideo_FrameExporter* p_exporter = (FFVideo_FrameExporter*)p_object;
+
+	if (status)
+	{
+		p_exporter->AppendManifest(w.m_frame_num, w.m_export_num, w.m_pts, w.m_fname.c_str());
+		p_exporter->mp_parent->mp_parent->m_throughput.Count(FFVIDEO_RATE::EXPORTED);
+	}
+	else p_exporter->mp_parent->mp_parent->m_throughput.Drop(FFVIDEO_DROP::EXPORT_FAILED);
+
+	if (p_exporter->mp_export_frame_cb)
+	{
+		// the same "status" as synchronous exports: false if this is the last expected export
+		bool more_status( status );
+		if (status && p_exporter->Size() == 0 && p_exporter->m_writer.InFlight() <= 1)
+		{
+			if (p_exporter->mp_parent->mp_parent->m_drain_complete)
+				more_status = false;
+		}
+
+		(p_exporter->mp_export_frame_cb)(p_exporter->mp_export_frame_object, w.m_frame_num, w.m_export_num, w.m_fname.c_str(), more_status);
+	}
+
+	if (!status)
+	{
+		p_exporter->mp_parent->m_frame_export_interval = -1;	// disable, -1 signals disabled in error
+		p_exporter->m_stop_export_processing_loop = true;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 // Constructor for class that delivers the video frames to the library client. 
 // Whereas FFVideo handles the reading of media stream packets, this class 
@@ -274,7 +503,7 @@ void FFVideo_FrameExporter::ExportProcessLoop(void)
 FFVideo_FrameMgr::FFVideo_FrameMgr(FFVideo* parent)
 {
 	mp_parent = parent;
-	m_stream_type = 0;			// 0=Media, 1=USB, 2=IP
+	m_stream_type = 0;			// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	m_is_playing = false;
 	m_paused = false;
 	m_drain_mode = false;
@@ -321,6 +550,8 @@ FFVideo_FrameMgr::FFVideo_FrameMgr(FFVideo* parent)
 	mp_stream_logging_callback = NULL;
 	mp_stream_logging_object = NULL;
 
+	mp_tracer = std::make_shared<FFVideo_Tracer>();
+
 	mp_frame_dest = new FFVideo_FrameDestination(this);
 }
 
@@ -356,6 +587,7 @@ void FFVideo_FrameMgr::HandleSeekRequests(void)
 	int64_t seek_max = m_seek_rel < 0 ? seek_target - m_seek_rel - 2 : INT64_MAX;
 	// FIXME the +-2 is due to rounding being not done in the correct direction in generation of the seek_pos/seek_rel variables
 
+	FFVideo_TraceScope trace(mp_tracer.get(), "seek", "seek", -1, "target", seek_target);
 
 	int nh(0), nm(0), ns(0);
 	double now_posd = m_est_play_pos;		// seconds
@@ -456,7 +688,10 @@ void FFVideo_FrameMgr::ProcessPacketToFrame(uint32_t& last_display_index,
 	mp_parent->m_display_index++;
 
 	if (IsPlaybackPaused() && (m_stream_type != 0)) // can only be a live stream, this is after frame has been consumed
+	{
+		m_throughput.Drop(FFVIDEO_DROP::PAUSED_LIVE);
 		return; // live streams advance their frame when paused
+	}
 
 	// it is possible for client to stop playback and delete our structs out from under us:
 	decompressed_frame = mp_parent->mp_decompressed_frame[decompress_index];
@@ -563,7 +798,7 @@ bool FFVideo_FrameMgr::SetFrameExporting(
 		}
 		
 		mp_frame_dest->m_frame_export_interval = export_interval;
-		mp_frame_dest->m_export_dir = export_dir + std::string("\\");
+		mp_frame_dest->m_export_dir = export_dir + std::string(FFVIDEO_PATH_SEPARATOR);
 		mp_frame_dest->m_export_base = export_base;
 		mp_frame_dest->m_export_scale = scale;
 		mp_frame_dest->m_export_quality = quality;
@@ -576,4 +811,123 @@ bool FFVideo_FrameMgr::SetFrameExporting(
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameMgr::SetFrameExportFormat( FFVIDEO_Export_Format& format )
+{
+	// must be set before playback has begun: 
+	if (HasPlaybackStarted())
+		return false;
+
+	if (format.m_format < 0 || format.m_format > 4)
+		return false;
+
+	if (format.m_channels != 1 && format.m_channels != 3)
+		return false;
+
+	mp_frame_dest->m_export_format = format;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameMgr::SetFrameExportArchive( bool archive, int32_t shard_mb )
+{
+	// must be set before playback has begun: 
+	if (HasPlaybackStarted())
+		return false;
+
+	if (archive && shard_mb < 1)
+		return false;
+
+	mp_frame_dest->m_export_archive = archive;
+	if (archive)
+		mp_frame_dest->m_export_shard_bytes = (uint64_t)shard_mb * 1024 * 1024;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameMgr::SetFrameExportWriters( FFVIDEO_Export_Writer_Params& params )
+{
+	// must be set before playback has begun: 
+	if (HasPlaybackStarted())
+		return false;
+
+	if (params.m_threads < 0 || params.m_threads > 64 || params.m_max_in_flight < 1 || params.m_sync_batch < 1)
+		return false;
+
+	mp_frame_dest->m_export_writer_params = params;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameMgr::SetFrameExportNaming( FFVIDEO_Export_Naming& naming )
+{
+	// must be set before playback has begun: 
+	if (HasPlaybackStarted())
+		return false;
+
+	// names must differ per frame, so the template needs a frame number or the export count, and
+	// both restart each time the stream opens, so it needs the run too:
+	if (naming.m_template.find("{frame}") == std::string::npos && naming.m_template.find("{export}") == std::string::npos)
+		return false;
+	if (naming.m_template.find("{run}") == std::string::npos)
+		return false;
+
+	if (naming.m_template.find_first_of("\\/:") != std::string::npos)
+		return false;
+
+	if (naming.m_stream_id < 0 || naming.m_stream_id > 999 || naming.m_files_per_dir < 0)
+		return false;
+
+	mp_frame_dest->m_export_naming = naming;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameMgr::SetFrameEncoding(
+		int32_t encode_interval, FFVIDEO_Encode_Params& params,
+		ENCODE_SEGMENT_CALLBACK_CB encode_segment_cb, void* encode_segment_object )
+{
+	// must be set before playback has begun: 
+	if (HasPlaybackStarted())
+		return false;
+
+	if (encode_interval > 0)
+	{
+		// we are enabling frame encoding. Examine the directory and outputs first:
+
+		// bad directory, or nothing to write?
+		if (params.m_encode_dir.size() < 1 || (!params.m_mp4 && !params.m_elementary))
+		{
+			mp_frame_dest->m_frame_encode_interval = 0; // disable
+			return false;
+		}
+
+		// get the directory inside a boost::filesystem::path
+		boost::filesystem::path dir(params.m_encode_dir);
+
+		// encode directory must already exist:
+		if (!boost::filesystem::is_directory(dir))
+		{
+			mp_frame_dest->m_frame_encode_interval = 0; // disable
+			return false;
+		}
+
+		mp_frame_dest->m_frame_encode_interval = encode_interval;
+		mp_frame_dest->m_encode_params = params;
+		mp_frame_dest->m_encode_params.m_encode_dir = params.m_encode_dir + std::string(FFVIDEO_PATH_SEPARATOR);
+		mp_frame_dest->m_frame_encoder.mp_encode_segment_cb = encode_segment_cb;
+		mp_frame_dest->m_frame_encoder.mp_encode_segment_object = encode_segment_object;
+	}
+	else // we are disabling frame encoding
+	{
+		mp_frame_dest->m_frame_encode_interval = 0;
+	}
+
+	return true;
+}
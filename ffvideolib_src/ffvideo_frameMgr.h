@@ -12,6 +12,7 @@
 #include <shared_mutex>
 #include <chrono>
 #include <functional>
+#include <memory>
 
 
 extern "C" {
@@ -26,12 +27,22 @@ extern "C" {
 #include "libavfilter/buffersink.h"
 #include "libavfilter/buffersrc.h"
 #include "libavutil/avstring.h"
+#include "libavutil/pixdesc.h"
 }
+#ifdef _MSC_VER
 #pragma comment(lib, "libavformat.a")
+#endif
 
 #include "BCTime.h"
 #include "ffvideo_image.h"
+#include "ffvideo_resize.h"
 #include "ffvideo_frameExporter.h"
+#include "ffvideo_frameEncoder.h"
+#include "ffvideo_pipelineStats.h"
+#include "ffvideo_throughput.h"
+#include "ffvideo_packetReplay.h"
+#include "ffvideo_trace.h"
+#include "ffvideo_platform.h"
 
 class FFVideo_FrameMgr;
 class FFVideo;
@@ -47,8 +58,6 @@ class FFVideo;
 #endif // defined(_MSC_VER) && _MSC_VER < 1900
 #endif // WIN32
 
-BOOLEAN nanosleep(LONGLONG ns);	// utility that sleeps in 100ns units
-
 //------------------------------------------------------------------------------
 // this describes one pixel format of a USB camera, where a specific USB cammera
 // has a std::vector of these describing the formats available to that camera.
@@ -63,6 +72,24 @@ typedef struct _FFVIDEO_USB_Camera_Format
 	float				m_max_fps;
 } FFVIDEO_USB_Camera_Format;
 
+//------------------------------------------------------------------------------
+// a generated stream, see FFVideo::OpenSyntheticSource(). m_source is one of libavfilter's video sources,
+// such as testsrc2, mandelbrot, smptehdbars, color or life, optionally with its own options, such as 
+// "mandelbrot=maxiter=256"; the size & rate are appended to them:
+typedef struct _FFVIDEO_Synthetic_Source
+{
+	std::string m_source = "testsrc2";
+	int32_t			m_width = 1920;
+	int32_t			m_height = 1080;
+	double			m_fps = 30.0;
+	std::string m_pixel_format = "yuv420p";	// as FFmpeg names them: yuv420p, nv12, rgb24, gray...
+	bool				m_frame_counter = false;		// draws each frame's number, needs an FFmpeg built with libfreetype
+	std::string m_font_file;									// the frame counter's font, else fontconfig's default font
+	int64_t			m_frames = 0;								// the stream ends after this many frames, 0 never ends
+	bool				m_paced = true;							// frames are generated at m_fps as a camera delivers them, 
+																					// else as fast as a media file plays
+} FFVIDEO_Synthetic_Source;
+
 //------------------------------------------------------------------------------
 // define the possible directions one can step a paused media file:
 enum class FFVIDEO_FRAMESTEP_DIRECTION
@@ -117,6 +144,7 @@ private:
 		mp_buffersrc_ctx  = NULL;
 		mp_buffersink_ctx = NULL;
 		mp_filter_graph   = NULL;
+		mp_tracer         = NULL;
 
 		// these "last" members track the active w, h & pixel format,
 		// in case they change dynamically during stream playback:
@@ -136,6 +164,9 @@ private:
 	int Init( AVFormatContext* p_format_context, AVStream* p_video_stream, 
 						AVFrame* p_video_frame, std::string& post_process )
 	{
+		// rebuilds stall delivery, so each is a span when tracing:
+		FFVideo_TraceScope trace( mp_tracer, "filter", "filter graph rebuild", -1, "width", p_video_frame->width );
+
 		// we'll be recreating the filter graph, so if one exists, delete it: 
 		if (mp_filter_graph)
 			avfilter_graph_free(&mp_filter_graph);
@@ -342,6 +373,7 @@ private:
 	AVFilterGraph*     mp_filter_graph;
 	int                m_last_width, m_last_height, m_last_format;
 	std::string				 m_last_post_process;
+	FFVideo_Tracer*		 mp_tracer;					// set by the frame destination
 };
 
 
@@ -355,6 +387,7 @@ private:
 class FFVideo_FrameDestination
 {
 	friend class FFVideo_FrameExporter;
+	friend class FFVideo_FrameEncoder;
 	friend class FFVIDEO_FrameFilter;
 	friend class FFVideo_FrameMgr;
 	friend class FFVideo;
@@ -376,7 +409,17 @@ private:
 	std::string									m_export_dir;										// export directory
 	std::string									m_export_base;									// basename before timestamp
 	float												m_export_scale;									// image scale factor, defaults to 1.0f
-	int32_t											m_export_quality;								// jpg quality setting when saved
+	int32_t											m_export_quality;								// jpg & lossy webp quality setting when saved
+	FFVIDEO_Export_Format				m_export_format;								// file format frames are exported in, defaults to jpg
+	bool												m_export_archive;								// if true, frames append into archive shards, not one file each
+	uint64_t										m_export_shard_bytes;						// archive shard size, defaults to 1 GB
+	FFVIDEO_Export_Writer_Params	m_export_writer_params;				// writer threads, in-flight limit & batched flushing
+	FFVIDEO_Export_Naming				m_export_naming;								// filename template, stream id & subdirectory sharding
+
+	int32_t											m_frame_encode_count;
+	FFVideo_FrameEncoder				m_frame_encoder;								// in-process encoder sink, no intermediate files
+	std::atomic<int32_t>				m_frame_encode_interval;				// independant of frame interval, how often to encode the frame?
+	FFVIDEO_Encode_Params				m_encode_params;								// segment length, resolution, codec & so on
 
 	// we normally vertically flip all video frames because images are bottom origin; 
 	// our constructor sets this to true, but if set to false, that flipping won't happen: 
@@ -388,6 +431,18 @@ private:
 	DISPLAY_FRAME_CALLBACK_CB		mp_process_frame;
 	void*												mp_process_frame_object;
 
+	// the "luma frame callback" receives the decoded frame's Y plane, just before the display callback of that frame:
+	typedef void(*LUMA_FRAME_CALLBACK_CB)(void* p_object, FFVideo_Image& luma, int32_t frame_num);
+	//
+	LUMA_FRAME_CALLBACK_CB			mp_luma_frame;
+	void*												mp_luma_frame_object;
+	std::atomic<float>					m_luma_scale;			// of the decoded frame size, 1.0f is native
+	FFVideo_Image								m_luma;						// gray, type 2, reused frame to frame
+	SwsContext*									mp_luma_sws;			// for decoded formats without an 8 bit luma plane
+
+	// fills m_luma from the decoded frame, before filtering converts it to RGBA:
+	bool ExtractLuma(AVFrame* frame);
+
 	FFVIDEO_FrameFilter*				mp_frame_filter;
 
 	bool IsEmptyAVrame(AVFrame* frame) { return ((frame->format == AV_PIX_FMT_NONE) || (frame->pict_type == AV_PICTURE_TYPE_NONE)); }
@@ -412,7 +467,7 @@ private:
 	~FFVideo_FrameMgr();
 
 	FFVideo*									mp_parent;
-	std::atomic<int32_t>			m_stream_type;					// 0=Media, 1=USB, 2=IP
+	std::atomic<int32_t>			m_stream_type;					// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	std::atomic<bool>					m_is_playing;						// if true, packet streaming has begun
 	std::atomic<bool>					m_paused;								// if true, m_is_playing must also be true for playback to be paused
 	std::atomic<bool>					m_drain_mode;						// when stream ends, frames need to drain out of pipeline before really over
@@ -446,13 +501,17 @@ private:
 
 	mutable std::shared_mutex m_cb_lock;
 
+	FFVideo_PipelineStats			m_pipeline_stats;				// per stage latencies, see FFVideo::GetPipelineStats()
+	FFVideo_Throughput				m_throughput;						// rolling rates & drops, see FFVideo::GetThroughputStats()
+	std::shared_ptr<FFVideo_Tracer>	mp_tracer;				// off until FFVideo::EnableTracing(), shared with clients by FFVideo::GetTracer()
+
 	FFVideo_FrameDestination*	mp_frame_dest;					// frame callbacks wrapper for destination delivery
 	FFVideo_Image							m_im;		
 
 	// this is how frame exporting is enabled, specify an interval < 1 to disable.
 	// The export directory must exist, or failure and disabling of exports. 
 	// Frames are exported as jpg files using the quality passed as the jpg compression. 
-	// The filename is the export dir + export_base + an ISO 8601 timestamp, with milliseconds. 
+	// The filename is the export dir + a name from the export naming template. 
 	// Failing to write fails silently, incrementing a failed export counter. 
 	bool SetFrameExporting(int32_t export_interval, 
 												 std::string& export_dir, 
@@ -462,6 +521,31 @@ private:
 												 EXPORT_FRAME_CALLBACK_CB frame_export_cb,
 												 void* frame_export_object );
 
+	// the file format of frame exports, see FFVIDEO_Export_Format; defaults to jpg.
+	// Also must be set before playback, fails with an unknown format or channel count. 
+	bool SetFrameExportFormat(FFVIDEO_Export_Format& format);
+
+	// exported frames append into sharded archive files with an index, rather than one file per frame. 
+	// Also must be set before playback. See ffvideo_frameArchive.h for the archive layout. 
+	bool SetFrameExportArchive(bool archive, int32_t shard_mb);
+
+	// how many threads write exported files, how many encoded frames may wait on them, and whether
+	// written files are flushed to the device in batches. Also must be set before playback. 
+	bool SetFrameExportWriters(FFVIDEO_Export_Writer_Params& params);
+
+	// the filename template, stream id & subdirectory shard size of exported files, see FFVIDEO_Export_Naming.
+	// Also must be set before playback, fails if names would not differ per frame or hold a path separator. 
+	bool SetFrameExportNaming(FFVIDEO_Export_Naming& naming);
+
+	// this is how in-process encoding is enabled, specify an encode_interval < 1 to disable.
+	// The encode directory must exist, or failure and disabling of encoding. Frames are encoded
+	// into .mp4 and/or elementary stream segments, see FFVIDEO_Encode_Params. 
+	// Failing to encode or write disables encoding, signaled by an encode interval of -1. 
+	bool SetFrameEncoding(int32_t encode_interval, 
+												FFVIDEO_Encode_Params& params,
+												ENCODE_SEGMENT_CALLBACK_CB encode_segment_cb,
+												void* encode_segment_object );
+
 	void SetScrubBufferSize(int32_t size) { mp_frame_dest->SetScrubBufferSize(size); }
 
 	// the interrupt_callback() function is a function callback registered with ffmpeg; 
@@ -535,6 +619,8 @@ private:
 		m_frames_received = 0;
 		m_fps_frames_received = 0;
 		m_fps = 0.0f;
+		m_pipeline_stats.Reset();
+		m_throughput.Reset();
 		//
 		m_is_playing = false;
 		m_paused = false;
@@ -557,6 +643,9 @@ private:
 		mp_frame_dest->m_frame_export_count = 0;
 		if (mp_frame_dest->m_frame_export_interval < 0)
 			mp_frame_dest->m_frame_export_interval = 0; // erase error state
+		mp_frame_dest->m_frame_encode_count = 0;
+		if (mp_frame_dest->m_frame_encode_interval < 0)
+			mp_frame_dest->m_frame_encode_interval = 0; // erase error state
 	}
 
 	void PausePlayback( void )
@@ -0,0 +1,140 @@
+#pragma once
+#ifndef _FFVIDEO_HISTOGRAM_H_
+#define _FFVIDEO_HISTOGRAM_H_
+
+
+#include <atomic>
+#include <cstdint>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+//------------------------------------------------------------------------------
+// a latency histogram of log-linear microsecond buckets, as HdrHistogram does with 2 bits of
+// precision: 0-3us have a bucket each, then each power of 2 is split into 4 equal buckets, so 
+// a bucket's bounds are within 25% of any value counted in it. The last bucket, from about 
+// 2 hours, also counts anything larger:
+typedef struct _FFVIDEO_Histogram
+{
+	static const int32_t	m_sub_buckets = 4;
+	static const int32_t	m_num_buckets = 128;
+
+	static int32_t Bucket(uint64_t us)
+	{
+		if (us < (uint64_t)m_sub_buckets)
+			return (int32_t)us;
+
+		int32_t msb;
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse64(&index, us);
+		msb = (int32_t)index;
+#else
+		msb = 63 - __builtin_clzll(us);
+#endif
+		int32_t bucket = m_sub_buckets + (msb - 2) * m_sub_buckets + (int32_t)((us >> (msb - 2)) & (m_sub_buckets - 1));
+		return (bucket < m_num_buckets) ? bucket : m_num_buckets - 1;
+	}
+
+	// the largest value counted by a bucket:
+	static uint64_t BucketMax(int32_t bucket)
+	{
+		if (bucket < m_sub_buckets)
+			return (uint64_t)bucket;
+
+		int32_t shift = (bucket - m_sub_buckets) / m_sub_buckets;
+		uint64_t sub = (uint64_t)((bucket - m_sub_buckets) % m_sub_buckets);
+		return ((m_sub_buckets + sub + 1) << shift) - 1;
+	}
+
+	uint64_t	m_buckets[m_num_buckets] = {};
+	uint64_t	m_count = 0;
+	uint64_t	m_total_us = 0;
+	uint64_t	m_max_us = 0;
+
+	double Mean(void) const { return (m_count) ? (double)m_total_us / (double)m_count : 0.0; }
+
+	// returns the upper bound, in microseconds, of the bucket holding the p'th percentile (0.0 to 1.0),
+	// never more than the largest value added:
+	uint64_t Percentile(double p) const
+	{
+		if (m_count == 0)
+			return 0;
+		uint64_t target = (uint64_t)(p * (double)m_count + 0.5);
+		if (target < 1)
+			target = 1;
+		uint64_t seen = 0;
+		for (int32_t i = 0; i < m_num_buckets; i++)
+		{
+			seen += m_buckets[i];
+			if (seen >= target)
+				return (BucketMax(i) < m_max_us) ? BucketMax(i) : m_max_us;
+		}
+		return m_max_us;
+	}
+
+	// adds another histogram's counts into this one:
+	void Merge(const _FFVIDEO_Histogram& other)
+	{
+		for (int32_t i = 0; i < m_num_buckets; i++)
+			m_buckets[i] += other.m_buckets[i];
+		m_count += other.m_count;
+		m_total_us += other.m_total_us;
+		if (other.m_max_us > m_max_us)
+			m_max_us = other.m_max_us;
+	}
+} FFVIDEO_Histogram;
+
+//------------------------------------------------------------------------------
+// the thread safe side of FFVIDEO_Histogram, Add() may be called from any thread:
+class FFVideo_Histogram
+{
+public:
+	FFVideo_Histogram() { Reset(); }
+
+	// 2nd required for for thread constructor
+	FFVideo_Histogram(const FFVideo_Histogram& obj) { Reset(); }
+
+	void Add(uint64_t us)
+	{
+		int32_t bucket = FFVIDEO_Histogram::Bucket(us);
+
+		m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+		m_count.fetch_add(1, std::memory_order_relaxed);
+		m_total_us.fetch_add(us, std::memory_order_relaxed);
+
+		uint64_t prev_max = m_max_us.load(std::memory_order_relaxed);
+		while (us > prev_max && !m_max_us.compare_exchange_weak(prev_max, us, std::memory_order_relaxed))
+			;
+	}
+
+	void Reset(void)
+	{
+		for (int32_t i = 0; i < FFVIDEO_Histogram::m_num_buckets; i++)
+			m_buckets[i] = 0;
+		m_count = 0;
+		m_total_us = 0;
+		m_max_us = 0;
+	}
+
+	// a copy for reading, not an atomic snapshot; values may be mid-update relative to each other:
+	void Snapshot(FFVIDEO_Histogram& hist) const
+	{
+		for (int32_t i = 0; i < FFVIDEO_Histogram::m_num_buckets; i++)
+			hist.m_buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		hist.m_count = m_count.load(std::memory_order_relaxed);
+		hist.m_total_us = m_total_us.load(std::memory_order_relaxed);
+		hist.m_max_us = m_max_us.load(std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<uint64_t>	m_buckets[FFVIDEO_Histogram::m_num_buckets];
+	std::atomic<uint64_t>	m_count;
+	std::atomic<uint64_t>	m_total_us;
+	std::atomic<uint64_t>	m_max_us;
+};
+
+
+
+#endif // _FFVIDEO_HISTOGRAM_H_
@@ -22,7 +22,9 @@ using namespace dlib;
 #include "stb_image_resize.h"
 
 
+#ifdef _MSC_VER
 #include <excpt.h>
+#endif
 
 // used when writing out jpegs:
 typedef struct
@@ -259,6 +261,7 @@ bool ReadJPEG(const char* pszInfile, uint8_t** ppOutImage, uint32_t& nOutRows, u
 		nCurRow--;
 	}
 
+#ifdef _MSC_VER
 	__try
 	{
 		jpeg_finish_decompress(&cinfo);        // finish the decompression
@@ -271,6 +274,10 @@ bool ReadJPEG(const char* pszInfile, uint8_t** ppOutImage, uint32_t& nOutRows, u
 		delete[] pOutImage;
 		return false;
 	}
+#else
+	jpeg_finish_decompress(&cinfo);        // structured exceptions are MSVC only
+	jpeg_destroy_decompress(&cinfo);
+#endif
 
 	fclose(hInfile);
 
@@ -355,7 +362,8 @@ bool SaveJpeg(const char* filepath, FFVideo_Image& image, int32_t quality = 80 )
 
 
 ////////////////////////////////////////////////////////////////////////////////
-bool SaveJpegTurbo(const char* filepath, FFVideo_Image& image, int32_t jpegQual = 80 )
+// compresses an RGBA bottom origin image into jpeg bytes in memory:
+bool EncodeJpegTurbo(FFVideo_Image& image, int32_t jpegQual, std::vector<uint8_t>& bytes)
 {
 	uint32_t total_pixels = image.m_width * image.m_height;
 
@@ -417,14 +425,24 @@ bool SaveJpegTurbo(const char* filepath, FFVideo_Image& image, int32_t jpegQual
 		return false;
 	}
 
-	bool ret_val = WriteFileBytes( filepath, jpegBuf, jpegSize );
+	bytes.assign( jpegBuf, jpegBuf + jpegSize );
 
-	tjFree( jpegBuf ); // its on disk now, free the RAM
+	tjFree( jpegBuf ); // its copied now, free the RAM
 
 	int32_t tjstat = tjDestroy(handle); //should deallocate data buffer
 	handle = 0;
 
-	return ret_val;
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SaveJpegTurbo(const char* filepath, FFVideo_Image& image, int32_t jpegQual = 80 )
+{
+	std::vector<uint8_t> bytes;
+	if (!EncodeJpegTurbo( image, jpegQual, bytes ))
+		return false;
+
+	return WriteFileBytes( filepath, bytes.data(), (uint32_t)bytes.size() );
 }
 
 
@@ -544,6 +562,15 @@ bool FFVideo_Image::Clone(uint8_t* p_pixels, uint32_t height, uint32_t width, ui
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Image::Swap(FFVideo_Image& im)
+{
+	std::swap( mp_pixels, im.mp_pixels );
+	std::swap( m_width, im.m_width );
+	std::swap( m_height, im.m_height );
+	std::swap( m_type, im.m_type );
+}
+
+////////////////////////////////////////////////////////////////////////////////
 // expected to contain image data which is clipped to a sub-rect, making this image that sub-rect
 bool FFVideo_Image::ClipToRect( uint32_t xmin, uint32_t ymin, uint32_t xmax, uint32_t ymax )
 {
@@ -658,6 +685,12 @@ bool FFVideo_Image::SaveJpgTurbo(const char* fname, int32_t quality)
 	return SaveJpegTurbo(fname, *this, quality);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Image::EncodeJpgTurbo(std::vector<uint8_t>& bytes, int32_t quality)
+{
+	return EncodeJpegTurbo(*this, quality, bytes);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 bool FFVideo_Image::SetAlpha(uint8_t alpha)
 {
@@ -719,23 +752,30 @@ uint8_t* FFVideo_Image::Pixel(uint32_t x, uint32_t y)
 ////////////////////////////////////////////////////////////////////////////////
 bool FFVideo_Image::Rescale( uint32_t new_height, uint32_t new_width )
 {
-	if (m_type != 1 && m_type != 4 && mp_pixels)
-		return NULL;
-
 	FFVideo_Image rescaled;
 
-	rescaled.Reallocate(new_height, new_width);
+	if (!RescaleTo( rescaled, new_height, new_width ))
+		return false;
+
+	// take the rescaled pixels rather than copy them back:
+	std::swap( mp_pixels, rescaled.mp_pixels );
+	m_height = rescaled.m_height;
+	m_width  = rescaled.m_width;
 
-	stbir_resize_uint8(          mp_pixels,          m_width,          m_height, 0,
-											rescaled.mp_pixels, rescaled.m_width, rescaled.m_height, 0, 4);
+	return true;
+}
 
-	Reallocate(new_height, new_width, m_type);
+////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Image::RescaleTo( FFVideo_Image& dst, uint32_t new_height, uint32_t new_width, int32_t threads ) const
+{
+	if (!mp_pixels || m_type > 4 || &dst == this)
+		return false;
 
-	uint32_t size = CalcSize( m_height, m_width, m_type );
-	if (!size)
+	// reuses dst's pixels when already this size:
+	if (!dst.Reallocate( new_height, new_width, m_type ))
 		return false;
 
-	memcpy(mp_pixels, rescaled.mp_pixels, size);
+	uint32_t channels = (m_type == 2) ? 1 : (m_type == 1 || m_type == 4) ? 4 : 3;
 
-	return true;
+	return FFVideo_Resizer::Resize( mp_pixels, m_width, m_height, 0, dst.mp_pixels, new_width, new_height, 0, channels, threads );
 }
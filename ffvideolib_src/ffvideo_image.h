@@ -2,6 +2,18 @@
 #ifndef _FFVIDEO_IMAGE_H_
 #define _FFVIDEO_IMAGE_H_
 
+#include <vector>
+
+//------------------------------------------------------------------------------
+// the file format an image is saved in by FFVideo_Image::Save(), as used by the frame exporter:
+typedef struct _FFVIDEO_Export_Format
+{
+	int32_t m_format = 0;							// 0=JPEG, 1=raw pixels, 2=NumPy .npy, 3=PNG, 4=WebP
+	int32_t m_channels = 3;						// raw, .npy & PNG: 3=RGB, 1=Gray; JPEG & WebP are always RGB
+	bool		m_mmap = false;						// raw & .npy: write through a memory mapped file rather than a buffered write
+	int32_t m_png_level = 1;					// PNG zlib compression level 0-9; 1 is the fastest that still compresses
+	bool		m_webp_lossless = false;	// WebP lossless, else lossy using the save quality
+} FFVIDEO_Export_Format;
 
 //------------------------------------------------------------------------------
 // an image in RAM
@@ -21,9 +33,22 @@ public:
 	bool     Load(const char* fname);
 	bool		 SaveJpg(const char* fname, int32_t quality = 80 );
 	bool		 SaveJpgTurbo(const char* fname, int32_t quality = 80 );
+	bool		 EncodeJpgTurbo(std::vector<uint8_t>& bytes, int32_t quality = 80 );
+
+	// these save top origin, so vflip = true is for bottom origin images (see ffvideo_imageFormats.cpp):
+	bool		 Save(const char* fname, FFVIDEO_Export_Format& format, int32_t quality = 80, bool vflip = true );
+	bool		 SaveRaw(const char* fname, int32_t channels = 3, bool mmap = false, bool vflip = true );
+	bool		 SaveNpy(const char* fname, int32_t channels = 3, bool mmap = false, bool vflip = true );
+	bool		 SavePng(const char* fname, int32_t channels = 3, int32_t level = 1, bool vflip = true );
+	bool		 SaveWebp(const char* fname, int32_t quality = 80, bool lossless = false, bool vflip = true );
+	bool		 Encode(std::vector<uint8_t>& bytes, FFVIDEO_Export_Format& format, int32_t quality = 80, bool vflip = true );
+	bool		 Decode(const uint8_t* p_bytes, size_t size, FFVIDEO_Export_Format& format, uint32_t width = 0, uint32_t height = 0 );
+	static const char* SaveExtension(FFVIDEO_Export_Format& format);
 
 	bool     Clone(const FFVideo_Image& im);
 	bool     Clone(uint8_t* p_pixels, uint32_t height, uint32_t width, uint32_t type = 1);
+	// exchanges pixels & dimensions with im, nothing is copied:
+	void     Swap(FFVideo_Image& im);
 	bool     ClipToRect( uint32_t xmin, uint32_t ymin, uint32_t xmax, uint32_t ymax ); 
 	bool     Reallocate(uint32_t height, uint32_t width, uint32_t type = 1);
 	void     MirrorVertical(void);
@@ -34,6 +59,8 @@ public:
 	bool     SetAlphaTweak(uint8_t alpha_threshold);
 	uint8_t* Pixel(uint32_t x, uint32_t y);
 	bool     Rescale( uint32_t new_height, uint32_t new_width );
+	// into dst, reusing dst's pixels if already the new size; threads as FFVideo_Resizer::Resize():
+	bool     RescaleTo( FFVideo_Image& dst, uint32_t new_height, uint32_t new_width, int32_t threads = 0 ) const;
 
 	uint8_t* mp_pixels;
 	uint32_t m_width;
@@ -0,0 +1,463 @@
+
+
+#include "ffvideo.h"
+
+#include <fstream>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+
+// The non-JPEG image file formats: raw pixel dumps and NumPy .npy files are for ML pipelines
+// that want the exact decoded pixels without a decode step, PNG is lossless with a selectable
+// zlib level, and WebP is lossless or lossy. PNG & WebP use the FFmpeg image encoders, so
+// WebP requires a libavcodec built with libwebp.
+
+
+//------------------------------------------------------------------------------
+// a thread's conversion contexts, reused while the size & formats repeat, as they do frame to frame
+// of an export, & freed as the thread exits:
+typedef struct _FFVIDEO_Sws_Cache
+{
+	struct SwsContext*	mp_convert = NULL;		// ConvertPixels()
+	struct SwsContext*	mp_decode = NULL;			// FFVideo_Image::Decode()
+
+	~_FFVIDEO_Sws_Cache()
+	{
+		sws_freeContext(mp_convert);
+		sws_freeContext(mp_decode);
+	}
+} FFVIDEO_Sws_Cache;
+//
+static thread_local FFVIDEO_Sws_Cache	gSwsCache;
+
+
+////////////////////////////////////////////////////////////////////////////////
+// maps the FFVideo_Image type to the equivalent FFmpeg pixel format:
+static enum AVPixelFormat ImagePixelFormat(uint32_t type)
+{
+	switch (type) // 0=RGB, 1=RGBA, 2=Gray, 3=BGR, 4=BGRA
+	{
+	case 0:  return AV_PIX_FMT_RGB24;
+	case 2:  return AV_PIX_FMT_GRAY8;
+	case 3:  return AV_PIX_FMT_BGR24;
+	case 4:  return AV_PIX_FMT_BGRA;
+	default: return AV_PIX_FMT_RGBA;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// converts the image into p_dst as packed top origin pixels of dst_format,
+// the bottom origin flip is done by swscale reading the source with a negative stride:
+static bool ConvertPixels(FFVideo_Image& im, enum AVPixelFormat dst_format, uint8_t* p_dst[4], int dst_linesize[4], bool vflip)
+{
+	if (!im.mp_pixels || im.m_width < 1 || im.m_height < 1)
+		return false;
+
+	enum AVPixelFormat src_format = ImagePixelFormat(im.m_type);
+	int32_t            src_stride = (int32_t)(im.Size() / im.m_height);
+
+	gSwsCache.mp_convert = sws_getCachedContext(gSwsCache.mp_convert, im.m_width, im.m_height, src_format,
+																							im.m_width, im.m_height, dst_format,
+																							SWS_POINT, NULL, NULL, NULL);
+	struct SwsContext* p_sws = gSwsCache.mp_convert;
+	if (!p_sws)
+	{
+		av_log(NULL, AV_LOG_ERROR, "ConvertPixels: unable to convert pixel format %d to %d\n", src_format, dst_format);
+		return false;
+	}
+
+	const uint8_t* src_data[4] = { im.mp_pixels, NULL, NULL, NULL };
+	int            src_linesize[4] = { src_stride, 0, 0, 0 };
+	if (vflip)
+	{
+		src_data[0] = im.mp_pixels + (size_t)src_stride * (im.m_height - 1);
+		src_linesize[0] = -src_stride;
+	}
+
+	int rows = sws_scale(p_sws, src_data, src_linesize, 0, im.m_height, p_dst, dst_linesize);
+
+	return (rows == (int)im.m_height);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool WriteBytes(const char* fname, std::vector<uint8_t>& bytes)
+{
+	FILE* fh = fopen(fname, "wb");
+	if (!fh)
+		return false;
+
+	size_t written = fwrite(bytes.data(), 1, bytes.size(), fh);
+	fclose(fh);
+
+	return (written == bytes.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// an optional header followed by the packed RGB or gray pixels:
+static bool PackPixels(std::vector<uint8_t>& bytes, const std::string& header, FFVideo_Image& im, int32_t channels, bool vflip)
+{
+	enum AVPixelFormat dst_format = (channels == 1) ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+	int32_t            linesize = (int32_t)im.m_width * ((channels == 1) ? 1 : 3);
+	size_t             pixel_bytes = (size_t)linesize * im.m_height;
+
+	if (pixel_bytes == 0)
+		return false;
+
+	bytes.resize(header.size() + pixel_bytes);
+	if (header.size() > 0)
+		memcpy(bytes.data(), header.data(), header.size());
+
+	uint8_t* dst_data[4] = { bytes.data() + header.size(), NULL, NULL, NULL };
+	int      dst_linesize[4] = { linesize, 0, 0, 0 };
+	return ConvertPixels(im, dst_format, dst_data, dst_linesize, vflip);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// writes an optional header followed by the packed pixels, either through a buffered
+// write or converting the pixels directly into a memory mapped view of the file:
+static bool WritePackedPixels(const char* fname, const std::string& header, FFVideo_Image& im, int32_t channels, bool mmap, bool vflip)
+{
+	if (!mmap)
+	{
+		std::vector<uint8_t> bytes;
+		if (!PackPixels(bytes, header, im, channels, vflip))
+			return false;
+
+		return WriteBytes(fname, bytes);
+	}
+
+	enum AVPixelFormat dst_format = (channels == 1) ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+	int32_t            linesize = (int32_t)im.m_width * ((channels == 1) ? 1 : 3);
+	size_t             pixel_bytes = (size_t)linesize * im.m_height;
+	size_t             total_bytes = header.size() + pixel_bytes;
+
+	if (pixel_bytes == 0)
+		return false;
+
+	try
+	{
+		// the file must have its final size before it can be mapped:
+		{
+			std::filebuf fbuf;
+			if (!fbuf.open(fname, std::ios_base::in | std::ios_base::out | std::ios_base::trunc | std::ios_base::binary))
+				return false;
+			fbuf.pubseekoff(total_bytes - 1, std::ios_base::beg);
+			fbuf.sputc(0);
+		}
+
+		boost::interprocess::file_mapping  mapping(fname, boost::interprocess::read_write);
+		boost::interprocess::mapped_region region(mapping, boost::interprocess::read_write);
+
+		uint8_t* p_view = (uint8_t*)region.get_address();
+		if (header.size() > 0)
+			memcpy(p_view, header.data(), header.size());
+
+		uint8_t* dst_data[4] = { p_view + header.size(), NULL, NULL, NULL };
+		int      dst_linesize[4] = { linesize, 0, 0, 0 };
+		return ConvertPixels(im, dst_format, dst_data, dst_linesize, vflip);
+	}
+	catch (...)
+	{
+		av_log(NULL, AV_LOG_ERROR, "WritePackedPixels: unable to memory map '%s'\n", fname);
+		return false;
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// encodes the image as a single frame with an FFmpeg image encoder, returning the packet bytes;
+// want_format is used if the encoder supports it, otherwise the encoder's first pixel format:
+static bool EncodeImage(std::vector<uint8_t>& bytes, FFVideo_Image& im, const AVCodec* p_codec, enum AVPixelFormat want_format,
+												int32_t compression_level, AVDictionary** pp_options, bool vflip)
+{
+	if (!p_codec)
+		return false;
+
+	enum AVPixelFormat pix_fmt = AV_PIX_FMT_NONE;
+	if (p_codec->pix_fmts)
+	{
+		pix_fmt = p_codec->pix_fmts[0];
+		for (const enum AVPixelFormat* p = p_codec->pix_fmts; *p != AV_PIX_FMT_NONE; p++)
+		{
+			if (*p == want_format)
+			{
+				pix_fmt = want_format;
+				break;
+			}
+		}
+	}
+	else pix_fmt = want_format;
+
+	AVCodecContext* p_context = avcodec_alloc_context3(p_codec);
+	AVFrame*        p_frame = av_frame_alloc();
+	AVPacket*       p_packet = av_packet_alloc();
+	bool            ret_val = false;
+
+	if (!p_context || !p_frame || !p_packet)
+		goto done;
+
+	p_context->width = im.m_width;
+	p_context->height = im.m_height;
+	p_context->pix_fmt = pix_fmt;
+	p_context->time_base = { 1, 25 };
+	if (compression_level >= 0)
+		p_context->compression_level = compression_level;
+
+	if (avcodec_open2(p_context, p_codec, pp_options) < 0)
+	{
+		av_log(NULL, AV_LOG_ERROR, "EncodeImage: unable to open the %s encoder\n", p_codec->name);
+		goto done;
+	}
+
+	p_frame->format = pix_fmt;
+	p_frame->width = im.m_width;
+	p_frame->height = im.m_height;
+	if (av_frame_get_buffer(p_frame, 0) < 0)
+		goto done;
+
+	if (!ConvertPixels(im, pix_fmt, p_frame->data, p_frame->linesize, vflip))
+		goto done;
+
+	if (avcodec_send_frame(p_context, p_frame) < 0 || avcodec_send_frame(p_context, NULL) < 0)
+		goto done;
+
+	bytes.clear();
+	while (avcodec_receive_packet(p_context, p_packet) == 0)
+	{
+		bytes.insert(bytes.end(), p_packet->data, p_packet->data + p_packet->size);
+		av_packet_unref(p_packet);
+	}
+	ret_val = (bytes.size() > 0);
+
+done:
+	av_packet_free(&p_packet);
+	av_frame_free(&p_frame);
+	avcodec_free_context(&p_context);
+
+	return ret_val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// NumPy .npy version 1.0 header for a uint8 array of shape (height, width, 3) or (height, width):
+static std::string NpyHeader(FFVideo_Image& im, int32_t channels)
+{
+	char dict[128];
+	if (channels == 1)
+		 snprintf(dict, sizeof(dict), "{'descr': '|u1', 'fortran_order': False, 'shape': (%u, %u), }", im.m_height, im.m_width);
+	else snprintf(dict, sizeof(dict), "{'descr': '|u1', 'fortran_order': False, 'shape': (%u, %u, 3), }", im.m_height, im.m_width);
+
+	// magic, version & header length take 10 bytes; the header is space padded and newline
+	// terminated so the array data starts 64 byte aligned:
+	std::string header_dict(dict);
+	size_t      unpadded = 10 + header_dict.size() + 1;
+	header_dict.append((64 - unpadded % 64) % 64, ' ');
+	header_dict += '\n';
+
+	uint16_t    header_len = (uint16_t)header_dict.size();
+	std::string header("\x93NUMPY\x01\x00", 8);
+	header += (char)(header_len & 0xff);
+	header += (char)(header_len >> 8);
+	header += header_dict;
+
+	return header;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool EncodePng(std::vector<uint8_t>& bytes, FFVideo_Image& im, int32_t channels, int32_t level, bool vflip)
+{
+	const AVCodec* p_codec = avcodec_find_encoder(AV_CODEC_ID_PNG);
+	if (!p_codec)
+	{
+		av_log(NULL, AV_LOG_ERROR, "EncodePng: no PNG encoder in this libavcodec\n");
+		return false;
+	}
+
+	if (level < 0) level = 0;
+	if (level > 9) level = 9;
+
+	enum AVPixelFormat want_format = (channels == 1) ? AV_PIX_FMT_GRAY8 : AV_PIX_FMT_RGB24;
+
+	return EncodeImage(bytes, im, p_codec, want_format, level, NULL, vflip);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+static bool EncodeWebp(std::vector<uint8_t>& bytes, FFVideo_Image& im, int32_t quality, bool lossless, bool vflip)
+{
+	const AVCodec* p_codec = avcodec_find_encoder_by_name("libwebp");
+	if (!p_codec)
+	{
+		av_log(NULL, AV_LOG_ERROR, "EncodeWebp: libavcodec was not built with libwebp\n");
+		return false;
+	}
+
+	if (quality < 0)   quality = 0;
+	if (quality > 100) quality = 100;
+
+	AVDictionary* p_options = NULL;
+	av_dict_set(&p_options, "lossless", lossless ? "1" : "0", 0);
+	av_dict_set_int(&p_options, "quality", quality, 0);
+
+	// lossless keeps RGB, lossy is YUV 4:2:0 internally anyway:
+	enum AVPixelFormat want_format = lossless ? AV_PIX_FMT_RGB32 : AV_PIX_FMT_YUV420P;
+
+	bool ret_val = EncodeImage(bytes, im, p_codec, want_format, -1, &p_options, vflip);
+
+	av_dict_free(&p_options);
+
+	return ret_val;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// raw packed pixels, no header; the width & height are up to the file name or the reader:
+bool FFVideo_Image::SaveRaw(const char* fname, int32_t channels, bool mmap, bool vflip)
+{
+	return WritePackedPixels(fname, std::string(), *this, channels, mmap, vflip);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Image::SaveNpy(const char* fname, int32_t channels, bool mmap, bool vflip)
+{
+	return WritePackedPixels(fname, NpyHeader(*this, channels), *this, channels, mmap, vflip);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Image::SavePng(const char* fname, int32_t channels, int32_t level, bool vflip)
+{
+	std::vector<uint8_t> bytes;
+	if (!EncodePng(bytes, *this, channels, level, vflip))
+		return false;
+
+	return WriteBytes(fname, bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Image::SaveWebp(const char* fname, int32_t quality, bool lossless, bool vflip)
+{
+	std::vector<uint8_t> bytes;
+	if (!EncodeWebp(bytes, *this, quality, lossless, vflip))
+		return false;
+
+	return WriteBytes(fname, bytes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// note: JPEG goes through SaveJpgTurbo(), which always expects RGBA bottom origin images
+bool FFVideo_Image::Save(const char* fname, FFVIDEO_Export_Format& format, int32_t quality, bool vflip)
+{
+	switch (format.m_format) // 0=JPEG, 1=raw pixels, 2=NumPy .npy, 3=PNG, 4=WebP
+	{
+	case 1:  return SaveRaw(fname, format.m_channels, format.m_mmap, vflip);
+	case 2:  return SaveNpy(fname, format.m_channels, format.m_mmap, vflip);
+	case 3:  return SavePng(fname, format.m_channels, format.m_png_level, vflip);
+	case 4:  return SaveWebp(fname, quality, format.m_webp_lossless, vflip);
+	default: return SaveJpgTurbo(fname, quality);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// same as Save(), but into memory; m_mmap does not apply:
+bool FFVideo_Image::Encode(std::vector<uint8_t>& bytes, FFVIDEO_Export_Format& format, int32_t quality, bool vflip)
+{
+	switch (format.m_format)
+	{
+	case 1:  return PackPixels(bytes, std::string(), *this, format.m_channels, vflip);
+	case 2:  return PackPixels(bytes, NpyHeader(*this, format.m_channels), *this, format.m_channels, vflip);
+	case 3:  return EncodePng(bytes, *this, format.m_channels, format.m_png_level, vflip);
+	case 4:  return EncodeWebp(bytes, *this, quality, format.m_webp_lossless, vflip);
+	default: return EncodeJpgTurbo(bytes, quality);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+const char* FFVideo_Image::SaveExtension(FFVIDEO_Export_Format& format)
+{
+	switch (format.m_format)
+	{
+	case 1:  return (format.m_channels == 1) ? ".gray" : ".rgb";
+	case 2:  return ".npy";
+	case 3:  return ".png";
+	case 4:  return ".webp";
+	default: return ".jpg";
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// the reverse of Encode(): raw & .npy become RGB or Gray images, the compressed formats are
+// decoded by libavcodec into RGBA; all are top origin. Raw pixels need the width & height:
+bool FFVideo_Image::Decode(const uint8_t* p_bytes, size_t size, FFVIDEO_Export_Format& format, uint32_t width, uint32_t height)
+{
+	if (!p_bytes || size < 1)
+		return false;
+
+	if (format.m_format == 1 || format.m_format == 2)
+	{
+		if (format.m_format == 2)
+		{
+			// skip the .npy header, its shape is taken as the width & height given:
+			if (size < 10 || memcmp(p_bytes, "\x93NUMPY", 6) != 0)
+				return false;
+			size_t header_size = 10 + (size_t)p_bytes[8] + ((size_t)p_bytes[9] << 8);
+			if (header_size > size)
+				return false;
+			p_bytes += header_size;
+			size -= header_size;
+		}
+
+		uint32_t type = (format.m_channels == 1) ? 2 : 0;
+		if (width < 1 || height < 1 || size < CalcSize(height, width, type))
+			return false;
+
+		return Clone((uint8_t*)p_bytes, height, width, type);
+	}
+
+	enum AVCodecID codec_id = AV_CODEC_ID_MJPEG;
+	if (format.m_format == 3)
+		 codec_id = AV_CODEC_ID_PNG;
+	else if (format.m_format == 4)
+		 codec_id = AV_CODEC_ID_WEBP;
+
+	const AVCodec*  p_codec = avcodec_find_decoder(codec_id);
+	if (!p_codec)
+		return false;
+
+	AVCodecContext*    p_context = avcodec_alloc_context3(p_codec);
+	AVFrame*           p_frame = av_frame_alloc();
+	AVPacket*          p_packet = av_packet_alloc();
+	bool               ret_val = false;
+
+	if (!p_context || !p_frame || !p_packet)
+		goto done;
+
+	if (avcodec_open2(p_context, p_codec, NULL) < 0)
+		goto done;
+
+	// the decoders want padding after the data, so the packet owns a copy:
+	if (av_new_packet(p_packet, (int)size) < 0)
+		goto done;
+	memcpy(p_packet->data, p_bytes, size);
+
+	if (avcodec_send_packet(p_context, p_packet) < 0 || avcodec_send_packet(p_context, NULL) < 0)
+		goto done;
+
+	if (avcodec_receive_frame(p_context, p_frame) < 0)
+		goto done;
+
+	if (!Reallocate(p_frame->height, p_frame->width, 1))
+		goto done;
+
+	gSwsCache.mp_decode = sws_getCachedContext(gSwsCache.mp_decode, p_frame->width, p_frame->height, (enum AVPixelFormat)p_frame->format,
+																						 p_frame->width, p_frame->height, AV_PIX_FMT_RGBA, SWS_POINT, NULL, NULL, NULL);
+	if (gSwsCache.mp_decode)
+	{
+		uint8_t* dst_data[4] = { mp_pixels, NULL, NULL, NULL };
+		int      dst_linesize[4] = { (int)m_width * 4, 0, 0, 0 };
+		ret_val = (sws_scale(gSwsCache.mp_decode, p_frame->data, p_frame->linesize, 0, p_frame->height, dst_data, dst_linesize) == p_frame->height);
+	}
+
+done:
+	av_packet_free(&p_packet);
+	av_frame_free(&p_frame);
+	avcodec_free_context(&p_context);
+
+	return ret_val;
+}
@@ -0,0 +1,379 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <errno.h>
+#include <algorithm>
+
+#include "ffvideo.h"
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_PacketRecorder::Open(const std::string& path, AVStream* p_stream)
+{
+	Close();
+
+	if (!p_stream || !p_stream->codecpar)
+		return false;
+
+	AVCodecParameters* p_par = p_stream->codecpar;
+
+	FFVIDEO_Packet_Rec_Header header;
+	memcpy(header.m_magic, "FFVP", 4);
+	header.m_version        = 1;
+	header.m_codec_id       = (int32_t)p_par->codec_id;
+	header.m_codec_tag      = p_par->codec_tag;
+	header.m_format         = p_par->format;
+	header.m_profile        = p_par->profile;
+	header.m_level          = p_par->level;
+	header.m_width          = p_par->width;
+	header.m_height         = p_par->height;
+	header.m_time_base_num  = p_stream->time_base.num;
+	header.m_time_base_den  = p_stream->time_base.den;
+	header.m_frame_rate_num = p_stream->avg_frame_rate.num;
+	header.m_frame_rate_den = p_stream->avg_frame_rate.den;
+	header.m_extradata_size = (p_par->extradata) ? (uint32_t)p_par->extradata_size : 0;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	mp_file = fopen(path.c_str(), "wb");
+	if (!mp_file)
+	{
+		av_log(NULL, AV_LOG_ERROR, "PacketRecorder: unable to create '%s'\n", path.c_str());
+		return false;
+	}
+
+	// packets are written as they arrive, a large buffer turns them into few large writes:
+	setvbuf(mp_file, NULL, _IOFBF, 1024 * 1024);
+
+	if (fwrite(&header, sizeof(header), 1, mp_file) != 1 ||
+			(header.m_extradata_size > 0 && fwrite(p_par->extradata, 1, header.m_extradata_size, mp_file) != header.m_extradata_size))
+	{
+		fclose(mp_file);
+		mp_file = NULL;
+		return false;
+	}
+
+	m_packets = 0;
+	m_open = true;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_PacketRecorder::Write(AVPacket* p_packet)
+{
+	if (!m_open)
+		return false;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	if (!mp_file)
+		return false;
+
+	if (m_packets == 0)
+		m_first_arrival = now;
+
+	FFVIDEO_Packet_Rec_Record record;
+	memcpy(record.m_magic, "FFVK", 4);
+	record.m_size       = (uint32_t)std::max(p_packet->size, 0);
+	record.m_arrival_us = std::chrono::duration_cast<std::chrono::microseconds>(now - m_first_arrival).count();
+	record.m_pts        = p_packet->pts;
+	record.m_dts        = p_packet->dts;
+	record.m_duration   = p_packet->duration;
+	record.m_flags      = p_packet->flags;
+
+	if (fwrite(&record, sizeof(record), 1, mp_file) != 1 ||
+			(record.m_size > 0 && fwrite(p_packet->data, 1, record.m_size, mp_file) != record.m_size))
+	{
+		av_log(NULL, AV_LOG_ERROR, "PacketRecorder: write failed, recording stopped\n");
+		fclose(mp_file);
+		mp_file = NULL;
+		m_open = false;
+		return false;
+	}
+
+	m_packets++;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_PacketRecorder::Close(void)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_open = false;
+	if (mp_file)
+	{
+		fclose(mp_file);
+		mp_file = NULL;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_PacketReplay::Open(const std::string& path, const FFVIDEO_Replay_Faults& faults)
+{
+	Close();
+
+	mp_file = fopen(path.c_str(), "rb");
+	if (!mp_file)
+	{
+		av_log(NULL, AV_LOG_ERROR, "PacketReplay: unable to open '%s'\n", path.c_str());
+		return false;
+	}
+
+	if (fread(&m_header, sizeof(m_header), 1, mp_file) != 1 || memcmp(m_header.m_magic, "FFVP", 4) != 0 || m_header.m_version != 1)
+	{
+		av_log(NULL, AV_LOG_ERROR, "PacketReplay: '%s' is not a packet recording\n", path.c_str());
+		Close();
+		return false;
+	}
+
+	m_extradata.resize(m_header.m_extradata_size);
+	if (m_header.m_extradata_size > 0 && fread(m_extradata.data(), 1, m_extradata.size(), mp_file) != m_extradata.size())
+	{
+		Close();
+		return false;
+	}
+	m_records_offset = (int64_t)(sizeof(m_header) + m_header.m_extradata_size);
+
+	std::lock_guard<std::mutex> lock(m_lock);
+
+	m_faults = faults;
+	m_faults.m_speed = std::max(m_faults.m_speed, 0.0f);
+	m_stats  = FFVIDEO_Replay_Stats();
+	m_jitter_random.seed(m_faults.m_seed);
+	m_stall_random.seed(m_faults.m_seed + 1);
+	m_dropout_random.seed(m_faults.m_seed + 2);
+
+	m_started         = false;
+	m_loop_arrival_us = 0;
+	m_loop_ts         = 0;
+	m_pass_packets    = 0;
+	m_dropout_end_us  = -1;
+	m_next_stall_us   = NextFault(m_faults.m_stall_every_s, m_stall_random);
+	m_next_dropout_us = NextFault(m_faults.m_dropout_every_s, m_dropout_random);
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_PacketReplay::Close(void)
+{
+	if (mp_file)
+	{
+		fclose(mp_file);
+		mp_file = NULL;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_PacketReplay::SetupStream(AVStream* p_stream)
+{
+	if (!mp_file || !p_stream)
+		return false;
+
+	AVCodecParameters* p_par = p_stream->codecpar;
+	p_par->codec_type = AVMEDIA_TYPE_VIDEO;
+	p_par->codec_id   = (enum AVCodecID)m_header.m_codec_id;
+	p_par->codec_tag  = m_header.m_codec_tag;
+	p_par->format     = m_header.m_format;
+	p_par->profile    = m_header.m_profile;
+	p_par->level      = m_header.m_level;
+	p_par->width      = m_header.m_width;
+	p_par->height     = m_header.m_height;
+
+	if (m_extradata.size() > 0)
+	{
+		p_par->extradata = (uint8_t*)av_mallocz(m_extradata.size() + AV_INPUT_BUFFER_PADDING_SIZE);
+		if (!p_par->extradata)
+			return false;
+		memcpy(p_par->extradata, m_extradata.data(), m_extradata.size());
+		p_par->extradata_size = (int)m_extradata.size();
+	}
+
+	p_stream->time_base      = { m_header.m_time_base_num, m_header.m_time_base_den };
+	p_stream->avg_frame_rate = { m_header.m_frame_rate_num, m_header.m_frame_rate_den };
+	p_stream->r_frame_rate   = p_stream->avg_frame_rate;
+
+	return (m_header.m_time_base_num > 0 && m_header.m_time_base_den > 0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_PacketReplay::ReadRecord(FFVIDEO_Packet_Rec_Record& record)
+{
+	if (fread(&record, sizeof(record), 1, mp_file) != 1 || memcmp(record.m_magic, "FFVK", 4) != 0)
+		return false;
+
+	m_payload.resize(record.m_size);
+	if (record.m_size > 0 && fread(m_payload.data(), 1, record.m_size, mp_file) != record.m_size)
+		return false;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// exponentially distributed, as independent faults are; INT64_MAX when there are none:
+int64_t FFVideo_PacketReplay::NextFault(float every_s, std::mt19937& random)
+{
+	if (every_s <= 0.0f)
+		return INT64_MAX;
+
+	std::exponential_distribution<double> gap(1.0 / ((double)every_s * 1.0e6));
+	return (int64_t)gap(random);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// sleeps in slices no longer than 10ms, so an interruption is noticed as FFmpeg's own I/O would:
+bool FFVideo_PacketReplay::Wait(std::chrono::steady_clock::time_point until, const std::function<bool(void)>& interrupted)
+{
+	while (true)
+	{
+		if (interrupted && interrupted())
+			return false;
+
+		std::chrono::steady_clock::duration remaining = until - std::chrono::steady_clock::now();
+		if (remaining <= std::chrono::steady_clock::duration::zero())
+			return true;
+
+		int64_t units = std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(remaining).count();
+		FFVideo_Sleep100ns(std::min<int64_t>(units, 100000));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int FFVideo_PacketReplay::Read(AVPacket* p_packet, const std::function<bool(void)>& interrupted)
+{
+	if (!mp_file)
+		return AVERROR_EOF;
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!m_started)
+	{
+		m_start    = now;
+		m_last_due = now;
+		m_started  = true;
+	}
+
+	FFVIDEO_Packet_Rec_Record record;
+	while (true)
+	{
+		if (!ReadRecord(record))
+		{
+			if (!m_faults.m_loop || m_pass_packets == 0)
+				return AVERROR_EOF;
+
+			// the next pass follows on a frame after this one, its arrivals & timestamps continuing:
+			int64_t arrival_gap = (m_pass_packets > 1) ? (m_last_arrival_us - m_first_arrival_us) / (m_pass_packets - 1) : 0;
+			m_loop_arrival_us += (m_last_arrival_us - m_first_arrival_us) + arrival_gap;
+			if (m_first_dts != AV_NOPTS_VALUE && m_last_dts != AV_NOPTS_VALUE)
+			{
+				int64_t ts_gap = (m_last_duration > 0) ? m_last_duration :
+												 (m_pass_packets > 1) ? (m_last_dts - m_first_dts) / (m_pass_packets - 1) : 0;
+				m_loop_ts += (m_last_dts - m_first_dts) + ts_gap;
+			}
+			m_pass_packets = 0;
+
+			if (FFVideo_Seek64(mp_file, m_records_offset, SEEK_SET) != 0)
+				return AVERROR_EOF;
+
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.m_loops++;
+			continue;
+		}
+
+		if (m_pass_packets == 0)
+		{
+			m_first_arrival_us = record.m_arrival_us;
+			m_first_dts        = record.m_dts;
+		}
+		m_last_arrival_us = record.m_arrival_us;
+		m_last_dts        = record.m_dts;
+		m_last_duration   = record.m_duration;
+		m_pass_packets++;
+
+		int64_t arrival_us = m_loop_arrival_us + record.m_arrival_us - m_first_arrival_us;
+
+		if (m_faults.m_disconnect_after_s > 0.0f && arrival_us >= (int64_t)(m_faults.m_disconnect_after_s * 1.0e6))
+			return AVERROR(ECONNRESET);
+
+		// a dropout loses the packets arriving during it:
+		while (arrival_us >= m_next_dropout_us)
+		{
+			m_dropout_end_us  = m_next_dropout_us + (int64_t)m_faults.m_dropout_ms * 1000;
+			m_next_dropout_us = m_dropout_end_us + NextFault(m_faults.m_dropout_every_s, m_dropout_random);
+		}
+		if (arrival_us < m_dropout_end_us)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.m_dropped++;
+			continue;
+		}
+
+		break;
+	}
+
+	int64_t arrival_us = m_loop_arrival_us + record.m_arrival_us - m_first_arrival_us;
+
+	// wait for the packet's arrival, as recorded & scaled by the replay speed, plus any jitter:
+	if (m_faults.m_speed > 0.0f)
+	{
+		int64_t due_us = (int64_t)((double)arrival_us / (double)m_faults.m_speed);
+		if (m_faults.m_jitter_ms > 0)
+		{
+			std::uniform_int_distribution<int64_t> jitter(0, (int64_t)m_faults.m_jitter_ms * 1000);
+			due_us += jitter(m_jitter_random);
+		}
+
+		// packets never overtake one another, as over TCP:
+		std::chrono::steady_clock::time_point due = std::max(m_start + std::chrono::microseconds(due_us), m_last_due);
+		m_last_due = due;
+
+		int64_t late_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - due).count();
+		if (late_us > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.m_max_late_us = std::max(m_stats.m_max_late_us, late_us);
+		}
+		else if (!Wait(due, interrupted))
+			return AVERROR_EXIT;
+	}
+
+	// a stall holds this packet back; those due meanwhile follow it at once, as a stalled socket's backlog does:
+	if (arrival_us >= m_next_stall_us)
+	{
+		m_next_stall_us = arrival_us + NextFault(m_faults.m_stall_every_s, m_stall_random);
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_stats.m_stalls++;
+		}
+		if (!Wait(std::chrono::steady_clock::now() + std::chrono::milliseconds(m_faults.m_stall_ms), interrupted))
+			return AVERROR_EXIT;
+	}
+
+	int ret = av_new_packet(p_packet, (int)record.m_size);
+	if (ret < 0)
+		return ret;
+	if (record.m_size > 0)
+		memcpy(p_packet->data, m_payload.data(), record.m_size);
+
+	p_packet->pts          = (record.m_pts != AV_NOPTS_VALUE) ? record.m_pts + m_loop_ts : AV_NOPTS_VALUE;
+	p_packet->dts          = (record.m_dts != AV_NOPTS_VALUE) ? record.m_dts + m_loop_ts : AV_NOPTS_VALUE;
+	p_packet->duration     = record.m_duration;
+	p_packet->flags        = record.m_flags;
+	p_packet->stream_index = 0;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	m_stats.m_packets++;
+
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_PacketReplay::GetStats(FFVIDEO_Replay_Stats& stats)
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	stats = m_stats;
+}
@@ -0,0 +1,174 @@
+#pragma once
+#ifndef _FFVIDEO_PACKETREPLAY_H_
+#define _FFVIDEO_PACKETREPLAY_H_
+
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <random>
+#include <functional>
+
+
+extern "C" {
+#include "libavformat/avformat.h"
+}
+
+
+// ---------------------------------------------------------------------------------
+// A packet recording holds the demuxed video packets of a stream, each with the time it arrived,
+// so a live session, typically an IP camera, can be replayed later through the same decode path
+// at its original pace, see FFVideo::StartPacketRecording() & FFVideo::OpenPacketReplay():
+//
+//		an FFVIDEO_Packet_Rec_Header, then the stream's extradata, then per packet an
+//		FFVIDEO_Packet_Rec_Record followed by the packet's payload
+//
+// Codec ids are FFmpeg's, so a recording replays with the same major version of FFmpeg that made
+// it. All values are little endian.
+// ---------------------------------------------------------------------------------
+
+#pragma pack(push, 1)
+
+typedef struct _FFVIDEO_Packet_Rec_Header
+{
+	char			m_magic[4];					// "FFVP"
+	uint32_t	m_version;					// 1
+	int32_t		m_codec_id;					// AVCodecID
+	uint32_t	m_codec_tag;
+	int32_t		m_format;						// AVPixelFormat, -1 if unknown
+	int32_t		m_profile;
+	int32_t		m_level;
+	int32_t		m_width;
+	int32_t		m_height;
+	int32_t		m_time_base_num;		// of the packets' pts, dts & duration
+	int32_t		m_time_base_den;
+	int32_t		m_frame_rate_num;		// the stream's average frame rate, 0/0 if unknown
+	int32_t		m_frame_rate_den;
+	uint32_t	m_extradata_size;
+} FFVIDEO_Packet_Rec_Header;
+
+typedef struct _FFVIDEO_Packet_Rec_Record
+{
+	char			m_magic[4];					// "FFVK"
+	uint32_t	m_size;							// payload bytes
+	int64_t		m_arrival_us;				// when av_read_frame() returned it, since the recording's first packet
+	int64_t		m_pts;							// AV_NOPTS_VALUE if unknown
+	int64_t		m_dts;							// AV_NOPTS_VALUE if unknown
+	int64_t		m_duration;
+	int32_t		m_flags;						// AV_PKT_FLAG_KEY, AV_PKT_FLAG_CORRUPT...
+} FFVIDEO_Packet_Rec_Record;
+
+#pragma pack(pop)
+
+
+//------------------------------------------------------------------------------
+// faults injected into a replay. They are scheduled on the recording's timeline from m_seed, so the
+// same recording, faults & seed stall and drop at the same packets every run:
+typedef struct _FFVIDEO_Replay_Faults
+{
+	float			m_speed = 1.0f;							// 1 replays at the recorded pace, 2 twice as fast, 0 as fast as it decodes
+	int32_t		m_jitter_ms = 0;						// each packet arrives up to this much later than recorded, packet order is kept
+	float			m_stall_every_s = 0.0f;			// on average a stall this often, 0 for none
+	int32_t		m_stall_ms = 0;							// the read blocks this long; longer than the read timeout trips interrupt_callback
+	float			m_dropout_every_s = 0.0f;		// on average a dropout this often, 0 for none
+	int32_t		m_dropout_ms = 0;						// the packets arriving during a dropout are lost
+	float			m_disconnect_after_s = 0.0f;// the stream dies this far into the replay, 0 for never
+	bool			m_loop = false;							// at the end the recording plays again, rather than the stream dying
+	uint32_t	m_seed = 1;
+} FFVIDEO_Replay_Faults;
+
+//------------------------------------------------------------------------------
+// what a replay has done so far:
+typedef struct _FFVIDEO_Replay_Stats
+{
+	uint64_t	m_packets = 0;							// delivered to the decoder
+	uint64_t	m_dropped = 0;							// lost to dropouts
+	uint64_t	m_stalls = 0;
+	uint64_t	m_loops = 0;
+	int64_t		m_max_late_us = 0;					// the most a packet was read after it was due, the decoder falling behind
+} FFVIDEO_Replay_Stats;
+
+
+// ---------------------------------------------------------------------------------
+// used by the packet reader thread to append packets as they arrive, started & stopped by the client:
+class FFVideo_PacketRecorder
+{
+public:
+	FFVideo_PacketRecorder() : mp_file(NULL), m_open(false), m_packets(0) {};
+	~FFVideo_PacketRecorder() { Close(); }
+
+	bool		Open(const std::string& path, AVStream* p_stream);
+	bool		Write(AVPacket* p_packet);			// the packet arrived now
+	void		Close(void);
+
+	bool		IsOpen(void) { return m_open; }
+	int64_t Packets(void) { return m_packets; }
+
+private:
+	std::mutex														m_lock;
+	FILE*																	mp_file;
+	std::atomic<bool>											m_open;				// checked without the lock, for every packet read
+	std::atomic<int64_t>									m_packets;
+	std::chrono::steady_clock::time_point	m_first_arrival;
+};
+
+
+// ---------------------------------------------------------------------------------
+// reads a recording back as an IP camera delivers it: Read() blocks until the next packet is due,
+// as av_read_frame() blocks on a socket, so read timeouts & the stream's death behave as they do live:
+class FFVideo_PacketReplay
+{
+public:
+	FFVideo_PacketReplay() : mp_file(NULL), m_records_offset(0), m_started(false) {};
+	~FFVideo_PacketReplay() { Close(); }
+
+	bool		Open(const std::string& path, const FFVIDEO_Replay_Faults& faults);
+	void		Close(void);
+
+	// describes the recorded stream, for a stream created with avformat_new_stream():
+	bool		SetupStream(AVStream* p_stream);
+
+	// as av_read_frame(): 0 with the next packet, AVERROR_EOF at the end, AVERROR_EXIT if interrupted
+	// while waiting, or AVERROR(ECONNRESET) at an injected disconnect. interrupted() is polled while waiting:
+	int			Read(AVPacket* p_packet, const std::function<bool(void)>& interrupted);
+
+	void		GetStats(FFVIDEO_Replay_Stats& stats);
+
+private:
+	bool		ReadRecord(FFVIDEO_Packet_Rec_Record& record);
+	bool		Wait(std::chrono::steady_clock::time_point until, const std::function<bool(void)>& interrupted);
+	int64_t NextFault(float every_s, std::mt19937& random);	// microseconds to the next fault, on the recording's timeline
+
+	std::mutex														m_lock;				// for GetStats()
+	FILE*																	mp_file;
+	FFVIDEO_Packet_Rec_Header							m_header;
+	std::vector<uint8_t>									m_extradata;
+	std::vector<uint8_t>									m_payload;
+	int64_t																m_records_offset;
+	FFVIDEO_Replay_Faults									m_faults;
+	FFVIDEO_Replay_Stats									m_stats;
+	std::mt19937													m_jitter_random;	// one per fault, so enabling one never moves another
+	std::mt19937													m_stall_random;
+	std::mt19937													m_dropout_random;
+
+	bool																	m_started;
+	std::chrono::steady_clock::time_point	m_start;
+	std::chrono::steady_clock::time_point	m_last_due;
+
+	// a loop continues the recording's timeline & timestamps from where its last pass ended:
+	int64_t																m_loop_arrival_us;
+	int64_t																m_loop_ts;
+	int64_t																m_pass_packets;
+	int64_t																m_first_arrival_us, m_last_arrival_us;
+	int64_t																m_first_dts, m_last_dts, m_last_duration;
+
+	int64_t																m_next_stall_us;
+	int64_t																m_next_dropout_us;
+	int64_t																m_dropout_end_us;
+};
+
+
+
+#endif // _FFVIDEO_PACKETREPLAY_H_
@@ -0,0 +1,139 @@
+#pragma once
+#ifndef _FFVIDEO_PIPELINESTATS_H_
+#define _FFVIDEO_PIPELINESTATS_H_
+
+
+#include <chrono>
+
+#include "ffvideo_histogram.h"
+#include "ffvideo_trace.h"
+
+
+// the per stage timing is always on, at two clock reads & four relaxed atomic adds per stage per frame.
+// Build with FFVIDEO_PIPELINE_STATS defined as 0 to remove it; FFVideo::GetPipelineStats() then returns
+// only the export stages, which the export writer times regardless, and the queue depths. The stages'
+// trace spans do not depend on it:
+#ifndef FFVIDEO_PIPELINE_STATS
+#define FFVIDEO_PIPELINE_STATS 1
+#endif
+
+//------------------------------------------------------------------------------
+// the stages of playback timed for FFVideo::GetPipelineStats():
+enum class FFVIDEO_PIPELINE_STAGE
+{
+	READ = 0,					// av_read_frame()
+	SEND,							// avcodec_send_packet()
+	RECEIVE,					// avcodec_receive_frame(), each frame & the final "again"
+	FILTER,						// FFVIDEO_FrameFilter::FilterFrame(), including the RGBA conversion
+	RGBA_COPY,				// the filtered frame into the frame delivered
+	MIRROR,						// FFVideo_Image::MirrorVertical() of the frame delivered
+	SCRUB_CLONE,			// media files keep a copy of each frame for stepping back
+	CLIENT_CALLBACK,	// the client's display frame callback
+	EXPORT_ENCODE,		// export thread: rescale & encode of one frame
+	EXPORT_WRITE,			// writer threads or the export thread: the file write or archive append
+	COUNT
+};
+
+//------------------------------------------------------------------------------
+// one stage of FFVIDEO_Pipeline_Stats, latencies are in microseconds:
+typedef struct _FFVIDEO_Stage_Stats
+{
+	const char*				m_name = "";
+	uint64_t					m_count = 0;
+	uint64_t					m_p50 = 0;
+	uint64_t					m_p95 = 0;
+	uint64_t					m_p99 = 0;
+	uint64_t					m_max = 0;
+	double						m_mean = 0.0;
+	FFVIDEO_Histogram	m_hist;
+} FFVIDEO_Stage_Stats;
+
+//------------------------------------------------------------------------------
+// returned by FFVideo::GetPipelineStats(), since playback began or ResetPipelineStats():
+typedef struct _FFVIDEO_Pipeline_Stats
+{
+	bool								m_timed = (FFVIDEO_PIPELINE_STATS != 0);		// false if built without the stage timing
+	FFVIDEO_Stage_Stats	m_stages[(int32_t)FFVIDEO_PIPELINE_STAGE::COUNT];
+
+	// queue depths at the time of the call:
+	int32_t							m_decoded_waiting = 0;				// decoded frames waiting on their display time
+	int32_t							m_export_queued = 0;					// frames waiting on the export thread
+	int32_t							m_export_in_flight = 0;				// encoded frames waiting on or being written
+	int32_t							m_encode_queued = 0;					// frames waiting on the in-process encoder
+} FFVIDEO_Pipeline_Stats;
+
+//------------------------------------------------------------------------------
+// the stage histograms; Add() may be called from any thread:
+class FFVideo_PipelineStats
+{
+public:
+	void Add(FFVIDEO_PIPELINE_STAGE stage, uint64_t us) { m_hists[(int32_t)stage].Add(us); }
+
+	void Reset(void)
+	{
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_PIPELINE_STAGE::COUNT; i++)
+			m_hists[i].Reset();
+	}
+
+	void Snapshot(FFVIDEO_PIPELINE_STAGE stage, FFVIDEO_Histogram& hist) const { m_hists[(int32_t)stage].Snapshot(hist); }
+
+	static const char* StageName(FFVIDEO_PIPELINE_STAGE stage)
+	{
+		static const char* names[] = { "read", "send", "receive", "filter", "rgba copy", "mirror", "scrub clone",
+																	 "callback", "export encode", "export write" };
+		return names[(int32_t)stage];
+	}
+
+private:
+	FFVideo_Histogram	m_hists[(int32_t)FFVIDEO_PIPELINE_STAGE::COUNT];
+};
+
+//------------------------------------------------------------------------------
+// times consecutive stages with one clock read each: FFVIDEO_STAGE_LAP() records the time since
+// the timer started or last lapped into the stage, then restarts it. With a tracer enabled when the
+// timer starts, each lap is also a trace span of the frame, frame_num -1 when not yet known.
+// Built without the timing, the spans remain, & a timer without a tracer reads no clock:
+class FFVideo_StageTimer
+{
+public:
+	FFVideo_StageTimer(FFVideo_Tracer* p_tracer) 
+		: mp_tracer((p_tracer && p_tracer->IsEnabled()) ? p_tracer : NULL), m_timing(FFVIDEO_PIPELINE_STATS != 0 || mp_tracer != NULL)
+	{
+		if (m_timing)
+			m_start = std::chrono::steady_clock::now();
+	};
+
+	void Lap(FFVideo_PipelineStats& stats, FFVIDEO_PIPELINE_STAGE stage, int32_t frame_num)
+	{
+		if (!m_timing)
+			return;
+
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+#if FFVIDEO_PIPELINE_STATS
+		stats.Add(stage, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - m_start).count());
+#endif
+		if (mp_tracer)
+			mp_tracer->Complete("pipeline", FFVideo_PipelineStats::StageName(stage), FFVideo_Tracer::Microseconds(m_start),
+													FFVideo_Tracer::Microseconds(now), frame_num);
+		m_start = now;
+	}
+
+	void Restart(void) 
+	{ 
+		if (m_timing)
+			m_start = std::chrono::steady_clock::now(); 
+	}
+
+private:
+	FFVideo_Tracer*												mp_tracer;
+	bool																	m_timing;			// stats built in, or a tracer to feed
+	std::chrono::steady_clock::time_point m_start;
+};
+
+#define FFVIDEO_STAGE_TIMER(t, tracer)							FFVideo_StageTimer t(tracer)
+#define FFVIDEO_STAGE_RESTART(t)										(t).Restart()
+#define FFVIDEO_STAGE_LAP(t, stats, stage, frame)	(t).Lap((stats), FFVIDEO_PIPELINE_STAGE::stage, (frame))
+
+
+
+#endif // _FFVIDEO_PIPELINESTATS_H_
@@ -0,0 +1,120 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX		// std::min & std::max, not the Windows macros
+#endif
+#include <Windows.h>
+#include <io.h>
+#else
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
+
+#include "ffvideo_platform.h"
+
+
+#ifdef _WIN32
+
+// Windows 10 1803 & later; older Windows fail to create it & fall back to the ~1ms timer:
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
+//------------------------------------------------------------------------------
+// a thread's waitable timer, created at its first sleep & closed as the thread exits:
+typedef struct _FFVIDEO_Sleep_Timer
+{
+	HANDLE	m_timer = NULL;
+
+	~_FFVIDEO_Sleep_Timer()
+	{
+		if (m_timer)
+			CloseHandle(m_timer);
+	}
+} FFVIDEO_Sleep_Timer;
+//
+static thread_local FFVIDEO_Sleep_Timer	gSleepTimer;
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Sleep100ns(int64_t units)
+{
+	if (units <= 0)
+		return true;
+
+	if (!gSleepTimer.m_timer)
+	{
+		gSleepTimer.m_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!gSleepTimer.m_timer)
+			gSleepTimer.m_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+		if (!gSleepTimer.m_timer)
+			return false;
+	}
+
+	// negative is relative to now:
+	LARGE_INTEGER li;
+	li.QuadPart = -units;
+	if (!SetWaitableTimer(gSleepTimer.m_timer, &li, 0, NULL, NULL, FALSE))
+		return false;
+
+	return WaitForSingleObject(gSleepTimer.m_timer, INFINITE) == WAIT_OBJECT_0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int FFVideo_Seek64(FILE* fp, int64_t offset, int origin)
+{
+	return _fseeki64(fp, offset, origin);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_SyncFile(FILE* fp)
+{
+	if (fflush(fp) != 0)
+		return false;
+	return _commit(_fileno(fp)) == 0;
+}
+
+#else
+
+//////////////////////////////////////////////////////////////////////////////////////
+// the monotonic clock, so changes to the wall clock never stretch a sleep; signals resume it:
+bool FFVideo_Sleep100ns(int64_t units)
+{
+	if (units <= 0)
+		return true;
+
+	struct timespec req, rem;
+	req.tv_sec = (time_t)(units / 10000000);
+	req.tv_nsec = (long)(units % 10000000) * 100;
+
+	int ret;
+	while ((ret = clock_nanosleep(CLOCK_MONOTONIC, 0, &req, &rem)) == EINTR)
+		req = rem;
+
+	return ret == 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+int FFVideo_Seek64(FILE* fp, int64_t offset, int origin)
+{
+	return fseeko(fp, (off_t)offset, origin);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_SyncFile(FILE* fp)
+{
+	if (fflush(fp) != 0)
+		return false;
+#if defined(__APPLE__)
+	return fsync(fileno(fp)) == 0;
+#else
+	return fdatasync(fileno(fp)) == 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+#ifndef _FFVIDEO_PLATFORM_H_
+#define _FFVIDEO_PLATFORM_H_
+
+
+#include <stdio.h>
+#include <cstdint>
+
+
+// what ffvideolib does differently on Windows & elsewhere. The Windows headers are included only by
+// ffvideo_platform.cpp & the DirectShow backend of ffvideo_USB.cpp, never by the library's headers.
+
+//------------------------------------------------------------------------------
+// the separator appended to export & encode directories:
+#ifdef _WIN32
+#define FFVIDEO_PATH_SEPARATOR	"\\"
+#else
+#define FFVIDEO_PATH_SEPARATOR	"/"
+#endif
+
+//------------------------------------------------------------------------------
+// sleeps the calling thread for units of 100 nanoseconds, so 10 units is 1 millisecond. Windows uses a
+// high resolution waitable timer where available, kept per thread; elsewhere it is clock_nanosleep():
+bool FFVideo_Sleep100ns(int64_t units);
+
+// fseek() beyond 2GB, for archive shards:
+int FFVideo_Seek64(FILE* fp, int64_t offset, int origin);
+
+// flushes & commits a file's data to the storage device:
+bool FFVideo_SyncFile(FILE* fp);
+
+
+
+#endif // _FFVIDEO_PLATFORM_H_
@@ -0,0 +1,685 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#include "ffvideo.h"
+#include "ffvideo_workerPool.h"
+
+#include "stb_image_resize.h"		// for the benchmark, the implementation is in ffvideo_image.cpp
+
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define FFVIDEO_RESIZE_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define FFVIDEO_TARGET_SSE41
+#define FFVIDEO_TARGET_AVX2
+#else
+#define FFVIDEO_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define FFVIDEO_TARGET_AVX2  __attribute__((target("avx2")))
+#endif
+#endif
+
+
+// area filter weights are 14 bit fixed point, horizontally filtered rows keep 7 fractional bits
+// so they fit int16 for the SIMD multiply-adds:
+#define RESIZE_WEIGHT_BITS	(14)
+#define RESIZE_ROW_BITS			(7)
+
+// rows per band below which resizing is not worth another thread:
+#define RESIZE_MIN_BAND_ROWS (64)
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+static int32_t DetectSimdLevel(void)
+{
+#if defined(FFVIDEO_RESIZE_X86) && defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 0);
+	int max_leaf = regs[0];
+
+	__cpuid(regs, 1);
+	bool sse41   = (regs[2] & (1 << 19)) != 0;
+	bool osxsave = (regs[2] & (1 << 27)) != 0;
+	bool avx     = (regs[2] & (1 << 28)) != 0;
+
+	bool avx2 = false;
+	if (max_leaf >= 7 && avx && osxsave && (_xgetbv(0) & 6) == 6)	// the OS saves the YMM registers
+	{
+		__cpuidex(regs, 7, 0);
+		avx2 = (regs[1] & (1 << 5)) != 0;
+	}
+
+	if (avx2)  return FFVideo_Resizer::SIMD_AVX2;
+	if (sse41) return FFVideo_Resizer::SIMD_SSE41;
+#elif defined(FFVIDEO_RESIZE_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))   return FFVideo_Resizer::SIMD_AVX2;
+	if (__builtin_cpu_supports("sse4.1")) return FFVideo_Resizer::SIMD_SSE41;
+#endif
+	return FFVideo_Resizer::SIMD_NONE;
+}
+
+static const int32_t		g_simd_supported = DetectSimdLevel();
+static std::atomic<int32_t> g_simd_level(g_simd_supported);
+
+//////////////////////////////////////////////////////////////////////////////////////
+int32_t FFVideo_Resizer::SimdLevel(void)
+{
+	return g_simd_level;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Resizer::SetSimdLevel(int32_t level)
+{
+	g_simd_level = std::max(0, std::min(level, g_simd_supported));
+}
+
+//------------------------------------------------------------------------------
+// the source span & weights of each output pixel along one axis:
+typedef struct _RESIZE_Taps
+{
+	std::vector<int32_t>	m_start;			// first source pixel
+	std::vector<int32_t>	m_count;			// source pixels contributing
+	std::vector<int32_t>	m_weights;		// m_max_taps per output pixel, each set summing to 1 << RESIZE_WEIGHT_BITS
+	int32_t								m_max_taps = 0;
+} RESIZE_Taps;
+
+//////////////////////////////////////////////////////////////////////////////////////
+// each output pixel averages the source pixels it covers, weighted by how much of each is covered:
+static void AreaTaps(uint32_t src_size, uint32_t dst_size, RESIZE_Taps& taps)
+{
+	double scale = (double)src_size / (double)dst_size;
+
+	taps.m_max_taps = (int32_t)ceil(scale) + 1;
+	taps.m_start.resize(dst_size);
+	taps.m_count.resize(dst_size);
+	taps.m_weights.assign((size_t)dst_size * taps.m_max_taps, 0);
+
+	for (uint32_t i = 0; i < dst_size; i++)
+	{
+		double  f0 = (double)i * scale;
+		double  f1 = std::min(f0 + scale, (double)src_size);
+		int32_t s0 = (int32_t)floor(f0);
+		int32_t s1 = std::min((int32_t)ceil(f1), (int32_t)src_size);
+		int32_t n  = std::max(1, std::min(s1 - s0, taps.m_max_taps));
+
+		int32_t* p_w = &taps.m_weights[(size_t)i * taps.m_max_taps];
+		int32_t  sum = 0, biggest = 0;
+		for (int32_t t = 0; t < n; t++)
+		{
+			double covered = std::min(f1, (double)(s0 + t + 1)) - std::max(f0, (double)(s0 + t));
+			p_w[t] = (int32_t)(covered / (f1 - f0) * (double)(1 << RESIZE_WEIGHT_BITS) + 0.5);
+			sum += p_w[t];
+			if (p_w[t] > p_w[biggest])
+				biggest = t;
+		}
+		// rounding is absorbed by the largest weight, so flat areas stay exactly flat:
+		p_w[biggest] += (1 << RESIZE_WEIGHT_BITS) - sum;
+
+		taps.m_start[i] = s0;
+		taps.m_count[i] = n;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// horizontal pass of one source row into 16 bit, RESIZE_ROW_BITS fractional bits:
+static void AreaRow_C(const uint8_t* p_src, uint16_t* p_row, uint32_t dst_width, uint32_t channels, const RESIZE_Taps& xt)
+{
+	for (uint32_t x = 0; x < dst_width; x++)
+	{
+		const uint8_t* s   = p_src + (size_t)xt.m_start[x] * channels;
+		const int32_t* p_w = &xt.m_weights[(size_t)x * xt.m_max_taps];
+		int32_t        n   = xt.m_count[x];
+
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			int32_t sum = 0;
+			for (int32_t t = 0; t < n; t++)
+				sum += p_w[t] * s[t * channels + c];
+			p_row[x * channels + c] = (uint16_t)((sum + (1 << (RESIZE_WEIGHT_BITS - RESIZE_ROW_BITS - 1))) >> (RESIZE_WEIGHT_BITS - RESIZE_ROW_BITS));
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// vertical pass: weighted sum of n filtered rows into one output row:
+static void AreaCol_C(const uint16_t** pp_rows, const int32_t* p_w, int32_t n, uint8_t* p_dst, uint32_t count)
+{
+	const int32_t shift = RESIZE_WEIGHT_BITS + RESIZE_ROW_BITS;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		int32_t sum = 1 << (shift - 1);
+		for (int32_t t = 0; t < n; t++)
+			sum += p_w[t] * pp_rows[t][i];
+		sum >>= shift;
+		p_dst[i] = (uint8_t)((sum > 255) ? 255 : sum);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// box average of k x k blocks for output rows [y0, y1):
+static void BoxRows_C(const uint8_t* p_src, uint32_t src_stride, uint8_t* p_dst, uint32_t dst_stride,
+											uint32_t dst_width, uint32_t y0, uint32_t y1, uint32_t channels, uint32_t k, std::vector<uint32_t>& colsum)
+{
+	uint32_t row_bytes = dst_width * k * channels;
+	uint64_t area      = (uint64_t)k * k;
+	uint64_t inv       = ((uint64_t)1 << 32) / area + 1;		// (sum * inv) >> 32 == sum / area over 8 bit sums
+
+	colsum.resize(row_bytes);
+
+	for (uint32_t y = y0; y < y1; y++)
+	{
+		const uint8_t* s = p_src + (size_t)y * k * src_stride;
+		std::fill(colsum.begin(), colsum.end(), 0);
+		for (uint32_t ky = 0; ky < k; ky++, s += src_stride)
+		{
+			for (uint32_t i = 0; i < row_bytes; i++)
+				colsum[i] += s[i];
+		}
+
+		uint8_t* d = p_dst + (size_t)y * dst_stride;
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			for (uint32_t c = 0; c < channels; c++)
+			{
+				uint32_t sum = 0;
+				for (uint32_t kx = 0; kx < k; kx++)
+					sum += colsum[(x * k + kx) * channels + c];
+				d[x * channels + c] = (uint8_t)(((uint64_t)(sum + area / 2) * inv) >> 32);
+			}
+		}
+	}
+}
+
+#ifdef FFVIDEO_RESIZE_X86
+
+//////////////////////////////////////////////////////////////////////////////////////
+// 4 channel horizontal pass, two taps at a time: the two pixels' channels are interleaved
+// as 16 bit pairs so one multiply-add applies both weights:
+FFVIDEO_TARGET_SSE41
+static void AreaRow4_SSE41(const uint8_t* p_src, uint16_t* p_row, uint32_t dst_width, const RESIZE_Taps& xt)
+{
+	const __m128i round = _mm_set1_epi32(1 << (RESIZE_WEIGHT_BITS - RESIZE_ROW_BITS - 1));
+	const __m128i pairs = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, -1, -1, -1, -1, -1, -1, -1, -1);
+
+	for (uint32_t x = 0; x < dst_width; x++)
+	{
+		const uint8_t* s   = p_src + (size_t)xt.m_start[x] * 4;
+		const int32_t* p_w = &xt.m_weights[(size_t)x * xt.m_max_taps];
+		int32_t        n   = xt.m_count[x];
+
+		__m128i sum = round;
+		int32_t t = 0;
+		for (; t + 2 <= n; t += 2)
+		{
+			__m128i px = _mm_cvtepu8_epi16(_mm_shuffle_epi8(_mm_loadl_epi64((const __m128i*)(s + t * 4)), pairs));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(px, _mm_set1_epi32((p_w[t + 1] << 16) | p_w[t])));
+		}
+		if (t < n)
+		{
+			// the last odd tap reads only its own pixel, it may end the row:
+			int32_t pixel;
+			memcpy(&pixel, s + t * 4, 4);
+			__m128i px = _mm_cvtepu8_epi16(_mm_shuffle_epi8(_mm_cvtsi32_si128(pixel), pairs));
+			sum = _mm_add_epi32(sum, _mm_madd_epi16(px, _mm_set1_epi32(p_w[t])));
+		}
+		sum = _mm_srli_epi32(sum, RESIZE_WEIGHT_BITS - RESIZE_ROW_BITS);
+		_mm_storel_epi64((__m128i*)(p_row + x * 4), _mm_packus_epi32(sum, sum));
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// vertical pass two rows at a time: the rows' values are interleaved as 16 bit pairs so one
+// multiply-add applies both weights; rows therefore keep only 7 fractional bits, to fit int16:
+FFVIDEO_TARGET_SSE41
+static void AreaCol_SSE41(const uint16_t** pp_rows, const int32_t* p_w, int32_t n, uint8_t* p_dst, uint32_t count)
+{
+	const int32_t shift = RESIZE_WEIGHT_BITS + RESIZE_ROW_BITS;
+	const __m128i round = _mm_set1_epi32(1 << (shift - 1));
+	const __m128i zero  = _mm_setzero_si128();
+
+	uint32_t i = 0;
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i lo = round, hi = round;
+		int32_t t = 0;
+		for (; t < n; t += 2)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(pp_rows[t] + i));
+			__m128i b = (t + 1 < n) ? _mm_loadu_si128((const __m128i*)(pp_rows[t + 1] + i)) : zero;
+			__m128i w = _mm_set1_epi32(((t + 1 < n) ? (p_w[t + 1] << 16) : 0) | p_w[t]);
+			lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w));
+			hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w));
+		}
+		lo = _mm_srai_epi32(lo, shift);
+		hi = _mm_srai_epi32(hi, shift);
+		_mm_storel_epi64((__m128i*)(p_dst + i), _mm_packus_epi16(_mm_packus_epi32(lo, hi), zero));
+	}
+	if (i < count)
+	{
+		const uint16_t* rows[64];
+		for (int32_t t = 0; t < n; t++)
+			rows[t] = pp_rows[t] + i;
+		AreaCol_C(rows, p_w, n, p_dst + i, count - i);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVIDEO_TARGET_AVX2
+static void AreaCol_AVX2(const uint16_t** pp_rows, const int32_t* p_w, int32_t n, uint8_t* p_dst, uint32_t count)
+{
+	const int32_t shift = RESIZE_WEIGHT_BITS + RESIZE_ROW_BITS;
+	const __m256i round = _mm256_set1_epi32(1 << (shift - 1));
+	const __m256i zero  = _mm256_setzero_si256();
+
+	uint32_t i = 0;
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i lo = round, hi = round;
+		int32_t t = 0;
+		for (; t < n; t += 2)
+		{
+			__m256i a = _mm256_loadu_si256((const __m256i*)(pp_rows[t] + i));
+			__m256i b = (t + 1 < n) ? _mm256_loadu_si256((const __m256i*)(pp_rows[t + 1] + i)) : zero;
+			__m256i w = _mm256_set1_epi32(((t + 1 < n) ? (p_w[t + 1] << 16) : 0) | p_w[t]);
+			lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), w));
+			hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), w));
+		}
+		lo = _mm256_srai_epi32(lo, shift);
+		hi = _mm256_srai_epi32(hi, shift);
+		// unpack & pack both work per 128 bit lane, so they undo each other's ordering; lane 0 holds
+		// values 0-7 and lane 1 values 8-15:
+		__m256i words = _mm256_packus_epi32(lo, hi);
+		__m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+		_mm_storeu_si128((__m128i*)(p_dst + i), bytes);
+	}
+	if (i < count)
+	{
+		const uint16_t* rows[64];
+		for (int32_t t = 0; t < n; t++)
+			rows[t] = pp_rows[t] + i;
+		AreaCol_SSE41(rows, p_w, n, p_dst + i, count - i);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// 2x2 box average of 4 channel pixels: pairs are split into even & odd pixels, widened to 16 bit & summed:
+FFVIDEO_TARGET_SSE41
+static void Box2Rows4_SSE41(const uint8_t* p_src, uint32_t src_stride, uint8_t* p_dst, uint32_t dst_stride,
+														uint32_t dst_width, uint32_t y0, uint32_t y1)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i two  = _mm_set1_epi16(2);
+
+	for (uint32_t y = y0; y < y1; y++)
+	{
+		const uint8_t* r0 = p_src + (size_t)y * 2 * src_stride;
+		const uint8_t* r1 = r0 + src_stride;
+		uint8_t*       d  = p_dst + (size_t)y * dst_stride;
+
+		uint32_t x = 0;
+		for (; x + 4 <= dst_width; x += 4)
+		{
+			__m128i sums[2];
+			for (int32_t h = 0; h < 2; h++)
+			{
+				// [p0 p1 p2 p3] -> [p0 p2 p1 p3], so the low half holds even pixels, the high half odd:
+				__m128i a = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(r0 + x * 8 + h * 16)), _MM_SHUFFLE(3, 1, 2, 0));
+				__m128i b = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(r1 + x * 8 + h * 16)), _MM_SHUFFLE(3, 1, 2, 0));
+				__m128i s = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpackhi_epi8(a, zero));
+				s = _mm_add_epi16(s, _mm_unpacklo_epi8(b, zero));
+				s = _mm_add_epi16(s, _mm_unpackhi_epi8(b, zero));
+				sums[h] = _mm_srli_epi16(_mm_add_epi16(s, two), 2);
+			}
+			_mm_storeu_si128((__m128i*)(d + x * 4), _mm_packus_epi16(sums[0], sums[1]));
+		}
+		for (; x < dst_width; x++)
+		{
+			for (uint32_t c = 0; c < 4; c++)
+				d[x * 4 + c] = (uint8_t)((r0[x * 8 + c] + r0[x * 8 + 4 + c] + r1[x * 8 + c] + r1[x * 8 + 4 + c] + 2) >> 2);
+		}
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVIDEO_TARGET_AVX2
+static void Box2Rows4_AVX2(const uint8_t* p_src, uint32_t src_stride, uint8_t* p_dst, uint32_t dst_stride,
+													 uint32_t dst_width, uint32_t y0, uint32_t y1)
+{
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i two  = _mm256_set1_epi16(2);
+
+	for (uint32_t y = y0; y < y1; y++)
+	{
+		const uint8_t* r0 = p_src + (size_t)y * 2 * src_stride;
+		const uint8_t* r1 = r0 + src_stride;
+		uint8_t*       d  = p_dst + (size_t)y * dst_stride;
+
+		uint32_t x = 0;
+		for (; x + 8 <= dst_width; x += 8)
+		{
+			__m256i sums[2];
+			for (int32_t h = 0; h < 2; h++)
+			{
+				__m256i a = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)(r0 + x * 8 + h * 32)), _MM_SHUFFLE(3, 1, 2, 0));
+				__m256i b = _mm256_shuffle_epi32(_mm256_loadu_si256((const __m256i*)(r1 + x * 8 + h * 32)), _MM_SHUFFLE(3, 1, 2, 0));
+				__m256i s = _mm256_add_epi16(_mm256_unpacklo_epi8(a, zero), _mm256_unpackhi_epi8(a, zero));
+				s = _mm256_add_epi16(s, _mm256_unpacklo_epi8(b, zero));
+				s = _mm256_add_epi16(s, _mm256_unpackhi_epi8(b, zero));
+				sums[h] = _mm256_srli_epi16(_mm256_add_epi16(s, two), 2);
+			}
+			// per lane packing leaves pixels [0 1 4 5 | 2 3 6 7], the permute restores the order:
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(sums[0], sums[1]), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)(d + x * 4), packed);
+		}
+		if (x < dst_width)
+			Box2Rows4_SSE41(p_src + x * 8, src_stride, p_dst + x * 4, dst_stride, dst_width - x, y, y + 1);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// k x k box average of 4 channel pixels for k up to 16, where 16 bit column sums cannot overflow.
+// The divide is the same multiply by a 32 bit reciprocal as BoxRows_C(), so results are identical:
+FFVIDEO_TARGET_SSE41
+static void BoxRows4_SSE41(const uint8_t* p_src, uint32_t src_stride, uint8_t* p_dst, uint32_t dst_stride,
+													 uint32_t dst_width, uint32_t y0, uint32_t y1, uint32_t k, std::vector<uint16_t>& colsum)
+{
+	uint32_t row_bytes = dst_width * k * 4;
+	uint32_t area      = k * k;
+	__m128i  half      = _mm_set1_epi32(area / 2);
+	__m128i  inv       = _mm_set1_epi32((int32_t)(uint32_t)(((uint64_t)1 << 32) / area + 1));
+
+	colsum.resize(row_bytes + 8);
+
+	for (uint32_t y = y0; y < y1; y++)
+	{
+		const uint8_t* s = p_src + (size_t)y * k * src_stride;
+		std::fill(colsum.begin(), colsum.end(), 0);
+		for (uint32_t ky = 0; ky < k; ky++, s += src_stride)
+		{
+			uint32_t i = 0;
+			for (; i + 8 <= row_bytes; i += 8)
+			{
+				__m128i c = _mm_loadu_si128((const __m128i*)&colsum[i]);
+				c = _mm_add_epi16(c, _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(s + i))));
+				_mm_storeu_si128((__m128i*)&colsum[i], c);
+			}
+			for (; i < row_bytes; i++)
+				colsum[i] += s[i];
+		}
+
+		uint8_t* d = p_dst + (size_t)y * dst_stride;
+		for (uint32_t x = 0; x < dst_width; x++)
+		{
+			const uint16_t* c   = &colsum[x * k * 4];
+			__m128i         sum = half;
+			for (uint32_t kx = 0; kx < k; kx++)
+				sum = _mm_add_epi32(sum, _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(c + kx * 4))));
+
+			// 32 x 32 -> 64 bit multiplies of the even then odd lanes, keeping the high halves:
+			__m128i even = _mm_srli_epi64(_mm_mul_epu32(sum, inv), 32);
+			__m128i odd  = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(sum, 32), inv), 32);
+			__m128i q    = _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+
+			int32_t out = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(q, q), q));
+			memcpy(d + x * 4, &out, 4);
+		}
+	}
+}
+
+#endif // FFVIDEO_RESIZE_X86
+
+//------------------------------------------------------------------------------
+// everything one band of output rows needs, shared read-only between bands:
+typedef struct _RESIZE_Job
+{
+	const uint8_t*	mp_src = NULL;
+	uint32_t				m_src_width = 0;
+	uint32_t				m_src_height = 0;
+	uint32_t				m_src_stride = 0;
+	uint8_t*				mp_dst = NULL;
+	uint32_t				m_dst_width = 0;
+	uint32_t				m_dst_stride = 0;
+	uint32_t				m_channels = 0;
+	uint32_t				m_box = 0;				// integer factor for box averaging, 0 for the area filter
+	int32_t					m_simd = 0;
+	RESIZE_Taps			m_xtaps;
+	RESIZE_Taps			m_ytaps;
+} RESIZE_Job;
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void ResizeBand(const RESIZE_Job& job, uint32_t y0, uint32_t y1)
+{
+	if (job.m_box)
+	{
+#ifdef FFVIDEO_RESIZE_X86
+		if (job.m_box == 2 && job.m_channels == 4 && job.m_simd >= FFVideo_Resizer::SIMD_SSE41)
+		{
+			if (job.m_simd >= FFVideo_Resizer::SIMD_AVX2)
+				Box2Rows4_AVX2(job.mp_src, job.m_src_stride, job.mp_dst, job.m_dst_stride, job.m_dst_width, y0, y1);
+			else
+				Box2Rows4_SSE41(job.mp_src, job.m_src_stride, job.mp_dst, job.m_dst_stride, job.m_dst_width, y0, y1);
+			return;
+		}
+		if (job.m_box <= 16 && job.m_channels == 4 && job.m_simd >= FFVideo_Resizer::SIMD_SSE41)
+		{
+			static thread_local std::vector<uint16_t> colsum16;
+			BoxRows4_SSE41(job.mp_src, job.m_src_stride, job.mp_dst, job.m_dst_stride, job.m_dst_width, y0, y1, job.m_box, colsum16);
+			return;
+		}
+#endif
+		static thread_local std::vector<uint32_t> colsum;
+		BoxRows_C(job.mp_src, job.m_src_stride, job.mp_dst, job.m_dst_stride, job.m_dst_width, y0, y1, job.m_channels, job.m_box, colsum);
+		return;
+	}
+
+	// source rows are filtered horizontally once each into a ring of m_max_taps rows, as output
+	// rows advance the oldest are replaced. The ring is per thread, so steady use does not allocate:
+	const RESIZE_Taps& yt = job.m_ytaps;
+	int32_t  ring = yt.m_max_taps;
+	uint32_t row_len = job.m_dst_width * job.m_channels;
+
+	static thread_local std::vector<uint16_t> rows;
+	static thread_local std::vector<int32_t>  held;		// the source row each ring slot holds
+	rows.resize((size_t)ring * row_len);
+	held.assign(ring, -1);
+
+	const uint16_t* p_rows[64];
+	for (uint32_t y = y0; y < y1; y++)
+	{
+		int32_t n = yt.m_count[y];
+		for (int32_t t = 0; t < n; t++)
+		{
+			int32_t   sy   = yt.m_start[y] + t;
+			int32_t   slot = sy % ring;
+			uint16_t* r    = &rows[(size_t)slot * row_len];
+			if (held[slot] != sy)
+			{
+				const uint8_t* s = job.mp_src + (size_t)sy * job.m_src_stride;
+#ifdef FFVIDEO_RESIZE_X86
+				if (job.m_channels == 4 && job.m_simd >= FFVideo_Resizer::SIMD_SSE41)
+					AreaRow4_SSE41(s, r, job.m_dst_width, job.m_xtaps);
+				else
+#endif
+					AreaRow_C(s, r, job.m_dst_width, job.m_channels, job.m_xtaps);
+				held[slot] = sy;
+			}
+			p_rows[t] = r;
+		}
+
+		const int32_t* p_w = &yt.m_weights[(size_t)y * yt.m_max_taps];
+		uint8_t*       d   = job.mp_dst + (size_t)y * job.m_dst_stride;
+#ifdef FFVIDEO_RESIZE_X86
+		if (job.m_simd >= FFVideo_Resizer::SIMD_AVX2)
+			AreaCol_AVX2(p_rows, p_w, n, d, row_len);
+		else if (job.m_simd >= FFVideo_Resizer::SIMD_SSE41)
+			AreaCol_SSE41(p_rows, p_w, n, d, row_len);
+		else
+#endif
+			AreaCol_C(p_rows, p_w, n, d, row_len);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Resizer::Resize(const uint8_t* p_src, uint32_t src_width, uint32_t src_height, uint32_t src_stride,
+														 uint8_t* p_dst, uint32_t dst_width, uint32_t dst_height, uint32_t dst_stride,
+														 uint32_t channels, int32_t threads)
+{
+	if (!p_src || !p_dst || src_width < 1 || src_height < 1 || dst_width < 1 || dst_height < 1 || channels < 1 || channels > 4)
+		return false;
+
+	if (src_stride == 0) src_stride = src_width * channels;
+	if (dst_stride == 0) dst_stride = dst_width * channels;
+
+	if (src_width == dst_width && src_height == dst_height)
+	{
+		for (uint32_t y = 0; y < dst_height; y++)
+			memcpy(p_dst + (size_t)y * dst_stride, p_src + (size_t)y * src_stride, (size_t)dst_width * channels);
+		return true;
+	}
+
+	RESIZE_Job job;
+	job.mp_src       = p_src;
+	job.m_src_width  = src_width;
+	job.m_src_height = src_height;
+	job.m_src_stride = src_stride;
+	job.mp_dst       = p_dst;
+	job.m_dst_width  = dst_width;
+	job.m_dst_stride = dst_stride;
+	job.m_channels   = channels;
+	job.m_simd       = g_simd_level;
+
+	// the same whole factor on both axes is a plain box average, otherwise the area filter:
+	if (src_width % dst_width == 0 && src_height % dst_height == 0 && src_width / dst_width == src_height / dst_height)
+		job.m_box = src_width / dst_width;
+	else
+	{
+		// beyond a 1/63 reduction an axis has too many taps, so it is reduced in steps of at most 1/32:
+		uint32_t mid_width  = (src_width  > dst_width  * 63) ? (src_width  + 31) / 32 : dst_width;
+		uint32_t mid_height = (src_height > dst_height * 63) ? (src_height + 31) / 32 : dst_height;
+		if (mid_width != dst_width || mid_height != dst_height)
+		{
+			std::vector<uint8_t> mid((size_t)mid_width * mid_height * channels);
+			return Resize(p_src, src_width, src_height, src_stride, mid.data(), mid_width, mid_height, 0, channels, threads) &&
+						 Resize(mid.data(), mid_width, mid_height, 0, p_dst, dst_width, dst_height, dst_stride, channels, threads);
+		}
+
+		AreaTaps(src_width,  dst_width,  job.m_xtaps);
+		AreaTaps(src_height, dst_height, job.m_ytaps);
+		if (job.m_xtaps.m_max_taps > 64 || job.m_ytaps.m_max_taps > 64)
+			return false;
+	}
+
+	if (threads < 1)
+	{
+		threads = (int32_t)std::thread::hardware_concurrency();
+		threads = std::max(1, std::min(threads, 8));
+	}
+	threads = std::max(1, std::min(threads, (int32_t)(dst_height / RESIZE_MIN_BAND_ROWS)));
+
+	// the bands run on the shared worker pool & this thread:
+	uint32_t band_rows = (dst_height + threads - 1) / threads;
+	FFVideo_WorkerPool::Shared().ParallelFor(threads, [&](int32_t b)
+	{
+		uint32_t y0 = b * band_rows;
+		uint32_t y1 = std::min(dst_height, y0 + band_rows);
+		if (y0 < y1)
+			ResizeBand(job, y0, y1);
+	});
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void AddResizeBenchmark(std::vector<FFVIDEO_Resize_Benchmark>& results, const char* name, float scale,
+															 bool ok, double ms, int32_t iterations, uint64_t src_pixels)
+{
+	FFVIDEO_Resize_Benchmark r;
+	r.m_name  = std::string(name);
+	r.m_scale = scale;
+	r.m_ok    = ok;
+	if (ok)
+	{
+		r.m_ms_per_frame = ms / iterations;
+		r.m_mpix_per_sec = (r.m_ms_per_frame > 0.0) ? (double)src_pixels / (r.m_ms_per_frame * 1000.0) : 0.0;
+	}
+	results.push_back(r);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_Resizer::Benchmark(FFVideo_Image& im, int32_t iterations, std::vector<FFVIDEO_Resize_Benchmark>& results)
+{
+	results.clear();
+
+	if (!im.mp_pixels || iterations < 1 || (im.m_type != 1 && im.m_type != 4))
+		return false;
+
+	const float scales[] = { 0.25f, 0.5f, 0.75f };
+	uint64_t    src_pixels = (uint64_t)im.m_width * im.m_height;
+	int32_t     simd_in_use = SimdLevel();
+
+	std::vector<uint8_t> dst;
+
+	for (int32_t s = 0; s < 3; s++)
+	{
+		float    scale = scales[s];
+		uint32_t dst_width  = std::max(1u, (uint32_t)((float)im.m_width * scale + 0.5f));
+		uint32_t dst_height = std::max(1u, (uint32_t)((float)im.m_height * scale + 0.5f));
+		dst.resize((size_t)dst_width * dst_height * 4);
+
+		for (int32_t level = 0; level <= g_simd_supported; level++)
+		{
+			SetSimdLevel(level);
+			const char* level_name = (level == SIMD_AVX2) ? "avx2" : (level == SIMD_SSE41) ? "sse4.1" : "c";
+
+			for (int32_t mt = 0; mt < 2; mt++)
+			{
+				char name[64];
+				snprintf(name, sizeof(name), "ffvideo %s %s", level_name, (mt) ? "threaded" : "1 thread");
+
+				BCTime timer;
+				bool   ok = true;
+				for (int32_t i = 0; i < iterations && ok; i++)
+					ok = Resize(im.mp_pixels, im.m_width, im.m_height, 0, dst.data(), dst_width, dst_height, 0, 4, (mt) ? 0 : 1);
+				AddResizeBenchmark(results, name, scale, ok, timer.micro() * 0.001, iterations, src_pixels);
+			}
+		}
+		SetSimdLevel(simd_in_use);
+
+		{
+			BCTime timer;
+			bool   ok = true;
+			for (int32_t i = 0; i < iterations && ok; i++)
+				ok = stbir_resize_uint8(im.mp_pixels, im.m_width, im.m_height, 0, dst.data(), dst_width, dst_height, 0, 4) != 0;
+			AddResizeBenchmark(results, "stbir", scale, ok, timer.micro() * 0.001, iterations, src_pixels);
+		}
+
+		const int32_t     sws_flags[] = { SWS_AREA, SWS_BILINEAR };
+		const char* const sws_names[] = { "swscale area", "swscale bilinear" };
+		for (int32_t f = 0; f < 2; f++)
+		{
+			SwsContext* p_sws = sws_getContext(im.m_width, im.m_height, AV_PIX_FMT_RGBA, dst_width, dst_height, AV_PIX_FMT_RGBA,
+																				 sws_flags[f], NULL, NULL, NULL);
+			BCTime timer;
+			bool   ok = (p_sws != NULL);
+			for (int32_t i = 0; i < iterations && ok; i++)
+			{
+				const uint8_t* src_planes[1] = { im.mp_pixels };
+				int            src_strides[1] = { (int)(im.m_width * 4) };
+				uint8_t*       dst_planes[1] = { dst.data() };
+				int            dst_strides[1] = { (int)(dst_width * 4) };
+				ok = sws_scale(p_sws, src_planes, src_strides, 0, im.m_height, dst_planes, dst_strides) > 0;
+			}
+			AddResizeBenchmark(results, sws_names[f], scale, ok, timer.micro() * 0.001, iterations, src_pixels);
+			sws_freeContext(p_sws);
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef _FFVIDEO_RESIZE_H_
+#define _FFVIDEO_RESIZE_H_
+
+
+#include <string>
+#include <vector>
+
+#include "ffvideo_image.h"
+
+
+//------------------------------------------------------------------------------
+// one row of FFVideo_Resizer::Benchmark() results:
+typedef struct _FFVIDEO_Resize_Benchmark
+{
+	std::string	m_name;								// resizer & kernel
+	float				m_scale = 1.0f;
+	bool				m_ok = false;
+	double			m_ms_per_frame = 0.0;
+	double			m_mpix_per_sec = 0.0;		// of source pixels
+} FFVIDEO_Resize_Benchmark;
+
+//------------------------------------------------------------------------------
+// 8 bit image resizing for frame exports & FFVideo_Image::Rescale(). Integer downscale factors
+// are box (area) averaged, other factors use a separable area filter in fixed point. Kernels are
+// SSE4.1 and AVX2 where the CPU supports them, chosen at runtime. Large images are split into
+// bands of rows resized in parallel on FFVideo_WorkerPool::Shared(). Reductions beyond 1/63 are
+// made in steps. Pixels have 1 to 4 interleaved channels:
+class FFVideo_Resizer
+{
+public:
+	enum SIMD_LEVEL { SIMD_NONE = 0, SIMD_SSE41 = 1, SIMD_AVX2 = 2 };
+
+	// resizes into the caller's buffer; strides are bytes per row, 0 for tightly packed.
+	// threads 0 picks a thread count by image size, 1 resizes on the calling thread:
+	static bool Resize(const uint8_t* p_src, uint32_t src_width, uint32_t src_height, uint32_t src_stride,
+										 uint8_t* p_dst, uint32_t dst_width, uint32_t dst_height, uint32_t dst_stride,
+										 uint32_t channels, int32_t threads = 0);
+
+	// the kernels in use; SetSimdLevel() lowers it for comparisons, it cannot exceed what the CPU supports:
+	static int32_t SimdLevel(void);
+	static void		 SetSimdLevel(int32_t level);
+
+	// times this resizer at each SIMD level, single & multi-threaded, stb_image_resize and swscale
+	// downscaling im by 0.25, 0.5 & 0.75. im must be RGBA or BGRA:
+	static bool Benchmark(FFVideo_Image& im, int32_t iterations, std::vector<FFVIDEO_Resize_Benchmark>& results);
+};
+
+
+
+#endif // _FFVIDEO_RESIZE_H_
@@ -2,6 +2,7 @@
 /////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdarg.h>
+#include <algorithm>
 
 #include "ffvideo.h"
 
@@ -27,7 +28,7 @@ bool FFVideo::OpenIPCamera(const std::string& url, int32_t frame_interval)
 		   mp_frameMgr->m_frame_interval = 1;
 	else mp_frameMgr->m_frame_interval = frame_interval;
 
-	// 0=Media, 1=USB, 2=IP
+	// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	mp_frameMgr->m_stream_type = 2;
 
 	m_vid_src = m_ip_url;
@@ -57,7 +58,7 @@ bool FFVideo::OpenUSBCamera(int32_t pin, int32_t frame_interval, FFVIDEO_USB_Cam
 		   mp_frameMgr->m_frame_interval = 1;
 	else mp_frameMgr->m_frame_interval = frame_interval;
 
-	// 0=Media, 1=USB, 2=IP
+	// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	mp_frameMgr->m_stream_type = 1;
 
 	// USB gets m_vid_src set internally, after some logic to figure it out
@@ -83,14 +84,11 @@ bool FFVideo::OpenMediaFile(const std::string& fname,
 		   mp_frameMgr->m_frame_interval = 1;
 	else mp_frameMgr->m_frame_interval = frame_interval;
 
-	// 0=Media, 1=USB, 2=IP
+	// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
 	mp_frameMgr->m_stream_type = 0;
 
-#ifdef WIN32
+	// FFmpeg's file protocol takes the path after "file:" as is, absolute or relative, on every platform:
 	m_vid_src = std::string("file:") + m_media_fname;
-#else
-	m_vid_src = std::string("file://") + m_media_fname;
-#endif
 
 	m_loop_media_file = loop_flag;
 
@@ -99,6 +97,118 @@ bool FFVideo::OpenMediaFile(const std::string& fname,
 	return StartStream(NULL, start_offset);
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+// the source becomes a filter graph, such as
+//   testsrc2=size=1920x1080:rate=60/1,drawtext=text='%{frame_num}':...,trim=end_frame=600,format=yuv420p
+// that StartSynthetic() opens through the lavfi input device:
+bool FFVideo::OpenSyntheticSource(const FFVIDEO_Synthetic_Source& source, int32_t frame_interval)
+{
+	StopStream();
+
+	if (source.m_source.empty() || source.m_width <= 0 || source.m_height <= 0 || source.m_fps <= 0.0)
+	{
+		ReportLog("OpenSyntheticSource: needs a source, a size and a frame rate.");
+		return false;
+	}
+	if (av_get_pix_fmt(source.m_pixel_format.c_str()) == AV_PIX_FMT_NONE)
+	{
+		ReportLog("OpenSyntheticSource: unknown pixel format '%s'.", source.m_pixel_format.c_str());
+		return false;
+	}
+
+	m_synthetic = source;
+
+	if (frame_interval == 0)
+		   m_auto_frame_interval = true;
+	else m_auto_frame_interval = false;
+
+	if (frame_interval <= 0)
+		   mp_frameMgr->m_frame_interval = 1;
+	else mp_frameMgr->m_frame_interval = frame_interval;
+
+	// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
+	mp_frameMgr->m_stream_type = 3;
+
+	// the size & rate follow any options the source has of its own:
+	AVRational rate = av_d2q(source.m_fps, 1001000);
+	char bsjnk[1024];
+	snprintf(bsjnk, sizeof(bsjnk), "%csize=%dx%d:rate=%d/%d",
+		(source.m_source.find('=') == std::string::npos) ? '=' : ':', source.m_width, source.m_height, rate.num, rate.den);
+	m_vid_src = source.m_source + bsjnk;
+
+	if (source.m_frame_counter)
+	{
+		snprintf(bsjnk, sizeof(bsjnk), ",drawtext=text='%%{frame_num}':x=%d:y=%d:fontsize=%d:fontcolor=white:box=1:boxcolor=black@0.6",
+			source.m_height / 40, source.m_height / 40, std::max(source.m_height / 12, 8));
+		m_vid_src += bsjnk;
+
+		if (source.m_font_file.size() > 0)
+		{
+			// quoted for the graph, with its colons escaped for drawtext's options, as in 'C\:/Windows/Fonts/arial.ttf':
+			std::string font_file = source.m_font_file;
+			replaceAll(font_file, "\\", "/");
+			replaceAll(font_file, ":", "\\:");
+			m_vid_src += ":fontfile='" + font_file + "'";
+		}
+	}
+
+	if (source.m_frames > 0)
+	{
+		snprintf(bsjnk, sizeof(bsjnk), ",trim=end_frame=%lld", (long long)source.m_frames);
+		m_vid_src += bsjnk;
+	}
+
+	m_vid_src += ",format=" + source.m_pixel_format;
+
+	m_loop_media_file = false;
+
+	return StartStream(NULL, 0.0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::OpenPacketReplay(const std::string& fname, int32_t frame_interval, const FFVIDEO_Replay_Faults* faults)
+{
+	StopStream();
+
+	m_replay_faults = (faults) ? *faults : FFVIDEO_Replay_Faults();
+
+	if (frame_interval == 0)
+		   m_auto_frame_interval = true;
+	else m_auto_frame_interval = false;
+
+	if (frame_interval <= 0)
+		   mp_frameMgr->m_frame_interval = 1;
+	else mp_frameMgr->m_frame_interval = frame_interval;
+
+	// 0=Media, 1=USB, 2=IP, 3=Synthetic, 4=Replay
+	mp_frameMgr->m_stream_type = 4;
+
+	// StartReplay() reads the recording itself, FFmpeg never opens it:
+	m_vid_src = fname;
+
+	m_loop_media_file = false;
+
+	return StartStream(NULL, 0.0);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::StartPacketRecording(const std::string& fname)
+{
+	if (!IsPlaybackActive() || !mp_video_stream)
+	{
+		ReportLog("StartPacketRecording: a stream must be playing to record it.");
+		return false;
+	}
+
+	if (!m_packet_recorder.Open(fname, mp_video_stream))
+	{
+		ReportLog("StartPacketRecording: unable to record into '%s'.", fname.c_str());
+		return false;
+	}
+
+	return true;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 void FFVideo::Pause()
 {
@@ -235,5 +345,9 @@ void FFVideo::StopStream()
 			 mp_frameMgr->mp_frame_dest->m_frame_exporter.StopExporter();
 	}
 
+	// the encoder finishes on its own: it encodes what's queued, closes its segment file & exits
+	if (mp_frameMgr)
+		 mp_frameMgr->mp_frame_dest->m_frame_encoder.FinishEncoder();
+
 	CloseStream(); // this deletes libav structs 
 }
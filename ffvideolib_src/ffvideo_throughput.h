@@ -0,0 +1,201 @@
+#pragma once
+#ifndef _FFVIDEO_THROUGHPUT_H_
+#define _FFVIDEO_THROUGHPUT_H_
+
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+
+//------------------------------------------------------------------------------
+// what FFVideo::GetThroughputStats() counts as the stream plays:
+enum class FFVIDEO_RATE
+{
+	PACKETS = 0,			// video & other packets read from the stream
+	BYTES,						// their bytes
+	DECODED,					// frames received from the decoder
+	DELIVERED,				// frames passed to the client's display frame callback
+	EXPORTED,					// frames written by frame export
+	COUNT
+};
+
+//------------------------------------------------------------------------------
+// why a packet or frame did not reach the client; a decode bottleneck shows as the decoder's rate
+// falling behind the packets', a consumer bottleneck as CLIENT drops while decoding keeps up:
+enum class FFVIDEO_DROP
+{
+	CORRUPT_PACKET = 0,		// AV_PKT_FLAG_CORRUPT, not decoded
+	DISCARD,							// decoded with AV_FRAME_FLAG_DISCARD
+	SEEK_SKIP,						// decoded after a seek, before its keyframe
+	BAD_FRAME,						// empty, failed filtering, or rows too short to copy
+	FRAME_INTERVAL,				// passed over by the frame interval
+	PAUSED_LIVE,					// a paused live stream's frames are consumed, not shown
+	EXPORT_FAILED,				// frame export failed to encode or write
+	ENCODE_BEHIND,				// the in-process encoder was FFVIDEO_Encode_Params::m_max_queued frames behind
+	CLIENT,								// the client could not keep up, see FFVideo::CountClientDrops()
+	COUNT
+};
+
+//------------------------------------------------------------------------------
+// one counter of FFVIDEO_Throughput_Stats. The rates are per second over the last 1, 10 & 60 whole
+// seconds, or over the whole seconds since playback began when that is shorter:
+typedef struct _FFVIDEO_Rate_Stats
+{
+	const char*	m_name = "";
+	uint64_t		m_total = 0;					// since playback began
+	double			m_rate_1s = 0.0;
+	double			m_rate_10s = 0.0;
+	double			m_rate_60s = 0.0;
+} FFVIDEO_Rate_Stats;
+
+//------------------------------------------------------------------------------
+// returned by FFVideo::GetThroughputStats():
+typedef struct _FFVIDEO_Throughput_Stats
+{
+	FFVIDEO_Rate_Stats	m_rates[(int32_t)FFVIDEO_RATE::COUNT];
+	FFVIDEO_Rate_Stats	m_drops[(int32_t)FFVIDEO_DROP::COUNT];
+	double							m_seconds = 0.0;		// since playback began
+} FFVIDEO_Throughput_Stats;
+
+//------------------------------------------------------------------------------
+// a total & per second counts of the last 64 seconds; Add() is lock free & may be called from any
+// thread. Each slot packs its second, modulo 2^24, above a 40 bit count, so a slot restarts for a
+// new second with the same compare & swap that adds to it:
+class FFVideo_RateCounter
+{
+public:
+	static const int32_t	m_num_slots = 64;
+
+	FFVideo_RateCounter() { Reset(); }
+
+	// 2nd required for for thread constructor
+	FFVideo_RateCounter(const FFVideo_RateCounter& obj) { Reset(); }
+
+	void Add(int64_t second, uint64_t n)
+	{
+		m_total.fetch_add(n, std::memory_order_relaxed);
+
+		std::atomic<uint64_t>& slot = m_slots[second & (m_num_slots - 1)];
+		uint64_t stamp = ((uint64_t)second & m_second_mask) << m_count_bits;
+		uint64_t prev = slot.load(std::memory_order_relaxed);
+		uint64_t next;
+		do
+		{
+			next = ((prev & ~m_count_mask) == stamp) ? prev + n : stamp + n;
+		} while (!slot.compare_exchange_weak(prev, next, std::memory_order_relaxed));
+	}
+
+	// the count of [first, last] seconds, those no longer held count 0:
+	uint64_t Sum(int64_t first, int64_t last) const
+	{
+		uint64_t sum = 0;
+		for (int64_t s = (last - first >= m_num_slots) ? last - m_num_slots + 1 : first; s <= last; s++)
+		{
+			uint64_t v = m_slots[s & (m_num_slots - 1)].load(std::memory_order_relaxed);
+			if ((v & ~m_count_mask) == (((uint64_t)s & m_second_mask) << m_count_bits))
+				sum += v & m_count_mask;
+		}
+		return sum;
+	}
+
+	uint64_t Total(void) const { return m_total.load(std::memory_order_relaxed); }
+
+	void Reset(void)
+	{
+		for (int32_t i = 0; i < m_num_slots; i++)
+			m_slots[i] = 0;
+		m_total = 0;
+	}
+
+private:
+	static const int32_t	m_count_bits = 40;
+	static const uint64_t	m_count_mask = ((uint64_t)1 << m_count_bits) - 1;
+	static const uint64_t	m_second_mask = ((uint64_t)1 << (64 - m_count_bits)) - 1;
+
+	std::atomic<uint64_t>	m_slots[m_num_slots];
+	std::atomic<uint64_t>	m_total;
+};
+
+//------------------------------------------------------------------------------
+// the counters of FFVIDEO_Throughput_Stats, kept by the frame manager:
+class FFVideo_Throughput
+{
+public:
+	FFVideo_Throughput() { Reset(); }
+
+	// 2nd required for for thread constructor
+	FFVideo_Throughput(const FFVideo_Throughput& obj) { Reset(); }
+
+	void Count(FFVIDEO_RATE rate, uint64_t n = 1) { m_rates[(int32_t)rate].Add(Now(), n); }
+	void Drop(FFVIDEO_DROP reason, uint64_t n = 1) { m_drops[(int32_t)reason].Add(Now(), n); }
+
+	void Reset(void)
+	{
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_RATE::COUNT; i++)
+			m_rates[i].Reset();
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_DROP::COUNT; i++)
+			m_drops[i].Reset();
+		m_start = std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+
+	// per second over the last whole seconds, up to window of them:
+	double Rate(FFVIDEO_RATE rate, int32_t window) const { return Rate(m_rates[(int32_t)rate], window); }
+
+	void GetStats(FFVIDEO_Throughput_Stats& stats) const
+	{
+		static const char* rate_names[] = { "packets", "bytes", "decoded", "delivered", "exported" };
+		static const char* drop_names[] = { "corrupt packet", "discard", "seek skip", "bad frame", "frame interval",
+																				"paused live", "export failed", "encode behind", "client" };
+
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_RATE::COUNT; i++)
+			Fill(m_rates[i], rate_names[i], stats.m_rates[i]);
+		for (int32_t i = 0; i < (int32_t)FFVIDEO_DROP::COUNT; i++)
+			Fill(m_drops[i], drop_names[i], stats.m_drops[i]);
+
+		stats.m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start()).count();
+	}
+
+private:
+	static int64_t Now(void)
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	std::chrono::steady_clock::time_point Start(void) const
+	{
+		return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(m_start.load(std::memory_order_relaxed)));
+	}
+
+	double Rate(const FFVideo_RateCounter& counter, int32_t window) const
+	{
+		int64_t now = Now();
+		int64_t began = (int64_t)std::chrono::duration_cast<std::chrono::seconds>(Start().time_since_epoch()).count();
+
+		// the current second is still counting, & the second playback began was partial:
+		int64_t whole = now - began - 1;
+		if (whole > window)
+			whole = window;
+		if (whole < 1)
+			return 0.0;
+
+		return (double)counter.Sum(now - whole, now - 1) / (double)whole;
+	}
+
+	void Fill(const FFVideo_RateCounter& counter, const char* name, FFVIDEO_Rate_Stats& rate) const
+	{
+		rate.m_name = name;
+		rate.m_total = counter.Total();
+		rate.m_rate_1s = Rate(counter, 1);
+		rate.m_rate_10s = Rate(counter, 10);
+		rate.m_rate_60s = Rate(counter, 60);
+	}
+
+	FFVideo_RateCounter										m_rates[(int32_t)FFVIDEO_RATE::COUNT];
+	FFVideo_RateCounter										m_drops[(int32_t)FFVIDEO_DROP::COUNT];
+	std::atomic<std::chrono::steady_clock::rep>	m_start;		// steady_clock ticks, Reset() may race GetStats()
+};
+
+
+
+#endif // _FFVIDEO_THROUGHPUT_H_
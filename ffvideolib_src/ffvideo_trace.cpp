@@ -0,0 +1,263 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <stdio.h>
+#include <map>
+#include <algorithm>
+
+#include "ffvideo.h"
+
+
+// thread names are kept for all tracers, threads are named once as they start:
+static std::mutex														gTraceThreadNamesLock;
+static std::map<std::thread::id, std::string>	gTraceThreadNames;
+
+static std::atomic<uint64_t>									gTraceNextId(1);
+
+// each thread's ring of the tracer it last recorded into:
+typedef struct _FFVIDEO_Trace_Cache
+{
+	uint64_t	m_tracer_id = 0;
+	uint64_t	m_generation = 0;
+	void*			mp_ring = NULL;
+} FFVIDEO_Trace_Cache;
+//
+static thread_local FFVIDEO_Trace_Cache			gTraceCache;
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_Tracer::FFVideo_Tracer() : m_enabled(false), m_id(gTraceNextId++), m_generation(0), m_stream_id(0),
+	m_events_per_thread(8192), m_dropped(0)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_Tracer::~FFVideo_Tracer()
+{
+	m_enabled = false;
+
+	std::lock_guard<std::mutex> lock(m_rings_lock);
+	for (size_t i = 0; i < m_rings.size(); i++)
+		delete m_rings[i];
+	m_rings.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// rings are kept & reused: each is held by the thread that claimed it until the next Enable(), when
+// they are all emptied & threads recording again claim them anew:
+void FFVideo_Tracer::Enable(bool enable, int32_t stream_id, int32_t events_per_thread)
+{
+	if (!enable)
+	{
+		m_enabled = false;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(m_rings_lock);
+
+	m_enabled = false;
+	m_stream_id = stream_id;
+	m_events_per_thread = std::max( events_per_thread, 16 );
+	m_dropped = 0;
+
+	for (size_t i = 0; i < m_rings.size(); i++)
+	{
+		std::lock_guard<std::mutex> ring_lock(m_rings[i]->m_lock);
+		m_rings[i]->m_thread = std::thread::id();
+		m_rings[i]->m_written = 0;
+		m_rings[i]->m_events.resize( m_events_per_thread );
+	}
+	m_generation++;
+	m_enabled = true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_Tracer::FFVIDEO_Trace_Ring* FFVideo_Tracer::ThreadRing(void)
+{
+	uint64_t generation = m_generation.load(std::memory_order_acquire);
+	if (gTraceCache.m_tracer_id == m_id && gTraceCache.m_generation == generation)
+		return (FFVIDEO_Trace_Ring*)gTraceCache.mp_ring;
+
+	std::thread::id self = std::this_thread::get_id();
+	FFVIDEO_Trace_Ring* p_ring = NULL;
+
+	std::lock_guard<std::mutex> lock(m_rings_lock);
+
+	// this thread's from before, else a free one, else a new one:
+	for (size_t i = 0; i < m_rings.size() && !p_ring; i++)
+		if (m_rings[i]->m_thread == self)
+			p_ring = m_rings[i];
+	for (size_t i = 0; i < m_rings.size() && !p_ring; i++)
+		if (m_rings[i]->m_thread == std::thread::id())
+			p_ring = m_rings[i];
+	if (!p_ring && m_rings.size() < (size_t)m_max_threads)
+	{
+		p_ring = new FFVIDEO_Trace_Ring;
+		p_ring->m_events.resize( m_events_per_thread );
+		m_rings.push_back( p_ring );
+	}
+	if (!p_ring)
+		return NULL;
+
+	p_ring->m_thread = self;
+
+	gTraceCache.m_tracer_id = m_id;
+	gTraceCache.m_generation = generation;
+	gTraceCache.mp_ring = p_ring;
+
+	return p_ring;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Tracer::Record(FFVIDEO_Trace_Event& e)
+{
+	FFVIDEO_Trace_Ring* p_ring = ThreadRing();
+	if (!p_ring)
+	{
+		m_dropped++;
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(p_ring->m_lock);
+	if (p_ring->m_events.empty())
+		return;
+	p_ring->m_events[p_ring->m_written % p_ring->m_events.size()] = e;
+	p_ring->m_written++;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Tracer::Complete(const char* cat, const char* name, int64_t start_us, int64_t end_us, int32_t frame_num,
+															const char* value_name, int64_t value)
+{
+	if (!IsEnabled())
+		return;
+
+	FFVIDEO_Trace_Event e;
+	e.m_cat = cat;
+	e.m_name = name;
+	e.m_ts_us = start_us;
+	e.m_dur_us = std::max( end_us - start_us, (int64_t)0 );
+	e.m_frame_num = frame_num;
+	e.m_value_name = value_name;
+	e.m_value = value;
+
+	Record( e );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Tracer::Instant(const char* cat, const char* name, int32_t frame_num, const char* value_name, int64_t value)
+{
+	if (!IsEnabled())
+		return;
+
+	FFVIDEO_Trace_Event e;
+	e.m_cat = cat;
+	e.m_name = name;
+	e.m_ts_us = Now();
+	e.m_dur_us = -1;
+	e.m_frame_num = frame_num;
+	e.m_value_name = value_name;
+	e.m_value = value;
+
+	Record( e );
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_Tracer::NameThread(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(gTraceThreadNamesLock);
+	gTraceThreadNames[std::this_thread::get_id()] = name;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// thread names are the only strings not from the code, so the only ones escaped:
+static std::string TraceEscape(const std::string& s)
+{
+	std::string out;
+	for (size_t i = 0; i < s.size(); i++)
+	{
+		if (s[i] == '"' || s[i] == '\\')
+			out += '\\';
+		if ((unsigned char)s[i] >= 0x20)
+			out += s[i];
+	}
+	return out;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+// the JSON object format of the Chrome trace event format: spans are complete ("X") events, a
+// begin & end in one, so a ring overwriting its oldest events never leaves a begin without its end:
+bool FFVideo_Tracer::WriteJSON(const std::string& path)
+{
+	FILE* fp = fopen(path.c_str(), "wb");
+	if (!fp)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FFVideo_Tracer: unable to create '%s'\n", path.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_rings_lock);
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"ffvideo stream %d\"}}",
+					m_stream_id, m_stream_id);
+
+	std::vector<FFVIDEO_Trace_Event> events;
+	for (size_t r = 0; r < m_rings.size(); r++)
+	{
+		FFVIDEO_Trace_Ring* p_ring = m_rings[r];
+		int32_t tid = (int32_t)r + 1;
+
+		// copied out, so recording waits only for the copy:
+		std::unique_lock<std::mutex> ring_lock(p_ring->m_lock);
+		std::thread::id thread = p_ring->m_thread;
+		size_t size = p_ring->m_events.size();
+		uint64_t written = p_ring->m_written;
+		uint64_t first = (written > size) ? written - size : 0;
+		events.clear();
+		for (uint64_t i = first; i < written; i++)
+			events.push_back( p_ring->m_events[i % size] );
+		ring_lock.unlock();
+
+		if (events.empty())
+			continue;
+
+		std::string name;
+		{
+			std::lock_guard<std::mutex> names_lock(gTraceThreadNamesLock);
+			auto it = gTraceThreadNames.find(thread);
+			if (it != gTraceThreadNames.end())
+				name = it->second;
+		}
+		if (name.empty())
+			name = "thread " + std::to_string(tid);
+		fprintf(fp, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+						m_stream_id, tid, TraceEscape(name).c_str());
+
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			FFVIDEO_Trace_Event& e = events[i];
+
+			fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%lld",
+							e.m_name, e.m_cat, m_stream_id, tid, (long long)e.m_ts_us);
+			if (e.m_dur_us >= 0)
+				fprintf(fp, ",\"ph\":\"X\",\"dur\":%lld", (long long)e.m_dur_us);
+			else fprintf(fp, ",\"ph\":\"i\",\"s\":\"t\"");
+
+			fprintf(fp, ",\"args\":{\"stream\":%d", m_stream_id);
+			if (e.m_frame_num >= 0)
+				fprintf(fp, ",\"frame\":%d", e.m_frame_num);
+			if (e.m_value_name)
+				fprintf(fp, ",\"%s\":%lld", e.m_value_name, (long long)e.m_value);
+			fprintf(fp, "}}");
+		}
+	}
+
+	fprintf(fp, "\n]}\n");
+
+	bool ok = (ferror(fp) == 0);
+	if (fclose(fp) != 0)
+		ok = false;
+
+	return ok;
+}
@@ -0,0 +1,120 @@
+#pragma once
+#ifndef _FFVIDEO_TRACE_H_
+#define _FFVIDEO_TRACE_H_
+
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+
+//------------------------------------------------------------------------------
+// one recorded event, a span when m_dur_us >= 0, else an instant:
+typedef struct _FFVIDEO_Trace_Event
+{
+	const char*	m_cat = NULL;						// static strings only, the tracer keeps the pointers
+	const char*	m_name = NULL;
+	int64_t			m_ts_us = 0;						// FFVideo_Tracer::Now() microseconds
+	int64_t			m_dur_us = -1;
+	int32_t			m_frame_num = -1;				// -1 when not about one frame
+	const char*	m_value_name = NULL;		// an optional named value, also a static string
+	int64_t			m_value = 0;
+} FFVIDEO_Trace_Event;
+
+//------------------------------------------------------------------------------
+// an optional timeline of one FFVideo instance, written as Chrome trace JSON that chrome://tracing &
+// ui.perfetto.dev open. While enabled, each thread recording events gets its own ring of the most recent
+// events_per_thread events, at most m_max_threads rings, so memory stays bounded however long it runs;
+// events of threads beyond that are counted as dropped. Disabled, recording is one relaxed atomic load.
+// Shared, see FFVideo::GetTracer(), so client threads such as face detection record into the same trace:
+class FFVideo_Tracer
+{
+public:
+	static const int32_t	m_max_threads = 64;
+
+	FFVideo_Tracer();
+	~FFVideo_Tracer();
+
+	// enabling clears what was recorded before; disabling keeps it for WriteJSON(). stream_id is the
+	// trace's process id, so traces of several streams can be told apart when opened together:
+	void Enable(bool enable, int32_t stream_id = 0, int32_t events_per_thread = 8192);
+
+	bool IsEnabled(void) const { return m_enabled.load(std::memory_order_relaxed); }
+
+	// microseconds of the steady clock, the time base of every tracer:
+	static int64_t Now(void) { return Microseconds(std::chrono::steady_clock::now()); }
+	static int64_t Microseconds(std::chrono::steady_clock::time_point t)
+	{
+		return (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count();
+	}
+
+	// a span from start_us to end_us; ignored while disabled:
+	void Complete(const char* cat, const char* name, int64_t start_us, int64_t end_us, int32_t frame_num = -1,
+								const char* value_name = NULL, int64_t value = 0);
+
+	void Instant(const char* cat, const char* name, int32_t frame_num = -1, const char* value_name = NULL, int64_t value = 0);
+
+	// names the calling thread in traces, of every tracer; call as a thread starts:
+	static void NameThread(const std::string& name);
+
+	bool WriteJSON(const std::string& path);
+
+	uint64_t GetDropped(void) const { return m_dropped; }
+
+private:
+	// the events of one thread, oldest overwritten first:
+	typedef struct _FFVIDEO_Trace_Ring
+	{
+		std::thread::id										m_thread;
+		std::mutex												m_lock;						// uncontended but while writing JSON
+		std::vector<FFVIDEO_Trace_Event>	m_events;
+		uint64_t													m_written = 0;
+	} FFVIDEO_Trace_Ring;
+
+	FFVIDEO_Trace_Ring* ThreadRing(void);
+	void Record(FFVIDEO_Trace_Event& e);
+
+	std::atomic<bool>									m_enabled;
+	uint64_t													m_id;								// unique per tracer, for each thread's cached ring
+	std::atomic<uint64_t>							m_generation;				// bumped by Enable(), invalidating cached rings
+	int32_t														m_stream_id;
+	int32_t														m_events_per_thread;
+	std::atomic<uint64_t>							m_dropped;
+
+	std::mutex												m_rings_lock;
+	std::vector<FFVIDEO_Trace_Ring*>	m_rings;
+};
+
+//------------------------------------------------------------------------------
+// records the span of a scope when its tracer is enabled at the start of the scope:
+class FFVideo_TraceScope
+{
+public:
+	FFVideo_TraceScope(FFVideo_Tracer* p_tracer, const char* cat, const char* name, int32_t frame_num = -1,
+										 const char* value_name = NULL, int64_t value = 0)
+		: mp_tracer((p_tracer && p_tracer->IsEnabled()) ? p_tracer : NULL), mp_cat(cat), mp_name(name), m_frame_num(frame_num),
+			mp_value_name(value_name), m_value(value), m_start_us((mp_tracer) ? FFVideo_Tracer::Now() : 0) {};
+
+	~FFVideo_TraceScope()
+	{
+		if (mp_tracer)
+			mp_tracer->Complete(mp_cat, mp_name, m_start_us, FFVideo_Tracer::Now(), m_frame_num, mp_value_name, m_value);
+	}
+
+private:
+	FFVideo_Tracer*		mp_tracer;
+	const char*				mp_cat;
+	const char*				mp_name;
+	int32_t						m_frame_num;
+	const char*				mp_value_name;
+	int64_t						m_value;
+	int64_t						m_start_us;
+};
+
+
+
+#endif // _FFVIDEO_TRACE_H_
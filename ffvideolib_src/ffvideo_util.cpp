@@ -3,34 +3,13 @@
 /////////////////////////////////////////////////////////////////////////////
 #include <stdio.h>
 #include <stdarg.h>
+#include <algorithm>
 
 #include "ffvideo.h"
 
+#include <boost/filesystem.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
-////////////////////////////////////////////////////////////////////////////////
-/* Windows sleep in 100ns units */
-BOOLEAN nanosleep(LONGLONG ns) {
-	/* Declarations */
-	HANDLE timer;   /* Timer handle */
-	LARGE_INTEGER li;   /* Time defintion */
-	/* Create timer */
-	if (!(timer = CreateWaitableTimer(NULL, TRUE, NULL)))
-		return FALSE;
-	/* Set timer properties */
-	li.QuadPart = -ns;
-	if (!SetWaitableTimer(timer, &li, 0, NULL, NULL, FALSE)) {
-		CloseHandle(timer);
-		return FALSE;
-	}
-	/* Start & wait for timer */
-	WaitForSingleObject(timer, INFINITE);
-	/* Clean resources */
-	CloseHandle(timer);
-	/* Slept without problems */
-	return TRUE;
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 void FFVideo::ReportLog(const char* formatStr, ...)
 {
@@ -44,10 +23,10 @@ void FFVideo::ReportLog(const char* formatStr, ...)
 	{
 		va_list valist;
 		va_start(valist, formatStr);
-#ifdef WIN32
+#ifdef _WIN32
 		vsprintf_s(buffer, bufsize, formatStr, valist);
 #else
-		vsprintf(buffer, formatStr, valist);
+		vsnprintf(buffer, bufsize, formatStr, valist);
 #endif
 		va_end(valist);
 
@@ -76,7 +55,9 @@ void FFVideo::replaceAll(std::string& str, const std::string& from, const std::s
 void FFVideo::setup_av_options(const char* cam_name, FFVIDEO_USB_Camera_Format* usb_format)
 {
 	// options for all stream types:
-	av_dict_set(&mp_opts, "threads", "auto", 0);						// if multi-threading is needed, do it
+	if (m_decoder_threads > 0)
+		av_dict_set_int(&mp_opts, "threads", m_decoder_threads, 0);	// as the client asked
+	else av_dict_set(&mp_opts, "threads", "auto", 0);							// if multi-threading is needed, do it
 	av_dict_set(&mp_opts, "refcounted_frames", "1", 0);		// ffplay sets this, so we do too
 	av_dict_set(&mp_opts, "sync", "video", 0);
 	av_dict_set(&mp_opts, "fflags", "discardcorrupt", 0);	// works, sets flag in mp_format_context
@@ -97,16 +78,23 @@ void FFVideo::setup_av_options(const char* cam_name, FFVIDEO_USB_Camera_Format*
 			sprintf(bsjnk, "%dx%d", usb_format->m_max_width, usb_format->m_max_height);
 			av_dict_set(&mp_opts, "video_size", bsjnk, 0);
 			//
-			sprintf(bsjnk, "%1.2f", usb_format->m_max_fps);
-			av_dict_set(&mp_opts, "framerate", bsjnk, 0);
+			if (usb_format->m_max_fps > 0.0f)	// Video4Linux2 devices need not report their frame rates
+			{
+				sprintf(bsjnk, "%1.2f", usb_format->m_max_fps);
+				av_dict_set(&mp_opts, "framerate", bsjnk, 0);
+			}
 			//
 			if (usb_format->m_pixelFormat.size() > 0)
 			{
 				av_dict_set(&mp_opts, "pixel_format", usb_format->m_pixelFormat.c_str(), 0);
 			}
-			else if (usb_format->m_pixelFormat.size() > 0)
+			else if (usb_format->m_vcodec.size() > 0)
 			{
+#ifdef _WIN32
 				av_dict_set(&mp_opts, "vcodec", usb_format->m_vcodec.c_str(), 0);
+#else
+				av_dict_set(&mp_opts, "input_format", usb_format->m_vcodec.c_str(), 0);	// Video4Linux2's name for it
+#endif
 			}
 		}
 		else
@@ -121,6 +109,10 @@ void FFVideo::setup_av_options(const char* cam_name, FFVIDEO_USB_Camera_Format*
 		av_dict_set(&mp_opts, "framerate", "29.97", 0);
 		av_dict_set(&mp_opts, "allowed_media_types", "video", 0);
 		break;
+	case 3: // synthetic, its size, rate & pixel format are in its filter graph
+		break;
+	case 4: // packet replay, only the decoder uses these
+		break;
 	}
 
 	// necessary to pre-allocate, so we can set the I/O callback:
@@ -301,33 +293,524 @@ int32_t FFVideo::GetFrameExportingQueueSize(void)
 }
 
 //////////////////////////////////////////////////////////////////////////////////////
-void FFVideo_FrameExporter::Add(FFVideo_Image& im, int32_t frame_num, int32_t export_num)
+bool FFVideo::SetFrameExportFormat(FFVIDEO_Export_Format& format)
 {
-	using namespace boost::posix_time;
-	ptime t = microsec_clock::universal_time();
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->SetFrameExportFormat(format);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameExportFormat(FFVIDEO_Export_Format& format)
+{
+	if (!mp_frameMgr)
+		return;
+
+	format = mp_frameMgr->mp_frame_dest->m_export_format;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::SetFrameExportArchive(bool archive, int32_t shard_mb)
+{
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->SetFrameExportArchive(archive, shard_mb);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameExportArchive(bool& archive, int32_t& shard_mb)
+{
+	if (!mp_frameMgr)
+	{
+		archive = false;
+		shard_mb = 0;
+		return;
+	}
+
+	archive  = mp_frameMgr->mp_frame_dest->m_export_archive;
+	shard_mb = (int32_t)(mp_frameMgr->mp_frame_dest->m_export_shard_bytes / (1024 * 1024));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::SetFrameExportWriters(FFVIDEO_Export_Writer_Params& params)
+{
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->SetFrameExportWriters(params);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameExportWriters(FFVIDEO_Export_Writer_Params& params)
+{
+	if (!mp_frameMgr)
+		return;
+
+	params = mp_frameMgr->mp_frame_dest->m_export_writer_params;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::SetFrameExportNaming(FFVIDEO_Export_Naming& naming)
+{
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->SetFrameExportNaming(naming);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameExportNaming(FFVIDEO_Export_Naming& naming)
+{
+	if (!mp_frameMgr)
+		return;
+
+	naming = mp_frameMgr->mp_frame_dest->m_export_naming;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameExportWriteStats(FFVIDEO_Export_Write_Stats& stats)
+{
+	if (!mp_frameMgr)
+		return;
+
+	mp_frameMgr->mp_frame_dest->m_frame_exporter.m_writer.GetStats(stats);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetPipelineStats(FFVIDEO_Pipeline_Stats& stats)
+{
+	stats = FFVIDEO_Pipeline_Stats();
+
+	if (!mp_frameMgr)
+		return;
+
+	FFVideo_FrameDestination* p_dest = mp_frameMgr->mp_frame_dest;
+
+	for (int32_t i = 0; i < (int32_t)FFVIDEO_PIPELINE_STAGE::COUNT; i++)
+		mp_frameMgr->m_pipeline_stats.Snapshot((FFVIDEO_PIPELINE_STAGE)i, stats.m_stages[i].m_hist);
+
+	// the export writer times encoding & its file writes itself:
+	FFVIDEO_Export_Write_Stats write_stats;
+	p_dest->m_frame_exporter.m_writer.GetStats(write_stats);
+	stats.m_stages[(int32_t)FFVIDEO_PIPELINE_STAGE::EXPORT_ENCODE].m_hist.Merge(write_stats.m_encode);
+	stats.m_stages[(int32_t)FFVIDEO_PIPELINE_STAGE::EXPORT_WRITE].m_hist.Merge(write_stats.m_write);
+
+	for (int32_t i = 0; i < (int32_t)FFVIDEO_PIPELINE_STAGE::COUNT; i++)
+	{
+		FFVIDEO_Stage_Stats& stage = stats.m_stages[i];
+		stage.m_name = FFVideo_PipelineStats::StageName((FFVIDEO_PIPELINE_STAGE)i);
+		stage.m_count = stage.m_hist.m_count;
+		stage.m_p50 = stage.m_hist.Percentile(0.50);
+		stage.m_p95 = stage.m_hist.Percentile(0.95);
+		stage.m_p99 = stage.m_hist.Percentile(0.99);
+		stage.m_max = stage.m_hist.m_max_us;
+		stage.m_mean = stage.m_hist.Mean();
+	}
+
+	stats.m_decoded_waiting = (int32_t)(m_decompress_index - m_display_index);
+	stats.m_export_queued = (int32_t)p_dest->m_frame_exporter.Size();
+	stats.m_export_in_flight = p_dest->m_frame_exporter.m_writer.InFlight();
+	stats.m_encode_queued = (int32_t)p_dest->m_frame_encoder.Size();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::ResetPipelineStats(void)
+{
+	if (!mp_frameMgr)
+		return;
+
+	mp_frameMgr->m_pipeline_stats.Reset();
+	mp_frameMgr->mp_frame_dest->m_frame_exporter.m_writer.ResetStats();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetThroughputStats(FFVIDEO_Throughput_Stats& stats)
+{
+	stats = FFVIDEO_Throughput_Stats();
+
+	if (!mp_frameMgr)
+		return;
+
+	mp_frameMgr->m_throughput.GetStats(stats);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::CountClientDrops(uint32_t n)
+{
+	if (!mp_frameMgr || n == 0)
+		return;
+
+	mp_frameMgr->m_throughput.Drop(FFVIDEO_DROP::CLIENT, n);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::EnableTracing(bool enable, int32_t stream_id, int32_t events_per_thread)
+{
+	if (!mp_frameMgr)
+		return;
+
+	mp_frameMgr->mp_tracer->Enable(enable, stream_id, events_per_thread);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::WriteTrace(const std::string& path)
+{
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->mp_tracer->WriteJSON(path);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+static void AddExportBenchmark(std::vector<FFVIDEO_Export_Benchmark>& formats, const char* name, 
+															 int32_t format, int32_t channels, bool mmap, int32_t png_level, bool webp_lossless)
+{
+	FFVIDEO_Export_Benchmark b;
+	b.m_name = name;
+	b.m_format.m_format = format;
+	b.m_format.m_channels = channels;
+	b.m_format.m_mmap = mmap;
+	b.m_format.m_png_level = png_level;
+	b.m_format.m_webp_lossless = webp_lossless;
+	formats.push_back(b);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::BenchmarkExportFormats(FFVideo_Image& im, std::string& bench_dir, int32_t iterations, 
+																		 std::vector<FFVIDEO_Export_Benchmark>& results)
+{
+	results.clear();
+
+	if (!im.mp_pixels || iterations < 1 || !boost::filesystem::is_directory(boost::filesystem::path(bench_dir)))
+		return false;
+
+	std::vector<FFVIDEO_Export_Benchmark> formats;
 	//
-	std::string iso_part = to_iso_extended_string(t);
+	AddExportBenchmark(formats, "jpg q80",        0, 3, false, 1, false);
+	AddExportBenchmark(formats, "raw rgb",        1, 3, false, 1, false);
+	AddExportBenchmark(formats, "raw gray",       1, 1, false, 1, false);
+	AddExportBenchmark(formats, "raw rgb mmap",   1, 3, true,  1, false);
+	AddExportBenchmark(formats, "npy rgb",        2, 3, false, 1, false);
+	AddExportBenchmark(formats, "npy rgb mmap",   2, 3, true,  1, false);
+	AddExportBenchmark(formats, "png level 0",    3, 3, false, 0, false);
+	AddExportBenchmark(formats, "png level 1",    3, 3, false, 1, false);
+	AddExportBenchmark(formats, "png level 6",    3, 3, false, 6, false);
+	AddExportBenchmark(formats, "webp lossy q80", 4, 3, false, 1, false);
+	AddExportBenchmark(formats, "webp lossless",  4, 3, false, 1, true);
+
+	double mb_per_frame = (double)im.Size() / (1024.0 * 1024.0);
+
+	for (size_t f = 0; f < formats.size(); f++)
+	{
+		FFVIDEO_Export_Benchmark& r = formats[f];
 
-	replaceAll(iso_part, std::string(":"), std::string("-"));
-	replaceAll(iso_part, std::string("."), std::string("-"));
+		std::string fname = bench_dir + std::string(FFVIDEO_PATH_SEPARATOR "ffvideo_bench") + FFVideo_Image::SaveExtension(r.m_format);
 
-  iso_part = std::string("_") + iso_part;
+		// the exporter saves a clone of the delivered frame, so the clone is part of the cost:
+		BCTime   timer;
+		bool     ok = true;
+		uint64_t bytes = 0;
+		for (int32_t i = 0; i < iterations && ok; i++)
+		{
+			FFVideo_Image frame;
+			frame.Clone(im);
+			ok = frame.Save(fname.c_str(), r.m_format, 80, true);
+			if (ok)
+			{
+				boost::system::error_code ec;
+				bytes += boost::filesystem::file_size(boost::filesystem::path(fname), ec);
+			}
+		}
+		double ms = timer.micro() * 0.001;
+
+		boost::system::error_code ec;
+		boost::filesystem::remove(boost::filesystem::path(fname), ec);
+
+		r.m_ok = ok;
+		if (ok)
+		{
+			r.m_ms_per_frame = ms / iterations;
+			r.m_fps = (r.m_ms_per_frame > 0.0) ? 1000.0 / r.m_ms_per_frame : 0.0;
+			r.m_mb_per_sec = mb_per_frame * r.m_fps;
+			r.m_file_bytes = bytes / iterations;
+		}
+		results.push_back(r);
+	}
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::BenchmarkResize(FFVideo_Image& im, int32_t iterations, std::vector<FFVIDEO_Resize_Benchmark>& results)
+{
+	return FFVideo_Resizer::Benchmark(im, iterations, results);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::SetFrameEncodingParams(int32_t encode_interval, FFVIDEO_Encode_Params& params,
+																		 ENCODE_SEGMENT_CALLBACK_CB encode_segment_cb, void* encode_segment_object)
+{
+	if (!mp_frameMgr)
+     return false;
+
+	return mp_frameMgr->SetFrameEncoding(encode_interval, params, encode_segment_cb, encode_segment_object);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo::GetFrameEncodingParams(int32_t& encode_interval, FFVIDEO_Encode_Params& params)
+{
+	if (!mp_frameMgr)
+	{
+		encode_interval = -1;
+		return;
+  }
+	encode_interval = mp_frameMgr->mp_frame_dest->m_frame_encode_interval;
+	params          = mp_frameMgr->mp_frame_dest->m_encode_params;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::GetFrameEncodingError(void)
+{
+	if (!mp_frameMgr)
+		return false;
 
-	std::string outfile = mp_parent->m_export_dir + mp_parent->m_export_base + iso_part;
+	return (mp_frameMgr->mp_frame_dest->m_frame_encode_interval == -1);
+}
 
-	outfile += std::string(".jpg");
+//////////////////////////////////////////////////////////////////////////////////////
+int32_t FFVideo::GetFrameEncodingQueueSize(void)
+{
+	if (!mp_frameMgr)
+		return -1;
+
+	return (int32_t)mp_frameMgr->mp_frame_dest->m_frame_encoder.Size();
+}
 
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo::IsFrameEncodingActive(void)
+{
+	if (!mp_frameMgr)
+		return false;
+
+	return mp_frameMgr->mp_frame_dest->m_frame_encoder.IsRunning();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameExporter::Add(FFVideo_Image& im, int32_t frame_num, int32_t export_num, int64_t pts)
+{
 	FFVideo_ExportFrame ef;
-	ef.m_fname = outfile;
 	ef.m_im.Clone(im);
 	ef.m_frame_num = frame_num;
 	ef.m_export_num = export_num;
+	ef.m_pts = pts;
+
+	// archived frames have no file of their own:
+	if (mp_parent->m_export_archive)
+	{
+		std::unique_lock<std::shared_mutex> lock(m_queue_lock);
+			m_exportQue.push(ef);
+		lock.unlock();
+		return;
+	}
+
+	FFVIDEO_Export_Naming& naming = mp_parent->m_export_naming;
+	FFVIDEO_Export_Format& format = mp_parent->m_export_format;
+	const char*            p_base = mp_parent->m_export_base.c_str();
+
+	// the path is built in place in m_name_buf, only the queued filename is allocated:
+	size_t buf_size = sizeof(m_name_buf);
+	size_t used = (size_t)snprintf(m_name_buf, buf_size, "%s", mp_parent->m_export_dir.c_str());
+
+	if (naming.m_files_per_dir > 0 && used < buf_size)
+	{
+		int32_t shard = ((export_num > 0) ? export_num - 1 : 0) / naming.m_files_per_dir;
+		used += (size_t)snprintf(m_name_buf + used, buf_size - used, "%s_s%03d_r%s_%06d", p_base, naming.m_stream_id, m_run, shard);
+
+		// a shard's subdirectory is created as the first file bound for it is named:
+		if (shard != m_name_shard && used < buf_size)
+		{
+			boost::system::error_code ec;
+			boost::filesystem::create_directory(boost::filesystem::path(m_name_buf), ec);
+			if (ec)
+				av_log(NULL, AV_LOG_ERROR, "FrameExporter: unable to create '%s'\n", m_name_buf);
+			m_name_shard = shard;
+		}
+		if (used < buf_size)
+			used += (size_t)snprintf(m_name_buf + used, buf_size - used, FFVIDEO_PATH_SEPARATOR);
+	}
+
+	if (used >= buf_size || 
+			!FormatName(m_name_buf + used, buf_size - used, naming.m_template.c_str(), p_base, naming.m_stream_id, m_run, frame_num, export_num, pts))
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameExporter: export filename too long, frame %d not exported\n", frame_num);
+		return;
+	}
+	used += strlen(m_name_buf + used);
+
+	// raw pixel dumps have no header, so their dimensions go in the filename:
+	if (format.m_format == 1)
+	{
+		uint32_t width = im.m_width, height = im.m_height;
+		float    scale_factor = mp_parent->m_export_scale;
+		if (scale_factor < 0.9999f)
+		{
+			width  = (uint32_t)((float)width * scale_factor + 0.5f);
+			height = (uint32_t)((float)height * scale_factor + 0.5f);
+		}
+		used += (size_t)snprintf(m_name_buf + used, buf_size - used, "_%ux%u", width, height);
+	}
+
+	if (used < buf_size)
+		used += (size_t)snprintf(m_name_buf + used, buf_size - used, "%s", FFVideo_Image::SaveExtension(format));
+	if (used >= buf_size)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameExporter: export filename too long, frame %d not exported\n", frame_num);
+		return;
+	}
+
+	ef.m_fname.assign(m_name_buf, used);
 
 	std::unique_lock<std::shared_mutex> lock(m_queue_lock);
 		m_exportQue.push(ef);
 	lock.unlock();
 }
 
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameExporter::FormatName(char* p_buf, size_t buf_size, const char* p_template, const char* p_base, 
+																			 int32_t stream_id, const char* p_run, int32_t frame_num, int32_t export_num, int64_t pts)
+{
+	size_t used = 0;
+
+	while (*p_template && used < buf_size)
+	{
+		int32_t written = 0;
+
+		if      (strncmp(p_template, "{base}", 6) == 0)   { written = snprintf(p_buf + used, buf_size - used, "%s", p_base);        p_template += 6; }
+		else if (strncmp(p_template, "{stream}", 8) == 0) { written = snprintf(p_buf + used, buf_size - used, "%03d", stream_id);   p_template += 8; }
+		else if (strncmp(p_template, "{run}", 5) == 0)    { written = snprintf(p_buf + used, buf_size - used, "%s", p_run);         p_template += 5; }
+		else if (strncmp(p_template, "{frame}", 7) == 0)  { written = snprintf(p_buf + used, buf_size - used, "%09d", frame_num);   p_template += 7; }
+		else if (strncmp(p_template, "{export}", 8) == 0) { written = snprintf(p_buf + used, buf_size - used, "%09d", export_num);  p_template += 8; }
+		else if (strncmp(p_template, "{pts}", 5) == 0)
+		{
+			if (pts == AV_NOPTS_VALUE)
+				written = snprintf(p_buf + used, buf_size - used, "none");
+			else
+				written = snprintf(p_buf + used, buf_size - used, "%013lld", (long long)pts);
+			p_template += 5;
+		}
+		else
+		{
+			p_buf[used] = *p_template++;
+			written = 1;
+		}
+
+		if (written < 0)
+			return false;
+		used += (size_t)written;
+	}
+
+	if (used >= buf_size)
+	{
+		p_buf[buf_size - 1] = 0;
+		return false;
+	}
+	p_buf[used] = 0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameExporter::NewRun(void)
+{
+	// ISO 8601 with microseconds, as encoded segments are named, but with no characters paths may not hold:
+	using namespace boost::posix_time;
+	ptime t = microsec_clock::universal_time();
+	//
+	std::string iso_part = to_iso_extended_string(t);
+	std::replace(iso_part.begin(), iso_part.end(), ':', '-');
+	std::replace(iso_part.begin(), iso_part.end(), '.', '-');
+
+	snprintf(m_run, sizeof(m_run), "%s", iso_part.c_str());
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+bool FFVideo_FrameExporter::OpenManifest(void)
+{
+	CloseManifest();
+
+	FFVIDEO_Export_Naming& naming = mp_parent->m_export_naming;
+
+	char path[1024];
+	snprintf(path, sizeof(path), "%s%s_s%03d_manifest.csv", mp_parent->m_export_dir.c_str(), mp_parent->m_export_base.c_str(), naming.m_stream_id);
+
+	// appended to, so exporting the same stream again adds rows; the last row for a frame is the latest:
+	std::lock_guard<std::mutex> lock(m_manifest_lock);
+	mp_manifest = fopen(path, "ab");
+	if (!mp_manifest)
+	{
+		av_log(NULL, AV_LOG_ERROR, "FrameExporter: unable to create manifest '%s'\n", path);
+		return false;
+	}
+
+	fseek(mp_manifest, 0, SEEK_END);
+	if (ftell(mp_manifest) == 0)
+	{
+		fprintf(mp_manifest, "# ffvideo frame export manifest 1\n");
+		fprintf(mp_manifest, "# template=%s\n", naming.m_template.c_str());
+		fprintf(mp_manifest, "# base=%s\n", mp_parent->m_export_base.c_str());
+		fprintf(mp_manifest, "# stream=%03d\n", naming.m_stream_id);
+		fprintf(mp_manifest, "# files_per_dir=%d\n", naming.m_files_per_dir);
+		if (naming.m_files_per_dir > 0)
+			fprintf(mp_manifest, "# subdir=%s_s%03d_r[run]_NNNNNN, NNNNNN = (export - 1) / files_per_dir\n", mp_parent->m_export_base.c_str(), naming.m_stream_id);
+		fprintf(mp_manifest, "# extension=%s\n", FFVideo_Image::SaveExtension(mp_parent->m_export_format));
+		fprintf(mp_manifest, "# pts is in microseconds, empty if unknown; path is relative to this file\n");
+		fprintf(mp_manifest, "frame,export,pts,path\n");
+	}
+	// frame & export numbers restart each run, the rows that follow are this run's:
+	fprintf(mp_manifest, "# run=%s\n", m_run);
+	m_manifest_unflushed = 0;
+
+	return true;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameExporter::AppendManifest(int32_t frame_num, int32_t export_num, int64_t pts, const char* filepath)
+{
+	std::lock_guard<std::mutex> lock(m_manifest_lock);
+	if (!mp_manifest)
+		return;
+
+	// paths are recorded relative to the export directory:
+	size_t dir_len = mp_parent->m_export_dir.size();
+	if (strncmp(filepath, mp_parent->m_export_dir.c_str(), dir_len) == 0)
+		filepath += dir_len;
+
+	if (pts == AV_NOPTS_VALUE)
+		fprintf(mp_manifest, "%d,%d,,%s\n", frame_num, export_num, filepath);
+	else
+		fprintf(mp_manifest, "%d,%d,%lld,%s\n", frame_num, export_num, (long long)pts, filepath);
+
+	// flushed periodically so readers of a live export see recent frames:
+	if (++m_manifest_unflushed >= 64)
+	{
+		fflush(mp_manifest);
+		m_manifest_unflushed = 0;
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_FrameExporter::CloseManifest(void)
+{
+	std::lock_guard<std::mutex> lock(m_manifest_lock);
+	if (mp_manifest)
+	{
+		fclose(mp_manifest);
+		mp_manifest = NULL;
+	}
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////
 // no trailing slash allowed
 int32_t FFVideo_FrameExporter::IsDirectory(const char* path)
@@ -0,0 +1,119 @@
+
+
+/////////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+
+#include "ffvideo_workerPool.h"
+
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_WorkerPool::FFVideo_WorkerPool(int32_t threads) : m_stop(false)
+{
+	if (threads < 1)
+		threads = std::max(1, (int32_t)std::thread::hardware_concurrency() - 1);
+
+	for (int32_t i = 0; i < threads; i++)
+		m_threads.push_back(new std::thread(&FFVideo_WorkerPool::WorkerProcessLoop, this));
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_WorkerPool::~FFVideo_WorkerPool()
+{
+	std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_stop = true;
+	lock.unlock();
+	m_queue_cv.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i]->join();
+		delete m_threads[i];
+	}
+	m_threads.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+FFVideo_WorkerPool& FFVideo_WorkerPool::Shared(void)
+{
+	static FFVideo_WorkerPool pool;
+	return pool;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_WorkerPool::Run(WORKER_BATCH& batch, int32_t i)
+{
+	try
+	{
+		(*batch.mp_task)(i);
+	}
+	catch (...)
+	{
+		std::lock_guard<std::mutex> lock(batch.m_lock);
+		if (!batch.m_error)
+			batch.m_error = std::current_exception();
+	}
+
+	if (batch.m_done.fetch_add(1) + 1 == batch.m_count)
+	{
+		std::lock_guard<std::mutex> lock(batch.m_lock);
+		batch.m_done_cv.notify_all();
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_WorkerPool::ParallelFor(int32_t count, const std::function<void(int32_t)>& task)
+{
+	if (count < 1)
+		return;
+
+	if (count == 1 || m_threads.size() < 1)
+	{
+		for (int32_t i = 0; i < count; i++)
+			task(i);
+		return;
+	}
+
+	std::shared_ptr<WORKER_BATCH> batch = std::make_shared<WORKER_BATCH>();
+	batch->mp_task = &task;
+	batch->m_count = count;
+
+	std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_batchQue.push_back(batch);
+	lock.unlock();
+	m_queue_cv.notify_all();
+
+	// the caller claims items as the pool threads do, until none are left:
+	int32_t i;
+	while ((i = batch->m_next.fetch_add(1)) < count)
+		Run(*batch, i);
+
+	// then waits for those the pool threads claimed:
+	std::unique_lock<std::mutex> done_lock(batch->m_lock);
+	batch->m_done_cv.wait(done_lock, [&] { return batch->m_done == count; });
+
+	if (batch->m_error)
+		std::rethrow_exception(batch->m_error);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void FFVideo_WorkerPool::WorkerProcessLoop(void)
+{
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(m_queue_lock);
+		m_queue_cv.wait(lock, [this] { return m_stop || !m_batchQue.empty(); });
+		if (m_stop)
+			break;
+
+		// a batch leaves the queue once its last item is claimed; its caller may have claimed them
+		// all already, so nothing of a finished batch but its counters is touched:
+		std::shared_ptr<WORKER_BATCH> batch = m_batchQue.front();
+		int32_t i = batch->m_next.fetch_add(1);
+		if (i + 1 >= batch->m_count)
+			m_batchQue.pop_front();
+		lock.unlock();
+
+		if (i < batch->m_count)
+			Run(*batch, i);
+	}
+}
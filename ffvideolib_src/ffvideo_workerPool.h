@@ -0,0 +1,65 @@
+#pragma once
+#ifndef _FFVIDEO_WORKERPOOL_H_
+#define _FFVIDEO_WORKERPOOL_H_
+
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <exception>
+
+
+//------------------------------------------------------------------------------
+// persistent threads for the data parallel work done per frame, resize bands, face detection
+// passes & per face work, so no thread is created per frame. ParallelFor() may be called from
+// any number of threads at once, & from inside a task: the caller works on its own items too,
+// so it always makes progress, even with every pool thread busy with other callers' items:
+class FFVideo_WorkerPool
+{
+public:
+	// threads 0 is one less than the CPU's hardware threads, the caller being the other:
+	FFVideo_WorkerPool(int32_t threads = 0);
+	~FFVideo_WorkerPool();
+
+	// the process wide pool, created on first use:
+	static FFVideo_WorkerPool& Shared(void);
+
+	// calls task(i) for each i in [0, count), returning when all have; the first exception a task
+	// throws is rethrown here, after the others have finished:
+	void ParallelFor(int32_t count, const std::function<void(int32_t)>& task);
+
+	int32_t Threads(void) { return (int32_t)m_threads.size(); }
+
+private:
+	// one ParallelFor() call; items are claimed by index, by the caller & the pool threads:
+	typedef struct _WORKER_BATCH
+	{
+		const std::function<void(int32_t)>*	mp_task = NULL;
+		int32_t															m_count = 0;
+		std::atomic<int32_t>								m_next{ 0 };
+		std::atomic<int32_t>								m_done{ 0 };
+		std::mutex													m_lock;				// for m_done_cv & m_error
+		std::condition_variable							m_done_cv;
+		std::exception_ptr									m_error;
+	} WORKER_BATCH;
+
+	// class sub-thread function, one per pool thread:
+	void WorkerProcessLoop(void);
+
+	static void Run(WORKER_BATCH& batch, int32_t i);
+
+	std::vector<std::thread*>										m_threads;
+	bool																				m_stop;
+	std::mutex																	m_queue_lock;
+	std::condition_variable											m_queue_cv;
+	std::deque<std::shared_ptr<WORKER_BATCH>>		m_batchQue;		// batches with items left to claim
+};
+
+
+
+#endif // _FFVIDEO_WORKERPOOL_H_